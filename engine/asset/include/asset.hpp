@@ -8,6 +8,7 @@
 #include "assetptr.hpp"
 #include "asset_types.hpp"
 #include "string_utils.hpp"
+#include "gfx.hpp"
 
 namespace std {
     template <>
@@ -21,6 +22,9 @@ namespace std {
 template<typename T>
 std::unique_ptr<T> load_asset(const prism::path p);
 
+template<typename T>
+std::vector<std::unique_ptr<T>> load_assets(const std::vector<prism::path>& paths);
+
 template<typename T>
 bool can_load_asset(const prism::path p);
 
@@ -65,6 +69,23 @@ public:
         return AssetPtr<T>(AssetStore<T>::at(path).get(), reference_block);
     }
     
+    /// Loads every asset that isn't loaded yet at once, which is faster than fetching them one by one for some asset types.
+    template<typename T>
+    void load_batch(const std::vector<prism::path>& paths) {
+        std::vector<prism::path> missing_paths;
+        for(const auto& path : paths) {
+            if(!AssetStore<T>::count(path) && !utility::contains(missing_paths, path))
+                missing_paths.push_back(path);
+        }
+        
+        if(missing_paths.empty())
+            return;
+        
+        auto assets = load_assets<T>(missing_paths);
+        for(size_t i = 0; i < missing_paths.size(); i++)
+            AssetStore<T>::try_emplace(missing_paths[i], std::move(assets[i]));
+    }
+    
     std::tuple<Asset*, ReferenceBlock*> load_asset_generic(const prism::path path) {
         Asset* asset = nullptr;
         ReferenceBlock* block = nullptr;
@@ -130,7 +151,28 @@ std::unique_ptr<Mesh> load_mesh(const prism::path path);
 std::unique_ptr<Material> load_material(const prism::path path);
 std::unique_ptr<Texture> load_texture(const prism::path path);
 
-void save_material(Material* material, const prism::path path);
+/// Decodes the textures on the engine's thread pool, then creates them on the gpu from this thread. Textures that fail to load are null.
+std::vector<std::unique_ptr<Texture>> load_textures(const std::vector<prism::path>& paths);
+
+/// Texture data that's been read from disk and decoded, but isn't on the gpu yet.
+struct texture_levels {
+    GFXTextureCreateInfo create_info = {};
+    std::vector<unsigned char> data;
+
+    // if empty, data only contains the first level and the rest are generated on the gpu
+    std::vector<GFXTextureLevel> levels;
+};
+
+/** Reads and decodes the mip levels of a streamable texture, starting from first_level.
+ It only uses what's passed in and doesn't touch the gpu, so it can run on any thread even if the texture is unloaded in the meantime.
+ */
+bool decode_texture_levels(const std::string& path, const prism::texture_header& header, const std::vector<prism::texture_level>& source_levels, int first_level, texture_levels& decoded);
+
+/// Creates a new GPU texture from decoded data. Has to be called on the main thread.
+GFXTexture* upload_texture(texture_levels& decoded);
+
+/// Saves to the binary material format, unless as_json is true. Both formats are loaded by load_material().
+void save_material(Material* material, const prism::path path, bool as_json = false);
 
 template<typename T>
 std::unique_ptr<T> load_asset(const prism::path path) {
@@ -143,6 +185,19 @@ std::unique_ptr<T> load_asset(const prism::path path) {
     }
 }
 
+template<typename T>
+std::vector<std::unique_ptr<T>> load_assets(const std::vector<prism::path>& paths) {
+    if constexpr(std::is_same_v<T, Texture>) {
+        return load_textures(paths);
+    } else {
+        std::vector<std::unique_ptr<T>> assets;
+        for(const auto& path : paths)
+            assets.push_back(load_asset<T>(path));
+        
+        return assets;
+    }
+}
+
 template<typename T>
 bool can_load_asset(const prism::path path) {
     if constexpr(std::is_same_v<T, Mesh>) {
@@ -150,6 +205,6 @@ bool can_load_asset(const prism::path path) {
     } else if constexpr(std::is_same_v<T, Material>) {
         return path.extension() == ".material";
     } else if constexpr(std::is_same_v<T, Texture>) {
-        return path.extension() == ".png";
+        return path.extension() == ".png" || path.extension() == ".texture";
     }
 }
@@ -7,14 +7,30 @@
 #include "material_nodes.hpp"
 #include "aabb.hpp"
 #include "utility.hpp"
+#include "texture_format.hpp"
+#include "gfx_commandbuffer.hpp"
+#include "mesh_optimizer.hpp"
 
 class GFXBuffer;
 class GFXTexture;
+struct texture_streaming_job;
 
 class Texture : public Asset {
 public:    
     GFXTexture* handle = nullptr;
     int width = 0, height = 0;
+
+    // cooked textures are streamed, only the mip levels from resident_level onwards are uploaded
+    bool streamable = false;
+    prism::texture_header header;
+    std::vector<prism::texture_level> levels;
+
+    int resident_level = 0;
+    int requested_level = 0; // the most detailed level requested last frame
+    int next_requested_level = 0; // accumulates requests for the current frame
+
+    // set while a residency change is being read from disk, the job also holds onto it so the texture can be unloaded in the meantime
+    std::shared_ptr<texture_streaming_job> streaming_job;
 };
 
 class GFXPipeline;
@@ -46,6 +62,11 @@ public:
     GFXPipeline* capture_pipeline = nullptr;
 
     std::map<int, AssetPtr<Texture>> bound_textures;
+
+    // constant values are read from here instead of being compiled into the shader, so materials that only differ in them can share pipelines
+    std::vector<prism::float4> parameters;
+    GFXBuffer* parameter_buffer = nullptr;
+    size_t parameter_buffer_size = 0;
 };
 
 constexpr int max_weights_per_vertex = 4;
@@ -59,7 +80,6 @@ struct Bone {
     int index = 0;
 
     std::string name;
-    Matrix4x4 local_transform, final_transform;
 
     Bone* parent = nullptr;
 
@@ -72,6 +92,12 @@ class Mesh : public Asset {
 public:
     // meshes are rendered in parts if we cannot batch it in one call, i.e. a mesh
     // with multiple materials with different textures, etc
+    // a simplified version of a part, it uses the same vertices but fewer indices
+    struct LOD {
+        uint32_t index_offset = 0, index_count = 0;
+        float error = 0.0f; // the furthest the surface moved from the original, in model space
+    };
+
     struct Part {
         std::string name;
         prism::aabb bounding_box;
@@ -81,21 +107,32 @@ public:
         
         uint32_t index_offset = 0, vertex_offset = 0, index_count = 0;
         int32_t material_override = -1;
+
+        // lods[0] is always the full detail part, every level after that is less detailed than the last
+        std::vector<LOD> lods;
+        
+        // clusters of the full detail part that can be culled individually, in model space
+        std::vector<prism::meshlet> meshlets;
     };
 
     std::vector<Part> parts;
     std::vector<Bone> bones;
     Bone* root_bone = nullptr;
+    
+    std::vector<int> bone_parents; // the index of each bone's parent, or -1
+    std::vector<uint32_t> bone_order; // every parent comes before its children, so the skeleton can be evaluated in one pass
 
     // atributes
     GFXBuffer* position_buffer = nullptr;
-    GFXBuffer* normal_buffer = nullptr;
-    GFXBuffer* texture_coord_buffer = nullptr;
-    GFXBuffer* tangent_buffer = nullptr;
-    GFXBuffer* bitangent_buffer = nullptr;
+    GFXBuffer* vertex_buffer = nullptr; // prism::packed_vertex
     GFXBuffer* bone_buffer = nullptr;
     
     GFXBuffer* index_buffer = nullptr;
+    IndexType index_type = IndexType::UINT32;
+    
+    // the least detailed level of every part, kept on the cpu so static meshes can be drawn into the occlusion buffer
+    std::vector<prism::float3> occluder_positions;
+    std::vector<uint32_t> occluder_indices; // a triangle list
     
     Matrix4x4 global_inverse_transformation;
 
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "assetptr.hpp"
 #include "render_options.hpp"
 
@@ -83,7 +86,7 @@ public:
             } else {
                 if(connector.is_normal_map) {
                     if(render_options.enable_normal_mapping) {
-                        return "in_tbn * (2.0 * " + connector.connected_node->get_connector_variable_name(*connector.connected_connector) + " - 1.0)";
+                        return "in_tbn * decode_normal_map(" + connector.connected_node->get_connector_variable_name(*connector.connected_connector) + ")";
                     } else {
                         return "in_normal";
                     }
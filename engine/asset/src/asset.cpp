@@ -2,6 +2,9 @@
 
 #include <map>
 #include <array>
+#include <algorithm>
+#include <limits>
+#include <cstring>
 #include <stb_image.h>
 
 #include "log.hpp"
@@ -14,6 +17,14 @@
 #include "input.hpp"
 #include "physics.hpp"
 #include "imgui_backend.hpp"
+#include "texture_format.hpp"
+#include "block_compression.hpp"
+#include "vertex_format.hpp"
+#include "texturestreaming.hpp"
+#include "render_options.hpp"
+#include "material_format.hpp"
+#include "thread_pool.hpp"
+#include "skeleton.hpp"
 
 std::unique_ptr<Mesh> load_mesh(const prism::path path) {
     Expects(!path.empty());
@@ -27,7 +38,7 @@ std::unique_ptr<Mesh> load_mesh(const prism::path path) {
     int version = 0;
     file->read(&version);
 
-    if(version == 5 || version == 6) {
+    if(version >= 5 && version <= 9) {
     } else {
         prism::log::error(System::Renderer, "{} failed the mesh version check! reported version = {}", path, std::to_string(version));
         return nullptr;
@@ -60,12 +71,32 @@ std::unique_ptr<Mesh> load_mesh(const prism::path path) {
         return buffer;
     };
     
-    // read positions
-    mesh->position_buffer = read_buffer(sizeof(prism::float3));
-    mesh->normal_buffer = read_buffer(sizeof(prism::float3));
-    mesh->texture_coord_buffer = read_buffer(sizeof(prism::float2));
-    mesh->tangent_buffer = read_buffer(sizeof(prism::float3));
-    mesh->bitangent_buffer = read_buffer(sizeof(prism::float3));
+    // read positions, which are also kept around until the occluder is built
+    std::vector<prism::float3> positions(numVertices);
+    file->read(positions.data(), sizeof(prism::float3) * numVertices);
+    
+    mesh->position_buffer = engine->get_gfx()->create_buffer(positions.data(), sizeof(prism::float3) * numVertices, false, GFXBufferUsage::Vertex);
+    
+    if(version >= 7) {
+        mesh->vertex_buffer = read_buffer(sizeof(prism::packed_vertex));
+    } else {
+        // older meshes store each attribute as a separate float stream, so they're packed here instead
+        std::vector<prism::float3> normals(numVertices), tangents(numVertices), bitangents(numVertices);
+        std::vector<prism::float2> texture_coords(numVertices);
+        
+        file->read(normals.data(), sizeof(prism::float3) * numVertices);
+        file->read(texture_coords.data(), sizeof(prism::float2) * numVertices);
+        file->read(tangents.data(), sizeof(prism::float3) * numVertices);
+        file->read(bitangents.data(), sizeof(prism::float3) * numVertices);
+        
+        mesh->vertex_buffer = engine->get_gfx()->create_buffer(nullptr, sizeof(prism::packed_vertex) * numVertices, false, GFXBufferUsage::Vertex);
+        auto vertex_ptr = reinterpret_cast<prism::packed_vertex*>(engine->get_gfx()->get_buffer_contents(mesh->vertex_buffer));
+        
+        for(int i = 0; i < numVertices; i++)
+            vertex_ptr[i] = prism::pack_vertex(normals[i], texture_coords[i], tangents[i], bitangents[i]);
+        
+        engine->get_gfx()->release_buffer_contents(mesh->vertex_buffer, vertex_ptr);
+    }
 
     if(mesh_type == MeshType::Skinned)
         mesh->bone_buffer = read_buffer(sizeof(BoneVertexData));
@@ -75,12 +106,33 @@ std::unique_ptr<Mesh> load_mesh(const prism::path path) {
     
     Expects(numIndices > 0);
     
-    mesh->index_buffer = engine->get_gfx()->create_buffer(nullptr, sizeof(uint32_t) * numIndices, false, GFXBufferUsage::Index);
-    auto index_ptr = reinterpret_cast<uint32_t*>(engine->get_gfx()->get_buffer_contents(mesh->index_buffer));
-
-    file->read(index_ptr, sizeof(uint32_t) * numIndices);
+    int index_size = sizeof(uint32_t);
+    if(version >= 7)
+        file->read(&index_size);
+    
+    Expects(index_size == sizeof(uint16_t) || index_size == sizeof(uint32_t));
+    
+    std::vector<uint8_t> indices(static_cast<size_t>(index_size) * numIndices);
+    file->read(indices.data(), indices.size());
+    
+    // older meshes always use 32-bit indices, even when every index would fit in 16 bits
+    if(version < 7) {
+        const auto old_indices = reinterpret_cast<const uint32_t*>(indices.data());
+        
+        if(*std::max_element(old_indices, old_indices + numIndices) <= std::numeric_limits<uint16_t>::max()) {
+            std::vector<uint8_t> new_indices(sizeof(uint16_t) * numIndices);
+            for(int i = 0; i < numIndices; i++) {
+                const auto index = static_cast<uint16_t>(old_indices[i]);
+                memcpy(new_indices.data() + sizeof(uint16_t) * i, &index, sizeof(uint16_t));
+            }
+            
+            indices = std::move(new_indices);
+            index_size = sizeof(uint16_t);
+        }
+    }
     
-    engine->get_gfx()->release_buffer_contents(mesh->index_buffer, index_ptr);
+    mesh->index_type = index_size == sizeof(uint16_t) ? IndexType::UINT16 : IndexType::UINT32;
+    mesh->index_buffer = engine->get_gfx()->create_buffer(indices.data(), indices.size(), false, GFXBufferUsage::Index);
 
     int bone_len = 0;
     file->read(&bone_len);
@@ -126,10 +178,13 @@ std::unique_ptr<Mesh> load_mesh(const prism::path path) {
             }
         }
         
+        mesh->bone_parents.resize(mesh->bones.size(), -1);
+        
         for(auto& [index, parentName] : parentQueue) {
-            for(auto& bone : mesh->bones) {
-                if(bone.name == parentName)
-                    mesh->bones[index].parent = &bone;
+            const auto parent = boneMapping.find(parentName);
+            if(parent != boneMapping.end()) {
+                mesh->bones[index].parent = &mesh->bones[parent->second];
+                mesh->bone_parents[index] = static_cast<int>(parent->second);
             }
         }
         
@@ -137,6 +192,8 @@ std::unique_ptr<Mesh> load_mesh(const prism::path path) {
             if(bone.parent == nullptr)
                 mesh->root_bone = &bone;
         }
+        
+        mesh->bone_order = prism::sort_bone_hierarchy(mesh->bone_parents);
     }
     
     int numMeshes = 0;
@@ -154,7 +211,7 @@ std::unique_ptr<Mesh> load_mesh(const prism::path path) {
 
         file->read_string(p.name);
         
-        if(version == 6) {
+        if(version >= 6) {
             file->read(&p.bounding_box);
         }
         
@@ -175,107 +232,411 @@ std::unique_ptr<Mesh> load_mesh(const prism::path path) {
         }
 
         file->read(&p.material_override);
+        
+        p.lods.push_back({p.index_offset, p.index_count, 0.0f});
+        
+        if(version >= 8) {
+            int numLods = 0;
+            file->read(&numLods);
+            
+            for(int l = 0; l < numLods; l++) {
+                Mesh::LOD lod;
+                file->read(&lod.index_offset);
+                file->read(&lod.index_count);
+                file->read(&lod.error);
+                
+                p.lods.push_back(lod);
+            }
+        }
+        
+        if(version >= 9) {
+            int numMeshlets = 0;
+            file->read(&numMeshlets);
+            
+            p.meshlets.resize(numMeshlets);
+            file->read(p.meshlets.data(), sizeof(prism::meshlet) * numMeshlets);
+        }
 
         vertexOffset += numVerts;
         indexOffset += p.index_count;
     }
 
-    mesh->num_indices = static_cast<uint32_t>(numIndices);
+    // lod indices are stored after every part, and shouldn't be drawn when rendering the entire mesh
+    mesh->num_indices = indexOffset;
+    
+    // skinned meshes move away from their bind pose, so they can't be trusted to hide anything
+    if(mesh_type == MeshType::Static) {
+        std::vector<uint32_t> remap(numVertices, std::numeric_limits<uint32_t>::max());
+        
+        for(const auto& part : mesh->parts) {
+            // simplifying can close doorways and windows, which would hide whatever is visible through them. so only levels
+            // that barely moved from the full detail part are used, relative to the size of the part
+            const auto extent = part.bounding_box.max - part.bounding_box.min;
+            const float max_error = std::max({extent.x, extent.y, extent.z}) * 0.001f;
+            
+            // every level is less detailed than the last, so this is the cheapest one that's still close enough
+            auto lod = part.lods.front();
+            for(const auto& candidate : part.lods) {
+                if(candidate.error > max_error)
+                    break;
+                
+                lod = candidate;
+            }
+            
+            for(uint32_t i = 0; i < lod.index_count; i++) {
+                uint32_t index = 0;
+                if(index_size == sizeof(uint16_t)) {
+                    uint16_t short_index = 0;
+                    memcpy(&short_index, indices.data() + sizeof(uint16_t) * (lod.index_offset + i), sizeof(uint16_t));
+                    index = short_index;
+                } else {
+                    memcpy(&index, indices.data() + sizeof(uint32_t) * (lod.index_offset + i), sizeof(uint32_t));
+                }
+                
+                index += part.vertex_offset;
+                Expects(index < static_cast<uint32_t>(numVertices));
+                
+                if(remap[index] == std::numeric_limits<uint32_t>::max()) {
+                    remap[index] = static_cast<uint32_t>(mesh->occluder_positions.size());
+                    mesh->occluder_positions.push_back(positions[index]);
+                }
+                
+                mesh->occluder_indices.push_back(remap[index]);
+            }
+        }
+    }
 
     return mesh;
 }
 
-std::unique_ptr<Texture> load_texture(const prism::path path) {
-    Expects(!path.empty());
-    
+GFXPixelFormat get_pixel_format(const prism::texture_format format) {
+    switch(format) {
+        case prism::texture_format::rgba8:
+            return GFXPixelFormat::R8G8B8A8_UNORM;
+        case prism::texture_format::bc1:
+            return GFXPixelFormat::BC1_UNORM;
+        case prism::texture_format::bc3:
+            return GFXPixelFormat::BC3_UNORM;
+        case prism::texture_format::bc4:
+            return GFXPixelFormat::BC4_UNORM;
+        case prism::texture_format::bc5:
+            return GFXPixelFormat::BC5_UNORM;
+        case prism::texture_format::bc7:
+            return GFXPixelFormat::BC7_UNORM;
+    }
+
+    return GFXPixelFormat::R8G8B8A8_UNORM;
+}
+
+bool decode_texture_levels(const std::string& path, const prism::texture_header& header, const std::vector<prism::texture_level>& source_levels, const int first_level, texture_levels& decoded) {
+    Expects(first_level >= 0 && first_level < static_cast<int>(source_levels.size()));
+
     auto file = prism::open_file(path, true);
     if(!file.has_value()) {
-        prism::log::error(System::Renderer, "Failed to load texture from {}!", path);
-        return nullptr;
+        prism::log::error(System::Renderer, "Failed to stream texture from {}!", path);
+        return false;
     }
-    
-    // TODO: expose somehow??
-    const bool should_generate_mipmaps = true;
 
-    file->read_all();
+    // levels are stored from most to least detailed, so everything from first_level onwards is one contiguous read
+    const uint64_t data_offset = source_levels[first_level].offset;
 
-    int width, height, channels;
-    unsigned char* data = stbi_load_from_memory(file->cast_data<unsigned char>(), file->size(), &width, &height, &channels, 4);
-    if(!data) {
-        prism::log::error(System::Renderer, "Failed to load texture from {}!", path);
-        return nullptr;
+    uint64_t data_size = 0;
+    std::vector<GFXTextureLevel> levels;
+    for(uint32_t i = first_level; i < header.mip_count; i++) {
+        GFXTextureLevel level;
+        level.level = i - first_level;
+        level.offset = source_levels[i].offset - data_offset;
+        level.size = source_levels[i].size;
+
+        data_size = std::max(data_size, level.offset + level.size);
+
+        levels.push_back(level);
     }
-    
-    Expects(width > 0);
-    Expects(height > 0);
-    
-    auto texture = std::make_unique<Texture>();
-    texture->path = path.string();
-    texture->width = width;
-    texture->height = height;
-    
-    GFXTextureCreateInfo createInfo = {};
-    createInfo.label = path.string();
-    createInfo.width = width;
-    createInfo.height = height;
-    createInfo.format = GFXPixelFormat::R8G8B8A8_UNORM;
-    createInfo.usage = GFXTextureUsage::Sampled;
-    
-    if(should_generate_mipmaps)
-        createInfo.mip_count = std::floor(std::log2(std::max(width, height))) + 1;
-    
-    texture->handle = engine->get_gfx()->create_texture(createInfo);
 
-    engine->get_gfx()->copy_texture(texture->handle, data, width * height * 4);
-    
-    if(createInfo.mip_count > 1) {
-        GFXCommandBuffer* cmd_buf = engine->get_gfx()->acquire_command_buffer();
-        
-        
-        cmd_buf->generate_mipmaps(texture->handle, createInfo.mip_count);
-        
-        engine->get_gfx()->submit(cmd_buf);
+    std::vector<unsigned char> data(data_size);
+    file->seek(data_offset);
+    file->read(data.data(), data_size);
+
+    auto format = header.format;
+
+    // fall back to decoding on the cpu if the gpu can't sample block compressed formats
+    if(prism::is_block_compressed(format) && !engine->get_gfx()->supports_feature(GFXFeature::BlockCompression)) {
+        std::vector<unsigned char> decoded_data;
+        for(auto& level : levels) {
+            const uint32_t level_width = prism::calculate_mip_extent(header.width, first_level + level.level);
+            const uint32_t level_height = prism::calculate_mip_extent(header.height, first_level + level.level);
+
+            const GFXSize decoded_offset = decoded_data.size();
+            decoded_data.resize(decoded_offset + prism::calculate_level_size(prism::texture_format::rgba8, level_width, level_height));
+
+            prism::decompress_blocks(format, data.data() + level.offset, level_width, level_height, decoded_data.data() + decoded_offset);
+
+            level.offset = decoded_offset;
+            level.size = decoded_data.size() - decoded_offset;
+        }
+
+        data = std::move(decoded_data);
+        format = prism::texture_format::rgba8;
     }
 
-    stbi_image_free(data);
+    decoded.create_info.label = path;
+    decoded.create_info.width = prism::calculate_mip_extent(header.width, first_level);
+    decoded.create_info.height = prism::calculate_mip_extent(header.height, first_level);
+    decoded.create_info.format = get_pixel_format(format);
+    decoded.create_info.usage = GFXTextureUsage::Sampled;
+    decoded.create_info.mip_count = header.mip_count - first_level;
+
+    decoded.data = std::move(data);
+    decoded.levels = std::move(levels);
 
-    return texture;
+    return true;
 }
 
-std::unique_ptr<Material> load_material(const prism::path path) {
-    Expects(!path.empty());
-    
-    auto file = prism::open_file(path);
-    if(!file.has_value()) {
-        prism::log::error(System::Core, "Failed to load material from {}!", path);
-        return {};
+GFXTexture* upload_texture(texture_levels& decoded) {
+    auto handle = engine->get_gfx()->create_texture(decoded.create_info);
+
+    if(!decoded.levels.empty()) {
+        engine->get_gfx()->copy_texture(handle, decoded.data.data(), decoded.data.size(), decoded.levels);
+    } else {
+        engine->get_gfx()->copy_texture(handle, decoded.data.data(), decoded.data.size());
+
+        if(decoded.create_info.mip_count > 1) {
+            GFXCommandBuffer* cmd_buf = engine->get_gfx()->acquire_command_buffer();
+
+            cmd_buf->generate_mipmaps(handle, decoded.create_info.mip_count);
+
+            engine->get_gfx()->submit(cmd_buf);
+        }
     }
-    
-    nlohmann::json j;
-    file->read_as_stream() >> j;
 
-    auto mat = std::make_unique<Material>();
-    mat->path = path.string();
-    
-    if(!j.count("version") || j["version"] != 2) {
-        prism::log::error(System::Core, "Material {} failed the version check!", path);
-        return mat;
+    return handle;
+}
+
+namespace {
+    /// Everything needed to create a texture on the gpu, decoding fills this in without touching the gpu so it can run on worker threads.
+    struct decoded_texture : texture_levels {
+        std::unique_ptr<Texture> texture;
+    };
+
+    // cooked textures are streamed, so only the smallest levels are decoded at first and the rest are left on disk
+    std::optional<decoded_texture> decode_cooked_texture(const prism::path path, prism::file& file) {
+        prism::texture_header header;
+        file.read(&header);
+
+        if(!prism::is_valid_texture_header(header)) {
+            prism::log::error(System::Renderer, "{} failed the texture header check!", path);
+            return std::nullopt;
+        }
+
+        decoded_texture decoded;
+        decoded.texture = std::make_unique<Texture>();
+
+        auto& texture = *decoded.texture;
+        texture.path = path.string();
+        texture.width = header.width;
+        texture.height = header.height;
+        texture.streamable = true;
+        texture.header = header;
+
+        texture.levels.resize(header.mip_count);
+        file.read(texture.levels.data(), sizeof(prism::texture_level) * header.mip_count);
+
+        // the levels are read from these offsets again whenever the texture streams in, so a truncated or corrupt file has to be caught here
+        if(!prism::are_valid_texture_levels(header, texture.levels.data(), file.size_on_disk())) {
+            prism::log::error(System::Renderer, "{} has mip levels outside of the file!", path);
+            return std::nullopt;
+        }
+
+        const int last_level = static_cast<int>(header.mip_count) - 1;
+        texture.resident_level = render_options.enable_texture_streaming ? get_initial_texture_level(texture) : 0;
+        texture.requested_level = last_level;
+        texture.next_requested_level = last_level;
+
+        if(!decode_texture_levels(texture.path, texture.header, texture.levels, texture.resident_level, decoded))
+            return std::nullopt;
+
+        return decoded;
     }
-    
+
+    std::optional<decoded_texture> decode_texture(const prism::path path) {
+        Expects(!path.empty());
+
+        auto file = prism::open_file(path, true);
+        if(!file.has_value()) {
+            prism::log::error(System::Renderer, "Failed to load texture from {}!", path);
+            return std::nullopt;
+        }
+
+        if(path.extension() == ".texture")
+            return decode_cooked_texture(path, *file);
+
+        // TODO: expose somehow??
+        const bool should_generate_mipmaps = true;
+
+        file->read_all();
+
+        int width, height, channels;
+        unsigned char* data = stbi_load_from_memory(file->cast_data<unsigned char>(), file->size(), &width, &height, &channels, 4);
+        if(!data) {
+            prism::log::error(System::Renderer, "Failed to load texture from {}!", path);
+            return std::nullopt;
+        }
+
+        Expects(width > 0);
+        Expects(height > 0);
+
+        decoded_texture decoded;
+        decoded.texture = std::make_unique<Texture>();
+        decoded.texture->path = path.string();
+        decoded.texture->width = width;
+        decoded.texture->height = height;
+
+        decoded.create_info.label = path.string();
+        decoded.create_info.width = width;
+        decoded.create_info.height = height;
+        decoded.create_info.format = GFXPixelFormat::R8G8B8A8_UNORM;
+        decoded.create_info.usage = GFXTextureUsage::Sampled;
+
+        if(should_generate_mipmaps)
+            decoded.create_info.mip_count = std::floor(std::log2(std::max(width, height))) + 1;
+
+        decoded.data.assign(data, data + width * height * 4);
+
+        stbi_image_free(data);
+
+        return decoded;
+    }
+
+    std::unique_ptr<Texture> upload_decoded_texture(decoded_texture& decoded) {
+        decoded.texture->handle = upload_texture(decoded);
+        if(decoded.texture->handle == nullptr)
+            return nullptr;
+
+        return std::move(decoded.texture);
+    }
+}
+
+std::unique_ptr<Texture> load_texture(const prism::path path) {
+    auto decoded = decode_texture(path);
+    if(!decoded.has_value())
+        return nullptr;
+
+    return upload_decoded_texture(*decoded);
+}
+
+std::vector<std::unique_ptr<Texture>> load_textures(const std::vector<prism::path>& paths) {
+    // decoding (and reading from disk) is the slow part, only creating the gpu textures has to stay on this thread
+    std::vector<std::optional<decoded_texture>> decoded(paths.size());
+    engine->get_thread_pool()->parallel_for(static_cast<uint32_t>(paths.size()), [&paths, &decoded](const uint32_t i) {
+        decoded[i] = decode_texture(paths[i]);
+    });
+
+    std::vector<std::unique_ptr<Texture>> textures(paths.size());
+    for(size_t i = 0; i < paths.size(); i++) {
+        if(decoded[i].has_value())
+            textures[i] = upload_decoded_texture(*decoded[i]);
+    }
+
+    return textures;
+}
+
+std::unique_ptr<MaterialNode> create_material_node(const std::string_view name) {
+    if(name == "Material Output") {
+        return std::make_unique<MaterialOutput>();
+    } else if(name == "Texture") {
+        return std::make_unique<TextureNode>();
+    } else if(name == "Float Constant") {
+        return std::make_unique<FloatConstant>();
+    } else if(name == "Vector3 Constant") {
+        return std::make_unique<Vector3Constant>();
+    }
+
+    return nullptr;
+}
+
+// textures referenced by a material are collected first, so they can all be loaded at once
+using material_texture_list = std::vector<std::pair<MaterialProperty*, prism::path>>;
+
+bool load_binary_material(Material& mat, prism::file& file, material_texture_list& textures) {
+    const auto data = file.cast_data<std::byte>();
+
+    const auto material_file = prism::read_material_file(data, file.size());
+    if(!material_file.has_value())
+        return false;
+
+    // nodes that fail to load still take up their index, so connections don't have to be shifted
+    std::vector<MaterialNode*> nodes(material_file->nodes.size());
+
+    size_t property_offset = 0;
+    for(const auto [i, node] : utility::enumerate(material_file->nodes)) {
+        const auto name = material_file->get_string(node.name);
+
+        const size_t first_property = property_offset;
+        property_offset += node.property_count;
+
+        auto n = create_material_node(name);
+        if(n == nullptr) {
+            prism::log::error(System::Core, "Unknown material node {} in {}!", std::string(name), mat.path);
+            continue;
+        }
+
+        n->x = node.x;
+        n->y = node.y;
+
+        // properties are stored in the order the node declares them
+        for(uint32_t p = 0; p < node.property_count && p < n->properties.size(); p++) {
+            const auto& property = material_file->properties[first_property + p];
+
+            n->properties[p].value = property.value;
+            n->properties[p].float_value = property.float_value;
+
+            const auto texture = material_file->get_string(property.texture);
+            if(!texture.empty())
+                textures.emplace_back(&n->properties[p], prism::app_domain / std::string(texture));
+        }
+
+        nodes[i] = n.get();
+
+        mat.nodes.emplace_back(std::move(n));
+    }
+
+    for(const auto& connection : material_file->connections) {
+        auto output_node = nodes[connection.output_node];
+        auto input_node = nodes[connection.input_node];
+
+        if(output_node == nullptr || input_node == nullptr || connection.output >= output_node->outputs.size() || connection.input >= input_node->inputs.size())
+            continue;
+
+        auto& output = output_node->outputs[connection.output];
+        auto& input = input_node->inputs[connection.input];
+
+        output.connected_node = input_node;
+        output.connected_connector = &input;
+        output.connected_index = connection.output;
+
+        input.connected_node = output_node;
+        input.connected_connector = &output;
+        input.connected_index = connection.output;
+    }
+
+    return true;
+}
+
+bool load_json_material(Material& mat, prism::file& file, material_texture_list& textures) {
+    nlohmann::json j = nlohmann::json::parse(file.cast_data<char>(), file.cast_data<char>() + file.size(), nullptr, false);
+
+    if(j.is_discarded() || !j.count("version") || j["version"] != 2)
+        return false;
+
+    std::unordered_map<int, MaterialNode*> nodes_by_id;
+
     for(auto node : j["nodes"]) {
-        std::unique_ptr<MaterialNode> n;
-        
-        auto name = node["name"];
-        if(name == "Material Output") {
-            n = std::make_unique<MaterialOutput>();
-        } else if(name == "Texture") {
-            n = std::make_unique<TextureNode>();
-        } else if(name == "Float Constant") {
-            n = std::make_unique<FloatConstant>();
-        }  else if(name == "Vector3 Constant") {
-            n = std::make_unique<Vector3Constant>();
+        auto n = create_material_node(node["name"].get<std::string>());
+        if(n == nullptr) {
+            prism::log::error(System::Core, "Unknown material node {} in {}!", node["name"].get<std::string>(), mat.path);
+            continue;
         }
-        
+
         n->id = node["id"];
         n->x = node["x"];
         n->y = node["y"];
@@ -286,40 +647,39 @@ std::unique_ptr<Material> load_material(const prism::path path) {
                     p.value = property["value"];
                     p.float_value = property["float_value"];
                     
-                    if(!property["asset_value"].get<std::string>().empty()) {
-                        p.value_tex = assetm->get<Texture>(prism::app_domain / property["asset_value"].get<std::string>());
-                    }
+                    if(!property["asset_value"].get<std::string>().empty())
+                        textures.emplace_back(&p, prism::app_domain / property["asset_value"].get<std::string>());
                 }
             }
         }
-        
-        mat->nodes.emplace_back(std::move(n));
+
+        nodes_by_id[n->id] = n.get();
+
+        mat.nodes.emplace_back(std::move(n));
     }
 
     for(auto node : j["nodes"]) {
-        MaterialNode* n = nullptr;
-        for(auto& nn : mat->nodes) {
-            if(nn->id == node["id"])
-                n = nn.get();
-        }
-        
-        if(n == nullptr)
+        const auto node_iter = nodes_by_id.find(node["id"].get<int>());
+        if(node_iter == nodes_by_id.end())
             continue;
-        
+
+        auto n = node_iter->second;
+
         for(auto connection : node["connections"]) {
             for(auto [i, output] : utility::enumerate(n->outputs)) {
                 if(connection["name"] == output.name) {
-                    for(auto& nn : mat->nodes) {
-                        if(nn->id == connection["connected_node"]) {                            
-                            output.connected_node = nn.get();
-                            
-                            auto connector = nn->find_connector(connection["connected_connector"]);
-                            output.connected_connector = connector;
-                            
-                            connector->connected_index = i;
-                            connector->connected_node = n;
-                            connector->connected_connector = &output;
-                        }
+                    const auto connected_iter = nodes_by_id.find(connection["connected_node"].get<int>());
+                    if(connected_iter != nodes_by_id.end()) {
+                        auto nn = connected_iter->second;
+
+                        output.connected_node = nn;
+
+                        auto connector = nn->find_connector(connection["connected_connector"]);
+                        output.connected_connector = connector;
+
+                        connector->connected_index = i;
+                        connector->connected_node = n;
+                        connector->connected_connector = &output;
                     }
                     
                     output.connected_index = connection["connected_index"];
@@ -327,14 +687,51 @@ std::unique_ptr<Material> load_material(const prism::path path) {
             }
         }
     }
-    
-    return mat;
+
+    return true;
 }
 
-void save_material(Material* material, const prism::path path) {
-    Expects(material != nullptr);
+std::unique_ptr<Material> load_material(const prism::path path) {
     Expects(!path.empty());
     
+    auto file = prism::open_file(path, true);
+    if(!file.has_value()) {
+        prism::log::error(System::Core, "Failed to load material from {}!", path);
+        return {};
+    }
+
+    file->read_all();
+
+    auto mat = std::make_unique<Material>();
+    mat->path = path.string();
+
+    material_texture_list textures;
+
+    if(prism::is_binary_material(file->cast_data<std::byte>(), file->size())) {
+        if(!load_binary_material(*mat, *file, textures)) {
+            prism::log::error(System::Core, "Material {} failed the header check!", path);
+            return mat;
+        }
+    } else {
+        if(!load_json_material(*mat, *file, textures)) {
+            prism::log::error(System::Core, "Material {} failed the version check!", path);
+            return mat;
+        }
+    }
+
+    std::vector<prism::path> texture_paths;
+    for(const auto& [property, texture_path] : textures)
+        texture_paths.push_back(texture_path);
+
+    assetm->load_batch<Texture>(texture_paths);
+
+    for(const auto& [property, texture_path] : textures)
+        property->value_tex = assetm->get<Texture>(texture_path);
+    
+    return mat;
+}
+
+void save_json_material(Material* material, const prism::path path) {
     nlohmann::json j;
 
     j["version"] = 2;
@@ -374,3 +771,61 @@ void save_material(Material* material, const prism::path path) {
     std::ofstream out(path);
     out << j;
 }
+
+void save_material(Material* material, const prism::path path, const bool as_json) {
+    Expects(material != nullptr);
+    Expects(!path.empty());
+
+    if(as_json) {
+        save_json_material(material, path);
+        return;
+    }
+
+    prism::material_file file;
+
+    std::unordered_map<MaterialNode*, uint32_t> node_indices;
+    for(auto [i, node] : utility::enumerate(material->nodes))
+        node_indices[node.get()] = static_cast<uint32_t>(i);
+
+    for(auto& node : material->nodes) {
+        prism::material_node n;
+        n.name = file.add_string(node->get_name());
+        n.property_count = static_cast<uint32_t>(node->properties.size());
+        n.x = node->x;
+        n.y = node->y;
+
+        for(auto& property : node->properties) {
+            prism::material_property p;
+            p.value = property.value;
+            p.float_value = property.float_value;
+
+            if(property.value_tex)
+                p.texture = file.add_string(property.value_tex->path);
+
+            file.properties.push_back(p);
+        }
+
+        for(auto [i, output] : utility::enumerate(node->outputs)) {
+            if(output.connected_connector == nullptr)
+                continue;
+
+            // the connected connector always lives in the inputs of the connected node
+            const auto& inputs = output.connected_node->inputs;
+
+            prism::material_connection c;
+            c.output_node = node_indices[node.get()];
+            c.output = static_cast<uint32_t>(i);
+            c.input_node = node_indices[output.connected_node];
+            c.input = static_cast<uint32_t>(output.connected_connector - inputs.data());
+
+            file.connections.push_back(c);
+        }
+
+        file.nodes.push_back(n);
+    }
+
+    const auto data = prism::write_material_file(file);
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "object.hpp"
+#include "cutscene.hpp"
+#include "matrix.hpp"
+#include "asset_types.hpp"
+#include "animation_sampler.hpp"
+
+class Scene;
+class GFXBuffer;
+class GFXCommandBuffer;
+struct Renderable;
+
+namespace prism {
+    struct AnimationTarget {
+        float current_time = 0.0f;
+        float animation_speed_modifier = 1.0f;
+        bool looping = false;
+
+        // additive animations are applied on top of the others, relative to their first frame
+        bool additive = false;
+
+        float weight = 1.0f;
+        float fade_speed = 0.0f; // change in weight per second, animations that fade out are removed once they reach 0
+
+        Object target = NullObject;
+        Animation animation;
+
+        animation_sampler<AnimationChannel> sampler;
+        std::vector<transform_pose> pose, reference_pose; // one for each channel
+        std::vector<int> channel_bones; // the bone each channel animates, or -1 if the mesh doesn't have it
+    };
+
+    /// The most bones a skinned mesh part can use, every part has this many skinning matrices.
+    constexpr int max_skinning_bones = 128;
+
+    /// Plays animations on objects with skinned meshes.
+    /// Every Renderable keeps its own pose so instances of the same mesh animate independently, and any number of animations can be blended on each one.
+    class animation_system {
+    public:
+        /// Replaces every animation playing on target, except for additive ones.
+        void play(Scene& scene, Animation animation, Object target, bool looping);
+
+        /// Fades the animation in over duration seconds, while every other animation playing on target fades out. Additive animations are left alone.
+        void cross_fade(Scene& scene, Animation animation, Object target, float duration, bool looping);
+
+        void play_additive(Scene& scene, Animation animation, Object target, float weight, bool looping);
+
+        void set_speed_modifier(Object target, float modifier);
+
+        void stop(Object target);
+
+        /// Replaces one bone of target's pose during the next update only, on top of every animation playing on it.
+        /// Cutscenes use this, since they sample their own channels and the bones on the mesh are shared with every other instance.
+        void override_bone(Object target, int bone, const transform_pose& pose, bool position, bool rotation, bool scale);
+
+        /// Advances every animation, then evaluates the pose and skinning matrices of every skinned mesh in the scene across the thread pool.
+        void update(Scene& scene, float delta_time);
+
+        /// The number of skinned meshes evaluated during the last update.
+        size_t get_instance_count() const {
+            return instances.size();
+        }
+
+        /// The skinning matrices of every skinned mesh from the last update, each Renderable's skinning_offset is where its own start.
+        /// They're uploaded by every render target into buffers of its own, since earlier frames may still be reading the last ones.
+        const std::vector<Matrix4x4>& get_skinning_matrices() const {
+            return skinning_matrices;
+        }
+
+    private:
+        AnimationTarget create_target(Scene& scene, Animation animation, Object target, bool looping) const;
+
+        struct bone_override {
+            int bone = -1;
+            transform_pose pose;
+            bool position = false, rotation = false, scale = false;
+        };
+
+        struct skinned_instance {
+            Object object = NullObject;
+            Renderable* renderable = nullptr;
+            Renderable* parent = nullptr; // meshes parented to another skinned mesh follow its bones
+
+            std::vector<AnimationTarget*> targets;
+            const std::vector<bone_override>* overrides = nullptr;
+
+            size_t matrix_offset = 0;
+            int depth = 0; // how many skinned meshes this one is parented under
+        };
+
+        void evaluate(skinned_instance& instance);
+
+        std::vector<AnimationTarget> targets;
+        std::vector<skinned_instance> instances;
+
+        std::unordered_map<Object, std::vector<bone_override>> bone_overrides; // cleared after every update
+
+        std::vector<Matrix4x4> skinning_matrices;
+    };
+
+    /// Binds the skinning matrices of one part of a mesh instance, where the skinned shaders read them from.
+    /// @param skinning_buffer This frame's upload of the animation system's skinning matrices.
+    void bind_skinning_matrices(GFXCommandBuffer* command_buffer, GFXBuffer* skinning_buffer, const Renderable& renderable, const Mesh::Part& part);
+}
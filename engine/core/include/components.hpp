@@ -6,6 +6,7 @@
 #include "object.hpp"
 #include "quaternion.hpp"
 #include "matrix.hpp"
+#include "animation_sampler.hpp"
 
 class btCollisionShape;
 class btRigidBody;
@@ -75,7 +76,30 @@ struct Renderable {
     AssetPtr<Mesh> mesh;
     std::vector<AssetPtr<Material>> materials;
     
-    std::vector<Matrix4x4> temp_bone_data;
+    // written by the animation system for skinned meshes, so every instance has its own pose
+    std::vector<prism::transform_pose> pose; // one for each bone
+    std::vector<Matrix4x4> bone_transforms; // model space
+    
+    // for meshes parented to another skinned mesh, the bone in the parent mesh each bone follows (or -1). it's only rebuilt when either mesh changes
+    std::vector<int> bone_remap;
+    const Mesh* bone_remap_source = nullptr; // this renderable's mesh when the remap was built
+    const Mesh* bone_remap_target = nullptr;
+    
+    bool has_skinning_matrices = false; // until the animation system first evaluates it, the mesh's own matrices are used
+    size_t skinning_offset = 0; // in bytes, every part has max_skinning_bones matrices one after another
+    
+    // whether the mesh is drawn into the occlusion buffer, automatic only uses static meshes that cover enough of the screen
+    enum class Occluder : int {
+        Automatic = 0,
+        Always = 1,
+        Never = 2
+    } occluder = Occluder::Automatic;
+    
+    // static renderables are drawn once into cached shadow maps, movable ones are drawn every frame on top of them
+    enum class Mobility : int {
+        Static = 0,
+        Movable = 1
+    } mobility = Mobility::Static;
 };
 
 struct Light {
@@ -8,6 +8,7 @@
 #include "asset_types.hpp"
 #include "platform.hpp"
 #include "path.hpp"
+#include "animation_sampler.hpp"
 
 class GFX;
 
@@ -25,15 +26,8 @@ namespace prism {
     class imgui_backend;
     class input_system;
     class renderer;
-
-    struct AnimationTarget {
-        float current_time = 0.0f;
-        float animation_speed_modifier = 1.0f;
-        bool looping = false;
-
-        Object target = NullObject;
-        Animation animation;
-    };
+    class thread_pool;
+    class animation_system;
 
     /// The glue between app and systems such as the Renderer.
     class engine {
@@ -127,6 +121,16 @@ namespace prism {
          */
         Physics* get_physics();
 
+        /** Get the worker threads shared by every system, for work that shouldn't block the main thread.
+         @return Instance of the thread pool. Will not be null.
+         */
+        thread_pool* get_thread_pool();
+
+        /** Get the animation system, which plays animations on skinned meshes.
+         @return Instance of the animation system. Will not be null.
+         */
+        animation_system* get_animation_system();
+
         /// Creates an empty scene with no path. This will change the current scene.
         void create_empty_scene();
 
@@ -304,6 +308,22 @@ namespace prism {
          */
         void play_animation(Animation animation, Object target, bool looping = false);
 
+        /** Fade from the animations playing on an object to a new one.
+         @param animation The animation to play.
+         @param target The animation's target.
+         @param duration How long the fade takes, in seconds.
+         @param looping Whether or not the animation should loop or be discarded when finished. Default is false.
+         */
+        void cross_fade_animation(Animation animation, Object target, float duration, bool looping = false);
+
+        /** Play an animation on top of the others playing on an object, it's applied relative to its first frame.
+         @param animation The animation to play.
+         @param target The animation's target.
+         @param weight How much of the animation is applied, from 0 to 1. Default is 1.
+         @param looping Whether or not the animation should loop or be discarded when finished. Default is false.
+         */
+        void play_additive_animation(Animation animation, Object target, float weight = 1.0f, bool looping = false);
+
         /** Sets the animation speed of an object.
          @param target The object you want to change the animation speed of.
          @param modifier The speed to play the object's animations at. A modifier of 2.0 would be 2x the speed, and 0.5 would be 1/2x the speed.
@@ -360,14 +380,12 @@ namespace prism {
             return nullptr;
         }
 
-        void calculate_bone(Mesh& mesh, const Mesh::Part& part, Bone& bone, const Bone* parent_bone = nullptr);
         void calculate_object(Scene& scene, Object object, Object parent_object = NullObject);
 
         Shot* get_shot(float time) const;
-        void update_animation(const Animation& anim, float time);
         void update_cutscene(float time);
 
-        void update_animation_channel(Scene& scene, const AnimationChannel& channel, float time);
+        void apply_animation_pose(Scene& scene, const std::vector<AnimationChannel>& channels, const std::vector<transform_pose>& pose);
 
         app* app = nullptr;
         GFX* gfx = nullptr;
@@ -380,16 +398,19 @@ namespace prism {
 
         std::map<std::string, std::string> strings;
 
-        std::vector<AnimationTarget> animation_targets;
+        animation_sampler<AnimationChannel> cutscene_sampler;
+        std::vector<transform_pose> cutscene_pose;
 
         std::unique_ptr<imgui_backend> imgui;
 
+        std::unique_ptr<animation_system> animation;
+
+        // declared last so it's destroyed first, jobs still running can use every other system
+        std::unique_ptr<thread_pool> thread_pool;
+
         const InputButton debug_button = InputButton::Q;
     };
 
-    inline bool operator==(const AnimationTarget& a1, const AnimationTarget& a2) {
-        return a1.current_time == a2.current_time;
-    }
 }
 
 inline prism::engine* engine = nullptr;
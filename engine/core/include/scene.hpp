@@ -7,6 +7,7 @@
 #include "object.hpp"
 #include "components.hpp"
 #include "utility.hpp"
+#include "aabb_tree.hpp"
 
 template<class Component>
 using Pool = std::unordered_map<Object, Component>;
@@ -200,6 +201,18 @@ const int max_environment_probes = 4;
 class GFXFramebuffer;
 class GFXTexture;
 
+/// Where a renderable is in the scene's culling tree, and what its bounds were last calculated from.
+struct RenderableProxy {
+    int leaf = prism::aabb_tree::null_node;
+    
+    Matrix4x4 model;
+    const Mesh* mesh = nullptr;
+    bool is_static = false;
+    bool moved = false; // if it ever moved, it's movable from then on even if it's marked static
+    
+    uint32_t last_seen = 0;
+};
+
 /// Represents a scene consisting of Objects with varying Components.
 class Scene : public ObjectComponents<Data, Transform, Renderable, Light, Camera, Collision, Rigidbody, UI, EnvironmentProbe> {
 public:
@@ -233,6 +246,14 @@ public:
     GFXTexture* pointLightArray = nullptr;
     GFXTexture* spotLightArray = nullptr;
     
+    // only static renderables are drawn into these, so they're kept until a light or static geometry changes
+    GFXTexture* staticDepthTexture = nullptr;
+    GFXFramebuffer* staticFramebuffer = nullptr;
+    
+    GFXTexture* staticPointLightArray = nullptr; // a layer for every face of every light, depth is kept too so movable renderables can be tested against it
+    GFXTexture* staticPointLightDepthArray = nullptr;
+    GFXTexture* staticSpotLightArray = nullptr;
+    
     bool sun_light_dirty = false;
     std::array<bool, max_point_shadows> point_light_dirty;
     std::array<bool, max_spot_shadows> spot_light_dirty;
@@ -244,6 +265,11 @@ public:
     std::array<bool, max_environment_probes> environment_dirty;
 
     GFXTexture *irradianceCubeArray = nullptr, *prefilteredCubeArray = nullptr;
+    
+    // culling, kept up to date by the renderer
+    prism::aabb_tree renderable_tree;
+    std::unordered_map<Object, RenderableProxy> renderable_proxies;
+    uint32_t renderable_tree_frame = 0;
 };
 
 /** Positions and rotates a camera to look at a target from a position.
@@ -0,0 +1,357 @@
+#include "animation_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "engine.hpp"
+#include "scene.hpp"
+#include "gfx_commandbuffer.hpp"
+#include "thread_pool.hpp"
+#include "transform.hpp"
+#include "utility.hpp"
+#include "assertions.hpp"
+#include "skeleton.hpp"
+
+using prism::animation_system;
+
+namespace {
+    constexpr size_t skinning_part_size = sizeof(Matrix4x4) * prism::max_skinning_bones;
+
+    prism::transform_pose get_bind_pose(const Bone& bone) {
+        prism::transform_pose pose;
+        pose.position = bone.position;
+        pose.rotation = bone.rotation;
+        pose.scale = bone.scale;
+
+        return pose;
+    }
+
+    Matrix4x4 get_pose_matrix(const prism::transform_pose& pose) {
+        Matrix4x4 local = prism::translate(Matrix4x4(), pose.position);
+        local *= matrix_from_quat(pose.rotation);
+
+        return prism::scale(local, pose.scale);
+    }
+}
+
+prism::AnimationTarget animation_system::create_target(Scene& scene, Animation animation, const Object target, const bool looping) const {
+    AnimationTarget animation_target;
+    animation_target.animation = std::move(animation);
+    animation_target.target = target;
+    animation_target.looping = looping;
+
+    const auto& bones = scene.get<Renderable>(target).mesh->bones;
+
+    // tracks without keys are left untouched when sampling, so they start out at the bind pose
+    for(const auto& channel : animation_target.animation.channels) {
+        int bone_index = -1;
+        for(const auto& bone : bones) {
+            if(channel.id == bone.name)
+                bone_index = bone.index;
+        }
+
+        animation_target.channel_bones.push_back(bone_index);
+        animation_target.pose.push_back(bone_index != -1 ? get_bind_pose(bones[bone_index]) : transform_pose());
+    }
+
+    return animation_target;
+}
+
+void animation_system::play(Scene& scene, Animation animation, const Object target, const bool looping) {
+    Expects(target != NullObject);
+
+    if(!scene.has<Renderable>(target) || !scene.get<Renderable>(target).mesh)
+        return;
+
+    utility::erase_if(targets, [target](const AnimationTarget& animation_target) {
+        return animation_target.target == target && !animation_target.additive;
+    });
+
+    targets.push_back(create_target(scene, std::move(animation), target, looping));
+}
+
+void animation_system::cross_fade(Scene& scene, Animation animation, const Object target, const float duration, const bool looping) {
+    Expects(target != NullObject);
+
+    if(!scene.has<Renderable>(target) || !scene.get<Renderable>(target).mesh)
+        return;
+
+    if(duration <= 0.0f) {
+        play(scene, std::move(animation), target, looping);
+        return;
+    }
+
+    for(auto& animation_target : targets) {
+        if(animation_target.target == target && !animation_target.additive)
+            animation_target.fade_speed = -1.0f / duration;
+    }
+
+    auto animation_target = create_target(scene, std::move(animation), target, looping);
+    animation_target.weight = 0.0f;
+    animation_target.fade_speed = 1.0f / duration;
+
+    targets.push_back(std::move(animation_target));
+}
+
+void animation_system::play_additive(Scene& scene, Animation animation, const Object target, const float weight, const bool looping) {
+    Expects(target != NullObject);
+
+    if(!scene.has<Renderable>(target) || !scene.get<Renderable>(target).mesh)
+        return;
+
+    auto animation_target = create_target(scene, std::move(animation), target, looping);
+    animation_target.additive = true;
+    animation_target.weight = weight;
+
+    // sampling before every key holds the first one
+    animation_target.reference_pose = animation_target.pose;
+
+    animation_sampler<AnimationChannel> reference_sampler;
+    reference_sampler.sample(animation_target.animation.channels, std::numeric_limits<float>::lowest(), animation_target.reference_pose);
+
+    targets.push_back(std::move(animation_target));
+}
+
+void animation_system::set_speed_modifier(const Object target, const float modifier) {
+    for(auto& animation_target : targets) {
+        if(animation_target.target == target)
+            animation_target.animation_speed_modifier = modifier;
+    }
+}
+
+void animation_system::stop(const Object target) {
+    utility::erase_if(targets, [target](const AnimationTarget& animation_target) {
+        return animation_target.target == target;
+    });
+}
+
+void animation_system::override_bone(const Object target, const int bone, const transform_pose& pose, const bool position, const bool rotation, const bool scale) {
+    bone_override entry;
+    entry.bone = bone;
+    entry.pose = pose;
+    entry.position = position;
+    entry.rotation = rotation;
+    entry.scale = scale;
+
+    bone_overrides[target].push_back(entry);
+}
+
+void animation_system::evaluate(skinned_instance& instance) {
+    auto& renderable = *instance.renderable;
+    const auto& mesh = *renderable.mesh.handle;
+    const auto& bones = mesh.bones;
+
+    renderable.pose.resize(bones.size());
+    for(size_t i = 0; i < bones.size(); i++)
+        renderable.pose[i] = get_bind_pose(bones[i]);
+
+    // a weighted average of every animation, where the bind pose makes up whatever weight is missing (like during a fade in from nothing)
+    float total_weight = 0.0f;
+    for(const auto target : instance.targets) {
+        if(!target->additive)
+            total_weight += target->weight;
+    }
+
+    float accumulated_weight = std::max(1.0f - total_weight, 0.0f);
+
+    for(const auto target : instance.targets) {
+        if(target->additive || target->weight <= 0.0f)
+            continue;
+
+        target->sampler.sample(target->animation.channels, static_cast<float>(target->current_time * target->animation.ticks_per_second), target->pose);
+
+        accumulated_weight += target->weight;
+        const float factor = target->weight / accumulated_weight;
+
+        for(size_t c = 0; c < target->channel_bones.size(); c++) {
+            if(target->channel_bones[c] != -1)
+                blend_pose(renderable.pose[target->channel_bones[c]], target->pose[c], factor);
+        }
+    }
+
+    for(const auto target : instance.targets) {
+        if(!target->additive || target->weight <= 0.0f)
+            continue;
+
+        target->sampler.sample(target->animation.channels, static_cast<float>(target->current_time * target->animation.ticks_per_second), target->pose);
+
+        for(size_t c = 0; c < target->channel_bones.size(); c++) {
+            if(target->channel_bones[c] != -1)
+                add_pose(renderable.pose[target->channel_bones[c]], target->pose[c], target->reference_pose[c], target->weight);
+        }
+    }
+
+    if(instance.overrides != nullptr) {
+        for(const auto& entry : *instance.overrides) {
+            if(entry.bone < 0 || entry.bone >= static_cast<int>(bones.size()))
+                continue;
+
+            auto& pose = renderable.pose[entry.bone];
+            if(entry.position)
+                pose.position = entry.pose.position;
+
+            if(entry.rotation)
+                pose.rotation = entry.pose.rotation;
+
+            if(entry.scale)
+                pose.scale = entry.pose.scale;
+        }
+    }
+
+    renderable.bone_transforms.resize(bones.size());
+
+    const bool follows_parent = instance.parent != nullptr && !renderable.bone_remap.empty();
+
+    for(const auto i : mesh.bone_order) {
+        // bones shared with the parent mesh follow it, instead of using their own pose
+        if(follows_parent && renderable.bone_remap[i] != -1) {
+            renderable.bone_transforms[i] = instance.parent->bone_transforms[renderable.bone_remap[i]];
+            continue;
+        }
+
+        const int parent = mesh.bone_parents[i];
+        if(parent != -1) {
+            renderable.bone_transforms[i] = renderable.bone_transforms[parent] * get_pose_matrix(renderable.pose[i]);
+        } else {
+            renderable.bone_transforms[i] = get_pose_matrix(renderable.pose[i]);
+        }
+    }
+
+    const size_t bone_count = std::min(bones.size(), static_cast<size_t>(max_skinning_bones));
+
+    for(const auto [p, part] : utility::enumerate(mesh.parts)) {
+        Matrix4x4* matrices = skinning_matrices.data() + instance.matrix_offset + p * max_skinning_bones;
+
+        for(size_t i = 0; i < bone_count; i++) {
+            matrices[i] = mesh.global_inverse_transformation * renderable.bone_transforms[i];
+
+            if(i < part.offset_matrices.size())
+                matrices[i] *= part.offset_matrices[i];
+        }
+    }
+}
+
+void animation_system::update(Scene& scene, const float delta_time) {
+    const auto is_past_end = [](const AnimationTarget& target) {
+        return target.current_time * target.animation.ticks_per_second > target.animation.duration;
+    };
+
+    utility::erase_if(targets, [&scene, &is_past_end](const AnimationTarget& target) {
+        const bool finished = !target.looping && is_past_end(target);
+        const bool faded_out = target.fade_speed < 0.0f && target.weight <= 0.0f;
+
+        return finished || faded_out || !scene.has<Renderable>(target.target);
+    });
+
+    for(auto& target : targets) {
+        if(is_past_end(target))
+            target.current_time = std::fmod(target.current_time, static_cast<float>(target.animation.duration / target.animation.ticks_per_second));
+    }
+
+    std::unordered_map<Object, std::vector<AnimationTarget*>> targets_by_object;
+    for(auto& target : targets)
+        targets_by_object[target.target].push_back(&target);
+
+    instances.clear();
+
+    size_t matrix_count = 0;
+    int max_depth = 0;
+    for(auto [object, renderable] : scene.get_all<Renderable>()) {
+        if(!renderable.mesh || renderable.mesh->bones.empty())
+            continue;
+
+        skinned_instance instance;
+        instance.object = object;
+        instance.renderable = &renderable;
+        instance.matrix_offset = matrix_count;
+
+        const auto found_targets = targets_by_object.find(object);
+        if(found_targets != targets_by_object.end())
+            instance.targets = found_targets->second;
+
+        if(const auto found_overrides = bone_overrides.find(object); found_overrides != bone_overrides.end())
+            instance.overrides = &found_overrides->second;
+
+        // walk up to the first skinned parent, and count how many are above it
+        for(Object parent = scene.get(object).parent; parent != NullObject && scene.has<Renderable>(parent); parent = scene.get(parent).parent) {
+            auto& parent_renderable = scene.get<Renderable>(parent);
+            if(!parent_renderable.mesh || parent_renderable.mesh->bones.empty())
+                break;
+
+            if(instance.parent == nullptr)
+                instance.parent = &parent_renderable;
+
+            instance.depth++;
+        }
+
+        if(instance.parent != nullptr) {
+            const Mesh* parent_mesh = instance.parent->mesh.handle;
+            if(renderable.bone_remap_source != renderable.mesh.handle || renderable.bone_remap_target != parent_mesh) {
+                const auto get_names = [](const Mesh& mesh) {
+                    std::vector<std::string> names;
+                    for(const auto& bone : mesh.bones)
+                        names.push_back(bone.name);
+
+                    return names;
+                };
+
+                renderable.bone_remap = create_bone_remap(get_names(*renderable.mesh.handle), get_names(*parent_mesh));
+                renderable.bone_remap_source = renderable.mesh.handle;
+                renderable.bone_remap_target = parent_mesh;
+            }
+        } else {
+            renderable.bone_remap.clear();
+            renderable.bone_remap_source = nullptr;
+            renderable.bone_remap_target = nullptr;
+        }
+
+        max_depth = std::max(max_depth, instance.depth);
+        matrix_count += renderable.mesh->parts.size() * max_skinning_bones;
+
+        instances.push_back(std::move(instance));
+    }
+
+    skinning_matrices.resize(matrix_count);
+
+    // meshes following another skinned mesh need its bones first, so they're evaluated a level at a time
+    std::vector<skinned_instance*> level;
+    for(int depth = 0; depth <= max_depth; depth++) {
+        level.clear();
+        for(auto& instance : instances) {
+            if(instance.depth == depth)
+                level.push_back(&instance);
+        }
+
+        ::engine->get_thread_pool()->parallel_for(static_cast<uint32_t>(level.size()), [this, &level](const uint32_t i) {
+            evaluate(*level[i]);
+        });
+    }
+
+    for(auto& target : targets) {
+        target.weight = std::clamp(target.weight + target.fade_speed * delta_time, 0.0f, 1.0f);
+        if(target.fade_speed > 0.0f && target.weight >= 1.0f)
+            target.fade_speed = 0.0f;
+
+        target.current_time += delta_time * target.animation_speed_modifier;
+    }
+
+    bone_overrides.clear();
+
+    for(auto& instance : instances) {
+        instance.renderable->has_skinning_matrices = true;
+        instance.renderable->skinning_offset = instance.matrix_offset * sizeof(Matrix4x4);
+    }
+}
+
+void prism::bind_skinning_matrices(GFXCommandBuffer* command_buffer, GFXBuffer* skinning_buffer, const Renderable& renderable, const Mesh::Part& part) {
+    // before the first update, the mesh's own buffer is used instead
+    if(skinning_buffer == nullptr || !renderable.has_skinning_matrices) {
+        command_buffer->bind_shader_buffer(part.bone_batrix_buffer, 0, 14, skinning_part_size);
+        return;
+    }
+
+    const size_t part_index = &part - renderable.mesh->parts.data();
+
+    command_buffer->bind_shader_buffer(skinning_buffer, static_cast<int>(renderable.skinning_offset + part_index * skinning_part_size), 14, skinning_part_size);
+}
@@ -12,6 +12,8 @@
 #include "scene.hpp"
 #include "renderer.hpp"
 #include "file.hpp"
+#include "texturestreaming.hpp"
+#include "shadercompiler.hpp"
 
 struct Options {
     std::string shader_source_path;
@@ -87,7 +89,7 @@ void draw_renderer() {
         const auto& probes = engine->get_scene()->get_all<EnvironmentProbe>();
         const auto& renderables = engine->get_scene()->get_all<Renderable>();
         
-        ImGui::ProgressBar("Light Budget", lights.size(), max_scene_lights);
+        ImGui::Text("Lights: %zu", lights.size());
         ImGui::ProgressBar("Probe Budget", probes.size(), max_environment_probes);
         
         int material_count = 0;
@@ -107,7 +109,14 @@ void draw_renderer() {
     for(auto target : targets) {
         ImGui::Text("Frame %i", target->current_frame);
         ImGui::Text("%i %i", target->extent.width, target->extent.height);
-        ImGui::Image(target->offscreenColorTexture, ImVec2(100, 100));
+        
+        const auto& graph_stats = target->graph.statistics;
+        ImGui::Text("Render Graph: %u passes (%u culled), %u transitions, %u barriers", graph_stats.passes, graph_stats.culled_passes, graph_stats.transitions, graph_stats.barriers);
+        ImGui::Text("Render Targets: %u textures in %u allocations, %.1f MB peak (%.1f MB without aliasing)", graph_stats.transient_textures, graph_stats.allocated_textures, graph_stats.peak_memory / (1024.0 * 1024.0), graph_stats.unaliased_memory / (1024.0 * 1024.0));
+        
+        if(target->offscreenColorTexture != nullptr)
+            ImGui::Image(target->offscreenColorTexture, ImVec2(100, 100));
+        
         ImGui::Separator();
     }
     
@@ -116,6 +125,46 @@ void draw_renderer() {
     
     ImGui::Text("FPS: %f", ImGui::GetIO().Framerate);
     
+    const auto& statistics = engine->get_renderer()->statistics;
+    ImGui::Text("Triangles: %u drawn of %u submitted", statistics.drawn_triangles, statistics.submitted_triangles);
+    ImGui::Text("Meshlets: %u culled of %u", statistics.culled_meshlets, statistics.meshlets);
+    ImGui::Text("Culling: %u of %u renderables culled, %u traversed", statistics.culling.objects_culled, statistics.culling.objects_visible + statistics.culling.objects_culled, statistics.culling.objects_traversed);
+    
+    const auto& shadow_culling = engine->get_renderer()->shadow_pass->statistics;
+    ImGui::Text("Shadow Culling: %u of %u renderables culled, %u traversed", shadow_culling.objects_culled, shadow_culling.objects_visible + shadow_culling.objects_culled, shadow_culling.objects_traversed);
+    
+    const auto shadow_pass = engine->get_renderer()->shadow_pass.get();
+    ImGui::Text("Shadow Draws: %u movable, %u static into the cache", shadow_pass->dynamic_commands.draw_calls, shadow_pass->static_commands.draw_calls);
+    
+    ImGui::Text("Light Clusters: %u lights, %u assigned to clusters, at most %u in one cluster", statistics.lights, statistics.light_assignments, statistics.max_cluster_lights);
+    
+    if(render_options.enable_occlusion_culling)
+        ImGui::Text("Occlusion Culling: %u of %u parts culled (%.1f%%) by %u occluders", statistics.occlusion_culled, statistics.occlusion_tested, statistics.occlusion_tested > 0 ? 100.0 * statistics.occlusion_culled / statistics.occlusion_tested : 0.0, statistics.occluders);
+    ImGui::Text("Draws: %u for %u instances, %u pipeline binds, %u descriptor binds, %u buffer binds", statistics.commands.draw_calls, statistics.commands.instances, statistics.commands.pipeline_binds, statistics.commands.descriptor_binds, statistics.commands.buffer_binds);
+    ImGui::Text("Shaders: %u compiled, %u loaded from cache", shader_compiler.get_compile_count(), shader_compiler.get_cache_hit_count());
+    
+    const auto& pipeline_stats = engine->get_renderer()->pipeline_stats;
+    ImGui::Text("Pipelines: %u compiled on workers, %u on the render thread, %zu pending, %u shared", pipeline_stats.compiled_on_workers, pipeline_stats.compiled_on_render_thread, engine->get_renderer()->get_pending_pipeline_count(), pipeline_stats.shared);
+    
+    ImGui::Text("Texture Streaming");
+    ImGui::Separator();
+    
+    ImGui::ProgressBar("Texture Budget (MB)", get_resident_texture_memory() / (1024 * 1024), render_options.texture_memory_budget);
+    
+    for(auto texture : assetm->get_all<Texture>()) {
+        if(texture == nullptr || !texture->streamable)
+            continue;
+        
+        ImGui::Text("%s", texture->path.c_str());
+        ImGui::Text("Resident: %i (%ix%i) Requested: %i (%ix%i)",
+                    texture->resident_level,
+                    prism::calculate_mip_extent(texture->header.width, texture->resident_level),
+                    prism::calculate_mip_extent(texture->header.height, texture->resident_level),
+                    texture->requested_level,
+                    prism::calculate_mip_extent(texture->header.width, texture->requested_level),
+                    prism::calculate_mip_extent(texture->header.height, texture->requested_level));
+    }
+    
     ImGui::Text("Options");
     ImGui::Separator();
     
@@ -151,6 +200,12 @@ void draw_renderer() {
     should_recompile |= ImGui::ComboEnum("Shadow Filter", &render_options.shadow_filter);
     ImGui::Checkbox("Enable Extra Passes", &render_options.enable_extra_passes);
     ImGui::Checkbox("Enable Frustum Culling", &render_options.enable_frustum_culling);
+    ImGui::Checkbox("Enable Texture Streaming", &render_options.enable_texture_streaming);
+    ImGui::InputInt("Texture Memory Budget (MB)", &render_options.texture_memory_budget);
+    ImGui::Checkbox("Enable Meshlet Culling", &render_options.enable_meshlet_culling);
+    ImGui::InputInt("LOD Bias", &render_options.lod_bias);
+    ImGui::Checkbox("Enable Occlusion Culling", &render_options.enable_occlusion_culling);
+    ImGui::InputInt("Occlusion Buffer Width", &render_options.occlusion_buffer_width);
 
     if(ImGui::Button("Force recompile materials (needed for some render option changes!)") || should_recompile) {
         for(auto material : assetm->get_all<Material>()) {
@@ -158,6 +213,8 @@ void draw_renderer() {
             material->skinned_pipeline = nullptr;
             material->static_pipeline = nullptr;
         }
+        
+        engine->get_renderer()->clear_pipeline_cache();
     }
 }
 
@@ -19,6 +19,10 @@
 #include "timer.hpp"
 #include "physics.hpp"
 #include "input.hpp"
+#include "texturestreaming.hpp"
+#include "thread_pool.hpp"
+#include "animation_format.hpp"
+#include "animation_system.hpp"
 
 // TODO: remove these in the future
 #include "shadowpass.hpp"
@@ -46,6 +50,8 @@ engine::engine(const int argc, char* argv[]) {
     physics = std::make_unique<Physics>();
     imgui = std::make_unique<prism::imgui_backend>();
     assetm = std::make_unique<AssetManager>();
+    animation = std::make_unique<animation_system>();
+    thread_pool = std::make_unique<prism::thread_pool>();
 }
 
 engine::~engine() = default;
@@ -98,6 +104,9 @@ bool engine::is_quitting() const {
 
 void engine::prepare_quit() {
     app->prepare_quit();
+    
+    if(gfx != nullptr)
+        gfx->save_pipeline_cache();
 }
 
 void engine::set_gfx(GFX* p_gfx) {
@@ -122,6 +131,14 @@ Physics* engine::get_physics() {
     return physics.get();
 }
 
+prism::thread_pool* engine::get_thread_pool() {
+    return thread_pool.get();
+}
+
+prism::animation_system* engine::get_animation_system() {
+    return animation.get();
+}
+
 void engine::create_empty_scene() {
     auto scene = std::make_unique<Scene>();
     
@@ -235,6 +252,42 @@ Animation engine::load_animation(const prism::path& path) {
 
     Animation anim;
 
+    file->read_all();
+
+    if(prism::is_compressed_animation(file->cast_data<std::byte>(), file->size())) {
+        const auto compressed = prism::read_animation_file(file->cast_data<std::byte>(), file->size());
+        if(!compressed.has_value()) {
+            prism::log::error(System::Core, "{} failed the animation header check!", path);
+            return {};
+        }
+
+        const auto clip = prism::decompress_animation(*compressed);
+
+        anim.duration = clip.duration;
+        anim.ticks_per_second = clip.ticks_per_second;
+
+        for(const auto& clip_channel : clip.channels) {
+            AnimationChannel channel;
+            channel.id = clip_channel.name;
+
+            for(const auto& key : clip_channel.positions)
+                channel.positions.push_back({key.time, key.value});
+
+            for(const auto& key : clip_channel.rotations)
+                channel.rotations.push_back({key.time, key.value});
+
+            for(const auto& key : clip_channel.scales)
+                channel.scales.push_back({key.time, key.value});
+
+            anim.channels.push_back(channel);
+        }
+
+        return anim;
+    }
+
+    // older animations are uncompressed keyframes, read straight from the file
+    file->seek(0);
+
     file->read(&anim.duration);
     file->read(&anim.ticks_per_second);
 
@@ -502,28 +555,6 @@ std::string engine::localize(const std::string& id) {
     return strings[id];
 }
 
-void engine::calculate_bone(Mesh& mesh, const Mesh::Part& part, Bone& bone, const Bone* parent_bone) {
-    if(part.offset_matrices.empty())
-        return;
-
-    Matrix4x4 parent_matrix;
-    if(parent_bone != nullptr)
-        parent_matrix = parent_bone->local_transform;
-
-    Matrix4x4 local = prism::translate(Matrix4x4(), bone.position);
-    local *= matrix_from_quat(bone.rotation);
-    local = prism::scale(local, bone.scale);
-
-    bone.local_transform = parent_matrix * local;
-
-    bone.final_transform = mesh.global_inverse_transformation * bone.local_transform * part.offset_matrices[bone.index];
-
-    for(auto& b : mesh.bones) {
-        if(b.parent != nullptr && b.parent->index == bone.index)
-            calculate_bone(mesh, part, b, &bone);
-    }
-}
-
 void engine::calculate_object(Scene& scene, Object object, const Object parent_object) {
     Matrix4x4 parent_matrix;
     if(parent_object != NullObject)
@@ -537,33 +568,6 @@ void engine::calculate_object(Scene& scene, Object object, const Object parent_o
 
     transform.model = parent_matrix * local;
 
-    if(scene.has<Renderable>(object)) {
-        auto& mesh = scene.get<Renderable>(object);
-
-        if(mesh.mesh && !mesh.mesh->bones.empty()) {
-            if(mesh.temp_bone_data.empty())
-                mesh.temp_bone_data.resize(mesh.mesh->bones.size());
-            
-            for(auto& part : mesh.mesh->parts) {
-                if(scene.get(object).parent != NullObject && scene.has<Renderable>(scene.get(object).parent) && !scene.get<Renderable>(scene.get(object).parent).mesh->bones.empty()) {
-                    for(auto [i, ourBone] : utility::enumerate(mesh.mesh->bones)) {
-                        for(auto& theirBone : scene.get<Renderable>(scene.get(object).parent).mesh->bones) {
-                            if(ourBone.name == theirBone.name)
-                                mesh.temp_bone_data[i] = mesh.mesh->global_inverse_transformation * theirBone.local_transform * part.offset_matrices[ourBone.index];
-                        }
-                    }
-                } else {
-                    calculate_bone(*mesh.mesh.handle, part, *mesh.mesh->root_bone);
-
-                    for(auto [i, bone] : utility::enumerate(mesh.temp_bone_data))
-                        mesh.temp_bone_data[i] = mesh.mesh->bones[i].final_transform;
-                }
-
-                gfx->copy_buffer(part.bone_batrix_buffer, mesh.temp_bone_data.data(), 0, mesh.temp_bone_data.size() * sizeof(Matrix4x4));
-            }
-        }
-    }
-
 	for(auto& child : scene.children_of(object))
         calculate_object(scene, child, object);
 }
@@ -577,67 +581,30 @@ Shot* engine::get_shot(const float time) const {
     return nullptr;
 }
 
-void engine::update_animation_channel(Scene& scene, const AnimationChannel& channel, const float time) {
-    {
-        int keyframeIndex = -1;
-        int i = 0;
-        for(auto& frame : channel.positions) {
-            if(time >= frame.time)
-                keyframeIndex = i;
-
-            i++;
-        }
-
-        if(keyframeIndex != -1) {
-            prism::float3* targetVec = nullptr;
-            if(channel.bone != nullptr)
-                targetVec = &channel.bone->position;
-
-            if(channel.target != NullObject && scene.has<Data>(channel.target))
-                targetVec = &scene.get<Transform>(channel.target).position;
+void engine::apply_animation_pose(Scene& scene, const std::vector<AnimationChannel>& channels, const std::vector<transform_pose>& pose) {
+    for(size_t i = 0; i < channels.size(); i++) {
+        const auto& channel = channels[i];
+        const auto& channel_pose = pose[i];
 
-            auto& startFrame = channel.positions[keyframeIndex];
+        // the bone belongs to the mesh and is shared by every instance of it, so only the target's own pose is changed
+        if(channel.bone != nullptr) {
+            if(channel.target != NullObject && scene.has<Renderable>(channel.target))
+                animation->override_bone(channel.target, channel.bone->index, channel_pose, !channel.positions.empty(), !channel.rotations.empty(), !channel.scales.empty());
 
-            int endFrameIndex = keyframeIndex + 1;
-            if(endFrameIndex > channel.positions.size() - 1) {
-                if(targetVec != nullptr)
-                    *targetVec = startFrame.value;
-            } else {
-                auto& endFrame = channel.positions[endFrameIndex];
-
-                if(targetVec != nullptr)
-                    *targetVec = lerp(startFrame.value, endFrame.value, (float)(time - startFrame.time) / (float)(endFrame.time - startFrame.time));
-            }
+            continue;
         }
-    }
 
-    {
-        int keyframeIndex = -1;
-        int i = 0;
-        for(auto& frame : channel.rotations) {
-            if(time >= frame.time)
-                keyframeIndex = i;
+        if(channel.target != NullObject && scene.has<Data>(channel.target)) {
+            auto& transform = scene.get<Transform>(channel.target);
 
-            i++;
-        }
-
-        if(keyframeIndex != -1) {
-            Quaternion* targetVec = nullptr;
-            if(channel.bone != nullptr)
-                targetVec = &channel.bone->rotation;
+            if(!channel.positions.empty())
+                transform.position = channel_pose.position;
 
-            auto& startFrame = channel.rotations[keyframeIndex];
-
-            int endFrameIndex = keyframeIndex + 1;
-            if(endFrameIndex > channel.rotations.size() - 1) {
-                if(targetVec != nullptr)
-                    *targetVec = startFrame.value;
-            } else {
-                auto& endFrame = channel.rotations[endFrameIndex];
+            if(!channel.rotations.empty())
+                transform.rotation = channel_pose.rotation;
 
-                if(targetVec != nullptr)
-                    *targetVec = lerp(startFrame.value, endFrame.value, (float)(time - startFrame.time) / (float)(endFrame.time - startFrame.time));
-            }
+            if(!channel.scales.empty())
+                transform.scale = channel_pose.scale;
         }
     }
 }
@@ -647,18 +614,13 @@ void engine::update_cutscene(const float time) {
     if(currentShot != nullptr) {
         current_scene = currentShot->scene;
 
-        for(auto& channel : currentShot->channels)
-            update_animation_channel(*current_scene, channel, time);
+        cutscene_sampler.sample(currentShot->channels, time, cutscene_pose);
+        apply_animation_pose(*current_scene, currentShot->channels, cutscene_pose);
     } else {
         current_scene = nullptr;
     }
 }
 
-void engine::update_animation(const Animation& anim, const float time) {
-    for(const auto& channel : anim.channels)
-        update_animation_channel(*current_scene, channel, time);
-}
-
 void engine::begin_frame(const float delta_time) {
     imgui->begin_frame(delta_time);
     
@@ -730,24 +692,14 @@ void engine::update(const float delta_time) {
             current_cutscene_time += delta_time;
         }
         
-        for(auto& target : animation_targets) {
-            if((target.current_time * target.animation.ticks_per_second) > target.animation.duration) {
-                if(target.looping) {
-                    target.current_time = 0.0f;
-                } else {
-                    utility::erase(animation_targets, target);
-                }
-            } else {
-                update_animation(target.animation, target.current_time * target.animation.ticks_per_second);
-                
-                target.current_time += delta_time * target.animation_speed_modifier;
-            }
-        }
+        animation->update(*current_scene, delta_time);
     
         update_scene(*current_scene);
     }
     
     assetm->perform_cleanup();
+    
+    update_texture_streaming();
 }
 
 void engine::update_scene(Scene& scene) {
@@ -819,36 +771,27 @@ void engine::on_remove(Object object) {
 void engine::play_animation(Animation animation, Object object, bool looping) {
     Expects(object != NullObject);
     
-    if(!current_scene->has<Renderable>(object))
-        return;
-    
-    AnimationTarget target;
-    target.animation = std::move(animation);
-    target.target = object;
-    target.looping = looping;
+    this->animation->play(*current_scene, std::move(animation), object, looping);
+}
 
-    for(auto& channel : target.animation.channels) {
-        for(auto& bone : current_scene->get<Renderable>(object).mesh->bones) {
-            if(channel.id == bone.name)
-                channel.bone = &bone;
-        }
-    }
+void engine::cross_fade_animation(Animation animation, Object object, float duration, bool looping) {
+    Expects(object != NullObject);
+    
+    this->animation->cross_fade(*current_scene, std::move(animation), object, duration, looping);
+}
 
-    animation_targets.push_back(target);
+void engine::play_additive_animation(Animation animation, Object object, float weight, bool looping) {
+    Expects(object != NullObject);
+    
+    this->animation->play_additive(*current_scene, std::move(animation), object, weight, looping);
 }
 
 void engine::set_animation_speed_modifier(Object target, float modifier) {
-    for(auto& animation : animation_targets) {
-        if(animation.target == target)
-            animation.animation_speed_modifier = modifier;
-    }
+    animation->set_speed_modifier(target, modifier);
 }
 
 void engine::stop_animation(Object target) {
-    for(auto& animation : animation_targets) {
-        if(animation.target == target)
-            utility::erase(animation_targets, animation);
-    }
+    animation->stop(target);
 }
 
 void engine::setup_scene(Scene& scene) {
@@ -860,6 +803,7 @@ void engine::setup_scene(Scene& scene) {
     
     get_renderer()->shadow_pass->create_scene_resources(scene);
     get_renderer()->scene_capture->create_scene_resources(scene);
+    get_renderer()->precompile_pipelines(scene);
     
     scene.reset_shadows();
     scene.reset_environment();
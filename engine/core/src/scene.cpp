@@ -23,6 +23,12 @@ void load_renderable_component(nlohmann::json j, Renderable& t) {
     
     for(auto& material : j["materials"])
         t.materials.push_back(assetm->get<Material>(prism::app_domain / material.get<std::string_view>()));
+    
+    if(j.contains("occluder"))
+        t.occluder = j["occluder"];
+    
+    if(j.contains("mobility"))
+        t.mobility = j["mobility"];
 }
 
 void load_camera_component(nlohmann::json j, Camera& camera) {
@@ -128,6 +134,9 @@ void save_renderable_component(nlohmann::json& j, const Renderable &mesh) {
         if(material)
             j["materials"].push_back(material->path);
     }
+    
+    j["occluder"] = mesh.occluder;
+    j["mobility"] = mesh.mobility;
 }
 
 void save_camera_component(nlohmann::json& j, const Camera& camera) {
@@ -24,12 +24,15 @@ public:
     void copy_buffer(GFXBuffer* buffer, void* data, const GFXSize offset, const GFXSize size) override;
     
     void* get_buffer_contents(GFXBuffer* buffer) override;
+    void destroy_buffer(GFXBuffer* buffer) override;
     
     // texture operations
     GFXTexture* create_texture(const GFXTextureCreateInfo& info) override;
     void copy_texture(GFXTexture* texture, void* data, GFXSize size) override;
+    void copy_texture(GFXTexture* texture, void* data, GFXSize size, const std::vector<GFXTextureLevel>& levels) override;
     void copy_texture(GFXTexture* from, GFXTexture* to) override;
     void copy_texture(GFXTexture* from, GFXBuffer* to) override;
+    void destroy_texture(GFXTexture* texture) override;
     
     // sampler opeations
     GFXSampler* create_sampler(const GFXSamplerCreateInfo& info) override;
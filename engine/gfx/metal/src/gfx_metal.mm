@@ -39,6 +39,42 @@ MTLPixelFormat toPixelFormat(GFXPixelFormat format) {
             return MTLPixelFormatRGBA16Float;
         case GFXPixelFormat::DEPTH_32F:
             return MTLPixelFormatDepth32Float;
+#if !defined(PLATFORM_IOS) && !defined(PLATFORM_TVOS)
+        case GFXPixelFormat::BC1_UNORM:
+            return MTLPixelFormatBC1_RGBA;
+        case GFXPixelFormat::BC3_UNORM:
+            return MTLPixelFormatBC3_RGBA;
+        case GFXPixelFormat::BC4_UNORM:
+            return MTLPixelFormatBC4_RUnorm;
+        case GFXPixelFormat::BC5_UNORM:
+            return MTLPixelFormatBC5_RGUnorm;
+        case GFXPixelFormat::BC7_UNORM:
+            return MTLPixelFormatBC7_RGBAUnorm;
+#else
+        default:
+            return MTLPixelFormatInvalid;
+#endif
+    }
+}
+
+// returns the size of one row of pixels, or one row of 4x4 blocks for compressed formats
+NSUInteger getBytesPerRow(const MTLPixelFormat format, const NSUInteger width) {
+    switch(format) {
+#if !defined(PLATFORM_IOS) && !defined(PLATFORM_TVOS)
+        case MTLPixelFormatBC1_RGBA:
+        case MTLPixelFormatBC4_RUnorm:
+            return ((width + 3) / 4) * 8;
+        case MTLPixelFormatBC3_RGBA:
+        case MTLPixelFormatBC5_RGUnorm:
+        case MTLPixelFormatBC7_RGBAUnorm:
+            return ((width + 3) / 4) * 16;
+#endif
+        case MTLPixelFormatRGBA8Unorm:
+            return width * 4;
+        case MTLPixelFormatRG8Unorm:
+            return width * 2;
+        default:
+            return width;
     }
 }
 
@@ -164,6 +200,14 @@ bool GFXMetal::supports_feature(const GFXFeature feature) {
         return true;
 #endif
     }
+
+    if(feature == GFXFeature::BlockCompression) {
+#if defined(PLATFORM_IOS) || defined(PLATFORM_TVOS)
+        return false;
+#else
+        return true;
+#endif
+    }
     
     return false;
 }
@@ -230,6 +274,11 @@ void* GFXMetal::get_buffer_contents(GFXBuffer* buffer) {
     return reinterpret_cast<unsigned char *>(metalBuffer->get(currentFrameIndex).contents);
 }
 
+void GFXMetal::destroy_buffer(GFXBuffer* buffer) {
+    // same as textures, command buffers in flight retain the underlying buffers
+    delete (GFXMetalBuffer*)buffer;
+}
+
 GFXTexture* GFXMetal::create_texture(const GFXTextureCreateInfo& info) {
     GFXMetalTexture* texture = new GFXMetalTexture();
 
@@ -334,6 +383,22 @@ void GFXMetal::copy_texture(GFXTexture* texture, void* data, const GFXSize) {
     [metalTexture->handle replaceRegion:region mipmapLevel:0 withBytes:data bytesPerRow:(NSUInteger)texture->width * byteSize];
 }
 
+void GFXMetal::copy_texture(GFXTexture* texture, void* data, const GFXSize, const std::vector<GFXTextureLevel>& levels) {
+    GFXMetalTexture* metalTexture = (GFXMetalTexture*)texture;
+
+    for(const auto& level : levels) {
+        const NSUInteger width = std::max(texture->width >> level.level, 1);
+        const NSUInteger height = std::max(texture->height >> level.level, 1);
+
+        MTLRegion region = {
+            { 0, 0, 0 },
+            { width, height, 1 }
+        };
+
+        [metalTexture->handle replaceRegion:region mipmapLevel:level.level withBytes:(unsigned char*)data + level.offset bytesPerRow:getBytesPerRow(metalTexture->format, width)];
+    }
+}
+
 void GFXMetal::copy_texture(GFXTexture* from, GFXTexture* to) {
     GFXMetalTexture* metalFromTexture = (GFXMetalTexture*)from;
     GFXMetalTexture* metalToTexture = (GFXMetalTexture*)to;
@@ -380,6 +445,11 @@ void GFXMetal::copy_texture(GFXTexture* from, GFXBuffer* to) {
     [commandBuffer waitUntilCompleted];
 }
 
+void GFXMetal::destroy_texture(GFXTexture* texture) {
+    // command buffers retain the resources they use, so in-flight frames keep the underlying texture alive
+    delete (GFXMetalTexture*)texture;
+}
+
 GFXSampler* GFXMetal::create_sampler(const GFXSamplerCreateInfo& info) {
     GFXMetalSampler* sampler = new GFXMetalSampler();
     
@@ -417,6 +487,8 @@ GFXRenderPass* GFXMetal::create_render_pass(const GFXRenderPassCreateInfo& info)
 
     for(const auto& attachment : info.attachments)
         renderPass->attachments.push_back(toPixelFormat(attachment));
+    
+    renderPass->keep_contents = info.keep_contents;
 
     return renderPass;
 }
@@ -543,6 +615,15 @@ GFXPipeline* GFXMetal::create_graphics_pipeline(const GFXGraphicsPipelineCreateI
             case GFXVertexFormat::INT4:
                 format = MTLVertexFormatInt4;
                 break;
+            case GFXVertexFormat::HALF2:
+                format = MTLVertexFormatHalf2;
+                break;
+            case GFXVertexFormat::SNORM16_2:
+                format = MTLVertexFormatShort2Normalized;
+                break;
+            case GFXVertexFormat::UNORM10_10_10_2:
+                format = MTLVertexFormatUInt1010102Normalized;
+                break;
         }
 
         descriptor.attributes[attribute.location].format = (MTLVertexFormat)format;
@@ -707,7 +788,7 @@ GFXCommandBuffer* GFXMetal::acquire_command_buffer(bool for_presentation_use) {
                 
                 free_command_buffers[i] = false;
                 
-                buffer->commands.clear();
+                buffer->reset();
                 
                 return buffer;
             }
@@ -772,15 +853,17 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                     MTLRenderPassDescriptor* descriptor = [MTLRenderPassDescriptor new];
 
                     if(currentRenderPass != nullptr && currentFramebuffer != nullptr) {
+                        const MTLLoadAction load_action = currentRenderPass->keep_contents ? MTLLoadActionLoad : MTLLoadActionClear;
+                        
                         unsigned int i = 0;
                         for(const auto& attachment : currentFramebuffer->attachments) {
                             if(attachment->format == MTLPixelFormatDepth32Float) {
                                 descriptor.depthAttachment.texture = attachment->handle;
-                                descriptor.depthAttachment.loadAction = MTLLoadActionClear;
+                                descriptor.depthAttachment.loadAction = load_action;
                                 descriptor.depthAttachment.storeAction = MTLStoreActionStore;
                             } else {
                                 descriptor.colorAttachments[i].texture = attachment->handle;
-                                descriptor.colorAttachments[i].loadAction = MTLLoadActionClear;
+                                descriptor.colorAttachments[i].loadAction = load_action;
                                 descriptor.colorAttachments[i].storeAction = MTLStoreActionStore;
                                 descriptor.colorAttachments[i].clearColor = currentClearColor;
                                 
@@ -818,19 +901,19 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
             current_encoder = encoder;
         };
 
-        for(auto command : command_buffer->commands) {
+        for(const auto command : *command_buffer) {
             switch(command.type) {
                 case GFXCommandType::Invalid:
                     break;
                 case GFXCommandType::SetRenderPass:
                 {
-                    currentClearColor = MTLClearColorMake(command.data.set_render_pass.clear_color.r,
-                                                          command.data.set_render_pass.clear_color.g,
-                                                          command.data.set_render_pass.clear_color.b,
-                                                          command.data.set_render_pass.clear_color.a );
+                    currentClearColor = MTLClearColorMake(command.set_render_pass().clear_color.r,
+                                                          command.set_render_pass().clear_color.g,
+                                                          command.set_render_pass().clear_color.b,
+                                                          command.set_render_pass().clear_color.a );
                     
-                    currentFramebuffer = (GFXMetalFramebuffer*)command.data.set_render_pass.framebuffer;
-                    currentRenderPass = (GFXMetalRenderPass*)command.data.set_render_pass.render_pass;
+                    currentFramebuffer = (GFXMetalFramebuffer*)command.set_render_pass().framebuffer;
+                    currentRenderPass = (GFXMetalRenderPass*)command.set_render_pass().render_pass;
                     
                     currentViewport = MTLViewport();
                     
@@ -841,14 +924,14 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                 {
                     needEncoder(CurrentEncoder::Render);
                     
-                    [renderEncoder setRenderPipelineState:((GFXMetalPipeline*)command.data.set_graphics_pipeline.pipeline)->handle];
+                    [renderEncoder setRenderPipelineState:((GFXMetalPipeline*)command.set_graphics_pipeline().pipeline)->handle];
 
-                    currentPipeline = (GFXMetalPipeline*)command.data.set_graphics_pipeline.pipeline;
+                    currentPipeline = (GFXMetalPipeline*)command.set_graphics_pipeline().pipeline;
 
                     [renderEncoder setDepthStencilState:currentPipeline->depthStencil];
 
-                    [renderEncoder setCullMode:((GFXMetalPipeline*)command.data.set_graphics_pipeline.pipeline)->cullMode];
-                    [renderEncoder setFrontFacingWinding:toWinding(((GFXMetalPipeline*)command.data.set_graphics_pipeline.pipeline)->winding_mode)];
+                    [renderEncoder setCullMode:((GFXMetalPipeline*)command.set_graphics_pipeline().pipeline)->cullMode];
+                    [renderEncoder setFrontFacingWinding:toWinding(((GFXMetalPipeline*)command.set_graphics_pipeline().pipeline)->winding_mode)];
 
                     if(currentPipeline->renderWire)
                         [renderEncoder setTriangleFillMode:MTLTriangleFillModeLines];
@@ -860,9 +943,9 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                 {
                     needEncoder(CurrentEncoder::Compute);
                     
-                    currentPipeline = (GFXMetalPipeline*)command.data.set_compute_pipeline.pipeline;
+                    currentPipeline = (GFXMetalPipeline*)command.set_compute_pipeline().pipeline;
                     
-                    [computeEncoder setComputePipelineState:((GFXMetalPipeline*)command.data.set_compute_pipeline.pipeline)->compute_handle];
+                    [computeEncoder setComputePipelineState:((GFXMetalPipeline*)command.set_compute_pipeline().pipeline)->compute_handle];
 
                 }
                     break;
@@ -870,13 +953,13 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                 {
                     needEncoder(CurrentEncoder::Render);
 
-                    [renderEncoder setVertexBuffer:((GFXMetalBuffer*)command.data.set_vertex_buffer.buffer)->get(currentFrameIndex) offset:(NSUInteger)command.data.set_vertex_buffer.offset atIndex:(NSUInteger)command.data.set_vertex_buffer.index ];
+                    [renderEncoder setVertexBuffer:((GFXMetalBuffer*)command.set_vertex_buffer().buffer)->get(currentFrameIndex) offset:(NSUInteger)command.set_vertex_buffer().offset atIndex:(NSUInteger)command.set_vertex_buffer().index ];
                 }
                     break;
                 case GFXCommandType::SetIndexBuffer:
                 {
-                    currentIndexBuffer = (GFXMetalBuffer*)command.data.set_index_buffer.buffer;
-                    currentIndextype = command.data.set_index_buffer.index_type;
+                    currentIndexBuffer = (GFXMetalBuffer*)command.set_index_buffer().buffer;
+                    currentIndextype = command.set_index_buffer().index_type;
                 }
                     break;
                 case GFXCommandType::SetPushConstant:
@@ -885,42 +968,42 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                         continue;
                     
                     if(current_encoder == CurrentEncoder::Render) {
-                        [renderEncoder setVertexBytes:command.data.set_push_constant.bytes.data() length:(NSUInteger)command.data.set_push_constant.size atIndex:(NSUInteger)currentPipeline->pushConstantIndex];
-                        [renderEncoder setFragmentBytes:command.data.set_push_constant.bytes.data() length:(NSUInteger)command.data.set_push_constant.size atIndex:(NSUInteger)currentPipeline->pushConstantIndex];
+                        [renderEncoder setVertexBytes:command.set_push_constant().bytes length:(NSUInteger)command.set_push_constant().size atIndex:(NSUInteger)currentPipeline->pushConstantIndex];
+                        [renderEncoder setFragmentBytes:command.set_push_constant().bytes length:(NSUInteger)command.set_push_constant().size atIndex:(NSUInteger)currentPipeline->pushConstantIndex];
                     } else if(current_encoder == CurrentEncoder::Compute) {
-                        [computeEncoder setBytes:command.data.set_push_constant.bytes.data() length:(NSUInteger)command.data.set_push_constant.size atIndex:(NSUInteger)currentPipeline->pushConstantIndex];
+                        [computeEncoder setBytes:command.set_push_constant().bytes length:(NSUInteger)command.set_push_constant().size atIndex:(NSUInteger)currentPipeline->pushConstantIndex];
                     }
                 }
                     break;
                 case GFXCommandType::BindShaderBuffer:
                 {
                     if(current_encoder == CurrentEncoder::Render) {
-                        [renderEncoder setVertexBuffer:((GFXMetalBuffer*)command.data.bind_shader_buffer.buffer)->get(currentFrameIndex) offset:(NSUInteger)command.data.bind_shader_buffer.offset atIndex:(NSUInteger)command.data.bind_shader_buffer.index ];
+                        [renderEncoder setVertexBuffer:((GFXMetalBuffer*)command.bind_shader_buffer().buffer)->get(currentFrameIndex) offset:(NSUInteger)command.bind_shader_buffer().offset atIndex:(NSUInteger)command.bind_shader_buffer().index ];
                         
-                        [renderEncoder setFragmentBuffer:((GFXMetalBuffer*)command.data.bind_shader_buffer.buffer)->get(currentFrameIndex) offset:(NSUInteger)command.data.bind_shader_buffer.offset atIndex:(NSUInteger)command.data.bind_shader_buffer.index ];
+                        [renderEncoder setFragmentBuffer:((GFXMetalBuffer*)command.bind_shader_buffer().buffer)->get(currentFrameIndex) offset:(NSUInteger)command.bind_shader_buffer().offset atIndex:(NSUInteger)command.bind_shader_buffer().index ];
                     } else if(current_encoder == CurrentEncoder::Compute) {
-                        [computeEncoder setBuffer:((GFXMetalBuffer*)command.data.bind_shader_buffer.buffer)->get(currentFrameIndex) offset:(NSUInteger)command.data.bind_shader_buffer.offset atIndex:(NSUInteger)command.data.bind_shader_buffer.index ];
+                        [computeEncoder setBuffer:((GFXMetalBuffer*)command.bind_shader_buffer().buffer)->get(currentFrameIndex) offset:(NSUInteger)command.bind_shader_buffer().offset atIndex:(NSUInteger)command.bind_shader_buffer().index ];
                     }
                 }
                     break;
                 case GFXCommandType::BindTexture:
                 {
                     if(current_encoder == CurrentEncoder::Render) {
-                        if(command.data.bind_texture.texture != nullptr) {
-                            [renderEncoder setVertexSamplerState:((GFXMetalTexture*)command.data.bind_texture.texture)->sampler atIndex:(NSUInteger)command.data.bind_texture.index];
+                        if(command.bind_texture().texture != nullptr) {
+                            [renderEncoder setVertexSamplerState:((GFXMetalTexture*)command.bind_texture().texture)->sampler atIndex:(NSUInteger)command.bind_texture().index];
                             
-                            [renderEncoder setVertexTexture:((GFXMetalTexture*)command.data.bind_texture.texture)->handle atIndex:(NSUInteger)command.data.bind_texture.index];
+                            [renderEncoder setVertexTexture:((GFXMetalTexture*)command.bind_texture().texture)->handle atIndex:(NSUInteger)command.bind_texture().index];
                             
-                            [renderEncoder setFragmentSamplerState:((GFXMetalTexture*)command.data.bind_texture.texture)->sampler atIndex:(NSUInteger)command.data.bind_texture.index];
+                            [renderEncoder setFragmentSamplerState:((GFXMetalTexture*)command.bind_texture().texture)->sampler atIndex:(NSUInteger)command.bind_texture().index];
 
-                            [renderEncoder setFragmentTexture:((GFXMetalTexture*)command.data.bind_texture.texture)->handle atIndex:(NSUInteger)command.data.bind_texture.index];
+                            [renderEncoder setFragmentTexture:((GFXMetalTexture*)command.bind_texture().texture)->handle atIndex:(NSUInteger)command.bind_texture().index];
                         } else {
-                            [renderEncoder setVertexTexture:nil atIndex:(NSUInteger)command.data.bind_texture.index];
+                            [renderEncoder setVertexTexture:nil atIndex:(NSUInteger)command.bind_texture().index];
                             
-                            [renderEncoder setFragmentTexture:nil atIndex:(NSUInteger)command.data.bind_texture.index];
+                            [renderEncoder setFragmentTexture:nil atIndex:(NSUInteger)command.bind_texture().index];
                         }
                     } else if(current_encoder == CurrentEncoder::Compute) {
-                        [computeEncoder setTexture:((GFXMetalTexture*)command.data.bind_texture.texture)->handle atIndex:(NSUInteger)command.data.bind_texture.index];
+                        [computeEncoder setTexture:((GFXMetalTexture*)command.bind_texture().texture)->handle atIndex:(NSUInteger)command.bind_texture().index];
                     }
                 }
                     break;
@@ -928,10 +1011,10 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                 {
                     needEncoder(CurrentEncoder::Render);
                     
-                    if(command.data.bind_sampler.sampler != nullptr) {
-                        [renderEncoder setFragmentSamplerState:((GFXMetalSampler*)command.data.bind_sampler.sampler)->handle atIndex:(NSUInteger)command.data.bind_sampler.index];
+                    if(command.bind_sampler().sampler != nullptr) {
+                        [renderEncoder setFragmentSamplerState:((GFXMetalSampler*)command.bind_sampler().sampler)->handle atIndex:(NSUInteger)command.bind_sampler().index];
                     } else {
-                        [renderEncoder setFragmentSamplerState:nil atIndex:(NSUInteger)command.data.bind_sampler.index];
+                        [renderEncoder setFragmentSamplerState:nil atIndex:(NSUInteger)command.bind_sampler().index];
                     }
                 }
                     break;
@@ -942,8 +1025,8 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                     if(currentPipeline == nullptr)
                         continue;
                     
-                    [renderEncoder drawPrimitives:currentPipeline->primitiveType vertexStart:(NSUInteger)command.data.draw.vertex_offset vertexCount:(NSUInteger)command.data.draw.vertex_count instanceCount:(NSUInteger)command.data.draw.instance_count
-                        baseInstance:(NSUInteger)command.data.draw.base_instance];
+                    [renderEncoder drawPrimitives:currentPipeline->primitiveType vertexStart:(NSUInteger)command.draw().vertex_offset vertexCount:(NSUInteger)command.draw().vertex_count instanceCount:(NSUInteger)command.draw().instance_count
+                        baseInstance:(NSUInteger)command.draw().base_instance];
                 }
                     break;
                 case GFXCommandType::DrawIndexed:
@@ -974,22 +1057,25 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                     }
 
                     for(auto& stride : currentPipeline->vertexStrides)
-                        [renderEncoder setVertexBufferOffset:(NSUInteger)command.data.draw_indexed.vertex_offset * stride.stride atIndex:stride.location];
+                        [renderEncoder setVertexBufferOffset:(NSUInteger)command.draw_indexed().vertex_offset * stride.stride atIndex:stride.location];
 
                     [renderEncoder
                     drawIndexedPrimitives:currentPipeline->primitiveType
-                    indexCount:(NSUInteger)command.data.draw_indexed.index_count
+                    indexCount:(NSUInteger)command.draw_indexed().index_count
                     indexType:indexType
                     indexBuffer:currentIndexBuffer->get(currentFrameIndex)
-                    indexBufferOffset:(NSUInteger)command.data.draw_indexed.first_index * indexSize];
+                    indexBufferOffset:(NSUInteger)command.draw_indexed().first_index * indexSize
+                    instanceCount:(NSUInteger)command.draw_indexed().instance_count
+                    baseVertex:0
+                    baseInstance:(NSUInteger)command.draw_indexed().base_instance];
                 }
                     break;
                 case GFXCommandType::MemoryBarrier:
                 {
-                    needEncoder(CurrentEncoder::Render);
-
+                    // starting an encoder just for this would clear the attachments, and Metal already tracks hazards between encoders
                     #ifdef PLATFORM_MACOS
-                    [renderEncoder memoryBarrierWithScope:MTLBarrierScopeTextures afterStages:MTLRenderStageFragment beforeStages:MTLRenderStageFragment];
+                    if(current_encoder == CurrentEncoder::Render)
+                        [renderEncoder memoryBarrierWithScope:MTLBarrierScopeTextures afterStages:MTLRenderStageFragment beforeStages:MTLRenderStageFragment];
                     #endif
                 }
                     break;
@@ -997,20 +1083,18 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                 {
                     needEncoder(CurrentEncoder::Blit);
 
-                    GFXMetalTexture* metalFromTexture = (GFXMetalTexture*)command.data.copy_texture.src;
-                    GFXMetalTexture* metalToTexture = (GFXMetalTexture*)command.data.copy_texture.dst;
+                    GFXMetalTexture* metalFromTexture = (GFXMetalTexture*)command.copy_texture().src;
+                    GFXMetalTexture* metalToTexture = (GFXMetalTexture*)command.copy_texture().dst;
                     if(metalFromTexture != nullptr && metalToTexture != nullptr) {
-                        const int slice_offset = command.data.copy_texture.to_slice + command.data.copy_texture.to_layer * 6;
-
                         [blitEncoder
                          copyFromTexture:metalFromTexture->handle
-                         sourceSlice:0
+                         sourceSlice:command.copy_texture().get_from_array_layer()
                          sourceLevel:0
                          sourceOrigin:MTLOriginMake(0, 0, 0)
-                         sourceSize:MTLSizeMake(command.data.copy_texture.width, command.data.copy_texture.height, 1)
+                         sourceSize:MTLSizeMake(command.copy_texture().width, command.copy_texture().height, 1)
                          toTexture:metalToTexture->handle
-                         destinationSlice: slice_offset
-                         destinationLevel:command.data.copy_texture.to_level
+                         destinationSlice:command.copy_texture().get_to_array_layer()
+                         destinationLevel:command.copy_texture().to_level
                          destinationOrigin: MTLOriginMake(0, 0, 0)];
                     }
                 }
@@ -1018,12 +1102,12 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                 case GFXCommandType::SetViewport:
                 {
                     MTLViewport viewport;
-                    viewport.originX = command.data.set_viewport.viewport.x;
-                    viewport.originY = command.data.set_viewport.viewport.y;
-                    viewport.width = command.data.set_viewport.viewport.width;
-                    viewport.height = command.data.set_viewport.viewport.height;
-                    viewport.znear = command.data.set_viewport.viewport.min_depth;
-                    viewport.zfar = command.data.set_viewport.viewport.max_depth;
+                    viewport.originX = command.set_viewport().viewport.x;
+                    viewport.originY = command.set_viewport().viewport.y;
+                    viewport.width = command.set_viewport().viewport.width;
+                    viewport.height = command.set_viewport().viewport.height;
+                    viewport.znear = command.set_viewport().viewport.min_depth;
+                    viewport.zfar = command.set_viewport().viewport.max_depth;
                     
                     if(renderEncoder != nil)
                         [renderEncoder setViewport:viewport];
@@ -1036,10 +1120,10 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                     needEncoder(CurrentEncoder::Render);
 
                     MTLScissorRect rect;
-                    rect.x = (NSUInteger)command.data.set_scissor.rect.offset.x;
-                    rect.y = (NSUInteger)command.data.set_scissor.rect.offset.y;
-                    rect.width = (NSUInteger)command.data.set_scissor.rect.extent.width;
-                    rect.height = (NSUInteger)command.data.set_scissor.rect.extent.height;
+                    rect.x = (NSUInteger)command.set_scissor().rect.offset.x;
+                    rect.y = (NSUInteger)command.set_scissor().rect.offset.y;
+                    rect.width = (NSUInteger)command.set_scissor().rect.extent.width;
+                    rect.height = (NSUInteger)command.set_scissor().rect.extent.height;
 
                     [renderEncoder setScissorRect:rect];
                 }
@@ -1047,7 +1131,7 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                 case GFXCommandType::GenerateMipmaps: {
                     needEncoder(CurrentEncoder::Blit);
 
-                    GFXMetalTexture* metalTexture = (GFXMetalTexture*)command.data.generate_mipmaps.texture;
+                    GFXMetalTexture* metalTexture = (GFXMetalTexture*)command.generate_mipmaps().texture;
                                         
                     [blitEncoder generateMipmapsForTexture: metalTexture->handle];
                 }
@@ -1055,13 +1139,13 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                 case GFXCommandType::SetDepthBias: {
                     needEncoder(CurrentEncoder::Render);
                     
-                    [renderEncoder setDepthBias:command.data.set_depth_bias.constant
-                                    slopeScale:command.data.set_depth_bias.slope_factor
-                                          clamp:command.data.set_depth_bias.clamp];
+                    [renderEncoder setDepthBias:command.set_depth_bias().constant
+                                    slopeScale:command.set_depth_bias().slope_factor
+                                          clamp:command.set_depth_bias().clamp];
                 }
                     break;
                 case GFXCommandType::PushGroup: {
-                    [commandBuffer pushDebugGroup:[NSString stringWithUTF8String:command.data.push_group.name.data()]];
+                    [commandBuffer pushDebugGroup:[NSString stringWithUTF8String:command.push_group().name.data()]];
                 }
                     break;
                 case GFXCommandType::PopGroup: {
@@ -1071,10 +1155,10 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                 case GFXCommandType::InsertLabel: {
                     switch(current_encoder) {
                         case CurrentEncoder::Render:
-                            [renderEncoder insertDebugSignpost:[NSString stringWithUTF8String:command.data.insert_label.name.data()]];
+                            [renderEncoder insertDebugSignpost:[NSString stringWithUTF8String:command.insert_label().name.data()]];
                             break;
                         case CurrentEncoder::Blit:
-                            [blitEncoder insertDebugSignpost:[NSString stringWithUTF8String:command.data.insert_label.name.data()]];
+                            [blitEncoder insertDebugSignpost:[NSString stringWithUTF8String:command.insert_label().name.data()]];
                             break;
                         default:
                             break;
@@ -1084,7 +1168,7 @@ void GFXMetal::submit(GFXCommandBuffer* command_buffer, const int window) {
                 case GFXCommandType::Dispatch: {
                     needEncoder(CurrentEncoder::Compute);
 
-                    [computeEncoder dispatchThreadgroups:MTLSizeMake(command.data.dispatch.group_count_x, command.data.dispatch.group_count_y, command.data.dispatch.group_count_z) threadsPerThreadgroup:currentPipeline->threadGroupSize];
+                    [computeEncoder dispatchThreadgroups:MTLSizeMake(command.dispatch().group_count_x, command.dispatch().group_count_y, command.dispatch().group_count_z) threadsPerThreadgroup:currentPipeline->threadGroupSize];
                 }
                     break;
             }
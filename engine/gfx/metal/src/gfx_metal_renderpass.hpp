@@ -7,4 +7,5 @@
 class GFXMetalRenderPass : public GFXRenderPass {
 public:
     std::vector<MTLPixelFormat> attachments;
+    bool keep_contents = false;
 };
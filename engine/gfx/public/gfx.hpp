@@ -25,7 +25,12 @@ enum class GFXPixelFormat : int {
     R8G8_SFLOAT = 6,
     R8G8B8A8_UNORM = 7,
     R16G16B16A16_SFLOAT = 8,
-    DEPTH_32F = 9
+    DEPTH_32F = 9,
+    BC1_UNORM = 10,
+    BC3_UNORM = 11,
+    BC4_UNORM = 12,
+    BC5_UNORM = 13,
+    BC7_UNORM = 14
 };
 
 enum class GFXVertexFormat : int {
@@ -34,7 +39,10 @@ enum class GFXVertexFormat : int {
     FLOAT4 = 2,
     INT = 3,
     UNORM4 = 4,
-    INT4 = 5
+    INT4 = 5,
+    HALF2 = 6,
+    SNORM16_2 = 7,
+    UNORM10_10_10_2 = 8
 };
 
 enum class GFXTextureUsage : int {
@@ -228,6 +236,9 @@ struct GFXRenderPassCreateInfo {
     std::vector<GFXPixelFormat> attachments;
     
     bool will_use_in_shader = false;
+    
+    // the attachments aren't cleared when the render pass begins, so it draws on top of what's already in them
+    bool keep_contents = false;
 };
 
 enum class GFXBorderColor {
@@ -279,6 +290,11 @@ struct GFXSamplerCreateInfo {
 
 using GFXSize = uint64_t;
 
+struct GFXTextureLevel {
+    int level = 0;
+    GFXSize offset = 0, size = 0; // offset is relative to the start of the data passed to copy_texture
+};
+
 enum class GFXContext {
 	None,
     Metal,
@@ -292,7 +308,9 @@ struct GFXCreateInfo {
 };
 
 enum class GFXFeature {
-    CubemapArray
+    CubemapArray,
+    BlockCompression,
+    AsyncPipelineCreation // create_graphics_pipeline can be called from worker threads
 };
 
 class GFX {
@@ -333,15 +351,25 @@ public:
     virtual void release_buffer_contents([[maybe_unused]] GFXBuffer* buffer,
                                          [[maybe_unused]] void* handle) {}
 
+    /// Destroys the buffer once frames still in flight are done with it, it can't be used again after this.
+    virtual void destroy_buffer([[maybe_unused]] GFXBuffer* buffer) {}
+
     // texture operations
     virtual GFXTexture* create_texture([[maybe_unused]] const GFXTextureCreateInfo& info) { return nullptr; }
     virtual void copy_texture([[maybe_unused]] GFXTexture* texture,
                               [[maybe_unused]] void* data,
                               [[maybe_unused]] const GFXSize size) {}
+    virtual void copy_texture([[maybe_unused]] GFXTexture* texture,
+                              [[maybe_unused]] void* data,
+                              [[maybe_unused]] const GFXSize size,
+                              [[maybe_unused]] const std::vector<GFXTextureLevel>& levels) {}
     virtual void copy_texture([[maybe_unused]] GFXTexture* from,
                               [[maybe_unused]] GFXTexture* to) {}
     virtual void copy_texture([[maybe_unused]] GFXTexture* from,
                               [[maybe_unused]] GFXBuffer* to) {}
+
+    /// Destroys the texture, waiting for the GPU to finish using it first.
+    virtual void destroy_texture([[maybe_unused]] GFXTexture* texture) {}
     
     // sampler opeations
     virtual GFXSampler* create_sampler([[maybe_unused]] const GFXSamplerCreateInfo& info) { return nullptr; }
@@ -356,6 +384,9 @@ public:
     virtual GFXPipeline* create_graphics_pipeline([[maybe_unused]] const GFXGraphicsPipelineCreateInfo& info) { return nullptr; }
     virtual GFXPipeline* create_compute_pipeline([[maybe_unused]] const GFXComputePipelineCreateInfo& info) { return nullptr; }
 
+    /// Writes compiled pipeline state to the writeable directory, so the next launch can create pipelines faster.
+    virtual void save_pipeline_cache() {}
+
     // misc operations
     virtual GFXSize get_alignment(const GFXSize size) { return size; }
 
@@ -1,9 +1,13 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 #include <cstring>
-#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <string_view>
+#include <type_traits>
 
 #include "common.hpp"
 
@@ -12,6 +16,7 @@ class GFXBuffer;
 class GFXFramebuffer;
 class GFXRenderPass;
 class GFXSampler;
+class GFXTexture;
 
 struct GFXRenderPassBeginInfo {
     struct ClearColor {
@@ -64,311 +69,451 @@ enum class GFXCommandType {
     EndRenderPass
 };
 
+/// A command decoded from a GFXCommandBuffer. The payload points into the buffer, so it's only valid until the buffer is recorded into again or reset.
 struct GFXDrawCommand {
+    struct SetGraphicsPipelineData {
+        GFXPipeline* pipeline = nullptr;
+    };
+
+    struct SetComputePipelineData {
+        GFXPipeline* pipeline = nullptr;
+    };
+
+    struct SetVertexData {
+        GFXBuffer* buffer = nullptr;
+        int offset = 0;
+        int index = 0;
+    };
+
+    struct SetIndexData {
+        GFXBuffer* buffer = nullptr;
+        IndexType index_type = IndexType::UINT32;
+    };
+
+    // the bytes are stored inline after the size
+    struct SetPushData {
+        const unsigned char* bytes = nullptr;
+        size_t size = 0;
+    };
+
+    struct BindShaderData {
+        GFXBuffer* buffer = nullptr;
+        int offset = 0;
+        int index = 0;
+        int size = 0;
+    };
+
+    struct BindTextureData {
+        GFXTexture* texture = nullptr;
+        int index = 0;
+    };
+
+    struct BindSamplerData {
+        GFXSampler* sampler = nullptr;
+        int index = 0;
+    };
+
+    struct DrawData {
+        int vertex_offset = 0;
+        int vertex_count = 0;
+        int base_instance = 0;
+        int instance_count = 0;
+    };
+
+    struct DrawIndexedData {
+        int index_count = 0;
+        int first_index = 0;
+        int vertex_offset = 0;
+        int base_instance = 0;
+        int instance_count = 1;
+    };
+
+    struct CopyTextureData {
+        GFXTexture* src = nullptr, *dst = nullptr;
+        int width = 0, height = 0;
+        int to_slice = 0;
+        int to_layer = 0;
+        int to_level = 0;
+        int from_slice = 0;
+        int from_layer = 0;
+        
+        // cubemaps have six array layers for every layer, while the layers of 2D arrays are array layers themselves
+        bool cubemap = true;
+        
+        int get_to_array_layer() const {
+            return cubemap ? to_slice + to_layer * 6 : to_layer;
+        }
+        
+        int get_from_array_layer() const {
+            return cubemap ? from_slice + from_layer * 6 : from_layer;
+        }
+    };
+
+    struct SetViewportData {
+        Viewport viewport;
+    };
+
+    struct SetScissorData {
+        prism::Rectangle rect;
+    };
+
+    struct GenerateMipmapData {
+        GFXTexture* texture = nullptr;
+        int mip_count = 0;
+    };
+
+    struct SetDepthBiasData {
+        float constant = 0.0f;
+        float clamp = 0.0f;
+        float slope_factor = 0.0f;
+    };
+
+    struct PushGroupData {
+        std::string_view name;
+    };
+
+    struct InsertLabelData {
+        std::string_view name;
+    };
+
+    struct DispatchData {
+        uint32_t group_count_x, group_count_y, group_count_z;
+    };
+
     GFXCommandType type = GFXCommandType::Invalid;
-    
-    struct CommandData {
-        GFXRenderPassBeginInfo set_render_pass;
-        
-        struct SetGraphicsPipelineData {
-            GFXPipeline* pipeline = nullptr;
-        } set_graphics_pipeline;
-        
-        struct SetComputePipelineData {
-            GFXPipeline* pipeline = nullptr;
-        } set_compute_pipeline;
-        
-        struct SetVertexData {
-            GFXBuffer* buffer = nullptr;
-            int offset = 0;
-            int index = 0;
-        } set_vertex_buffer;
-        
-        struct SetIndexData {
-            GFXBuffer* buffer = nullptr;
-			IndexType index_type = IndexType::UINT32;
-        } set_index_buffer;
-        
-        struct SetPushData {
-            std::vector<unsigned char> bytes;
-            size_t size = 0;
-        } set_push_constant;
-        
-        struct BindShaderData {
-            GFXBuffer* buffer = nullptr;
-            int offset = 0;
-            int index = 0;
-            int size = 0;
-        } bind_shader_buffer;
-        
-        struct BindTextureData {
-            GFXTexture* texture = nullptr;
-            int index = 0;
-        } bind_texture;
-        
-        struct BindSamplerData {
-            GFXSampler* sampler = nullptr;
-            int index = 0;
-        } bind_sampler;
-        
-        struct DrawData {
-            int vertex_offset = 0;
-            int vertex_count = 0;
-            int base_instance = 0;
-            int instance_count = 0;
-        } draw;
-        
-        struct DrawIndexedData {
-            int index_count = 0;
-            int first_index = 0;
-            int vertex_offset = 0;
-            int base_instance = 0;
-        } draw_indexed;
-
-        struct CopyTextureData {
-            GFXTexture* src = nullptr, *dst = nullptr;
-            int width = 0, height = 0;
-            int to_slice = 0;
-            int to_layer = 0;
-            int to_level = 0;
-        } copy_texture;
-        
-        struct SetViewportData {
-            Viewport viewport;
-        } set_viewport;
-        
-        struct SetScissorData {
-            prism::Rectangle rect;
-        } set_scissor;
-        
-        struct GenerateMipmapData {
-            GFXTexture* texture = nullptr;
-            int mip_count = 0;
-        } generate_mipmaps;
-        
-        struct SetDepthBiasData {
-            float constant = 0.0f;
-            float clamp = 0.0f;
-            float slope_factor = 0.0f;
-        } set_depth_bias;
-        
-        struct PushGroupData {
-            std::string_view name;
-        } push_group;
-        
-        struct InsertLabelData {
-            std::string_view name;
-        } insert_label;
-        
-        struct DispatchData {
-            uint32_t group_count_x, group_count_y, group_count_z;
-        } dispatch;
-    } data;
+    const std::byte* payload = nullptr;
+
+    const GFXRenderPassBeginInfo& set_render_pass() const { return get<GFXRenderPassBeginInfo>(); }
+    const SetGraphicsPipelineData& set_graphics_pipeline() const { return get<SetGraphicsPipelineData>(); }
+    const SetComputePipelineData& set_compute_pipeline() const { return get<SetComputePipelineData>(); }
+    const SetVertexData& set_vertex_buffer() const { return get<SetVertexData>(); }
+    const SetIndexData& set_index_buffer() const { return get<SetIndexData>(); }
+    const BindShaderData& bind_shader_buffer() const { return get<BindShaderData>(); }
+    const BindTextureData& bind_texture() const { return get<BindTextureData>(); }
+    const BindSamplerData& bind_sampler() const { return get<BindSamplerData>(); }
+    const DrawData& draw() const { return get<DrawData>(); }
+    const DrawIndexedData& draw_indexed() const { return get<DrawIndexedData>(); }
+    const CopyTextureData& copy_texture() const { return get<CopyTextureData>(); }
+    const SetViewportData& set_viewport() const { return get<SetViewportData>(); }
+    const SetScissorData& set_scissor() const { return get<SetScissorData>(); }
+    const GenerateMipmapData& generate_mipmaps() const { return get<GenerateMipmapData>(); }
+    const SetDepthBiasData& set_depth_bias() const { return get<SetDepthBiasData>(); }
+    const PushGroupData& push_group() const { return get<PushGroupData>(); }
+    const InsertLabelData& insert_label() const { return get<InsertLabelData>(); }
+    const DispatchData& dispatch() const { return get<DispatchData>(); }
+
+    SetPushData set_push_constant() const {
+        SetPushData data;
+        memcpy(&data.size, payload, sizeof(size_t));
+        data.bytes = reinterpret_cast<const unsigned char*>(payload + sizeof(size_t));
+
+        return data;
+    }
+
+private:
+    template<typename T>
+    const T& get() const {
+        return *reinterpret_cast<const T*>(payload);
+    }
 };
 
+/** Records commands into a packed stream, where every command only takes up the size of its own payload.
+ The stream is a linear arena that keeps its memory when reset, so a buffer that's reused every frame stops allocating once it's grown large enough.
+ */
 class GFXCommandBuffer {
 public:
     void set_render_pass(GFXRenderPassBeginInfo& info) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::SetRenderPass;
-        command.data.set_render_pass = info;
-        
-        commands.push_back(command);
+        record(GFXCommandType::SetRenderPass, info);
     }
     
     void set_graphics_pipeline(GFXPipeline* pipeline) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::SetGraphicsPipeline;
-        command.data.set_graphics_pipeline.pipeline = pipeline;
+        GFXDrawCommand::SetGraphicsPipelineData data;
+        data.pipeline = pipeline;
         
-        commands.push_back(command);
+        record(GFXCommandType::SetGraphicsPipeline, data);
     }
     
     void set_compute_pipeline(GFXPipeline* pipeline) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::SetComputePipeline;
-        command.data.set_compute_pipeline.pipeline = pipeline;
+        GFXDrawCommand::SetComputePipelineData data;
+        data.pipeline = pipeline;
         
-        commands.push_back(command);
+        record(GFXCommandType::SetComputePipeline, data);
     }
     
     void set_vertex_buffer(GFXBuffer* buffer, int offset, int index) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::SetVertexBuffer;
-        command.data.set_vertex_buffer.buffer = buffer;
-        command.data.set_vertex_buffer.offset = offset;
-        command.data.set_vertex_buffer.index = index;
+        GFXDrawCommand::SetVertexData data;
+        data.buffer = buffer;
+        data.offset = offset;
+        data.index = index;
         
-        commands.push_back(command);
+        record(GFXCommandType::SetVertexBuffer, data);
     }
     
     void set_index_buffer(GFXBuffer* buffer, IndexType indexType) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::SetIndexBuffer;
-        command.data.set_index_buffer.buffer = buffer;
-		command.data.set_index_buffer.index_type = indexType;
+        GFXDrawCommand::SetIndexData data;
+        data.buffer = buffer;
+        data.index_type = indexType;
         
-        commands.push_back(command);
+        record(GFXCommandType::SetIndexBuffer, data);
     }
     
     void set_push_constant(const void* data, const size_t size) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::SetPushConstant;
-        command.data.set_push_constant.size = size;
-        command.data.set_push_constant.bytes.resize(size);
-        
-        memcpy(command.data.set_push_constant.bytes.data(), data, size);
+        std::byte* payload = allocate(GFXCommandType::SetPushConstant, sizeof(size_t) + size);
         
-        commands.push_back(command);
+        memcpy(payload, &size, sizeof(size_t));
+        memcpy(payload + sizeof(size_t), data, size);
     }
     
     void bind_shader_buffer(GFXBuffer* buffer, int offset, int index, int size) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::BindShaderBuffer;
-        command.data.bind_shader_buffer.buffer = buffer;
-        command.data.bind_shader_buffer.offset = offset;
-        command.data.bind_shader_buffer.index = index;
-        command.data.bind_shader_buffer.size = size;
-
+        GFXDrawCommand::BindShaderData data;
+        data.buffer = buffer;
+        data.offset = offset;
+        data.index = index;
+        data.size = size;
         
-        commands.push_back(command);
+        record(GFXCommandType::BindShaderBuffer, data);
     }
     
     void bind_texture(GFXTexture* texture, int index) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::BindTexture;
-        command.data.bind_texture.texture = texture;
-        command.data.bind_texture.index = index;
+        GFXDrawCommand::BindTextureData data;
+        data.texture = texture;
+        data.index = index;
         
-        commands.push_back(command);
+        record(GFXCommandType::BindTexture, data);
     }
     
     void bind_sampler(GFXSampler* sampler, const int index) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::BindSampler;
-        command.data.bind_sampler.sampler = sampler;
-        command.data.bind_sampler.index = index;
+        GFXDrawCommand::BindSamplerData data;
+        data.sampler = sampler;
+        data.index = index;
         
-        commands.push_back(command);
+        record(GFXCommandType::BindSampler, data);
     }
     
     void draw(int offset, int count, int instance_base, int instance_count) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::Draw;
-        command.data.draw.vertex_offset = offset;
-        command.data.draw.vertex_count = count;
-        command.data.draw.base_instance = instance_base;
-        command.data.draw.instance_count = instance_count;
+        GFXDrawCommand::DrawData data;
+        data.vertex_offset = offset;
+        data.vertex_count = count;
+        data.base_instance = instance_base;
+        data.instance_count = instance_count;
         
-        commands.push_back(command);
+        record(GFXCommandType::Draw, data);
     }
     
-    void draw_indexed(int indexCount, int firstIndex, int vertexOffset, int base_instance) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::DrawIndexed;
-        command.data.draw_indexed.vertex_offset = vertexOffset;
-        command.data.draw_indexed.first_index = firstIndex;
-        command.data.draw_indexed.index_count = indexCount;
-        command.data.draw_indexed.base_instance = base_instance;
-        
-        commands.push_back(command);
+    void draw_indexed(int indexCount, int firstIndex, int vertexOffset, int base_instance, int instance_count = 1) {
+        GFXDrawCommand::DrawIndexedData data;
+        data.vertex_offset = vertexOffset;
+        data.first_index = firstIndex;
+        data.index_count = indexCount;
+        data.base_instance = base_instance;
+        data.instance_count = instance_count;
+        
+        record(GFXCommandType::DrawIndexed, data);
     }
     
     void memory_barrier() {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::MemoryBarrier;
-        
-        commands.push_back(command);
+        allocate(GFXCommandType::MemoryBarrier, 0);
     }
     
-    void copy_texture(GFXTexture* src, int width, int height, GFXTexture* dst, int to_slice, int to_layer, int to_level) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::CopyTexture;
-        command.data.copy_texture.src = src;
-        command.data.copy_texture.width = width;
-        command.data.copy_texture.height = height;
-        command.data.copy_texture.dst = dst;
-        command.data.copy_texture.to_slice = to_slice;
-        command.data.copy_texture.to_layer = to_layer;
-        command.data.copy_texture.to_level = to_level;
-        
-        commands.push_back(command);
+    // slices and layers are cubemap faces and array elements, so an element is found at slice + layer * 6
+    void copy_texture(GFXTexture* src, int width, int height, GFXTexture* dst, int to_slice, int to_layer, int to_level, int from_slice = 0, int from_layer = 0) {
+        GFXDrawCommand::CopyTextureData data;
+        data.src = src;
+        data.width = width;
+        data.height = height;
+        data.dst = dst;
+        data.to_slice = to_slice;
+        data.to_layer = to_layer;
+        data.to_level = to_level;
+        data.from_slice = from_slice;
+        data.from_layer = from_layer;
+        
+        record(GFXCommandType::CopyTexture, data);
+    }
+    
+    // for 2D arrays, where each layer is a single texture
+    void copy_array_texture(GFXTexture* src, int width, int height, GFXTexture* dst, int to_layer, int from_layer = 0) {
+        GFXDrawCommand::CopyTextureData data;
+        data.src = src;
+        data.width = width;
+        data.height = height;
+        data.dst = dst;
+        data.to_layer = to_layer;
+        data.from_layer = from_layer;
+        data.cubemap = false;
+        
+        record(GFXCommandType::CopyTexture, data);
     }
     
     void set_viewport(Viewport viewport) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::SetViewport;
-        command.data.set_viewport.viewport = viewport;
+        GFXDrawCommand::SetViewportData data;
+        data.viewport = viewport;
         
-        commands.push_back(command);
+        record(GFXCommandType::SetViewport, data);
     }
     
     void set_scissor(const prism::Rectangle rect) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::SetScissor;
-        command.data.set_scissor.rect = rect;
+        GFXDrawCommand::SetScissorData data;
+        data.rect = rect;
 
-        commands.push_back(command);
+        record(GFXCommandType::SetScissor, data);
     }
     
     void generate_mipmaps(GFXTexture* texture, int mip_count) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::GenerateMipmaps;
-        command.data.generate_mipmaps.texture = texture;
-        command.data.generate_mipmaps.mip_count = mip_count;
+        GFXDrawCommand::GenerateMipmapData data;
+        data.texture = texture;
+        data.mip_count = mip_count;
         
-        commands.push_back(command);
+        record(GFXCommandType::GenerateMipmaps, data);
     }
     
     void set_depth_bias(const float constant, const float clamp, const float slope) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::SetDepthBias;
-        command.data.set_depth_bias.constant = constant;
-        command.data.set_depth_bias.clamp = clamp;
-        command.data.set_depth_bias.slope_factor = slope;
+        GFXDrawCommand::SetDepthBiasData data;
+        data.constant = constant;
+        data.clamp = clamp;
+        data.slope_factor = slope;
         
-        commands.push_back(command);
+        record(GFXCommandType::SetDepthBias, data);
     }
     
     void push_group(const std::string_view name) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::PushGroup;
-        command.data.push_group.name = name;
+        GFXDrawCommand::PushGroupData data;
+        data.name = name;
         
-        commands.push_back(command);
+        record(GFXCommandType::PushGroup, data);
     }
     
     void pop_group() {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::PopGroup;
-        
-        commands.push_back(command);
+        allocate(GFXCommandType::PopGroup, 0);
     }
     
     void insert_label(const std::string_view name) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::InsertLabel;
-        command.data.insert_label.name = name;
+        GFXDrawCommand::InsertLabelData data;
+        data.name = name;
         
-        commands.push_back(command);
+        record(GFXCommandType::InsertLabel, data);
     }
     
     void dispatch(const uint32_t group_count_x, const uint32_t group_count_y, const uint32_t group_count_z) {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::Dispatch;
-        command.data.dispatch.group_count_x = group_count_x;
-        command.data.dispatch.group_count_y = group_count_y;
-        command.data.dispatch.group_count_z = group_count_z;
+        GFXDrawCommand::DispatchData data;
+        data.group_count_x = group_count_x;
+        data.group_count_y = group_count_y;
+        data.group_count_z = group_count_z;
         
-        commands.push_back(command);
+        record(GFXCommandType::Dispatch, data);
     }
     
     void end_render_pass() {
-        GFXDrawCommand command;
-        command.type = GFXCommandType::EndRenderPass;
-        
-        commands.push_back(command);
+        allocate(GFXCommandType::EndRenderPass, 0);
     }
     
-    std::vector<GFXDrawCommand> commands;
+    /// Copies every command of another buffer to the end of this one and resets it, so parts of a frame can be recorded separately and then put back in order.
+    void append(GFXCommandBuffer& other) {
+        if(other.stream_size == 0)
+            return;
+
+        memcpy(reserve(other.stream_size), other.stream.data(), other.stream_size);
+        other.reset();
+    }
+
+    /// Forgets every recorded command, but keeps the memory around for the next time the buffer is recorded into.
+    void reset() {
+        stream_size = 0;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return stream_size == 0;
+    }
+
+    /// Walks the stream one command at a time, decoding each header as it goes.
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = GFXDrawCommand;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const GFXDrawCommand*;
+        using reference = GFXDrawCommand;
+
+        explicit iterator(const std::byte* cursor) : cursor(cursor) {}
+
+        GFXDrawCommand operator*() const {
+            Header header;
+            memcpy(&header, cursor, sizeof(Header));
+
+            GFXDrawCommand command;
+            command.type = header.type;
+            command.payload = cursor + sizeof(Header);
+
+            return command;
+        }
+
+        iterator& operator++() {
+            Header header;
+            memcpy(&header, cursor, sizeof(Header));
+
+            cursor += header.size;
+
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const { return cursor == other.cursor; }
+        bool operator!=(const iterator& other) const { return cursor != other.cursor; }
+
+    private:
+        const std::byte* cursor = nullptr;
+    };
+
+    [[nodiscard]] iterator begin() const {
+        return iterator(stream.data());
+    }
+
+    [[nodiscard]] iterator end() const {
+        return iterator(stream.data() + stream_size);
+    }
+
+private:
+    // every command starts with this, the size includes the header and any padding
+    struct Header {
+        GFXCommandType type = GFXCommandType::Invalid;
+        uint32_t size = 0;
+    };
+
+    // payloads hold pointers, so every command starts on an 8 byte boundary
+    static constexpr size_t command_alignment = 8;
+
+    static_assert(sizeof(Header) % command_alignment == 0);
+
+    template<typename T>
+    void record(const GFXCommandType type, const T& data) {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= command_alignment);
+
+        memcpy(allocate(type, sizeof(T)), &data, sizeof(T));
+    }
+
+    std::byte* allocate(const GFXCommandType type, const size_t payload_size) {
+        const size_t size = (sizeof(Header) + payload_size + command_alignment - 1) & ~(command_alignment - 1);
+
+        Header header;
+        header.type = type;
+        header.size = static_cast<uint32_t>(size);
+
+        std::byte* command = reserve(size);
+        memcpy(command, &header, sizeof(Header));
+
+        return command + sizeof(Header);
+    }
+
+    // grows geometrically so the arena settles on the size of the largest frame
+    std::byte* reserve(const size_t size) {
+        if(stream_size + size > stream.size())
+            stream.resize(std::max(stream_size + size, stream.size() * 2));
+
+        std::byte* result = stream.data() + stream_size;
+        stream_size += size;
+
+        return result;
+    }
+
+    std::vector<std::byte> stream;
+    size_t stream_size = 0; // the used part of the stream, which is never shrunk
 };
@@ -11,6 +11,7 @@
 
 #include <map>
 #include <array>
+#include <mutex>
 
 #include "gfx.hpp"
 #include "gfx_vulkan_constants.hpp"
@@ -40,6 +41,9 @@ struct NativeSurface {
 };
 
 class GFXVulkanPipeline;
+class GFXVulkanCommandBuffer;
+class GFXVulkanTexture;
+class GFXVulkanBuffer;
 
 class GFXVulkan : public GFX {
 public:
@@ -65,8 +69,11 @@ public:
     // texture operations
     GFXTexture* create_texture(const GFXTextureCreateInfo& info) override;
     void copy_texture(GFXTexture* texture, void* data, const GFXSize size) override;
+    void copy_texture(GFXTexture* texture, void* data, const GFXSize size, const std::vector<GFXTextureLevel>& levels) override;
     void copy_texture(GFXTexture* from, GFXTexture* to) override;
     void copy_texture(GFXTexture* from, GFXBuffer* to) override;
+    void destroy_texture(GFXTexture* texture) override;
+    void destroy_buffer(GFXBuffer* buffer) override;
 
 	// sampler operations
 	GFXSampler* create_sampler(const GFXSamplerCreateInfo& info) override;
@@ -81,6 +88,8 @@ public:
     GFXPipeline* create_graphics_pipeline(const GFXGraphicsPipelineCreateInfo& info) override;
     GFXPipeline* create_compute_pipeline(const GFXComputePipelineCreateInfo& info) override;
 
+    void save_pipeline_cache() override;
+
     // misc operations
 	GFXSize get_alignment(const GFXSize size) override;
 
@@ -93,7 +102,10 @@ private:
 	void createLogicalDevice(std::vector<const char*> extensions);
 	void createSwapchain(NativeSurface* native_surface, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
 	void createDescriptorPool();
+	void createPipelineCache();
     void createSyncPrimitives(NativeSurface* native_surface);
+    void releaseRetiredResources();
+    std::vector<VkDescriptorSet> takeDescriptorSetsUsing(GFXTexture* texture, GFXBuffer* buffer);
 
 	// dynamic descriptor sets
 	void resetDescriptorState();
@@ -120,13 +132,35 @@ private:
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	VkDevice device = VK_NULL_HANDLE;
 
+	bool supportsBlockCompression = false;
+
 	VkQueue graphicsQueue = VK_NULL_HANDLE;
 	VkQueue presentQueue = VK_NULL_HANDLE;
 
 	VkCommandPool commandPool = VK_NULL_HANDLE;
 
+	// submit translates every command right away, so one buffer (and its command arena) is reused for presentation every frame
+	GFXVulkanCommandBuffer* presentation_command_buffer = nullptr;
+
 	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
 
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+	// kept so cached descriptor sets can be invalidated when a texture is destroyed
+	std::vector<GFXVulkanPipeline*> pipelines;
+	std::mutex pipelines_mutex; // pipelines can be created from worker threads, this also guards retired_resources
+
+	// destroyed textures or buffers and the descriptor sets that used them, kept until every frame that could still read them has finished
+	struct RetiredResource {
+		GFXVulkanTexture* texture = nullptr;
+		GFXVulkanBuffer* buffer = nullptr;
+		std::vector<VkDescriptorSet> descriptor_sets;
+		uint64_t frame = 0;
+	};
+
+	std::vector<RetiredResource> retired_resources;
+	uint64_t presented_frames = 0;
+
     std::vector<NativeSurface*> native_surfaces;
 
 	struct BoundShaderBuffer {
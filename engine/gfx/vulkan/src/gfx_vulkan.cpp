@@ -5,6 +5,8 @@
 #include <cstddef>
 #include <array>
 #include <sstream>
+#include <algorithm>
+#include <fstream>
 
 #include "gfx_vulkan_buffer.hpp"
 #include "gfx_vulkan_pipeline.hpp"
@@ -56,6 +58,21 @@ VkFormat toVkFormat(GFXPixelFormat format) {
 
 	case GFXPixelFormat::DEPTH_32F:
 		return VK_FORMAT_D32_SFLOAT;
+
+    case GFXPixelFormat::BC1_UNORM:
+        return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+
+    case GFXPixelFormat::BC3_UNORM:
+        return VK_FORMAT_BC3_UNORM_BLOCK;
+
+    case GFXPixelFormat::BC4_UNORM:
+        return VK_FORMAT_BC4_UNORM_BLOCK;
+
+    case GFXPixelFormat::BC5_UNORM:
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+
+    case GFXPixelFormat::BC7_UNORM:
+        return VK_FORMAT_BC7_UNORM_BLOCK;
     }
 
 	return VK_FORMAT_UNDEFINED;
@@ -75,6 +92,12 @@ VkFormat toVkFormat(GFXVertexFormat format) {
         return VK_FORMAT_R32G32B32A32_SINT;
 	case GFXVertexFormat::UNORM4:
 		return VK_FORMAT_R8G8B8A8_UNORM;
+	case GFXVertexFormat::HALF2:
+		return VK_FORMAT_R16G16_SFLOAT;
+	case GFXVertexFormat::SNORM16_2:
+		return VK_FORMAT_R16G16_SNORM;
+	case GFXVertexFormat::UNORM10_10_10_2:
+		return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
 	}
 
 	return VK_FORMAT_UNDEFINED;
@@ -222,6 +245,7 @@ bool GFXVulkan::initialize(const GFXCreateInfo& info) {
 	createInstance({}, enabledExtensions);
 	createLogicalDevice({ VK_KHR_SWAPCHAIN_EXTENSION_NAME });
 	createDescriptorPool();
+	createPipelineCache();
 
     return true;
 }
@@ -507,6 +531,7 @@ GFXTexture* GFXVulkan::create_texture(const GFXTextureCreateInfo& info) {
 	samplerInfo.borderColor = toBorderColor(info.border_color);
 	samplerInfo.compareOp = toCompareFunc(info.compare_function);
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.maxLod = static_cast<float>(info.mip_count);
 
 	vkCreateSampler(device, &samplerInfo, nullptr, &texture->sampler);
 
@@ -578,6 +603,84 @@ void GFXVulkan::copy_texture(GFXTexture* texture, void* data, GFXSize size) {
 	endSingleTimeCommands(commandBuffer);
 }
 
+void GFXVulkan::copy_texture(GFXTexture* texture, void* data, GFXSize size, const std::vector<GFXTextureLevel>& levels) {
+	GFXVulkanTexture* vulkanTexture = (GFXVulkanTexture*)texture;
+
+	// create staging buffer, all levels share it and are uploaded in one submit
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	vkCreateBuffer(device, &bufferInfo, nullptr, &stagingBuffer);
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, stagingBuffer, &memRequirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	vkAllocateMemory(device, &allocInfo, nullptr, &stagingBufferMemory);
+
+	vkBindBufferMemory(device, stagingBuffer, stagingBufferMemory, 0);
+
+	void* mapped_data;
+	vkMapMemory(device, stagingBufferMemory, 0, size, 0, &mapped_data);
+	memcpy(mapped_data, data, size);
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+	std::vector<VkBufferImageCopy> regions;
+	for(const auto& level : levels) {
+		VkImageSubresourceRange range = {};
+		range.baseMipLevel = level.level;
+		range.levelCount = 1;
+		range.baseArrayLayer = 0;
+		range.layerCount = 1;
+
+		// the previous contents of the level are always discarded
+		inlineTransitionImageLayout(commandBuffer, vulkanTexture->handle, vulkanTexture->format, vulkanTexture->aspect, range, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = level.offset;
+		region.imageSubresource.aspectMask = vulkanTexture->aspect;
+		region.imageSubresource.mipLevel = level.level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = {
+			std::max((uint32_t)vulkanTexture->width >> level.level, 1u),
+			std::max((uint32_t)vulkanTexture->height >> level.level, 1u),
+			1
+		};
+
+		regions.push_back(region);
+	}
+
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, vulkanTexture->handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions.size(), regions.data());
+
+	for(const auto& level : levels) {
+		VkImageSubresourceRange range = {};
+		range.baseMipLevel = level.level;
+		range.levelCount = 1;
+		range.baseArrayLayer = 0;
+		range.layerCount = 1;
+
+		inlineTransitionImageLayout(commandBuffer, vulkanTexture->handle, vulkanTexture->format, vulkanTexture->aspect, range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	endSingleTimeCommands(commandBuffer);
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	vkFreeMemory(device, stagingBufferMemory, nullptr);
+}
+
 void GFXVulkan::copy_texture(GFXTexture* from, GFXTexture* to) {
     prism::log::error(System::GFX, "Copy Texture->Texture unimplemented!");
 }
@@ -604,6 +707,118 @@ void GFXVulkan::copy_texture(GFXTexture* from, GFXBuffer* to) {
 	endSingleTimeCommands(commandBuffer);
 }
 
+void GFXVulkan::destroy_texture(GFXTexture* texture) {
+	if(texture == nullptr)
+		return;
+
+	RetiredResource retired;
+	retired.texture = (GFXVulkanTexture*)texture;
+	retired.frame = presented_frames;
+
+	{
+		std::lock_guard lock(pipelines_mutex);
+
+		retired.descriptor_sets = takeDescriptorSetsUsing(texture, nullptr);
+		retired_resources.push_back(std::move(retired));
+	}
+
+	for(auto& bound_texture : boundTextures) {
+		if(bound_texture == texture)
+			bound_texture = nullptr;
+	}
+}
+
+void GFXVulkan::destroy_buffer(GFXBuffer* buffer) {
+	if(buffer == nullptr)
+		return;
+
+	RetiredResource retired;
+	retired.buffer = (GFXVulkanBuffer*)buffer;
+	retired.frame = presented_frames;
+
+	{
+		std::lock_guard lock(pipelines_mutex);
+
+		retired.descriptor_sets = takeDescriptorSetsUsing(nullptr, buffer);
+		retired_resources.push_back(std::move(retired));
+	}
+
+	for(auto& bound_buffer : boundShaderBuffers) {
+		if(bound_buffer.buffer == buffer)
+			bound_buffer.buffer = nullptr;
+	}
+}
+
+std::vector<VkDescriptorSet> GFXVulkan::takeDescriptorSetsUsing(GFXTexture* texture, GFXBuffer* buffer) {
+	std::vector<VkDescriptorSet> descriptor_sets;
+
+	// descriptor sets are cached by resource address, so the ones using it can't be found again once it's reused. frames in flight may still bind them, so they're freed with the resource
+	const auto uses = [](const auto& resources, const uint64_t hash, const auto resource) {
+		const auto it = resources.find(hash);
+
+		return resource != nullptr && it != resources.end() && utility::contains(it->second, resource);
+	};
+
+	for(auto pipeline : pipelines) {
+		for(auto it = pipeline->cachedDescriptorSets.begin(); it != pipeline->cachedDescriptorSets.end();) {
+			const bool uses_texture = uses(pipeline->cachedDescriptorTextures, it->first, texture);
+			const bool uses_buffer = uses(pipeline->cachedDescriptorBuffers, it->first, buffer);
+
+			if(!uses_texture && !uses_buffer) {
+				++it;
+				continue;
+			}
+
+			if(it->second != VK_NULL_HANDLE)
+				descriptor_sets.push_back(it->second);
+
+			pipeline->cachedDescriptorTextures.erase(it->first);
+			pipeline->cachedDescriptorBuffers.erase(it->first);
+
+			it = pipeline->cachedDescriptorSets.erase(it);
+		}
+	}
+
+	return descriptor_sets;
+}
+
+void GFXVulkan::releaseRetiredResources() {
+	std::lock_guard lock(pipelines_mutex);
+
+	// every surface keeps its own frames in flight, so this waits for the worst case across all of them
+	const uint64_t frames_in_flight = MAX_FRAMES_IN_FLIGHT * std::max<uint64_t>(native_surfaces.size(), 1);
+
+	utility::erase_if(retired_resources, [this, frames_in_flight](RetiredResource& retired) {
+		if(retired.frame + frames_in_flight > presented_frames)
+			return false;
+
+		// commands recorded before the resource was destroyed are only translated on submit, so sets using it can be cached after it was retired
+		const auto late_descriptor_sets = takeDescriptorSetsUsing(retired.texture, retired.buffer);
+		retired.descriptor_sets.insert(retired.descriptor_sets.end(), late_descriptor_sets.begin(), late_descriptor_sets.end());
+
+		if(!retired.descriptor_sets.empty())
+			vkFreeDescriptorSets(device, descriptorPool, static_cast<uint32_t>(retired.descriptor_sets.size()), retired.descriptor_sets.data());
+
+		if(retired.texture != nullptr) {
+			vkDestroySampler(device, retired.texture->sampler, nullptr);
+			vkDestroyImageView(device, retired.texture->view, nullptr);
+			vkDestroyImage(device, retired.texture->handle, nullptr);
+			vkFreeMemory(device, retired.texture->memory, nullptr);
+
+			delete retired.texture;
+		}
+
+		if(retired.buffer != nullptr) {
+			vkDestroyBuffer(device, retired.buffer->handle, nullptr);
+			vkFreeMemory(device, retired.buffer->memory, nullptr);
+
+			delete retired.buffer;
+		}
+
+		return true;
+	});
+}
+
 GFXSampler* GFXVulkan::create_sampler(const GFXSamplerCreateInfo& info) {
 	GFXVulkanSampler* sampler = new GFXVulkanSampler();
 
@@ -698,7 +913,21 @@ GFXRenderPass* GFXVulkan::create_render_pass(const GFXRenderPassCreateInfo& info
 		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         
-        if(info.will_use_in_shader) {
+        if(info.keep_contents) {
+            // the attachments are expected in the layout sampled textures are kept in, which is also where copies leave them
+            attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            
+            if(info.will_use_in_shader) {
+                attachment.initialLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            } else if(isDepthAttachment) {
+                attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            } else {
+                attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+                attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            }
+        } else if(info.will_use_in_shader) {
             if(isDepthAttachment) {
                 attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
             } else {
@@ -764,7 +993,7 @@ GFXRenderPass* GFXVulkan::create_render_pass(const GFXRenderPassCreateInfo& info
 GFXPipeline* GFXVulkan::create_graphics_pipeline(const GFXGraphicsPipelineCreateInfo& info) {
 	GFXVulkanPipeline* pipeline = new GFXVulkanPipeline();
 
-	vkDeviceWaitIdle(device);
+	// creating a pipeline doesn't touch any work in flight, so there's no need to wait for the device. that also keeps this safe to call from worker threads
 
 	VkShaderModule vertex_module = VK_NULL_HANDLE, fragment_module = VK_NULL_HANDLE;
 
@@ -1040,13 +1269,16 @@ GFXPipeline* GFXVulkan::create_graphics_pipeline(const GFXGraphicsPipelineCreate
 	if (info.render_pass != nullptr && ((GFXVulkanRenderPass*)info.render_pass)->hasDepthAttachment)
 		pipelineInfo.pDepthStencilState = &depthStencil;
 
-	vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline->handle);
+	vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline->handle);
 
     pipeline->label = info.label;
 
 	name_object(device, VK_OBJECT_TYPE_PIPELINE, (uint64_t)pipeline->handle, pipeline->label);
 	name_object(device, VK_OBJECT_TYPE_PIPELINE_LAYOUT, (uint64_t)pipeline->layout, pipeline->label);
 
+	std::lock_guard lock(pipelines_mutex);
+	pipelines.push_back(pipeline);
+
 	return pipeline;
 }
 
@@ -1157,16 +1389,33 @@ GFXPipeline* GFXVulkan::create_compute_pipeline(const GFXComputePipelineCreateIn
     pipelineInfo.stage = shaderStageInfo;
     pipelineInfo.layout = pipeline->layout;
 
-    vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline->handle);
+    vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline->handle);
 
     pipeline->label = info.label;
 
     name_object(device, VK_OBJECT_TYPE_PIPELINE, (uint64_t)pipeline->handle, pipeline->label);
     name_object(device, VK_OBJECT_TYPE_PIPELINE_LAYOUT, (uint64_t)pipeline->layout, pipeline->label);
 
+    std::lock_guard lock(pipelines_mutex);
+    pipelines.push_back(pipeline);
+
     return pipeline;
 }
 
+void GFXVulkan::save_pipeline_cache() {
+	if (pipelineCache == VK_NULL_HANDLE)
+		return;
+
+	size_t size = 0;
+	vkGetPipelineCacheData(device, pipelineCache, &size, nullptr);
+
+	std::vector<char> data(size);
+	vkGetPipelineCacheData(device, pipelineCache, &size, data.data());
+
+	std::ofstream out(prism::get_writeable_directory() / "pipeline_cache.bin", std::ios::binary);
+	out.write(data.data(), static_cast<std::streamsize>(size));
+}
+
 GFXSize GFXVulkan::get_alignment(GFXSize size) {
 	VkPhysicalDeviceProperties properties;
 	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
@@ -1176,17 +1425,24 @@ GFXSize GFXVulkan::get_alignment(GFXSize size) {
 }
 
 GFXCommandBuffer* GFXVulkan::acquire_command_buffer(bool for_presentation_use) {
+    if(for_presentation_use) {
+        if(presentation_command_buffer == nullptr)
+            presentation_command_buffer = new GFXVulkanCommandBuffer();
+
+        presentation_command_buffer->reset();
+
+        return presentation_command_buffer;
+    }
+
     GFXVulkanCommandBuffer* cmdbuf = new GFXVulkanCommandBuffer();
     
-    if(!for_presentation_use) {
-        VkCommandBufferAllocateInfo info = {};
-        info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        info.commandPool = commandPool;
-        info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        info.commandBufferCount = 1;
-        
-        vkAllocateCommandBuffers(device, &info, &cmdbuf->handle);
-    }
+    VkCommandBufferAllocateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    info.commandPool = commandPool;
+    info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    info.commandBufferCount = 1;
+    
+    vkAllocateCommandBuffers(device, &info, &cmdbuf->handle);
     
 	return cmdbuf;
 }
@@ -1202,6 +1458,8 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
     if(identifier != -1 && current_surface != nullptr) {
         vkWaitForFences(device, 1, &current_surface->inFlightFences[current_surface->currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
 
+        releaseRetiredResources();
+
         VkResult result = vkAcquireNextImageKHR(device, current_surface->swapchain, std::numeric_limits<uint64_t>::max(), current_surface->imageAvailableSemaphores[current_surface->currentFrame], VK_NULL_HANDLE, &imageIndex);
         if (result == VK_ERROR_OUT_OF_DATE_KHR)
             return;
@@ -1249,7 +1507,7 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
 		return true;
 	};
 
-	for (const auto& command : command_buffer->commands) {
+	for (const auto command : *command_buffer) {
 		switch (command.type) {
         case GFXCommandType::SetRenderPass:
         {
@@ -1258,8 +1516,8 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
                 vkCmdEndRenderPass(cmd);
             }
             
-            GFXVulkanRenderPass* renderPass = (GFXVulkanRenderPass*)command.data.set_render_pass.render_pass;
-            GFXVulkanFramebuffer* framebuffer = (GFXVulkanFramebuffer*)command.data.set_render_pass.framebuffer;
+            GFXVulkanRenderPass* renderPass = (GFXVulkanRenderPass*)command.set_render_pass().render_pass;
+            GFXVulkanFramebuffer* framebuffer = (GFXVulkanFramebuffer*)command.set_render_pass().framebuffer;
             
             if (renderPass != nullptr) {
                 currentRenderPass = renderPass->handle;
@@ -1307,8 +1565,8 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
                 vkCmdSetScissor(cmd, 0, 1, &scissor);
             }
             
-            renderPassInfo.renderArea.offset = { command.data.set_render_pass.render_area.offset.x, command.data.set_render_pass.render_area.offset.y };
-            renderPassInfo.renderArea.extent = { command.data.set_render_pass.render_area.extent.width, command.data.set_render_pass.render_area.extent.height };
+            renderPassInfo.renderArea.offset = { command.set_render_pass().render_area.offset.x, command.set_render_pass().render_area.offset.y };
+            renderPassInfo.renderArea.extent = { command.set_render_pass().render_area.extent.width, command.set_render_pass().render_area.extent.height };
             
             std::vector<VkClearValue> clearColors;
             if (renderPass != nullptr) {
@@ -1318,10 +1576,10 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
                 clearColors.resize(1);
             }
             
-            clearColors[0].color.float32[0] = command.data.set_render_pass.clear_color.r;
-            clearColors[0].color.float32[1] = command.data.set_render_pass.clear_color.g;
-            clearColors[0].color.float32[2] = command.data.set_render_pass.clear_color.b;
-            clearColors[0].color.float32[3] = command.data.set_render_pass.clear_color.a;
+            clearColors[0].color.float32[0] = command.set_render_pass().clear_color.r;
+            clearColors[0].color.float32[1] = command.set_render_pass().clear_color.g;
+            clearColors[0].color.float32[2] = command.set_render_pass().clear_color.b;
+            clearColors[0].color.float32[3] = command.set_render_pass().clear_color.a;
             
             if(renderPass != nullptr) {
                 if(renderPass->depth_attachment != -1)
@@ -1338,7 +1596,7 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
         break;
 		case GFXCommandType::SetGraphicsPipeline:
 		{
-			currentPipeline = (GFXVulkanPipeline*)command.data.set_graphics_pipeline.pipeline;
+			currentPipeline = (GFXVulkanPipeline*)command.set_graphics_pipeline().pipeline;
 			if(currentPipeline != nullptr) {
                 vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, currentPipeline->handle);
 
@@ -1351,7 +1609,7 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
 		break;
         case GFXCommandType::SetComputePipeline:
         {
-            currentPipeline = (GFXVulkanPipeline*)command.data.set_compute_pipeline.pipeline;
+            currentPipeline = (GFXVulkanPipeline*)command.set_compute_pipeline().pipeline;
             if(currentPipeline != nullptr) {
                 vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, currentPipeline->handle);
 
@@ -1364,18 +1622,18 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
             break;
 		case GFXCommandType::SetVertexBuffer:
 		{
-            VkBuffer buffer = ((GFXVulkanBuffer*)command.data.set_vertex_buffer.buffer)->handle;
-			VkDeviceSize offset = command.data.set_vertex_buffer.offset;
-			vkCmdBindVertexBuffers(cmd, command.data.set_vertex_buffer.index, 1, &buffer, &offset);
+            VkBuffer buffer = ((GFXVulkanBuffer*)command.set_vertex_buffer().buffer)->handle;
+			VkDeviceSize offset = command.set_vertex_buffer().offset;
+			vkCmdBindVertexBuffers(cmd, command.set_vertex_buffer().index, 1, &buffer, &offset);
 		}
 			break;
 		case GFXCommandType::SetIndexBuffer:
 		{
 			VkIndexType indexType = VK_INDEX_TYPE_UINT32;
-			if (command.data.set_index_buffer.index_type == IndexType::UINT16)
+			if (command.set_index_buffer().index_type == IndexType::UINT16)
 				indexType = VK_INDEX_TYPE_UINT16;
 
-            vkCmdBindIndexBuffer(cmd, ((GFXVulkanBuffer*)command.data.set_index_buffer.buffer)->handle, 0, indexType);
+            vkCmdBindIndexBuffer(cmd, ((GFXVulkanBuffer*)command.set_index_buffer().buffer)->handle, 0, indexType);
 		}
 			break;
         case GFXCommandType::SetPushConstant:
@@ -1385,59 +1643,57 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
 		        applicableStages = VK_SHADER_STAGE_COMPUTE_BIT;
 
 			if(currentPipeline != nullptr)
-				vkCmdPushConstants(cmd, currentPipeline->layout, applicableStages , 0, command.data.set_push_constant.size, command.data.set_push_constant.bytes.data());
+				vkCmdPushConstants(cmd, currentPipeline->layout, applicableStages , 0, command.set_push_constant().size, command.set_push_constant().bytes);
 		}
 			break;
         case GFXCommandType::BindShaderBuffer:
 		{
 			BoundShaderBuffer bsb;
-			bsb.buffer = command.data.bind_shader_buffer.buffer;
-			bsb.offset = command.data.bind_shader_buffer.offset;
-			bsb.size = command.data.bind_shader_buffer.size;
+			bsb.buffer = command.bind_shader_buffer().buffer;
+			bsb.offset = command.bind_shader_buffer().offset;
+			bsb.size = command.bind_shader_buffer().size;
 
-			boundShaderBuffers[command.data.bind_shader_buffer.index] = bsb;
+			boundShaderBuffers[command.bind_shader_buffer().index] = bsb;
 		}
 			break;
 		case GFXCommandType::BindTexture:
 		{
-			boundTextures[command.data.bind_texture.index] = command.data.bind_texture.texture;
+			boundTextures[command.bind_texture().index] = command.bind_texture().texture;
 		}
 		break;
 		case GFXCommandType::BindSampler:
 		{
-			boundSamplers[command.data.bind_sampler.index] = command.data.bind_sampler.sampler;
+			boundSamplers[command.bind_sampler().index] = command.bind_sampler().sampler;
 		}
 		break;
 		case GFXCommandType::Draw:
 		{
 			if(try_bind_descriptor()) {
-                vkCmdDraw(cmd, command.data.draw.vertex_count, command.data.draw.instance_count,
-                          command.data.draw.vertex_offset, command.data.draw.base_instance);
+                vkCmdDraw(cmd, command.draw().vertex_count, command.draw().instance_count,
+                          command.draw().vertex_offset, command.draw().base_instance);
             }
 		}
 			break;
 		case GFXCommandType::DrawIndexed:
 		{
 			if(try_bind_descriptor())
-				vkCmdDrawIndexed(cmd, command.data.draw_indexed.index_count, 1, command.data.draw_indexed.first_index, command.data.draw_indexed.vertex_offset, 0);
+				vkCmdDrawIndexed(cmd, command.draw_indexed().index_count, command.draw_indexed().instance_count, command.draw_indexed().first_index, command.draw_indexed().vertex_offset, command.draw_indexed().base_instance);
 		}
 		break;
 		case GFXCommandType::SetDepthBias:
 		{
-			vkCmdSetDepthBias(cmd, command.data.set_depth_bias.constant, command.data.set_depth_bias.clamp, command.data.set_depth_bias.slope_factor);
+			vkCmdSetDepthBias(cmd, command.set_depth_bias().constant, command.set_depth_bias().clamp, command.set_depth_bias().slope_factor);
 		}
 		break;
         case GFXCommandType::CopyTexture:
         {
-            GFXVulkanTexture* src = (GFXVulkanTexture*)command.data.copy_texture.src;
-            GFXVulkanTexture* dst = (GFXVulkanTexture*)command.data.copy_texture.dst;
-
-            const int slice_offset = command.data.copy_texture.to_slice + command.data.copy_texture.to_layer * 6;
+            GFXVulkanTexture* src = (GFXVulkanTexture*)command.copy_texture().src;
+            GFXVulkanTexture* dst = (GFXVulkanTexture*)command.copy_texture().dst;
 
             VkImageSubresourceRange dstRange = {};
             dstRange.layerCount = 1;
-            dstRange.baseArrayLayer = slice_offset;
-            dstRange.baseMipLevel = command.data.copy_texture.to_level;
+            dstRange.baseArrayLayer = command.copy_texture().get_to_array_layer();
+            dstRange.baseMipLevel = command.copy_texture().to_level;
             dstRange.levelCount = 1;
             dstRange.aspectMask = dst->aspect;
 
@@ -1445,10 +1701,11 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
             inlineTransitionImageLayout(cmd, dst->handle, dst->format, dst->aspect, dstRange, dst->layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
             VkImageCopy region = {};
-            region.extent.width = static_cast<uint32_t>(command.data.copy_texture.width);
-            region.extent.height = static_cast<uint32_t>(command.data.copy_texture.height);
+            region.extent.width = static_cast<uint32_t>(command.copy_texture().width);
+            region.extent.height = static_cast<uint32_t>(command.copy_texture().height);
             region.extent.depth = 1.0f;
 
+            region.srcSubresource.baseArrayLayer = command.copy_texture().get_from_array_layer();
             region.srcSubresource.layerCount = 1;
             region.srcSubresource.aspectMask = src->aspect;
 
@@ -1466,17 +1723,17 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
         case GFXCommandType::SetViewport:
         {
             VkViewport viewport = {};
-            viewport.x = command.data.set_viewport.viewport.x;
-            viewport.y = command.data.set_viewport.viewport.height - command.data.set_viewport.viewport.y;
-            viewport.width = command.data.set_viewport.viewport.width;
-            viewport.height = -command.data.set_viewport.viewport.height;
+            viewport.x = command.set_viewport().viewport.x;
+            viewport.y = command.set_viewport().viewport.height - command.set_viewport().viewport.y;
+            viewport.width = command.set_viewport().viewport.width;
+            viewport.height = -command.set_viewport().viewport.height;
             viewport.maxDepth = 1.0f;
 
             vkCmdSetViewport(cmd, 0, 1, &viewport);
 
             VkRect2D scissor = {};
-            scissor.extent.width = command.data.set_viewport.viewport.width;
-            scissor.extent.height = command.data.set_viewport.viewport.height;
+            scissor.extent.width = command.set_viewport().viewport.width;
+            scissor.extent.height = command.set_viewport().viewport.height;
 
             vkCmdSetScissor(cmd, 0, 1, &scissor);
         }
@@ -1489,6 +1746,19 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
             }
 		}
 		break;
+        case GFXCommandType::MemoryBarrier:
+        {
+            // render passes don't declare a self-dependency, so barriers are only possible outside of one
+            if(currentRenderPass == nullptr) {
+                VkMemoryBarrier barrier = {};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+                vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+            }
+        }
+            break;
         case GFXCommandType::Dispatch:
         {
             if(try_bind_descriptor()) {
@@ -1497,8 +1767,8 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
                     inlineTransitionImageLayout(cmd, tex->handle, tex->format, tex->aspect, tex->range, tex->current_layout, VK_IMAGE_LAYOUT_GENERAL);
                 }
 
-                vkCmdDispatch(cmd, command.data.dispatch.group_count_x, command.data.dispatch.group_count_y,
-                              command.data.dispatch.group_count_z);
+                vkCmdDispatch(cmd, command.dispatch().group_count_x, command.dispatch().group_count_y,
+                              command.dispatch().group_count_z);
 
                 for(auto binding : currentPipeline->bindings_marked_as_storage_images) {
                     auto tex = (GFXVulkanTexture*)boundTextures[binding];
@@ -1522,7 +1792,7 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
         {
             VkDebugUtilsLabelEXT marker_info = {};
             marker_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
-            marker_info.pLabelName = command.data.push_group.name.data();
+            marker_info.pLabelName = command.push_group().name.data();
 
             cmd_debug_marker_begin(device, cmd, marker_info);
         }
@@ -1534,7 +1804,7 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
             break;
         case GFXCommandType::GenerateMipmaps:
         {
-            auto texture = static_cast<GFXVulkanTexture*>(command.data.generate_mipmaps.texture);
+            auto texture = static_cast<GFXVulkanTexture*>(command.generate_mipmaps().texture);
 
             for(int l = 0; l < texture->range.layerCount; l++) {
                 int mip_width = texture->width;
@@ -1559,7 +1829,7 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
                                                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
                 }
 
-                for (int i = 1; i < command.data.generate_mipmaps.mip_count; i++) {
+                for (int i = 1; i < command.generate_mipmaps().mip_count; i++) {
                     VkImageSubresourceRange range = {};
                     range.layerCount = 1;
                     range.baseArrayLayer = l;
@@ -1620,7 +1890,7 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
                 range.layerCount = 1;
                 range.baseArrayLayer = l;
                 range.baseMipLevel = 0;
-                range.levelCount = command.data.generate_mipmaps.mip_count;
+                range.levelCount = command.generate_mipmaps().mip_count;
                 range.aspectMask = texture->aspect;
 
                 inlineTransitionImageLayout(cmd,
@@ -1689,6 +1959,7 @@ void GFXVulkan::submit(GFXCommandBuffer* command_buffer, const int identifier) {
         vkQueuePresentKHR(presentQueue, &presentInfo);
         
         current_surface->currentFrame = (current_surface->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        presented_frames++;
     }
 }
 
@@ -1700,6 +1971,12 @@ bool GFXVulkan::supports_feature(const GFXFeature feature) {
     if(feature == GFXFeature::CubemapArray)
         return true;
 
+    if(feature == GFXFeature::BlockCompression)
+        return supportsBlockCompression;
+
+    if(feature == GFXFeature::AsyncPipelineCreation)
+        return true;
+
     return false;
 }
 
@@ -1805,6 +2082,13 @@ void GFXVulkan::createLogicalDevice(std::vector<const char*> extensions) {
 	enabledFeatures.fillModeNonSolid = true;
 	enabledFeatures.imageCubeArray = true;
 
+	// software devices and some mobile hardware don't expose bc, textures are decoded on the cpu instead
+	VkPhysicalDeviceFeatures supportedFeatures = {};
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+	supportsBlockCompression = supportedFeatures.textureCompressionBC;
+	enabledFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
 	createInfo.pEnabledFeatures = &enabledFeatures;
 
 	vkCreateDevice(physicalDevice, &createInfo, nullptr, &device);
@@ -2029,6 +2313,52 @@ void GFXVulkan::createDescriptorPool() {
 	vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool);
 }
 
+void GFXVulkan::createPipelineCache() {
+	std::vector<char> data;
+
+	std::ifstream in(prism::get_writeable_directory() / "pipeline_cache.bin", std::ios::binary);
+	if (in)
+		data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+	// the header is laid out as the header size, header version, vendor id, device id and then the cache uuid
+	struct PipelineCacheHeader {
+		uint32_t headerSize, headerVersion, vendorID, deviceID;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	};
+
+	// the driver should reject caches from other devices itself, but not all of them do
+	if (data.size() >= sizeof(PipelineCacheHeader)) {
+		PipelineCacheHeader header = {};
+		memcpy(&header, data.data(), sizeof(PipelineCacheHeader));
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+			header.vendorID != properties.vendorID ||
+			header.deviceID != properties.deviceID ||
+			memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+			prism::log::info(System::GFX, "Discarding pipeline cache from a different device or driver");
+
+			data.clear();
+		}
+	} else {
+		data.clear();
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+		// a cache is only an optimization, so pipelines are still created without one
+		prism::log::error(System::GFX, "Failed to create pipeline cache!");
+
+		pipelineCache = VK_NULL_HANDLE;
+	}
+}
+
 void GFXVulkan::createSyncPrimitives(NativeSurface* native_surface) {
     native_surface->imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     native_surface->renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -2158,6 +2488,22 @@ void GFXVulkan::cacheDescriptorState(GFXVulkanPipeline* pipeline, VkDescriptorSe
 	}
 
 	pipeline->cachedDescriptorSets[hash] = descriptorSet;
+
+	auto& textures = pipeline->cachedDescriptorTextures[hash];
+	textures.clear();
+
+	for(auto texture : boundTextures) {
+		if(texture != nullptr)
+			textures.push_back(texture);
+	}
+
+	auto& buffers = pipeline->cachedDescriptorBuffers[hash];
+	buffers.clear();
+
+	for(auto& buffer : boundShaderBuffers) {
+		if(buffer.buffer != nullptr)
+			buffers.push_back(buffer.buffer);
+	}
 }
 
 uint64_t GFXVulkan::getDescriptorHash(GFXVulkanPipeline* pipeline) {
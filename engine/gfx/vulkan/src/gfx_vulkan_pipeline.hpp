@@ -2,9 +2,13 @@
 
 #include <vulkan/vulkan.h>
 
+#include <map>
+#include <vector>
+
 #include "gfx_pipeline.hpp"
 
 class GFXVulkanTexture;
+class GFXTexture;
 
 class GFXVulkanPipeline : public GFXPipeline {
 public:
@@ -21,4 +25,6 @@ public:
 
     // dynamic descriptor sets
     std::map<uint64_t, VkDescriptorSet> cachedDescriptorSets;
+    std::map<uint64_t, std::vector<GFXTexture*>> cachedDescriptorTextures; // what was written into each set, so destroying a texture only drops the sets using it
+    std::map<uint64_t, std::vector<GFXBuffer*>> cachedDescriptorBuffers; // same for buffers
 };
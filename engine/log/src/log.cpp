@@ -3,10 +3,16 @@
 #include <iostream>
 #include <chrono>
 #include <iomanip>
+#include <mutex>
 #include "string_utils.hpp"
 #include "utility.hpp"
 
+// messages can come from worker threads too
+static std::mutex output_mutex;
+
 void prism::log::process_message(const Level level, const System system, const std::string_view message) {
+    std::lock_guard lock(output_mutex);
+    
     auto now = std::chrono::system_clock::now();
     std::time_t t_c = std::chrono::system_clock::to_time_t(now);
     
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 
 #include "vector.hpp"
+#include "matrix.hpp"
 
 namespace prism {
     /// A 3D axis aligned bounding box.
@@ -22,4 +25,59 @@ namespace prism {
                 float3(aabb.min.x, aabb.max.y, aabb.max.z),
                 float3(aabb.max.x, aabb.max.y, aabb.max.z)};
     }
-}
\ No newline at end of file
+
+    /// The smallest bounding box containing both boxes.
+    inline aabb merge(const aabb& a, const aabb& b) {
+        aabb result;
+        for(int i = 0; i < 3; i++) {
+            result.min[i] = std::min(a.min[i], b.min[i]);
+            result.max[i] = std::max(a.max[i], b.max[i]);
+        }
+
+        return result;
+    }
+
+    /// Returns true if inner is completely inside of outer, touching edges count as inside.
+    inline bool contains(const aabb& outer, const aabb& inner) {
+        for(int i = 0; i < 3; i++) {
+            if(inner.min[i] < outer.min[i] || inner.max[i] > outer.max[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    inline bool overlaps(const aabb& a, const aabb& b) {
+        for(int i = 0; i < 3; i++) {
+            if(a.max[i] < b.min[i] || a.min[i] > b.max[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    /** The smallest world space box containing the box after it's transformed, including any rotation.
+     The center is transformed as a point, and each axis of the new extent is how far the old extent reaches along it.
+     */
+    inline aabb transform_aabb(const aabb& aabb, const Matrix4x4& matrix) {
+        const float3 center = (aabb.min + aabb.max) * 0.5f;
+        const float3 extent = (aabb.max - aabb.min) * 0.5f;
+
+        float3 new_center, new_extent;
+        for(int row = 0; row < 3; row++) {
+            new_center[row] = matrix.data[3][row];
+
+            for(int column = 0; column < 3; column++) {
+                new_center[row] += matrix.data[column][row] * center[column];
+                new_extent[row] += std::abs(matrix.data[column][row]) * extent[column];
+            }
+        }
+
+        return {new_center - new_extent, new_center + new_extent};
+    }
+
+    inline float get_surface_area(const aabb& aabb) {
+        const float3 size = aabb.max - aabb.min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+}
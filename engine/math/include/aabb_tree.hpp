@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "aabb.hpp"
+
+namespace prism {
+    struct aabb_tree_statistics {
+        uint32_t nodes_tested = 0; // inner nodes and leaves
+        uint32_t objects_traversed = 0; // leaves that were reached and tested themselves
+        uint32_t objects_visible = 0;
+        uint32_t objects_culled = 0; // everything in the tree that wasn't visible, whether it was reached or skipped with its parent
+    };
+
+    /** A bounding volume hierarchy over boxes that move, where every leaf is one object.
+     Leaves are enlarged by a margin, so an object that only moves a little stays inside of its leaf and the tree doesn't change.
+     When an object does leave its leaf, it's removed and inserted again where it grows the tree the least, and the nodes above it are rotated to stay balanced.
+     */
+    class aabb_tree {
+    public:
+        static constexpr int null_node = -1;
+
+        /// @param margin How far leaves are enlarged on every side, in the same units as the boxes.
+        explicit aabb_tree(float margin = 0.1f) : margin(margin) {}
+
+        /// Returns the leaf for the object, which stays the same until it's removed.
+        int insert(const aabb& bounds, uint64_t user_data);
+
+        void remove(int leaf);
+
+        /// Returns true if the bounds left the leaf, and it had to be moved in the tree.
+        bool update(int leaf, const aabb& bounds);
+
+        void clear();
+
+        [[nodiscard]] uint64_t get_user_data(const int leaf) const {
+            return nodes[leaf].user_data;
+        }
+
+        /// The bounds of the leaf, which includes the margin.
+        [[nodiscard]] const aabb& get_bounds(const int leaf) const {
+            return nodes[leaf].bounds;
+        }
+
+        [[nodiscard]] size_t size() const {
+            return leaf_count;
+        }
+
+        /// A tree with only a root has a height of 0.
+        [[nodiscard]] int get_height() const {
+            return root == null_node ? 0 : nodes[root].height;
+        }
+
+        /** Calls visitor with the user data of every leaf where test returns true. A node that fails the test isn't descended into,
+         so test has to be conservative: if it fails for a box, it has to fail for every box inside of it too (like a frustum or overlap test).
+         This only reads the tree, so several queries can run at once.
+         @param statistics If not null, what was tested is added to it.
+         */
+        template<typename Test, typename Visitor>
+        void query(Test&& test, Visitor&& visitor, aabb_tree_statistics* statistics = nullptr) const {
+            uint32_t nodes_tested = 0, objects_traversed = 0, objects_visible = 0;
+
+            // the tree is kept balanced, so its height is logarithmic and can't get close to this
+            int stack[max_query_depth];
+            int stack_size = 0;
+
+            if(root != null_node)
+                stack[stack_size++] = root;
+
+            while(stack_size > 0) {
+                const auto& node = nodes[stack[--stack_size]];
+
+                nodes_tested++;
+
+                if(node.is_leaf())
+                    objects_traversed++;
+
+                if(!test(node.bounds))
+                    continue;
+
+                if(node.is_leaf()) {
+                    objects_visible++;
+                    visitor(node.user_data);
+                } else {
+                    stack[stack_size++] = node.left;
+                    stack[stack_size++] = node.right;
+                }
+            }
+
+            if(statistics != nullptr) {
+                statistics->nodes_tested += nodes_tested;
+                statistics->objects_traversed += objects_traversed;
+                statistics->objects_visible += objects_visible;
+                statistics->objects_culled += static_cast<uint32_t>(leaf_count) - objects_visible;
+            }
+        }
+
+    private:
+        static constexpr int max_query_depth = 128;
+
+        struct node {
+            aabb bounds;
+            uint64_t user_data = 0;
+
+            int parent = null_node; // or the next free node, if this one isn't used
+            int left = null_node, right = null_node;
+
+            // leaves are 0, and unused nodes are -1
+            int height = 0;
+
+            [[nodiscard]] bool is_leaf() const {
+                return left == null_node;
+            }
+        };
+
+        int allocate_node();
+        void free_node(int index);
+
+        void insert_leaf(int leaf);
+        void remove_leaf(int leaf);
+
+        // rotates the taller child up if the children of the node are unbalanced, and returns whichever node is now in its place
+        int balance(int index);
+
+        // recalculates the bounds and height of every node from index to the root
+        void refit(int index);
+
+        float margin = 0.1f;
+
+        std::vector<node> nodes;
+        int root = null_node;
+        int free_list = null_node;
+        size_t leaf_count = 0;
+    };
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "aabb.hpp"
+#include "plane.hpp"
+
+namespace prism {
+    /// Boxes stored as separate arrays of centers and extents (half of their size), so several of them can be loaded at once.
+    struct aabb_soa {
+        std::vector<float> center_x, center_y, center_z;
+        std::vector<float> extent_x, extent_y, extent_z;
+
+        void clear();
+
+        void push_back(const aabb& aabb);
+
+        [[nodiscard]] aabb get(size_t index) const;
+
+        [[nodiscard]] size_t size() const {
+            return center_x.size();
+        }
+    };
+
+    using frustum_planes = std::array<Plane, 6>;
+
+    /** Returns true if any part of the box is on the positive side of every plane.
+     Only the corner furthest along each plane's normal has to be tested, which is the center plus the extent projected onto the normal.
+     This gives the same result as testing all 8 corners, and the planes don't have to be normalized.
+     */
+    bool test_aabb_planes(const frustum_planes& planes, const aabb& aabb);
+
+    /** Tests every box like test_aabb_planes, and sets visible[i] to 1 if box i passes or 0 if it doesn't.
+     Boxes are tested 8 at a time when compiled with AVX, and 4 at a time with SSE2 (which every x86-64 target has). Other targets test them one at a time.
+     */
+    void test_aabbs_planes(const frustum_planes& planes, const aabb_soa& bounds, std::vector<uint8_t>& visible);
+}
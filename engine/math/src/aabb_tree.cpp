@@ -0,0 +1,235 @@
+#include "aabb_tree.hpp"
+
+#include <algorithm>
+
+namespace {
+    prism::aabb enlarge(const prism::aabb& bounds, const float margin) {
+        prism::aabb result = bounds;
+        result.min = result.min - prism::float3(margin);
+        result.max = result.max + prism::float3(margin);
+
+        return result;
+    }
+}
+
+int prism::aabb_tree::insert(const aabb& bounds, const uint64_t user_data) {
+    const int leaf = allocate_node();
+
+    auto& node = nodes[leaf];
+    node.bounds = enlarge(bounds, margin);
+    node.user_data = user_data;
+    node.height = 0;
+
+    insert_leaf(leaf);
+
+    leaf_count++;
+
+    return leaf;
+}
+
+void prism::aabb_tree::remove(const int leaf) {
+    remove_leaf(leaf);
+    free_node(leaf);
+
+    leaf_count--;
+}
+
+bool prism::aabb_tree::update(const int leaf, const aabb& bounds) {
+    if(contains(nodes[leaf].bounds, bounds))
+        return false;
+
+    remove_leaf(leaf);
+
+    nodes[leaf].bounds = enlarge(bounds, margin);
+
+    insert_leaf(leaf);
+
+    return true;
+}
+
+void prism::aabb_tree::clear() {
+    nodes.clear();
+    root = null_node;
+    free_list = null_node;
+    leaf_count = 0;
+}
+
+int prism::aabb_tree::allocate_node() {
+    if(free_list == null_node) {
+        nodes.emplace_back();
+        return static_cast<int>(nodes.size() - 1);
+    }
+
+    const int index = free_list;
+    free_list = nodes[index].parent;
+
+    nodes[index] = node();
+
+    return index;
+}
+
+void prism::aabb_tree::free_node(const int index) {
+    nodes[index].parent = free_list;
+    nodes[index].height = -1;
+
+    free_list = index;
+}
+
+void prism::aabb_tree::insert_leaf(const int leaf) {
+    if(root == null_node) {
+        root = leaf;
+        nodes[leaf].parent = null_node;
+        return;
+    }
+
+    const aabb leaf_bounds = nodes[leaf].bounds;
+
+    // walk down towards whichever side the leaf would grow the least, using the surface area as the cost of a node
+    int index = root;
+    while(!nodes[index].is_leaf()) {
+        const auto& node = nodes[index];
+
+        const float area = get_surface_area(node.bounds);
+        const float combined_area = get_surface_area(merge(node.bounds, leaf_bounds));
+
+        // making a new parent for this node and the leaf
+        const float cost = 2.0f * combined_area;
+
+        // going further down still grows this node
+        const float inheritance_cost = 2.0f * (combined_area - area);
+
+        const auto get_descend_cost = [this, &leaf_bounds, inheritance_cost](const int child) {
+            const auto& child_node = nodes[child];
+            const float merged_area = get_surface_area(merge(child_node.bounds, leaf_bounds));
+
+            if(child_node.is_leaf())
+                return merged_area + inheritance_cost;
+
+            return merged_area - get_surface_area(child_node.bounds) + inheritance_cost;
+        };
+
+        const float left_cost = get_descend_cost(node.left);
+        const float right_cost = get_descend_cost(node.right);
+
+        if(cost < left_cost && cost < right_cost)
+            break;
+
+        index = left_cost < right_cost ? node.left : node.right;
+    }
+
+    const int sibling = index;
+    const int old_parent = nodes[sibling].parent;
+
+    const int new_parent = allocate_node();
+    nodes[new_parent].parent = old_parent;
+    nodes[new_parent].bounds = merge(leaf_bounds, nodes[sibling].bounds);
+    nodes[new_parent].height = nodes[sibling].height + 1;
+    nodes[new_parent].left = sibling;
+    nodes[new_parent].right = leaf;
+
+    nodes[sibling].parent = new_parent;
+    nodes[leaf].parent = new_parent;
+
+    if(old_parent == null_node) {
+        root = new_parent;
+    } else if(nodes[old_parent].left == sibling) {
+        nodes[old_parent].left = new_parent;
+    } else {
+        nodes[old_parent].right = new_parent;
+    }
+
+    refit(new_parent);
+}
+
+void prism::aabb_tree::remove_leaf(const int leaf) {
+    if(leaf == root) {
+        root = null_node;
+        return;
+    }
+
+    // the parent only existed to hold the leaf and its sibling, so the sibling takes its place
+    const int parent = nodes[leaf].parent;
+    const int grandparent = nodes[parent].parent;
+    const int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+    free_node(parent);
+
+    nodes[sibling].parent = grandparent;
+
+    if(grandparent == null_node) {
+        root = sibling;
+        return;
+    }
+
+    if(nodes[grandparent].left == parent)
+        nodes[grandparent].left = sibling;
+    else
+        nodes[grandparent].right = sibling;
+
+    refit(grandparent);
+}
+
+void prism::aabb_tree::refit(int index) {
+    while(index != null_node) {
+        index = balance(index);
+
+        auto& node = nodes[index];
+        node.bounds = merge(nodes[node.left].bounds, nodes[node.right].bounds);
+        node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+
+        index = node.parent;
+    }
+}
+
+int prism::aabb_tree::balance(const int a) {
+    if(nodes[a].is_leaf() || nodes[a].height < 2)
+        return a;
+
+    const int b = nodes[a].left;
+    const int c = nodes[a].right;
+
+    const int difference = nodes[c].height - nodes[b].height;
+    if(difference >= -1 && difference <= 1)
+        return a;
+
+    // the taller child replaces a, and a takes the taller of its children's places
+    const int up = difference > 1 ? c : b;
+    const int other = difference > 1 ? b : c;
+
+    const int up_left = nodes[up].left;
+    const int up_right = nodes[up].right;
+
+    nodes[up].left = a;
+    nodes[up].parent = nodes[a].parent;
+    nodes[a].parent = up;
+
+    if(nodes[up].parent == null_node) {
+        root = up;
+    } else if(nodes[nodes[up].parent].left == a) {
+        nodes[nodes[up].parent].left = up;
+    } else {
+        nodes[nodes[up].parent].right = up;
+    }
+
+    // the taller grandchild stays under the node that moved up, and the shorter one moves under a
+    const bool keep_left = nodes[up_left].height > nodes[up_right].height;
+    const int kept = keep_left ? up_left : up_right;
+    const int moved = keep_left ? up_right : up_left;
+
+    nodes[up].right = kept;
+
+    if(up == c)
+        nodes[a].right = moved;
+    else
+        nodes[a].left = moved;
+
+    nodes[moved].parent = a;
+
+    nodes[a].bounds = merge(nodes[other].bounds, nodes[moved].bounds);
+    nodes[a].height = 1 + std::max(nodes[other].height, nodes[moved].height);
+
+    nodes[up].bounds = merge(nodes[a].bounds, nodes[kept].bounds);
+    nodes[up].height = 1 + std::max(nodes[a].height, nodes[kept].height);
+
+    return up;
+}
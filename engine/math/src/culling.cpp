@@ -0,0 +1,144 @@
+#include "culling.hpp"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // the operations are done in the same order in every version, so they all round the same way and never disagree
+    bool test_aabb_planes(const prism::frustum_planes& planes, const float center_x, const float center_y, const float center_z, const float extent_x, const float extent_y, const float extent_z) {
+        for(const auto& plane : planes) {
+            const float distance = plane.a * center_x + plane.b * center_y + plane.c * center_z + plane.d;
+            const float radius = std::abs(plane.a) * extent_x + std::abs(plane.b) * extent_y + std::abs(plane.c) * extent_z;
+
+            if(distance + radius < 0.0f)
+                return false;
+        }
+
+        return true;
+    }
+
+#if defined(__AVX__)
+    constexpr size_t batch_size = 8;
+
+    // returns a bit for each visible box, starting at first
+    uint32_t test_batch(const prism::frustum_planes& planes, const prism::aabb_soa& bounds, const size_t first) {
+        const __m256 center_x = _mm256_loadu_ps(bounds.center_x.data() + first);
+        const __m256 center_y = _mm256_loadu_ps(bounds.center_y.data() + first);
+        const __m256 center_z = _mm256_loadu_ps(bounds.center_z.data() + first);
+        const __m256 extent_x = _mm256_loadu_ps(bounds.extent_x.data() + first);
+        const __m256 extent_y = _mm256_loadu_ps(bounds.extent_y.data() + first);
+        const __m256 extent_z = _mm256_loadu_ps(bounds.extent_z.data() + first);
+
+        const __m256 zero = _mm256_setzero_ps();
+
+        __m256 outside = zero;
+        for(const auto& plane : planes) {
+            __m256 distance = _mm256_mul_ps(_mm256_set1_ps(plane.a), center_x);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.b), center_y));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.c), center_z));
+            distance = _mm256_add_ps(distance, _mm256_set1_ps(plane.d));
+
+            __m256 radius = _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.a)), extent_x);
+            radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.b)), extent_y));
+            radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.c)), extent_z));
+
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+        }
+
+        return ~static_cast<uint32_t>(_mm256_movemask_ps(outside)) & 0xFF;
+    }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    constexpr size_t batch_size = 4;
+
+    // returns a bit for each visible box, starting at first
+    uint32_t test_batch(const prism::frustum_planes& planes, const prism::aabb_soa& bounds, const size_t first) {
+        const __m128 center_x = _mm_loadu_ps(bounds.center_x.data() + first);
+        const __m128 center_y = _mm_loadu_ps(bounds.center_y.data() + first);
+        const __m128 center_z = _mm_loadu_ps(bounds.center_z.data() + first);
+        const __m128 extent_x = _mm_loadu_ps(bounds.extent_x.data() + first);
+        const __m128 extent_y = _mm_loadu_ps(bounds.extent_y.data() + first);
+        const __m128 extent_z = _mm_loadu_ps(bounds.extent_z.data() + first);
+
+        const __m128 zero = _mm_setzero_ps();
+
+        __m128 outside = zero;
+        for(const auto& plane : planes) {
+            __m128 distance = _mm_mul_ps(_mm_set1_ps(plane.a), center_x);
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.b), center_y));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.c), center_z));
+            distance = _mm_add_ps(distance, _mm_set1_ps(plane.d));
+
+            __m128 radius = _mm_mul_ps(_mm_set1_ps(std::abs(plane.a)), extent_x);
+            radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::abs(plane.b)), extent_y));
+            radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::abs(plane.c)), extent_z));
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        return ~static_cast<uint32_t>(_mm_movemask_ps(outside)) & 0xF;
+    }
+#else
+    constexpr size_t batch_size = 1;
+
+    uint32_t test_batch(const prism::frustum_planes& planes, const prism::aabb_soa& bounds, const size_t first) {
+        return test_aabb_planes(planes, bounds.center_x[first], bounds.center_y[first], bounds.center_z[first], bounds.extent_x[first], bounds.extent_y[first], bounds.extent_z[first]) ? 1 : 0;
+    }
+#endif
+}
+
+void prism::aabb_soa::clear() {
+    center_x.clear();
+    center_y.clear();
+    center_z.clear();
+    extent_x.clear();
+    extent_y.clear();
+    extent_z.clear();
+}
+
+void prism::aabb_soa::push_back(const aabb& aabb) {
+    const float3 center = (aabb.min + aabb.max) * 0.5f;
+    const float3 extent = (aabb.max - aabb.min) * 0.5f;
+
+    center_x.push_back(center.x);
+    center_y.push_back(center.y);
+    center_z.push_back(center.z);
+    extent_x.push_back(extent.x);
+    extent_y.push_back(extent.y);
+    extent_z.push_back(extent.z);
+}
+
+prism::aabb prism::aabb_soa::get(const size_t index) const {
+    const float3 center(center_x[index], center_y[index], center_z[index]);
+    const float3 extent(extent_x[index], extent_y[index], extent_z[index]);
+
+    return {center - extent, center + extent};
+}
+
+bool prism::test_aabb_planes(const frustum_planes& planes, const aabb& aabb) {
+    const float3 center = (aabb.min + aabb.max) * 0.5f;
+    const float3 extent = (aabb.max - aabb.min) * 0.5f;
+
+    return ::test_aabb_planes(planes, center.x, center.y, center.z, extent.x, extent.y, extent.z);
+}
+
+void prism::test_aabbs_planes(const frustum_planes& planes, const aabb_soa& bounds, std::vector<uint8_t>& visible) {
+    const size_t count = bounds.size();
+    visible.resize(count);
+
+    size_t i = 0;
+    for(; i + batch_size <= count; i += batch_size) {
+        const uint32_t mask = test_batch(planes, bounds, i);
+
+        for(size_t j = 0; j < batch_size; j++)
+            visible[i + j] = (mask >> j) & 1;
+    }
+
+    // whatever doesn't fill a whole batch
+    for(; i < count; i++)
+        visible[i] = ::test_aabb_planes(planes, bounds.center_x[i], bounds.center_y[i], bounds.center_z[i], bounds.extent_x[i], bounds.extent_y[i], bounds.extent_z[i]) ? 1 : 0;
+}
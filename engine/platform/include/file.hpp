@@ -54,6 +54,11 @@ namespace prism {
             }
         }
 
+        /// Moves the read position to an offset from the beginning of the file.
+        void seek(const size_t offset) {
+            fseek(handle, static_cast<long>(offset), SEEK_SET);
+        }
+
         /// Loads the entire file into memory, accessible via cast_data()
         void read_all() {
             fseek(handle, 0L, SEEK_END);
@@ -75,6 +80,17 @@ namespace prism {
             return data.size();
         }
 
+        /// Returns the size of the file on disk, whether it's loaded in memory or not. The read position is left where it was.
+        [[nodiscard]] size_t size_on_disk() const {
+            const long position = ftell(handle);
+
+            fseek(handle, 0L, SEEK_END);
+            const auto _size = static_cast<size_t>(ftell(handle));
+            fseek(handle, position, SEEK_SET);
+
+            return _size;
+        }
+
         /// Reads the entire file as a string.
         std::string read_as_string() {
             auto s = read_as_stream();
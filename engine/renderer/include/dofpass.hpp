@@ -1,5 +1,7 @@
 #pragma once
 
+#include "render_graph.hpp"
+
 class GFX;
 class GFXCommandBuffer;
 class GFXFramebuffer;
@@ -16,13 +18,12 @@ class DoFPass {
 public:
     DoFPass(GFX* gfx, prism::renderer* renderer);
         
-    void render(GFXCommandBuffer* command_buffer, Scene& scene);
-    
-    GFXTexture* far_field = nullptr;
-    GFXTexture* normal_field = nullptr;
+    struct fields {
+        prism::render_texture far_field, normal_field;
+    };
     
-    GFXFramebuffer* far_framebuffer = nullptr;
-    GFXFramebuffer* normal_framebuffer = nullptr;
+    /// Adds the pass that renders both fields, which is culled if nothing reads them.
+    fields add_passes(prism::render_graph& graph, prism::Extent extent);
     
     GFXRenderPass* renderpass = nullptr;
     
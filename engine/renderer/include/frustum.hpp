@@ -1,12 +1,15 @@
 #pragma once
 
 #include <array>
+#include <vector>
 
 #include "frustum.hpp"
 #include "matrix.hpp"
 #include "vector.hpp"
 #include "components.hpp"
 #include "aabb.hpp"
+#include "aabb_tree.hpp"
+#include "culling.hpp"
 #include "plane.hpp"
 #include "asset_types.hpp"
 
@@ -24,4 +27,30 @@ bool test_point_plane(const Plane& plane, const prism::float3& point);
 bool test_point_frustum(const CameraFrustum& frustum, const prism::float3& point);
 bool test_aabb_frustum(const CameraFrustum& frustum, const prism::aabb& aabb);
 
+/// Tests every box at once with prism::test_aabbs_planes, or marks all of them as visible if frustum culling is disabled.
+void cull_aabbs(const CameraFrustum& frustum, const prism::aabb_soa& bounds, std::vector<uint8_t>& visible);
+
+// the frustum has to be normalized, otherwise the plane distances aren't comparable to the radius
+bool test_sphere_frustum(const CameraFrustum& frustum, const prism::float3& center, float radius);
+
+/// The world space bounds of the part, from the transform's model matrix.
 prism::aabb get_aabb_for_part(const Transform& transform, const Mesh::Part& part);
+
+/// The bounds of every part of the mesh together.
+prism::aabb get_aabb_for_renderable(const Transform& transform, const Mesh& mesh);
+
+/// Whether the renderable can be drawn into cached shadow maps. Skinned meshes never are, their pose can change without their transform changing, and neither is anything moved by physics.
+bool is_static_renderable(Scene& scene, Object obj, const Renderable& renderable);
+
+/** Moves renderables in the scene's culling tree if their transform or mesh changed since the last call, and adds or removes the ones that appeared or disappeared.
+ If any of them were static, the scene's shadows are reset so the cached shadow maps are drawn again.
+ Static renderables whose transform changes anyway are treated as movable from then on, so they only reset the shadows once.
+ */
+void update_renderable_tree(Scene& scene);
+
+/** Collects every renderable whose bounds are inside of the frustum from the scene's culling tree, or every renderable if frustum culling is disabled.
+ Only the bounds of whole renderables are tested, so parts still have to be culled on their own.
+ @param visible Cleared first, it's only passed in so its allocation can be reused.
+ @param statistics What was tested is added to this.
+ */
+void query_renderables(const Scene& scene, const CameraFrustum& frustum, std::vector<Object>& visible, prism::aabb_tree_statistics& statistics);
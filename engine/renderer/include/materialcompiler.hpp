@@ -7,12 +7,16 @@
 class Material;
 
 constexpr int position_buffer_index = 2;
-constexpr int normal_buffer_index = 3;
-constexpr int texcoord_buffer_index = 4;
-constexpr int tangent_buffer_index = 5;
-constexpr int bitangent_buffer_index = 6;
+constexpr int vertex_buffer_index = 3;
 constexpr int bone_buffer_index = 7;
 
+constexpr int material_parameter_binding = 4;
+constexpr int instance_buffer_binding = 5;
+
+// the last bindings there are, so the material textures counting up from 10 have room before them
+constexpr int light_buffer_binding = 23;
+constexpr int light_grid_binding = 24;
+
 class MaterialCompiler {
 public:
     GFXPipeline* create_static_pipeline(GFXGraphicsPipelineCreateInfo createInfo, bool positions_only = false, bool cubemap = false);
@@ -21,6 +25,9 @@ public:
     // generates static and skinned versions of the pipeline provided
     std::tuple<GFXPipeline*, GFXPipeline*> create_pipeline_permutations(GFXGraphicsPipelineCreateInfo& createInfo, bool positions_only = false);
     
+    // generates the GLSL source of the material's fragment shader, this also updates the material's bound textures
+    std::string generate_material_fragment(Material& material, bool use_ibl = true);
+    
     ShaderSource compile_material_fragment(Material& material, bool use_ibl = true);
 };
 
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "asset_types.hpp"
+
+// a level of detail is only used when its simplification error covers less than this many pixels
+constexpr float max_lod_screen_error = 1.0f;
+
+/** Calculates how large an object is on screen for an orthographic projection, like the one used for sun shadows.
+ @param bounds The world space bounds of the object.
+ @param view_height The height of the orthographic view volume, in world units.
+ @param screen_height The height of the render target in pixels.
+ @return The approximate diameter of the object in pixels.
+ */
+float calculate_orthographic_screen_size(const prism::aabb& bounds, float view_height, uint32_t screen_height);
+
+/** Picks the level of detail to draw for a mesh part.
+ @param part The part to pick a level from, parts without any simplified levels always use the full detail level.
+ @param screen_size The on-screen size of the part in pixels, see calculate_screen_size.
+ @return The index into part.lods of the least detailed level whose error isn't visible at that size, offset by the lod bias in render_options.
+ */
+int select_mesh_lod(const Mesh::Part& part, float screen_size);
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+#include "gfx.hpp"
+
+class GFXCommandBuffer;
+class GFXFramebuffer;
+class GFXRenderPass;
+class GFXTexture;
+
+namespace prism {
+    class render_graph;
+
+    /// A texture inside of a render graph, only valid until the graph is reset.
+    struct render_texture {
+        uint32_t index = std::numeric_limits<uint32_t>::max();
+
+        [[nodiscard]] bool is_valid() const {
+            return index != std::numeric_limits<uint32_t>::max();
+        }
+    };
+
+    struct render_texture_desc {
+        std::string_view label; // only used for debug, and has to outlive the graph
+        prism::Extent extent;
+        GFXPixelFormat format = GFXPixelFormat::RGBA_32F;
+        GFXTextureUsage usage = GFXTextureUsage::Attachment | GFXTextureUsage::Sampled;
+    };
+
+    /// How a pass uses a texture, which decides what has to happen to the texture between two passes.
+    enum class texture_access {
+        attachment,
+        sampled,
+        storage
+    };
+
+    struct texture_transition {
+        render_texture texture;
+        texture_access from = texture_access::attachment, to = texture_access::sampled;
+    };
+
+    /// Handed to a pass while it's being added, so it can declare everything it reads and writes.
+    class render_graph_builder {
+    public:
+        render_texture read(render_texture texture, texture_access access = texture_access::sampled);
+
+        render_texture write(render_texture texture, texture_access access = texture_access::attachment);
+
+        /// The pass affects something outside of the graph (like the screen), so it's never culled.
+        void set_side_effect();
+
+    private:
+        friend class render_graph;
+
+        render_graph_builder(render_graph& graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+        render_graph& graph;
+        uint32_t pass = 0;
+    };
+
+    struct render_graph_statistics {
+        uint32_t passes = 0, culled_passes = 0;
+        uint32_t transient_textures = 0; // what the passes asked for
+        uint32_t allocated_textures = 0; // what they ended up sharing
+        uint32_t transitions = 0, barriers = 0;
+
+        // the transient textures are held for the whole frame, so the peak is everything allocated this frame
+        uint64_t peak_memory = 0;
+        uint64_t unaliased_memory = 0; // what the peak would be if every transient texture had its own memory
+    };
+
+    /** Passes of a frame that declare the textures they read and write, instead of owning them.
+     Passes run in the order they were added. Passes that nothing reads from are culled, and transient textures whose lifetimes
+     don't overlap share the same allocation. Allocations are kept between frames, so a graph that's rebuilt the same way every frame stops creating textures.
+     */
+    class render_graph {
+    public:
+        using execute_function = std::function<void(GFXCommandBuffer*, render_graph&)>;
+
+        /// Forgets every pass and texture, but keeps their allocations for the next frame.
+        void reset();
+
+        /** Adds a pass, the setup function is called right away.
+         @param name Used as the debug group of the pass, and has to outlive the frame.
+         */
+        void add_pass(std::string_view name, const std::function<void(render_graph_builder&)>& setup, execute_function execute);
+
+        /** Creates a texture that only lives while the passes using it run, its contents are undefined until a pass writes to it.
+         It's only allocated if a pass that isn't culled uses it.
+         */
+        render_texture create_texture(const render_texture_desc& desc);
+
+        /// Brings a texture that's owned outside of the graph in, which is never aliased.
+        render_texture import_texture(std::string_view label, GFXTexture* texture);
+
+        /// Keeps a transient texture alive until the end of the frame, so it can be used after the graph is executed.
+        void export_texture(render_texture texture);
+
+        /// Culls passes, then works out the lifetimes and transitions of every texture and allocates the transient ones.
+        void compile(GFX* gfx);
+
+        /// Records every pass that wasn't culled, must be called after compile.
+        void execute(GFXCommandBuffer* command_buffer);
+
+        /// Only valid while executing, or afterwards for exported textures.
+        GFXTexture* get_texture(render_texture texture) const;
+
+        /// Framebuffers are cached by their render pass and attachments, so this doesn't create a new one every frame.
+        GFXFramebuffer* get_framebuffer(GFXRenderPass* render_pass, std::initializer_list<render_texture> attachments);
+
+        render_graph_statistics statistics;
+
+    private:
+        friend class render_graph_builder;
+
+        struct texture_use {
+            render_texture texture;
+            texture_access access = texture_access::sampled;
+            bool write = false;
+        };
+
+        struct pass {
+            std::string_view name;
+            execute_function execute;
+
+            std::vector<texture_use> uses;
+            bool side_effect = false;
+            bool culled = false;
+
+            std::vector<texture_transition> transitions; // from the last pass that used each texture
+            bool needs_barrier = false;
+        };
+
+        struct texture {
+            render_texture_desc desc;
+            bool imported = false, exported = false;
+
+            GFXTexture* handle = nullptr;
+
+            // in passes, only meaningful for transient textures that are used
+            uint32_t first_use = 0, last_use = 0;
+            bool used = false;
+        };
+
+        // a texture owned by the graph, shared by every transient texture with the same description that isn't alive at the same time
+        struct allocation {
+            render_texture_desc desc;
+            GFXTexture* handle = nullptr;
+
+            uint32_t last_use = 0; // this frame
+            bool taken = false;
+            int unused_frames = 0;
+        };
+
+        struct cached_framebuffer {
+            GFXRenderPass* render_pass = nullptr;
+            std::vector<GFXTexture*> attachments;
+            GFXFramebuffer* framebuffer = nullptr;
+        };
+
+        void cull_passes();
+        void derive_transitions();
+        void allocate_textures(GFX* gfx);
+        void release_unused_allocations(GFX* gfx);
+
+        GFX* gfx = nullptr;
+
+        // passes are only ever added, so the ones from earlier frames are kept to reuse their vectors
+        std::vector<pass> passes;
+        size_t pass_count = 0;
+
+        std::vector<texture> textures;
+
+        std::vector<allocation> allocations;
+        std::vector<cached_framebuffer> framebuffers;
+    };
+}
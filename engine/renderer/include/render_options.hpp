@@ -59,6 +59,15 @@ struct RenderOptions {
     ShadowFilter shadow_filter = default_shadow_filter;
     bool enable_extra_passes = true;
     bool enable_frustum_culling = true;
+
+    bool enable_texture_streaming = true;
+    int texture_memory_budget = 256; // in megabytes
+
+    bool enable_meshlet_culling = true;
+    int lod_bias = 0; // added to the selected level of detail, negative values keep more detail
+
+    bool enable_occlusion_culling = false;
+    int occlusion_buffer_width = 256; // in pixels, the height follows the aspect ratio
 };
 
 inline RenderOptions render_options;
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "asset_types.hpp"
+#include "matrix.hpp"
+#include "vector.hpp"
+
+class GFX;
+class GFXBuffer;
+class GFXCommandBuffer;
+class GFXPipeline;
+class GFXTexture;
+struct Renderable;
+
+namespace prism {
+    /// A single mesh part to draw, extracted from the scene so draws can be sorted before anything is recorded.
+    struct draw_item {
+        uint64_t key = 0;
+
+        GFXPipeline* pipeline = nullptr;
+        Material* material = nullptr;
+        const Renderable* renderable = nullptr;
+        const Mesh* mesh = nullptr;
+        const Mesh::Part* part = nullptr;
+
+        Matrix4x4 model;
+        int lod = 0;
+
+        // meshlet cones are in model space, so the camera is moved there instead of transforming every cone
+        float3 model_camera_position;
+        float model_scale = 1.0f; // the largest axis of the model matrix
+    };
+
+    /** Packs a sort key for a draw, ordered by pipeline, then material, then mesh and finally front to back.
+     The ids are truncated to fit, which only makes the order less efficient and never incorrect.
+     @param depth The distance from the camera, negative distances are treated as 0.
+     */
+    uint64_t make_sort_key(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+    /// Consecutive items in a queue that are drawn together with one instanced draw.
+    struct draw_batch {
+        uint32_t first_item = 0, item_count = 0;
+    };
+
+    /// Draws of a single view, sorted to minimize how often state changes between them.
+    class render_queue {
+    public:
+        void clear();
+
+        /// Fills in the key of the item from its pipeline, material and mesh, then adds it to the queue.
+        void add(draw_item item, float depth);
+
+        /// Sorts the items by their keys, then groups items that can be drawn together into batches.
+        void sort();
+
+        /// The model matrix of every item in order, so the instances of a batch start at its first item.
+        std::vector<Matrix4x4> get_models() const;
+
+        std::vector<draw_item> items;
+        std::vector<draw_batch> batches;
+
+    private:
+        // small ids given out in the order things are first seen, pointers are too wide to fit in a key
+        uint32_t get_id(std::unordered_map<const void*, uint32_t>& ids, const void* pointer);
+
+        std::unordered_map<const void*, uint32_t> pipeline_ids, material_ids, mesh_ids;
+    };
+
+    /** Model matrices for instanced draws, which vertex shaders read from instance_buffer_binding by instance index.
+     Uploads are appended until the next reset, so several views can share one buffer in a frame.
+     */
+    class instance_buffer {
+    public:
+        void reset();
+
+        /// Copies the matrices into the buffer, and returns the instance index of the first one.
+        uint32_t upload(GFX* gfx, const std::vector<Matrix4x4>& models);
+
+        [[nodiscard]] int get_size() const {
+            return static_cast<int>(capacity * sizeof(Matrix4x4));
+        }
+
+        GFXBuffer* buffer = nullptr;
+
+    private:
+        // in matrices
+        size_t capacity = 0, used = 0;
+    };
+
+    struct command_statistics {
+        uint32_t pipeline_binds = 0;
+        uint32_t descriptor_binds = 0; // textures and shader buffers
+        uint32_t buffer_binds = 0; // vertex and index buffers
+        uint32_t draw_calls = 0;
+        uint32_t instances = 0;
+    };
+
+    /** Records into a command buffer, but drops state changes that wouldn't change anything.
+     Binding a pipeline resets every descriptor in the backend, so they're all considered unbound after one.
+     */
+    class command_state_cache {
+    public:
+        explicit command_state_cache(GFXCommandBuffer* command_buffer) : command_buffer(command_buffer) {}
+
+        void set_graphics_pipeline(GFXPipeline* pipeline);
+
+        void bind_shader_buffer(GFXBuffer* buffer, int offset, int index, int size);
+
+        void bind_texture(GFXTexture* texture, int index);
+
+        void set_vertex_buffer(GFXBuffer* buffer, int offset, int index);
+
+        void set_index_buffer(GFXBuffer* buffer, IndexType index_type);
+
+        void draw_indexed(int index_count, int first_index, int vertex_offset, int base_instance, int instance_count = 1);
+
+        /// Forgets everything that's bound, for when commands were recorded around the cache.
+        void invalidate();
+
+        GFXCommandBuffer* command_buffer = nullptr;
+
+        command_statistics statistics;
+
+    private:
+        struct bound_buffer {
+            GFXBuffer* buffer = nullptr;
+            int offset = 0, size = 0;
+        };
+
+        static constexpr int max_bindings = 25;
+
+        GFXPipeline* pipeline = nullptr;
+        std::array<bound_buffer, max_bindings> shader_buffers = {};
+        std::array<GFXTexture*, max_bindings> textures = {};
+        std::array<bound_buffer, max_bindings> vertex_buffers = {};
+        GFXBuffer* index_buffer = nullptr;
+        IndexType index_type = IndexType::UINT32;
+    };
+}
@@ -4,8 +4,11 @@
 #include <vector>
 #include <cmath>
 #include <functional>
+#include <memory>
+#include <unordered_map>
 
 #include "pass.hpp"
+#include "assetptr.hpp"
 #include "matrix.hpp"
 #include "object.hpp"
 #include "common.hpp"
@@ -13,6 +16,13 @@
 #include "path.hpp"
 #include "shadercompiler.hpp"
 #include "rendertarget.hpp"
+#include "render_queue.hpp"
+#include "aabb_tree.hpp"
+#include "culling.hpp"
+#include "occlusion_buffer.hpp"
+#include "light_clusters.hpp"
+#include "scene_lights.hpp"
+#include "gfx_commandbuffer.hpp"
 
 namespace ui {
     class Screen;
@@ -32,8 +42,18 @@ class DoFPass;
 
 class Scene;
 struct Camera;
+struct CameraFrustum;
 
-constexpr int max_scene_materials = 25, max_scene_lights = 25;
+constexpr int max_scene_materials = 25;
+
+// the depth slices of the light clusters grow up to this distance from the camera, everything further away shares the last one
+constexpr float light_cluster_distance = 500.0f;
+
+// the camera's draws are only split across threads when each thread would get at least this many batches
+constexpr size_t min_batches_per_recording_job = 64;
+
+// renderables set to automatically become occluders only do so when they're at least this much of the screen's height
+constexpr float min_occluder_screen_fraction = 0.1f;
 
 struct render_screen_options {
     bool render_world = false;
@@ -75,6 +95,41 @@ namespace prism {
 
         void create_mesh_pipeline(Material& material) const;
 
+        /** Makes sure the material's pipelines are ready to draw with.
+         @param blocking If false, missing pipelines are compiled on worker threads instead and the material can't be drawn until they finish.
+         @return True if the pipelines can be used right now.
+         */
+        bool request_mesh_pipeline(const AssetPtr<Material>& material, bool blocking = false);
+
+        /// Starts compiling the pipelines of every material in the scene on worker threads, so they're ready before they're first drawn.
+        void precompile_pipelines(Scene& scene);
+
+        struct pipeline_statistics {
+            uint32_t compiled_on_workers = 0;
+            uint32_t compiled_on_render_thread = 0; // every one of these is a hitch
+            uint32_t shared = 0; // materials that reused the pipelines of another material with the same structure
+        };
+
+        /// Forgets pipelines that are shared between materials, so the next request compiles them again.
+        void clear_pipeline_cache();
+
+        pipeline_statistics pipeline_stats;
+
+        struct frame_statistics {
+            uint32_t submitted_triangles = 0; // every part that passed part culling, at the level of detail it was drawn with
+            uint32_t drawn_triangles = 0; // what's left after meshlet culling
+            uint32_t meshlets = 0, culled_meshlets = 0;
+            prism::aabb_tree_statistics culling; // renderables, before any of their parts are culled
+            uint32_t occluders = 0;
+            uint32_t occlusion_tested = 0, occlusion_culled = 0; // parts that passed frustum culling
+            uint32_t lights = 0;
+            uint32_t light_assignments = 0, max_cluster_lights = 0; // point and spot lights in the light grid
+            command_statistics commands; // what was actually recorded, after redundant state changes were dropped
+        };
+
+        // from the last call to render_camera
+        frame_statistics statistics;
+
         // passes
         template<class T, typename... Args>
         T* addPass(Args &&... args) {
@@ -123,7 +178,30 @@ namespace prism {
             return render_targets;
         }
 
+        [[nodiscard]] size_t get_pending_pipeline_count() const {
+            return pipeline_jobs.size();
+        }
+
     private:
+        struct mesh_pipelines {
+            GFXPipeline* static_pipeline = nullptr;
+            GFXPipeline* skinned_pipeline = nullptr;
+            GFXPipeline* capture_pipeline = nullptr;
+        };
+
+        struct mesh_pipeline_job;
+
+        // everything that has to happen on the render thread, the returned job can then be compiled anywhere
+        std::unique_ptr<mesh_pipeline_job> prepare_mesh_pipeline(Material& material) const;
+
+        // hands pipelines compiled on worker threads over to their materials
+        void finish_pipeline_jobs();
+
+        std::vector<std::unique_ptr<mesh_pipeline_job>> pipeline_jobs;
+
+        // keyed by the generated shaders, materials with the same structure (but maybe different parameters) share these
+        std::unordered_map<std::string, mesh_pipelines> shared_pipelines;
+
         void create_dummy_texture();
 
         void create_render_target_resources(RenderTarget& target);
@@ -171,6 +249,31 @@ namespace prism {
         GFXBuffer* histogram_buffer = nullptr;
         GFXTexture* average_luminance_texture = nullptr;
 
+        // reused between frames, so it doesn't have to grow again every frame
+        render_queue opaque_queue;
+        std::vector<Object> visible_objects;
+        prism::aabb_soa all_part_bounds;
+        std::vector<uint8_t> part_visibility;
+        
+        prism::occlusion_buffer occlusion_buffer;
+        
+        std::vector<SceneLight> scene_lights;
+        std::vector<prism::float4> light_bounds;
+        prism::light_clusters light_clusters;
+        
+        // draws the occluders among the visible objects, and hides every part in all_part_bounds that's completely behind them
+        void cull_occluded_parts(Scene& scene, const Camera& camera, prism::Extent extent, prism::float3 camera_position);
+
+        struct recording_job {
+            GFXCommandBuffer commands;
+            frame_statistics statistics;
+        };
+
+        std::vector<recording_job> recording_jobs;
+
+        // only reads the scene and the queue, so this can be called from any thread
+        void record_opaque_batches(GFXCommandBuffer* command_buffer, Scene& scene, RenderTarget& target, const CameraFrustum& frustum, uint32_t first_instance, size_t first_batch, size_t last_batch, frame_statistics& job_statistics) const;
+
         std::unique_ptr<SMAAPass> smaa_pass;
         std::unique_ptr<DoFPass> dof_pass;
 
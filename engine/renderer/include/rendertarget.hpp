@@ -2,6 +2,9 @@
 
 #include "common.hpp"
 #include "render_options.hpp"
+#include "render_queue.hpp"
+#include "render_graph.hpp"
+#include "scene_lights.hpp"
 
 class GFXTexture;
 class GFXFramebuffer;
@@ -18,21 +21,18 @@ public:
             static_cast<uint32_t>(std::max(int(extent.height * render_options.render_scale), 1))};
     }
     
-    // offscreen
-    GFXTexture* offscreenColorTexture = nullptr;
-    GFXTexture* offscreenDepthTexture = nullptr;
+    // owns every texture that's only used while rendering the frame
+    prism::render_graph graph;
     
-    GFXFramebuffer* offscreenFramebuffer = nullptr;
+    // exported from the graph after every frame, so the scene can be shown somewhere else
+    GFXTexture* offscreenColorTexture = nullptr;
     
     // mesh
     GFXBuffer* sceneBuffer = nullptr;
-    
-    // smaa
-    GFXTexture* edge_texture = nullptr;
-    GFXTexture* blend_texture = nullptr;
-
-    GFXFramebuffer* edge_framebuffer = nullptr;
-    GFXFramebuffer* blend_framebuffer = nullptr;
+    prism::instance_buffer instances[RT_MAX_FRAMES_IN_FLIGHT];
+    prism::instance_buffer shadow_instances[RT_MAX_FRAMES_IN_FLIGHT]; // the shadow pass is recorded again for every target
+    prism::instance_buffer skinning[RT_MAX_FRAMES_IN_FLIGHT]; // the animation system's skinning matrices, uploaded again for every target
+    light_buffers lights[RT_MAX_FRAMES_IN_FLIGHT];
     
     // imgui
     GFXBuffer* vertex_buffer[RT_MAX_FRAMES_IN_FLIGHT] = {};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vector.hpp"
+
+class GFX;
+class GFXBuffer;
+class Scene;
+struct Light;
+
+// point and spot lights fade out where their radiance would drop below this, which is as far as they're sorted into clusters
+constexpr float min_light_radiance = 0.01f;
+
+/// A light as the shaders read it from the light buffer.
+struct SceneLight {
+    prism::float4 positionType;
+    prism::float4 directionPower;
+    prism::float4 colorSize;
+    prism::float4 shadowsEnable; // whether shadows are enabled, the size of the light, the layer of its shadow map and its range
+};
+
+/// How far a point or spot light reaches before it's too dim to matter.
+float calculate_light_range(const Light& light);
+
+/** Collects every light in the scene in the order the shaders expect: point and spot lights, which are sorted into clusters, followed by sun lights, which reach everything.
+ Shadow map layers are handed out in the same order and with the same limits as ShadowPass, which renders them.
+ @param bounds Filled with a world space sphere around every point and spot light, in the same order.
+ @return The number of point and spot lights.
+ */
+uint32_t gather_scene_lights(Scene& scene, std::vector<SceneLight>& lights, std::vector<prism::float4>& bounds);
+
+/// The storage buffers shaders read the lights and the light grid from, they're recreated when they need to grow.
+/// They're rewritten every frame, so there should be one for every frame in flight.
+struct light_buffers {
+    GFXBuffer* lights = nullptr;
+    GFXBuffer* grid = nullptr;
+    size_t lights_size = 0, grid_size = 0; // in bytes
+
+    void upload(GFX* gfx, const std::vector<SceneLight>& scene_lights, const std::vector<uint32_t>& light_grid);
+};
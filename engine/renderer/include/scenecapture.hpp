@@ -1,6 +1,14 @@
 #pragma once
 
+#include <vector>
+
 #include "math.hpp"
+#include "object.hpp"
+#include "aabb_tree.hpp"
+#include "culling.hpp"
+#include "light_clusters.hpp"
+#include "scene_lights.hpp"
+#include "rendertarget.hpp"
 
 class GFX;
 class GFXCommandBuffer;
@@ -32,8 +40,25 @@ public:
     GFXFramebuffer* offscreenFramebuffer = nullptr, *irradianceFramebuffer = nullptr, *prefilteredFramebuffer = nullptr;
     
     GFXBuffer* sceneBuffer = nullptr;
+    // captures aren't tied to a render target, so they keep their own frames in flight
+    light_buffers lights[RT_MAX_FRAMES_IN_FLIGHT];
+    uint32_t current_frame = 0;
+    
+    // every face of every probe from the last call to render together
+    prism::aabb_tree_statistics statistics;
     
     void createSkyResources();
     void createIrradianceResources();
     void createPrefilterResources();
+    
+private:
+    // reused between faces, so they don't have to grow again for each one
+    std::vector<Object> visible_objects;
+    prism::aabb_soa part_bounds;
+    std::vector<uint8_t> part_visibility;
+    
+    // probes are only captured once, so every light is put into a single cluster instead of building a grid for each face
+    std::vector<SceneLight> scene_lights;
+    std::vector<prism::float4> light_bounds;
+    prism::light_clusters light_clusters;
 };
@@ -3,6 +3,9 @@
 #include "math.hpp"
 #include "object.hpp"
 #include "components.hpp"
+#include "render_queue.hpp"
+#include "frustum.hpp"
+#include "gfx_commandbuffer.hpp"
 
 class GFX;
 class GFXCommandBuffer;
@@ -13,7 +16,6 @@ class GFXTexture;
 class GFXSampler;
 class GFXBuffer;
 class Scene;
-struct CameraFrustum;
 
 class ShadowPass {
 public:
@@ -21,14 +23,64 @@ public:
     
     void create_scene_resources(Scene& scene);
     
-    void render(GFXCommandBuffer* command_buffer, Scene& scene);
+    /// @param frame_instances Where this frame's model matrices go, frames still in flight may be reading the others.
+    /// @param frame_skinning This frame's upload of the skinning matrices.
+    void render(GFXCommandBuffer* command_buffer, Scene& scene, prism::instance_buffer& frame_instances, GFXBuffer* frame_skinning);
+    
+    // every view from the last call to render together
+    prism::aabb_tree_statistics statistics;
+    
+    // what was drawn into the cached shadow maps, which only happens when a light or static geometry changes, and what was drawn on top of them
+    prism::command_statistics static_commands, dynamic_commands;
     
 private:
-    void render_meshes(GFXCommandBuffer* command_buffer, Scene& scene, const Matrix4x4 light_matrix, const Matrix4x4 model, const prism::float3 light_position, const Light::Type type, const CameraFrustum& frustum, const int base_instance);
+    // copied into a view's attachments before it's rendered, or out of them afterwards
+    struct texture_copy {
+        GFXTexture* source = nullptr;
+        GFXTexture* target = nullptr;
+        int source_slice = 0, source_layer = 0;
+        int target_slice = 0, target_layer = 0;
+        bool cubemap = true; // spot lights are in a 2D array, which has no slices
+    };
+    
+    // a single shadow map (or cubemap face) to render, each one is recorded into its own command buffer
+    struct shadow_view {
+        GFXRenderPassBeginInfo begin_info;
+        
+        bool draw_meshes = false;
+        bool static_casters = false; // static renderables are only drawn into the cache, everything else is drawn on top of it
+        Light::Type type = Light::Type::Sun;
+        Matrix4x4 light_matrix;
+        CameraFrustum frustum;
+        prism::float3 light_position;
+        int light_index = 0;
+        
+        // spot and point lights are rendered offscreen, so they're copied into their arrays. drawing on top of a cached shadow map starts by copying it in
+        std::vector<texture_copy> copies_before, copies_after;
+        
+        std::vector<Object> visible_objects;
+        prism::aabb_tree_statistics culling;
+        
+        // every part of every visible renderable, in the order they're visited
+        prism::aabb_soa part_bounds;
+        std::vector<uint8_t> part_visibility;
+        
+        prism::render_queue queue;
+        uint32_t first_instance = 0;
+        
+        GFXCommandBuffer commands;
+        prism::command_statistics command_statistics;
+    };
+    
+    shadow_view& add_view(const GFXRenderPassBeginInfo& begin_info);
     
-    void render_sun(GFXCommandBuffer* command_buffer, Scene& scene, Object light_object, Light& light);
-    void render_spot(GFXCommandBuffer* command_buffer, Scene& scene, Object light_object, Light& light);
-    void render_point(GFXCommandBuffer* command_buffer, Scene& scene, Object light_object, Light& light);
+    // these only read the scene, so they can run on any thread
+    void build_queue(Scene& scene, shadow_view& view) const;
+    void record_view(shadow_view& view) const;
+    
+    void prepare_sun(Scene& scene, Object light_object, Light& light);
+    void prepare_spot(Scene& scene, Object light_object, Light& light);
+    void prepare_point(Scene& scene, Object light_object, Light& light);
     
     int last_point_light = 0;
     int last_spot_light = 0;
@@ -40,6 +92,10 @@ private:
     GFXRenderPass* render_pass = nullptr;
     GFXRenderPass* cube_render_pass = nullptr;
     
+    // the same, but without clearing so movable renderables can be drawn on top of the cached shadow maps
+    GFXRenderPass* keep_render_pass = nullptr;
+    GFXRenderPass* cube_keep_render_pass = nullptr;
+    
     GFXTexture* offscreen_color_texture = nullptr;
     GFXTexture* offscreen_depth = nullptr;
     GFXFramebuffer* offscreen_framebuffer = nullptr;
@@ -47,6 +103,14 @@ private:
     GFXBuffer* point_location_buffer = nullptr;
     prism::float3* point_location_map = nullptr;
     
+    // kept between frames so their allocations can be reused, only the first view_count are used this frame
+    std::vector<shadow_view> views;
+    size_t view_count = 0;
+    
+    // every view's draws are appended to the same instance buffer, which starts over each frame. it's owned by the render target
+    prism::instance_buffer* instances = nullptr;
+    GFXBuffer* skinning_buffer = nullptr;
+    
     // sun
     GFXPipeline* static_sun_pipeline = nullptr;
     GFXPipeline* skinned_sun_pipeline = nullptr;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.hpp"
+#include "render_graph.hpp"
 
 class Scene;
 class GFX;
@@ -19,9 +20,8 @@ class SMAAPass {
 public:
     SMAAPass(GFX* gfx, prism::renderer* renderer);
     
-    void create_render_target_resources(RenderTarget& target);
-    
-    void render(GFXCommandBuffer* command_buffer, RenderTarget& target);
+    /// Adds the edge detection and blending passes, which are culled if nothing reads the returned blend weights.
+    prism::render_texture add_passes(prism::render_graph& graph, RenderTarget& target, prism::render_texture color, prism::render_texture depth);
 
 private:
     void create_textures();
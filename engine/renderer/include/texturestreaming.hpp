@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#include "aabb.hpp"
+#include "vector.hpp"
+
+class Texture;
+
+// levels at or below this size are uploaded when the texture is loaded, so it's usable before anything is streamed in
+constexpr uint32_t texture_streaming_initial_size = 128;
+
+// each residency change is read on the thread pool and then re-uploads the texture, so limit how many can be in flight at once
+constexpr int max_texture_streaming_changes_per_frame = 4;
+
+/// Returns the most detailed mip level that is loaded up front.
+int get_initial_texture_level(const Texture& texture);
+
+/** Calculates how large an object is on screen.
+ @param bounds The world space bounds of the object.
+ @param camera_position The world space position of the camera.
+ @param fov The vertical field of view of the camera, in degrees.
+ @param screen_height The height of the render target in pixels.
+ @return The approximate diameter of the object in pixels.
+ */
+float calculate_screen_size(const prism::aabb& bounds, prism::float3 camera_position, float fov, uint32_t screen_height);
+
+/// Requests the mip level needed to draw the texture at the specified on-screen size. Only affects streamable textures.
+void request_texture_level(Texture& texture, float screen_size);
+
+/// Streams mip levels in or out to match last frame's requests, while staying inside the texture memory budget.
+void update_texture_streaming();
+
+/// Returns the size in bytes of all of the mip levels currently resident for streamable textures.
+uint64_t get_resident_texture_memory();
+
+/// Returns the size in bytes of the mip levels of a texture, starting from first_level.
+uint64_t get_texture_levels_size(const Texture& texture, int first_level);
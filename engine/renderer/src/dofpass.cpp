@@ -52,77 +52,73 @@ DoFPass::DoFPass(GFX* gfx, prism::renderer* renderer) : renderer(renderer) {
     create_info.blending.dst_alpha = GFXBlendFactor::One;
 
     pipeline = gfx->create_graphics_pipeline(create_info);
-        
-    GFXTextureCreateInfo textureInfo = {};
-    textureInfo.label = "Normal Field";
-    textureInfo.width = extent.width;
-    textureInfo.height = extent.height;
-    textureInfo.format = GFXPixelFormat::RGBA_32F;
-    textureInfo.usage = GFXTextureUsage::Attachment | GFXTextureUsage::Sampled;
-    textureInfo.samplingMode = SamplingMode::ClampToEdge;
-    
-    normal_field = gfx->create_texture(textureInfo);
-
-    textureInfo.label = "Far Field";
-    far_field = gfx->create_texture(textureInfo);
-            
-    GFXFramebufferCreateInfo framebufferInfo = {};
-    framebufferInfo.render_pass = renderpass;
-    framebufferInfo.attachments = { normal_field };
-    
-    normal_framebuffer = gfx->create_framebuffer(framebufferInfo);
-    
-    framebufferInfo.attachments = { far_field };
-    
-    far_framebuffer = gfx->create_framebuffer(framebufferInfo);
 }
 
-void DoFPass::render(GFXCommandBuffer* command_buffer, Scene&) {
-    //const auto render_extent = renderer->get_render_extent();
-    const auto extent = prism::Extent();
-    const auto render_extent = prism::Extent();
-    
-    // render far field
-    GFXRenderPassBeginInfo beginInfo = {};
-    beginInfo.framebuffer = far_framebuffer;
-    beginInfo.render_pass = renderpass;
+DoFPass::fields DoFPass::add_passes(prism::render_graph& graph, const prism::Extent extent) {
+    prism::render_texture_desc desc;
+    desc.label = "Far Field";
+    desc.extent = extent;
+    desc.format = GFXPixelFormat::RGBA_32F;
+    desc.usage = GFXTextureUsage::Attachment | GFXTextureUsage::Sampled;
 
-    command_buffer->set_render_pass(beginInfo);
-    
-    Viewport viewport = {};
-    viewport.width = render_extent.width;
-    viewport.height = render_extent.height;
-    
-    command_buffer->set_viewport(viewport);
-    
-    command_buffer->set_graphics_pipeline(pipeline);
-    
-    //command_buffer->bind_texture(renderer->offscreenColorTexture, 0);
-    //command_buffer->bind_texture(renderer->offscreenDepthTexture, 1);
-    command_buffer->bind_texture(aperture_texture->handle, 3);
+    fields result;
+    result.far_field = graph.create_texture(desc);
 
-    //const auto extent = renderer->get_render_extent();
+    desc.label = "Normal Field";
+    result.normal_field = graph.create_texture(desc);
 
-    prism::float4 params(render_options.depth_of_field_strength, 0.0, 0.0, 0.0);
-    
-    command_buffer->set_push_constant(&params, sizeof(prism::float4));
-    
-    command_buffer->draw(0, 4, 0, extent.width * extent.height);
-    
-    // render normal field
-    beginInfo.framebuffer = normal_framebuffer;
-    
-    command_buffer->set_render_pass(beginInfo);
-    
-    command_buffer->set_graphics_pipeline(pipeline);
-    
-    //command_buffer->bind_texture(renderer->offscreenColorTexture, 0);
-    //command_buffer->bind_texture(renderer->offscreenDepthTexture, 1);
-    command_buffer->bind_texture(aperture_texture->handle, 2);
+    graph.add_pass("Depth of Field", [result](prism::render_graph_builder& builder) {
+        builder.write(result.far_field);
+        builder.write(result.normal_field);
+    }, [this, result](GFXCommandBuffer* command_buffer, prism::render_graph& graph) {
+        //const auto render_extent = renderer->get_render_extent();
+        const auto extent = prism::Extent();
+        const auto render_extent = prism::Extent();
+        
+        // render far field
+        GFXRenderPassBeginInfo beginInfo = {};
+        beginInfo.framebuffer = graph.get_framebuffer(renderpass, {result.far_field});
+        beginInfo.render_pass = renderpass;
 
-    params.y = 1;
-    
-    command_buffer->set_push_constant(&params, sizeof(prism::float4));
-    
-    command_buffer->draw(0, 4, 0, extent.width * extent.height);
+        command_buffer->set_render_pass(beginInfo);
+        
+        Viewport viewport = {};
+        viewport.width = render_extent.width;
+        viewport.height = render_extent.height;
+        
+        command_buffer->set_viewport(viewport);
+        
+        command_buffer->set_graphics_pipeline(pipeline);
+        
+        //command_buffer->bind_texture(renderer->offscreenColorTexture, 0);
+        //command_buffer->bind_texture(renderer->offscreenDepthTexture, 1);
+        command_buffer->bind_texture(aperture_texture->handle, 3);
+
+        //const auto extent = renderer->get_render_extent();
+
+        prism::float4 params(render_options.depth_of_field_strength, 0.0, 0.0, 0.0);
+        
+        command_buffer->set_push_constant(&params, sizeof(prism::float4));
+        
+        command_buffer->draw(0, 4, 0, extent.width * extent.height);
+        
+        // render normal field
+        beginInfo.framebuffer = graph.get_framebuffer(renderpass, {result.normal_field});
+        
+        command_buffer->set_render_pass(beginInfo);
+        
+        command_buffer->set_graphics_pipeline(pipeline);
+        
+        //command_buffer->bind_texture(renderer->offscreenColorTexture, 0);
+        //command_buffer->bind_texture(renderer->offscreenDepthTexture, 1);
+        command_buffer->bind_texture(aperture_texture->handle, 2);
+
+        params.y = 1;
+        
+        command_buffer->set_push_constant(&params, sizeof(prism::float4));
+        
+        command_buffer->draw(0, 4, 0, extent.width * extent.height);
+    });
+
+    return result;
 }
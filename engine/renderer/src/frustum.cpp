@@ -1,6 +1,9 @@
 #include "frustum.hpp"
 
+#include <cstring>
+
 #include "scene.hpp"
+#include "render_options.hpp"
 
 CameraFrustum extract_frustum(const Matrix4x4 combined) {
     CameraFrustum frustum;
@@ -72,26 +75,119 @@ bool test_point_frustum(const CameraFrustum& frustum, const prism::float3& point
     return !inside_frustum;
 }
 
-bool test_aabb_frustum(const CameraFrustum& frustum, const prism::aabb& aabb) {
+bool test_sphere_frustum(const CameraFrustum& frustum, const prism::float3& center, const float radius) {
     for(int i = 0; i < 6; i++) {
-        int out = 0;
-        
-        for(const auto point : get_points(aabb))
-            out += (distance_to_point(frustum.planes[i], point) < 0.0) ? 1 : 0;
-        
-        if(out == 8)
+        if(distance_to_point(frustum.planes[i], center) < -radius)
             return false;
     }
     
     return true;
 }
 
+bool test_aabb_frustum(const CameraFrustum& frustum, const prism::aabb& aabb) {
+    return prism::test_aabb_planes(frustum.planes, aabb);
+}
+
+void cull_aabbs(const CameraFrustum& frustum, const prism::aabb_soa& bounds, std::vector<uint8_t>& visible) {
+    if(render_options.enable_frustum_culling) {
+        prism::test_aabbs_planes(frustum.planes, bounds, visible);
+    } else {
+        visible.assign(bounds.size(), 1);
+    }
+}
+
 prism::aabb get_aabb_for_part(const Transform& transform, const Mesh::Part& part) {
-    prism::aabb aabb = {};
-    aabb.min = part.bounding_box.min - transform.get_world_position();
-    aabb.max = transform.get_world_position() + part.bounding_box.max;
-    aabb.min *= transform.scale;
-    aabb.max *= transform.scale;
+    return prism::transform_aabb(part.bounding_box, transform.model);
+}
+
+prism::aabb get_aabb_for_renderable(const Transform& transform, const Mesh& mesh) {
+    prism::aabb bounds = get_aabb_for_part(transform, mesh.parts[0]);
+    for(size_t i = 1; i < mesh.parts.size(); i++)
+        bounds = merge(bounds, get_aabb_for_part(transform, mesh.parts[i]));
+    
+    return bounds;
+}
+
+bool is_static_renderable(Scene& scene, const Object obj, const Renderable& renderable) {
+    if(renderable.mobility != Renderable::Mobility::Static || !renderable.mesh || !renderable.mesh->bones.empty())
+        return false;
     
-    return aabb;
+    return !scene.has<Rigidbody>(obj) || scene.get<Rigidbody>(obj).type != Rigidbody::Type::Dynamic;
+}
+
+void update_renderable_tree(Scene& scene) {
+    const uint32_t frame = ++scene.renderable_tree_frame;
+    
+    bool static_changed = false;
+    
+    for(const auto& [obj, renderable] : scene.get_all<Renderable>()) {
+        if(!renderable.mesh || renderable.mesh->parts.empty())
+            continue;
+        
+        const auto& transform = scene.get<Transform>(obj);
+        const Mesh* mesh = renderable.mesh.handle;
+        
+        auto& proxy = scene.renderable_proxies[obj];
+        proxy.last_seen = frame;
+        
+        const bool moved = proxy.leaf != prism::aabb_tree::null_node && std::memcmp(&proxy.model, &transform.model, sizeof(Matrix4x4)) != 0;
+        proxy.moved |= moved;
+        
+        const bool is_static = !proxy.moved && is_static_renderable(scene, obj, renderable);
+        
+        // moving between the cached and the per-frame shadows changes both
+        if(proxy.leaf != prism::aabb_tree::null_node && proxy.is_static != is_static)
+            static_changed = true;
+        
+        proxy.is_static = is_static;
+        
+        // most renderables don't move, so this is the common case and only costs a comparison
+        if(proxy.leaf != prism::aabb_tree::null_node && proxy.mesh == mesh && !moved)
+            continue;
+        
+        const auto bounds = get_aabb_for_renderable(transform, *mesh);
+        
+        if(proxy.leaf == prism::aabb_tree::null_node)
+            proxy.leaf = scene.renderable_tree.insert(bounds, obj);
+        else
+            scene.renderable_tree.update(proxy.leaf, bounds);
+        
+        proxy.model = transform.model;
+        proxy.mesh = mesh;
+        
+        static_changed |= is_static;
+    }
+    
+    // anything that wasn't seen was removed, or lost its mesh
+    for(auto it = scene.renderable_proxies.begin(); it != scene.renderable_proxies.end();) {
+        if(it->second.last_seen != frame) {
+            static_changed |= it->second.is_static;
+            
+            scene.renderable_tree.remove(it->second.leaf);
+            it = scene.renderable_proxies.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    if(static_changed)
+        scene.reset_shadows();
+}
+
+void query_renderables(const Scene& scene, const CameraFrustum& frustum, std::vector<Object>& visible, prism::aabb_tree_statistics& statistics) {
+    visible.clear();
+    
+    const auto collect = [&visible](const uint64_t obj) {
+        visible.push_back(obj);
+    };
+    
+    if(render_options.enable_frustum_culling) {
+        scene.renderable_tree.query([&frustum](const prism::aabb& bounds) {
+            return test_aabb_frustum(frustum, bounds);
+        }, collect, &statistics);
+    } else {
+        scene.renderable_tree.query([](const prism::aabb&) {
+            return true;
+        }, collect, &statistics);
+    }
 }
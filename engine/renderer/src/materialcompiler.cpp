@@ -1,5 +1,6 @@
 #include "materialcompiler.hpp"
 
+#include <algorithm>
 #include <cstring>
 
 #include "file.hpp"
@@ -9,6 +10,7 @@
 #include "shadercompiler.hpp"
 #include "material_nodes.hpp"
 #include "renderer.hpp"
+#include "vertex_format.hpp"
 
 ShaderSource get_shader(std::string filename, bool skinned, bool cubemap) {
     auto shader_file = prism::open_file(prism::internal_domain / filename);
@@ -58,18 +60,14 @@ GFXPipeline* MaterialCompiler::create_static_pipeline(GFXGraphicsPipelineCreateI
     } else {
         createInfo.vertex_input.inputs = {
             {position_buffer_index, sizeof(prism::float3)},
-            {normal_buffer_index, sizeof(prism::float3)},
-            {texcoord_buffer_index, sizeof(prism::float2)},
-            {tangent_buffer_index, sizeof(prism::float3)},
-            {bitangent_buffer_index, sizeof(prism::float3)}
+            {vertex_buffer_index, sizeof(prism::packed_vertex)}
         };
         
         createInfo.vertex_input.attributes = {
             {position_buffer_index, 0, 0, GFXVertexFormat::FLOAT3},
-            {normal_buffer_index, 1, 0, GFXVertexFormat::FLOAT3},
-            {texcoord_buffer_index, 2, 0, GFXVertexFormat::FLOAT2},
-            {tangent_buffer_index, 3, 0, GFXVertexFormat::FLOAT3},
-            {bitangent_buffer_index, 4, 0, GFXVertexFormat::FLOAT3}
+            {vertex_buffer_index, 1, offsetof(prism::packed_vertex, normal), GFXVertexFormat::SNORM16_2},
+            {vertex_buffer_index, 2, offsetof(prism::packed_vertex, texture_coord), GFXVertexFormat::HALF2},
+            {vertex_buffer_index, 3, offsetof(prism::packed_vertex, tangent), GFXVertexFormat::UNORM10_10_10_2}
         };
     }
     
@@ -101,19 +99,15 @@ GFXPipeline* MaterialCompiler::create_skinned_pipeline(GFXGraphicsPipelineCreate
     } else {
         createInfo.vertex_input.inputs = {
             {position_buffer_index, sizeof(prism::float3)},
-            {normal_buffer_index, sizeof(prism::float3)},
-            {texcoord_buffer_index, sizeof(prism::float2)},
-            {tangent_buffer_index, sizeof(prism::float3)},
-            {bitangent_buffer_index, sizeof(prism::float3)},
+            {vertex_buffer_index, sizeof(prism::packed_vertex)},
             {bone_buffer_index, sizeof(BoneVertexData)}
         };
         
         createInfo.vertex_input.attributes = {
             {position_buffer_index, 0, 0, GFXVertexFormat::FLOAT3},
-            {normal_buffer_index, 1, 0, GFXVertexFormat::FLOAT3},
-            {texcoord_buffer_index, 2, 0, GFXVertexFormat::FLOAT2},
-            {tangent_buffer_index, 3, 0, GFXVertexFormat::FLOAT3},
-            {bitangent_buffer_index, 4, 0, GFXVertexFormat::FLOAT3},
+            {vertex_buffer_index, 1, offsetof(prism::packed_vertex, normal), GFXVertexFormat::SNORM16_2},
+            {vertex_buffer_index, 2, offsetof(prism::packed_vertex, texture_coord), GFXVertexFormat::HALF2},
+            {vertex_buffer_index, 3, offsetof(prism::packed_vertex, tangent), GFXVertexFormat::UNORM10_10_10_2},
             {bone_buffer_index, 5, offsetof(BoneVertexData, ids), GFXVertexFormat::INT4},
             {bone_buffer_index, 6, offsetof(BoneVertexData, weights), GFXVertexFormat::FLOAT4},
         };
@@ -129,38 +123,144 @@ std::tuple<GFXPipeline*, GFXPipeline*> MaterialCompiler::create_pipeline_permuta
     return {st, ss};
 }
 
-std::vector<MaterialNode*> walked_nodes;
-
-void walk_node(std::string& src, MaterialNode* node) {
-    if(utility::contains(walked_nodes, node))
-        return;
-    
-    walked_nodes.push_back(node);
-    
-    for(auto& input : node->inputs) {
-        if(input.connected_node != nullptr)
-            walk_node(src, input.connected_node);
-    }
-    
-    std::string intermediate = node->get_glsl();
-    for(auto& property : node->properties) {
-        intermediate = replace_substring(intermediate, property.name, node->get_property_value(property));
-    }
-    
-    for(auto& input : node->inputs) {
-        intermediate = replace_substring(intermediate, input.name, node->get_connector_value(input));
-    }
-    
-    for(auto& output : node->outputs) {
-        intermediate = replace_substring(intermediate, output.name, node->get_connector_variable_name(output));
+namespace {
+    // constant nodes never make it into the shader, their values are read from the material's parameters wherever they're used
+    bool is_constant_node(MaterialNode* node) {
+        return dynamic_cast<Vector3Constant*>(node) != nullptr || dynamic_cast<FloatConstant*>(node) != nullptr;
     }
     
-    src += intermediate;
+    /*
+     The nodes that actually contribute to the output, anything else in the material is dead and isn't generated. Variables are
+     named after a node's position in the graph instead of its id, so two materials with the same structure generate the same shader.
+     */
+    class material_graph {
+    public:
+        explicit material_graph(Material& material) {
+            for(auto& node : material.nodes) {
+                if(!strcmp(node->get_name(), "Material Output")) {
+                    output = node.get();
+                    visit(output);
+                    break;
+                }
+            }
+            
+            // every property that isn't a texture is moved into the parameter buffer, in the same order the nodes are visited in
+            for(auto node : nodes) {
+                for(auto& property : node->properties) {
+                    switch(property.type) {
+                        case DataType::Vector3:
+                            parameters.emplace_back(property.value, 0.0f);
+                            break;
+                        case DataType::Float:
+                            parameters.emplace_back(property.float_value, 0.0f, 0.0f, 0.0f);
+                            break;
+                        case DataType::AssetTexture:
+                            break;
+                    }
+                }
+            }
+        }
+        
+        std::string get_variable_name(MaterialNode* node, const std::string& name) const {
+            const auto index = std::find(nodes.begin(), nodes.end(), node) - nodes.begin();
+            
+            return std::string(node->get_prefix()) + std::to_string(index) + "_" + name;
+        }
+        
+        std::string get_property_value(MaterialNode* node, MaterialProperty& property) const {
+            switch(property.type) {
+                case DataType::Vector3:
+                    return "material_parameters.values[" + std::to_string(get_parameter_index(property)) + "].xyz";
+                case DataType::Float:
+                    return "material_parameters.values[" + std::to_string(get_parameter_index(property)) + "].x";
+                case DataType::AssetTexture:
+                    return "texture(" + get_variable_name(node, property.name) + ", in_uv).rgb";
+            }
+            
+            return {};
+        }
+        
+        // the value of a constant node's output is its property, so it's used directly instead of going through a variable
+        std::string get_output_value(MaterialNode* node, MaterialConnector& output) const {
+            if(is_constant_node(node))
+                return get_property_value(node, node->properties[0]);
+            
+            return get_variable_name(node, output.name);
+        }
+        
+        std::string get_input_value(MaterialConnector& input) const {
+            if(input.connected_node == nullptr) {
+                switch(input.type) {
+                    case DataType::Float:
+                        return "0.0";
+                    default:
+                        return "vec3(1, 1, 1)";
+                }
+            }
+            
+            const std::string value = get_output_value(input.connected_node, *input.connected_connector);
+            
+            if(input.type != input.connected_connector->type) {
+                if(input.type == DataType::Float)
+                    return "(" + value + ").r";
+                
+                return "vec3(" + value + ")";
+            }
+            
+            if(input.is_normal_map) {
+                if(render_options.enable_normal_mapping)
+                    return "in_tbn * decode_normal_map(" + value + ")";
+                
+                return "in_normal";
+            }
+            
+            return value;
+        }
+        
+        MaterialNode* output = nullptr;
+        
+        // ordered so every node comes after the nodes it reads from
+        std::vector<MaterialNode*> nodes;
+        
+        std::vector<prism::float4> parameters;
+        
+    private:
+        void visit(MaterialNode* node) {
+            if(utility::contains(visited, node))
+                return;
+            
+            // marked before the inputs are visited, so a cycle can't recurse forever
+            visited.push_back(node);
+            
+            for(auto& input : node->inputs) {
+                if(input.connected_node != nullptr)
+                    visit(input.connected_node);
+            }
+            
+            nodes.push_back(node);
+        }
+        
+        int get_parameter_index(const MaterialProperty& property) const {
+            int index = 0;
+            for(auto other_node : nodes) {
+                for(auto& other_property : other_node->properties) {
+                    if(&other_property == &property)
+                        return index;
+                    
+                    if(other_property.type != DataType::AssetTexture)
+                        index++;
+                }
+            }
+            
+            return index;
+        }
+        
+        std::vector<MaterialNode*> visited;
+    };
 }
 
 constexpr std::string_view struct_info =
 "layout (constant_id = 0) const int max_materials = 25;\n \
-layout (constant_id = 1) const int max_lights = 25;\n \
 layout (constant_id = 2) const int max_spot_lights = 4;\n \
 layout (constant_id = 3) const int max_probes = 4;\n \
 struct Material {\n \
@@ -181,18 +281,17 @@ layout(std430, binding = 1) buffer readonly SceneInformation {\n \
     mat4 vp, lightSpace;\n \
     mat4 spotLightSpaces[max_spot_lights];\n \
     Material materials[max_materials];\n \
-    Light lights[max_lights];\n \
     Probe probes[max_probes];\n \
+    vec4 cluster_grid;\n \
+    vec4 cluster_slices;\n \
     int numLights;\n \
+    int numClusteredLights;\n \
 } scene;\n \
 layout (binding = 2) uniform sampler2D sun_shadow;\n \
-layout (binding = 6) uniform sampler2DArray spot_shadow;\n \
-layout(push_constant, binding = 0) uniform PushConstant {\n \
-    mat4 model;\n \
-};\n";
+layout (binding = 6) uniform sampler2DArray spot_shadow;\n";
 
-ShaderSource MaterialCompiler::compile_material_fragment(Material& material, bool use_ibl) {
-    walked_nodes.clear();
+std::string MaterialCompiler::generate_material_fragment(Material& material, bool use_ibl) {
+    const material_graph graph(material);
     
     if(!render_options.enable_ibl)
         use_ibl = false;
@@ -224,6 +323,14 @@ ShaderSource MaterialCompiler::compile_material_fragment(Material& material, boo
 
     src += struct_info;
     
+    src += "layout(std430, binding = " + std::to_string(light_buffer_binding) + ") buffer readonly SceneLights {\n \
+        Light lights[];\n \
+    } scene_lights;\n";
+    
+    src += "layout(std430, binding = " + std::to_string(light_grid_binding) + ") buffer readonly LightGrid {\n \
+        uint light_grid[];\n \
+    };\n";
+    
     if(use_ibl) {
         src += "layout (binding = 7) uniform samplerCubeArray irrandianceSampler;\n \
         layout (binding = 8) uniform samplerCubeArray prefilterSampler;\n \
@@ -237,16 +344,21 @@ ShaderSource MaterialCompiler::compile_material_fragment(Material& material, boo
     src += "#include \"common.glsl\"\n";
     src += "#include \"rendering.glsl\"\n";
     
+    src += "layout(std430, binding = " + std::to_string(material_parameter_binding) + ") buffer readonly MaterialParameters {\n \
+        vec4 values[];\n \
+    } material_parameters;\n";
+    
+    material.parameters = graph.parameters;
     material.bound_textures.clear();
     
     // insert samplers as needed
     int sampler_index = 10;
-    for(auto& node : material.nodes) {
+    for(auto node : graph.nodes) {
         for(auto& property : node->properties) {
             if(property.type == DataType::AssetTexture) {
                 material.bound_textures[sampler_index] = property.value_tex;
                 
-                src += "layout(binding = " + std::to_string(sampler_index++) + ") uniform sampler2D " + node->get_property_variable_name(property) + ";\n";
+                src += "layout(binding = " + std::to_string(sampler_index++) + ") uniform sampler2D " + graph.get_variable_name(node, property.name) + ";\n";
             }
         }
     }
@@ -285,7 +397,7 @@ ShaderSource MaterialCompiler::compile_material_fragment(Material& material, boo
             float shadow = 0.0;\n \
             while(pos <= 1.0) {\n \
                 vec3 tmp_normal = texture(normal_map, in_uv + dir * pos).rgb;\n \
-                tmp_normal = in_tbn * (tmp_normal * 2.0 - 1.0);\n \
+                tmp_normal = in_tbn * decode_normal_map(tmp_normal);\n \
                 float tmp_lighting = dot(light_dir, tmp_normal);\n \
                 float shadowed = -tmp_lighting;\n \
                 slope += shadowed;\n \
@@ -314,24 +426,42 @@ ShaderSource MaterialCompiler::compile_material_fragment(Material& material, boo
     
     src += "void main() {\n";
     
-    bool has_output = false;
     bool has_normal_mapping = false;
     std::string normal_map_property_name;
-    for(auto& node : material.nodes) {
-        if(!strcmp(node->get_name(), "Material Output")) {
-            for(auto& input : node->inputs) {
-                if(input.is_normal_map && input.connected_node != nullptr) {
-                    has_normal_mapping = true;
-                    normal_map_property_name = input.connected_node->get_property_variable_name(input.connected_node->properties[0]); // quick and dirty workaround to get the normal map texture name
+    if(graph.output != nullptr) {
+        for(auto& input : graph.output->inputs) {
+            if(input.is_normal_map && input.connected_node != nullptr) {
+                for(auto& property : input.connected_node->properties) {
+                    if(property.type == DataType::AssetTexture) {
+                        has_normal_mapping = true;
+                        normal_map_property_name = graph.get_variable_name(input.connected_node, property.name);
+                    }
                 }
             }
-            
-            walk_node(src, node.get());
-            has_output = true;
         }
     }
     
-    if(!has_output) {
+    for(auto node : graph.nodes) {
+        if(is_constant_node(node))
+            continue;
+        
+        std::string intermediate = node->get_glsl();
+        for(auto& property : node->properties) {
+            intermediate = replace_substring(intermediate, property.name, graph.get_property_value(node, property));
+        }
+        
+        for(auto& input : node->inputs) {
+            intermediate = replace_substring(intermediate, input.name, graph.get_input_value(input));
+        }
+        
+        for(auto& output : node->outputs) {
+            intermediate = replace_substring(intermediate, output.name, graph.get_variable_name(node, output.name));
+        }
+        
+        src += intermediate;
+    }
+    
+    if(graph.output == nullptr) {
         src += "vec3 final_diffuse_color = vec3(1);\n";
         src += "float final_roughness = 0.5;\n";
         src += "float final_metallic = 0.0;\n";
@@ -341,18 +471,21 @@ ShaderSource MaterialCompiler::compile_material_fragment(Material& material, boo
     src +=
     "ComputedSurfaceInfo surface_info = compute_surface(final_diffuse_color.rgb, final_normal, final_metallic, final_roughness);\n \
     vec3 Lo = vec3(0);\n \
-    for(int i = 0; i < scene.numLights; i++) {\n \
-        const int type = int(scene.lights[i].positionType.w);\n \
+    const uvec2 cluster = get_light_cluster();\n \
+    const uint sun_count = uint(scene.numLights - scene.numClusteredLights);\n \
+    for(uint l = 0; l < cluster.y + sun_count; l++) {\n \
+        const int i = l < cluster.y ? int(light_grid[cluster.x + l]) : scene.numClusteredLights + int(l - cluster.y);\n \
+        const int type = int(scene_lights.lights[i].positionType.w);\n \
         ComputedLightInformation light_info;\n \
         switch(type) {\n \
             case 0:\n \
-                light_info = calculate_point(scene.lights[i]);\n \
+                light_info = calculate_point(scene_lights.lights[i]);\n \
                 break;\n \
             case 1:\n \
-                light_info = calculate_spot(scene.lights[i]);\n \
+                light_info = calculate_spot(scene_lights.lights[i]);\n \
                 break;\n \
             case 2:\n \
-                light_info = calculate_sun(scene.lights[i]);\n \
+                light_info = calculate_sun(scene_lights.lights[i]);\n \
                 break;\n \
         }\n \
     SurfaceBRDF surface_brdf = brdf(light_info.direction, surface_info);\n";
@@ -361,7 +494,7 @@ ShaderSource MaterialCompiler::compile_material_fragment(Material& material, boo
         src += std::string("light_info.radiance *= calculate_normal_lighting(") + normal_map_property_name + ", final_normal, light_info.direction);\n";
     }
         
-    src += "Lo += ((surface_brdf.specular + surface_brdf.diffuse) * light_info.radiance * surface_brdf.NdotL) * scene.lights[i].colorSize.rgb;\n \
+    src += "Lo += ((surface_brdf.specular + surface_brdf.diffuse) * light_info.radiance * surface_brdf.NdotL) * scene_lights.lights[i].colorSize.rgb;\n \
     }\n";
         
     if(use_ibl) {
@@ -393,5 +526,9 @@ ShaderSource MaterialCompiler::compile_material_fragment(Material& material, boo
     
     src += "}\n";
             
-    return *shader_compiler.compile(ShaderLanguage::GLSL, ShaderStage::Fragment, ShaderSource(src), engine->get_gfx()->accepted_shader_language());
+    return src;
+}
+
+ShaderSource MaterialCompiler::compile_material_fragment(Material& material, bool use_ibl) {
+    return *shader_compiler.compile(ShaderLanguage::GLSL, ShaderStage::Fragment, ShaderSource(generate_material_fragment(material, use_ibl)), engine->get_gfx()->accepted_shader_language());
 }
@@ -0,0 +1,31 @@
+#include "meshlod.hpp"
+
+#include <algorithm>
+
+#include "render_options.hpp"
+
+float calculate_orthographic_screen_size(const prism::aabb& bounds, const float view_height, const uint32_t screen_height) {
+    return length(bounds.max - bounds.min) / view_height * static_cast<float>(screen_height);
+}
+
+int select_mesh_lod(const Mesh::Part& part, const float screen_size) {
+    if(part.lods.size() <= 1)
+        return 0;
+
+    // lod errors are in model space, so they're compared against the size of the model space bounds
+    const float part_size = length(part.bounding_box.max - part.bounding_box.min);
+
+    int level = 0;
+    if(part_size > 0.0f) {
+        const float pixels_per_unit = screen_size / part_size;
+
+        for(size_t i = 1; i < part.lods.size(); i++) {
+            if(part.lods[i].error * pixels_per_unit > max_lod_screen_error)
+                break;
+
+            level = static_cast<int>(i);
+        }
+    }
+
+    return std::clamp(level + render_options.lod_bias, 0, static_cast<int>(part.lods.size()) - 1);
+}
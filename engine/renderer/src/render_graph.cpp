@@ -0,0 +1,399 @@
+#include "render_graph.hpp"
+
+#include <algorithm>
+
+#include "gfx.hpp"
+#include "gfx_commandbuffer.hpp"
+#include "assertions.hpp"
+
+namespace {
+    // allocations nothing asked for in this many frames are destroyed, so toggling a feature doesn't recreate its textures every time
+    constexpr int max_unused_frames = 30;
+
+    uint64_t get_bits_per_pixel(const GFXPixelFormat format) {
+        switch(format) {
+            case GFXPixelFormat::R8_UNORM:
+                return 8;
+            case GFXPixelFormat::R_16F:
+            case GFXPixelFormat::R8G8_UNORM:
+            case GFXPixelFormat::R8G8_SFLOAT:
+                return 16;
+            case GFXPixelFormat::R_32F:
+            case GFXPixelFormat::RGBA8_UNORM:
+            case GFXPixelFormat::R8G8B8A8_UNORM:
+            case GFXPixelFormat::DEPTH_32F:
+                return 32;
+            case GFXPixelFormat::R16G16B16A16_SFLOAT:
+                return 64;
+            case GFXPixelFormat::RGBA_32F:
+                return 128;
+            case GFXPixelFormat::BC1_UNORM:
+            case GFXPixelFormat::BC4_UNORM:
+                return 4;
+            case GFXPixelFormat::BC3_UNORM:
+            case GFXPixelFormat::BC5_UNORM:
+            case GFXPixelFormat::BC7_UNORM:
+                return 8;
+        }
+
+        return 0;
+    }
+
+    uint64_t get_memory_size(const prism::render_texture_desc& desc) {
+        return uint64_t(desc.extent.width) * desc.extent.height * get_bits_per_pixel(desc.format) / 8;
+    }
+
+    bool is_compatible(const prism::render_texture_desc& a, const prism::render_texture_desc& b) {
+        return a.extent.width == b.extent.width && a.extent.height == b.extent.height && a.format == b.format && a.usage == b.usage;
+    }
+}
+
+prism::render_texture prism::render_graph_builder::read(const render_texture texture, const texture_access access) {
+    Expects(texture.is_valid());
+
+    render_graph::texture_use use;
+    use.texture = texture;
+    use.access = access;
+
+    graph.passes[pass].uses.push_back(use);
+
+    return texture;
+}
+
+prism::render_texture prism::render_graph_builder::write(const render_texture texture, const texture_access access) {
+    Expects(texture.is_valid());
+
+    render_graph::texture_use use;
+    use.texture = texture;
+    use.access = access;
+    use.write = true;
+
+    graph.passes[pass].uses.push_back(use);
+
+    return texture;
+}
+
+void prism::render_graph_builder::set_side_effect() {
+    graph.passes[pass].side_effect = true;
+}
+
+void prism::render_graph::reset() {
+    pass_count = 0;
+    textures.clear();
+    statistics = {};
+}
+
+void prism::render_graph::add_pass(const std::string_view name, const std::function<void(render_graph_builder&)>& setup, execute_function execute) {
+    if(pass_count == passes.size())
+        passes.emplace_back();
+
+    auto& new_pass = passes[pass_count];
+    new_pass.name = name;
+    new_pass.execute = std::move(execute);
+    new_pass.uses.clear();
+    new_pass.side_effect = false;
+    new_pass.culled = false;
+    new_pass.transitions.clear();
+    new_pass.needs_barrier = false;
+
+    render_graph_builder builder(*this, static_cast<uint32_t>(pass_count));
+    pass_count++;
+
+    setup(builder);
+}
+
+prism::render_texture prism::render_graph::create_texture(const render_texture_desc& desc) {
+    texture texture;
+    texture.desc = desc;
+
+    textures.push_back(texture);
+
+    render_texture handle;
+    handle.index = static_cast<uint32_t>(textures.size() - 1);
+
+    return handle;
+}
+
+prism::render_texture prism::render_graph::import_texture(const std::string_view label, GFXTexture* handle) {
+    texture texture;
+    texture.desc.label = label;
+    texture.imported = true;
+    texture.handle = handle;
+
+    textures.push_back(texture);
+
+    render_texture result;
+    result.index = static_cast<uint32_t>(textures.size() - 1);
+
+    return result;
+}
+
+void prism::render_graph::export_texture(const render_texture texture) {
+    Expects(texture.is_valid());
+
+    textures[texture.index].exported = true;
+}
+
+void prism::render_graph::compile(GFX* gfx) {
+    Expects(gfx != nullptr);
+
+    this->gfx = gfx;
+
+    cull_passes();
+    derive_transitions();
+    allocate_textures(gfx);
+    release_unused_allocations(gfx);
+}
+
+void prism::render_graph::execute(GFXCommandBuffer* command_buffer) {
+    for(size_t i = 0; i < pass_count; i++) {
+        auto& pass = passes[i];
+        if(pass.culled)
+            continue;
+
+        // render passes already transition their attachments for sampling, but nothing finishes storage writes for us
+        if(pass.needs_barrier) {
+            command_buffer->end_render_pass();
+            command_buffer->memory_barrier();
+        }
+
+        command_buffer->push_group(pass.name);
+
+        pass.execute(command_buffer, *this);
+
+        command_buffer->pop_group();
+    }
+}
+
+GFXTexture* prism::render_graph::get_texture(const render_texture texture) const {
+    Expects(texture.is_valid());
+
+    return textures[texture.index].handle;
+}
+
+GFXFramebuffer* prism::render_graph::get_framebuffer(GFXRenderPass* render_pass, const std::initializer_list<render_texture> attachments) {
+    for(auto& cached : framebuffers) {
+        if(cached.render_pass != render_pass || cached.attachments.size() != attachments.size())
+            continue;
+
+        if(std::equal(attachments.begin(), attachments.end(), cached.attachments.begin(), [this](const render_texture texture, GFXTexture* handle) {
+            return get_texture(texture) == handle;
+        }))
+            return cached.framebuffer;
+    }
+
+    GFXFramebufferCreateInfo info = {};
+    info.render_pass = render_pass;
+
+    for(const auto attachment : attachments)
+        info.attachments.push_back(get_texture(attachment));
+
+    cached_framebuffer cached;
+    cached.render_pass = render_pass;
+    cached.attachments = info.attachments;
+    cached.framebuffer = gfx->create_framebuffer(info);
+
+    return framebuffers.emplace_back(std::move(cached)).framebuffer;
+}
+
+void prism::render_graph::cull_passes() {
+    // every pass is referenced by the textures it writes, and every texture by the passes that read it
+    std::vector<uint32_t> pass_references(pass_count), texture_references(textures.size());
+
+    for(size_t i = 0; i < pass_count; i++) {
+        for(const auto& use : passes[i].uses) {
+            if(use.write)
+                pass_references[i]++;
+            else
+                texture_references[use.texture.index]++;
+        }
+    }
+
+    for(size_t i = 0; i < textures.size(); i++) {
+        if(textures[i].exported)
+            texture_references[i]++;
+    }
+
+    std::vector<uint32_t> unreferenced;
+
+    const auto cull = [&texture_references, &unreferenced](pass& pass) {
+        pass.culled = true;
+
+        for(const auto& use : pass.uses) {
+            if(!use.write && --texture_references[use.texture.index] == 0)
+                unreferenced.push_back(use.texture.index);
+        }
+    };
+
+    for(size_t i = 0; i < textures.size(); i++) {
+        if(texture_references[i] == 0)
+            unreferenced.push_back(static_cast<uint32_t>(i));
+    }
+
+    for(size_t i = 0; i < pass_count; i++) {
+        if(pass_references[i] == 0 && !passes[i].side_effect)
+            cull(passes[i]);
+    }
+
+    // nothing reads these textures, so the passes writing them might not be needed either
+    while(!unreferenced.empty()) {
+        const uint32_t texture = unreferenced.back();
+        unreferenced.pop_back();
+
+        for(size_t i = 0; i < pass_count; i++) {
+            auto& pass = passes[i];
+            if(pass.culled || pass.side_effect)
+                continue;
+
+            for(const auto& use : pass.uses) {
+                if(use.write && use.texture.index == texture && --pass_references[i] == 0) {
+                    cull(pass);
+                    break;
+                }
+            }
+        }
+    }
+
+    for(size_t i = 0; i < pass_count; i++) {
+        if(passes[i].culled)
+            statistics.culled_passes++;
+        else
+            statistics.passes++;
+    }
+}
+
+void prism::render_graph::derive_transitions() {
+    struct texture_state {
+        texture_access access = texture_access::sampled;
+        bool written = false, used = false;
+    };
+
+    std::vector<texture_state> states(textures.size());
+
+    for(size_t i = 0; i < pass_count; i++) {
+        auto& pass = passes[i];
+        if(pass.culled)
+            continue;
+
+        for(const auto& use : pass.uses) {
+            auto& texture = textures[use.texture.index];
+            auto& state = states[use.texture.index];
+
+            if(!texture.used) {
+                texture.first_use = static_cast<uint32_t>(i);
+                texture.used = true;
+            }
+
+            texture.last_use = static_cast<uint32_t>(i);
+
+            // reading the same way twice in a row is the only case that doesn't need anything in between
+            if(state.used && (state.written || use.write || state.access != use.access)) {
+                texture_transition transition;
+                transition.texture = use.texture;
+                transition.from = state.access;
+                transition.to = use.access;
+
+                pass.transitions.push_back(transition);
+
+                pass.needs_barrier |= state.written && state.access == texture_access::storage;
+            }
+
+            state.access = use.access;
+            state.written = use.write;
+            state.used = true;
+        }
+
+        statistics.transitions += static_cast<uint32_t>(pass.transitions.size());
+
+        if(pass.needs_barrier)
+            statistics.barriers++;
+    }
+
+    for(auto& texture : textures) {
+        if(texture.exported)
+            texture.last_use = static_cast<uint32_t>(pass_count);
+    }
+}
+
+void prism::render_graph::allocate_textures(GFX* gfx) {
+    for(auto& allocation : allocations)
+        allocation.taken = false;
+
+    // textures that start earlier are placed first, so each one only has to fit after whatever is already in an allocation
+    std::vector<uint32_t> order;
+    for(size_t i = 0; i < textures.size(); i++) {
+        if(!textures[i].imported && textures[i].used)
+            order.push_back(static_cast<uint32_t>(i));
+    }
+
+    std::sort(order.begin(), order.end(), [this](const uint32_t a, const uint32_t b) {
+        return textures[a].first_use < textures[b].first_use;
+    });
+
+    for(const auto index : order) {
+        auto& texture = textures[index];
+
+        statistics.transient_textures++;
+        statistics.unaliased_memory += get_memory_size(texture.desc);
+
+        allocation* found = nullptr;
+        for(auto& allocation : allocations) {
+            if(is_compatible(allocation.desc, texture.desc) && (!allocation.taken || allocation.last_use < texture.first_use)) {
+                found = &allocation;
+                break;
+            }
+        }
+
+        if(found == nullptr) {
+            GFXTextureCreateInfo info = {};
+            info.label = std::string(texture.desc.label);
+            info.width = texture.desc.extent.width;
+            info.height = texture.desc.extent.height;
+            info.format = texture.desc.format;
+            info.usage = texture.desc.usage;
+            info.samplingMode = SamplingMode::ClampToEdge; // everything in the graph covers the screen, so nothing should repeat
+
+            allocation allocation;
+            allocation.desc = texture.desc;
+            allocation.handle = gfx->create_texture(info);
+
+            found = &allocations.emplace_back(allocation);
+        }
+
+        if(!found->taken) {
+            statistics.allocated_textures++;
+            statistics.peak_memory += get_memory_size(found->desc);
+        }
+
+        found->taken = true;
+        found->last_use = texture.last_use;
+        found->unused_frames = 0;
+
+        texture.handle = found->handle;
+    }
+}
+
+void prism::render_graph::release_unused_allocations(GFX* gfx) {
+    for(auto& allocation : allocations) {
+        if(!allocation.taken)
+            allocation.unused_frames++;
+    }
+
+    const auto is_expired = [](const allocation& allocation) {
+        return allocation.unused_frames > max_unused_frames;
+    };
+
+    for(const auto& allocation : allocations) {
+        if(!is_expired(allocation))
+            continue;
+
+        // there's no way to destroy framebuffers, but they can at least stop being handed out
+        framebuffers.erase(std::remove_if(framebuffers.begin(), framebuffers.end(), [&allocation](const cached_framebuffer& cached) {
+            return std::find(cached.attachments.begin(), cached.attachments.end(), allocation.handle) != cached.attachments.end();
+        }), framebuffers.end());
+
+        gfx->destroy_texture(allocation.handle);
+    }
+
+    allocations.erase(std::remove_if(allocations.begin(), allocations.end(), is_expired), allocations.end());
+}
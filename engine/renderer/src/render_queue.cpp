@@ -0,0 +1,197 @@
+#include "render_queue.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include "gfx.hpp"
+#include "gfx_commandbuffer.hpp"
+
+namespace {
+    constexpr int pipeline_bits = 12, material_bits = 16, mesh_bits = 16, depth_bits = 20;
+
+    constexpr uint64_t mask(const int bits) {
+        return (uint64_t(1) << bits) - 1;
+    }
+}
+
+uint64_t prism::make_sort_key(const uint32_t pipeline, const uint32_t material, const uint32_t mesh, const float depth) {
+    // positive floats sort the same way as their bits, so the top bits are a coarse but ordered depth
+    const float clamped_depth = depth > 0.0f ? depth : 0.0f;
+
+    uint32_t depth_value = 0;
+    memcpy(&depth_value, &clamped_depth, sizeof(float));
+    depth_value >>= 32 - 1 - depth_bits;
+
+    uint64_t key = std::min<uint64_t>(pipeline, mask(pipeline_bits));
+    key = (key << material_bits) | std::min<uint64_t>(material, mask(material_bits));
+    key = (key << mesh_bits) | std::min<uint64_t>(mesh, mask(mesh_bits));
+    key = (key << depth_bits) | (depth_value & mask(depth_bits));
+
+    return key;
+}
+
+void prism::render_queue::clear() {
+    items.clear();
+    batches.clear();
+    pipeline_ids.clear();
+    material_ids.clear();
+    mesh_ids.clear();
+}
+
+void prism::render_queue::add(draw_item item, const float depth) {
+    item.key = make_sort_key(get_id(pipeline_ids, item.pipeline), get_id(material_ids, item.material), get_id(mesh_ids, item.mesh), depth);
+
+    items.push_back(item);
+}
+
+void prism::render_queue::sort() {
+    std::sort(items.begin(), items.end(), [](const draw_item& a, const draw_item& b) {
+        return a.key < b.key;
+    });
+
+    // the parts of a mesh only differ in depth, so they're grouped again to put instances of the same part next to each other
+    for(auto run = items.begin(); run != items.end();) {
+        const uint64_t state = run->key >> depth_bits;
+        const auto run_end = std::find_if(run, items.end(), [state](const draw_item& item) {
+            return (item.key >> depth_bits) != state;
+        });
+
+        // truncated ids can put parts of different meshes in the same run, and only std::less orders unrelated pointers
+        std::stable_sort(run, run_end, [](const draw_item& a, const draw_item& b) {
+            if(a.part != b.part)
+                return std::less<const Mesh::Part*>()(a.part, b.part);
+
+            return a.lod < b.lod;
+        });
+
+        run = run_end;
+    }
+
+    // skinned meshes have their own matrices for every renderable, so they can't be instanced
+    const auto can_batch = [](const draw_item& a, const draw_item& b) {
+        return a.pipeline == b.pipeline && a.material == b.material && a.mesh == b.mesh && a.part == b.part && a.lod == b.lod && a.mesh->bones.empty();
+    };
+
+    batches.clear();
+    for(uint32_t i = 0; i < items.size(); i++) {
+        if(!batches.empty() && can_batch(items[batches.back().first_item], items[i])) {
+            batches.back().item_count++;
+        } else {
+            batches.push_back({i, 1});
+        }
+    }
+}
+
+std::vector<Matrix4x4> prism::render_queue::get_models() const {
+    std::vector<Matrix4x4> models;
+    models.reserve(items.size());
+
+    for(const auto& item : items)
+        models.push_back(item.model);
+
+    return models;
+}
+
+uint32_t prism::render_queue::get_id(std::unordered_map<const void*, uint32_t>& ids, const void* pointer) {
+    return ids.try_emplace(pointer, static_cast<uint32_t>(ids.size())).first->second;
+}
+
+void prism::instance_buffer::reset() {
+    used = 0;
+}
+
+uint32_t prism::instance_buffer::upload(GFX* gfx, const std::vector<Matrix4x4>& models) {
+    if(models.empty())
+        return 0;
+
+    // draws recorded earlier in the frame still read from the old buffer, so it's retired instead of being reused
+    if(used + models.size() > capacity) {
+        capacity = std::max(models.size(), capacity * 2);
+        gfx->destroy_buffer(buffer);
+        buffer = gfx->create_buffer(nullptr, capacity * sizeof(Matrix4x4), true, GFXBufferUsage::Storage);
+        used = 0;
+    }
+
+    const auto first = static_cast<uint32_t>(used);
+
+    gfx->copy_buffer(buffer, const_cast<Matrix4x4*>(models.data()), used * sizeof(Matrix4x4), models.size() * sizeof(Matrix4x4));
+    used += models.size();
+
+    return first;
+}
+
+void prism::command_state_cache::set_graphics_pipeline(GFXPipeline* pipeline) {
+    if(this->pipeline == pipeline)
+        return;
+
+    command_buffer->set_graphics_pipeline(pipeline);
+    statistics.pipeline_binds++;
+
+    this->pipeline = pipeline;
+    shader_buffers = {};
+    textures = {};
+}
+
+void prism::command_state_cache::bind_shader_buffer(GFXBuffer* buffer, const int offset, const int index, const int size) {
+    if(index >= 0 && index < max_bindings) {
+        auto& bound = shader_buffers[index];
+        if(bound.buffer == buffer && bound.offset == offset && bound.size == size)
+            return;
+
+        bound = {buffer, offset, size};
+    }
+
+    command_buffer->bind_shader_buffer(buffer, offset, index, size);
+    statistics.descriptor_binds++;
+}
+
+void prism::command_state_cache::bind_texture(GFXTexture* texture, const int index) {
+    if(index >= 0 && index < max_bindings) {
+        if(textures[index] == texture)
+            return;
+
+        textures[index] = texture;
+    }
+
+    command_buffer->bind_texture(texture, index);
+    statistics.descriptor_binds++;
+}
+
+void prism::command_state_cache::set_vertex_buffer(GFXBuffer* buffer, const int offset, const int index) {
+    if(index >= 0 && index < max_bindings) {
+        auto& bound = vertex_buffers[index];
+        if(bound.buffer == buffer && bound.offset == offset)
+            return;
+
+        bound = {buffer, offset, 0};
+    }
+
+    command_buffer->set_vertex_buffer(buffer, offset, index);
+    statistics.buffer_binds++;
+}
+
+void prism::command_state_cache::set_index_buffer(GFXBuffer* buffer, const IndexType index_type) {
+    if(index_buffer == buffer && this->index_type == index_type)
+        return;
+
+    command_buffer->set_index_buffer(buffer, index_type);
+    statistics.buffer_binds++;
+
+    index_buffer = buffer;
+    this->index_type = index_type;
+}
+
+void prism::command_state_cache::draw_indexed(const int index_count, const int first_index, const int vertex_offset, const int base_instance, const int instance_count) {
+    command_buffer->draw_indexed(index_count, first_index, vertex_offset, base_instance, instance_count);
+    statistics.draw_calls++;
+    statistics.instances += instance_count;
+}
+
+void prism::command_state_cache::invalidate() {
+    pipeline = nullptr;
+    shader_buffers = {};
+    textures = {};
+    vertex_buffers = {};
+    index_buffer = nullptr;
+}
@@ -1,6 +1,9 @@
 #include "renderer.hpp"
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <future>
 
 #include "gfx_commandbuffer.hpp"
 #include "math.hpp"
@@ -23,6 +26,13 @@
 #include "shadercompiler.hpp"
 #include "asset.hpp"
 #include "debug.hpp"
+#include "texturestreaming.hpp"
+#include "meshlod.hpp"
+#include "engine.hpp"
+#include "thread_pool.hpp"
+#include "animation_system.hpp"
+#include "render_queue.hpp"
+#include "scene_lights.hpp"
 
 using prism::renderer;
 
@@ -50,13 +60,6 @@ struct SceneMaterial {
     prism::float4 color, info;
 };
 
-struct SceneLight {
-    prism::float4 positionType;
-    prism::float4 directionPower;
-    prism::float4 colorSize;
-    prism::float4 shadowsEnable;
-};
-
 struct SceneProbe {
     prism::float4 position, size;
 };
@@ -67,10 +70,12 @@ struct SceneInformation {
     Matrix4x4 vp, lightspace;
     Matrix4x4 spotLightSpaces[max_spot_shadows];
     SceneMaterial materials[max_scene_materials];
-    SceneLight lights[max_scene_lights];
     SceneProbe probes[max_environment_probes];
+    prism::float4 cluster_grid; // the number of light clusters across, down and in depth
+    prism::float4 cluster_slices; // the scale and bias of prism::light_clusters
     int numLights;
-    int p[3];
+    int numClusteredLights; // the lights before this are in the light grid, every light after it lights everything
+    int p[2];
 };
 
 struct PostPushConstants {
@@ -88,10 +93,48 @@ struct SkyPushConstant {
     float aspect;
 };
 
+struct renderer::mesh_pipeline_job {
+    // every material waiting on these pipelines, more can join while the job is running. these keep the materials loaded until the job is finished
+    std::vector<AssetPtr<Material>> materials;
+    
+    // the generated fragment shaders, which only depend on the structure of the material
+    std::string key;
+    
+    // the fragment shaders are still GLSL at this point, compiling them is most of the work
+    GFXGraphicsPipelineCreateInfo mesh_info, capture_info;
+    
+    mesh_pipelines pipelines;
+    
+    // set by the worker once compile() has returned
+    std::promise<void> compiled;
+    std::future<void> compiled_future = compiled.get_future();
+    
+    bool is_finished() const {
+        return compiled_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+    
+    void compile() {
+        const auto language = ::engine->get_gfx()->accepted_shader_language();
+        
+        mesh_info.shaders.fragment_src = *shader_compiler.compile(ShaderLanguage::GLSL, ShaderStage::Fragment, mesh_info.shaders.fragment_src, language);
+        std::tie(pipelines.static_pipeline, pipelines.skinned_pipeline) = material_compiler.create_pipeline_permutations(mesh_info);
+        
+        capture_info.shaders.fragment_src = *shader_compiler.compile(ShaderLanguage::GLSL, ShaderStage::Fragment, capture_info.shaders.fragment_src, language);
+        pipelines.capture_pipeline = material_compiler.create_static_pipeline(capture_info, false, true);
+    }
+};
+
+void apply_mesh_pipelines(Material& material, GFXPipeline* static_pipeline, GFXPipeline* skinned_pipeline, GFXPipeline* capture_pipeline) {
+    material.static_pipeline = static_pipeline;
+    material.skinned_pipeline = skinned_pipeline;
+    material.capture_pipeline = capture_pipeline;
+}
+
 renderer::renderer(GFX* gfx, const bool enable_imgui) : gfx(gfx) {
     Expects(gfx != nullptr);
     
     shader_compiler.set_include_path(prism::get_domain_path(prism::domain::internal).string());
+    shader_compiler.set_cache_directory(prism::get_writeable_directory() / "shader_cache");
 
     create_dummy_texture();
     create_histogram_resources();
@@ -122,7 +165,11 @@ renderer::renderer(GFX* gfx, const bool enable_imgui) : gfx(gfx) {
     create_sky_pipeline();
 }
 
-renderer::~renderer() = default;
+renderer::~renderer() {
+    // the jobs point into pipeline_jobs, so they can't outlive it
+    for(const auto& job : pipeline_jobs)
+        job->compiled_future.wait();
+}
 
 RenderTarget* renderer::allocate_render_target(const prism::Extent extent) {
     auto target = new RenderTarget();
@@ -138,7 +185,6 @@ void renderer::resize_render_target(RenderTarget& target, const prism::Extent ex
     target.extent = extent;
         
     create_render_target_resources(target);
-    smaa_pass->create_render_target_resources(target);
     create_post_pipelines();
     
     GFXGraphicsPipelineCreateInfo pipelineInfo = {};
@@ -228,6 +274,8 @@ void renderer::update_screen() {
 }
 
 void renderer::render(GFXCommandBuffer* commandbuffer, Scene* scene, RenderTarget& target, int index) {
+    finish_pipeline_jobs();
+    
     const auto extent = target.extent;
     const auto render_extent = target.get_render_extent();
         
@@ -249,32 +297,80 @@ void renderer::render(GFXCommandBuffer* commandbuffer, Scene* scene, RenderTarge
         return;
     }
 
-    commandbuffer->push_group("Scene Rendering");
-    
-    GFXRenderPassBeginInfo beginInfo = {};
-    beginInfo.framebuffer = target.offscreenFramebuffer;
-    beginInfo.render_pass = offscreen_render_pass;
-    beginInfo.render_area.extent = render_extent;
+    auto& graph = target.graph;
+    graph.reset();
 
     controller_continuity continuity;
 
+    // the shadow maps are owned by the scene, they're only imported so the scene pass waits on them
+    std::array<prism::render_texture, 3> shadow_maps;
     if(scene != nullptr) {
-        commandbuffer->push_group("Shadow Rendering");
+        // every view this frame culls against the same tree, so it's only updated once
+        update_renderable_tree(*scene);
         
-        shadow_pass->render(commandbuffer, *scene);
-        
-        commandbuffer->pop_group();
+        // the matrices are rewritten every frame, so they go into this frame's buffer instead of one still being read
+        auto& skinning = target.skinning[target.current_frame];
+        skinning.reset();
+        skinning.upload(gfx, ::engine->get_animation_system()->get_skinning_matrices());
         
+        shadow_maps = {graph.import_texture("Sun Shadow", scene->depthTexture),
+                       graph.import_texture("Point Shadows", scene->pointLightArray),
+                       graph.import_texture("Spot Shadows", scene->spotLightArray)};
+
+        graph.add_pass("Shadow Rendering", [&shadow_maps](prism::render_graph_builder& builder) {
+            for(const auto shadow_map : shadow_maps)
+                builder.write(shadow_map);
+        }, [this, scene, &target](GFXCommandBuffer* command_buffer, prism::render_graph&) {
+            shadow_pass->render(command_buffer, *scene, target.shadow_instances[target.current_frame], target.skinning[target.current_frame].buffer);
+        });
+
+        // probes are kept between frames, so nothing in this frame has to read them for the capture to matter
         if(render_options.enable_ibl) {
-            commandbuffer->push_group("Scene Capture");
-            scene_capture->render(commandbuffer, scene);
-            commandbuffer->pop_group();
+            graph.add_pass("Scene Capture", [](prism::render_graph_builder& builder) {
+                builder.set_side_effect();
+            }, [this, scene](GFXCommandBuffer* command_buffer, prism::render_graph&) {
+                scene_capture->render(command_buffer, scene);
+            });
         }
-        
-        commandbuffer->set_render_pass(beginInfo);
-        
+    }
+
+    prism::render_texture_desc desc;
+    desc.label = "Offscreen Color";
+    desc.extent = render_extent;
+    desc.format = GFXPixelFormat::RGBA_32F;
+    desc.usage = GFXTextureUsage::Attachment | GFXTextureUsage::Sampled | GFXTextureUsage::Storage;
+
+    const auto color = graph.create_texture(desc);
+
+    desc.label = "Offscreen Depth";
+    desc.format = GFXPixelFormat::DEPTH_32F;
+    desc.usage = GFXTextureUsage::Attachment | GFXTextureUsage::Sampled;
+
+    const auto depth = graph.create_texture(desc);
+
+    graph.add_pass("Scene Rendering", [&](prism::render_graph_builder& builder) {
+        builder.write(color);
+        builder.write(depth);
+
+        if(scene != nullptr) {
+            for(const auto shadow_map : shadow_maps)
+                builder.read(shadow_map);
+        }
+    }, [&](GFXCommandBuffer* command_buffer, prism::render_graph& graph) {
+        GFXRenderPassBeginInfo beginInfo = {};
+        beginInfo.framebuffer = graph.get_framebuffer(offscreen_render_pass, {color, depth});
+        beginInfo.render_pass = offscreen_render_pass;
+        beginInfo.render_area.extent = render_extent;
+
+        command_buffer->set_render_pass(beginInfo);
+
+        if(scene == nullptr)
+            return;
+
+        target.instances[target.current_frame].reset();
+
         const auto& cameras = scene->get_all<Camera>();
-        for(auto& [obj, camera] : cameras) {            
+        for(auto& [obj, camera] : cameras) {
             const bool requires_limited_perspective = render_options.enable_depth_of_field;
             if(requires_limited_perspective) {
                 camera.perspective = prism::perspective(radians(camera.fov),
@@ -286,124 +382,148 @@ void renderer::render(GFXCommandBuffer* commandbuffer, Scene* scene, RenderTarge
                                                                      static_cast<float>(render_extent.width) / static_cast<float>(render_extent.height),
                                                                  camera.near);
             }
-        
+
             camera.view = inverse(scene->get<Transform>(obj).model);
-            
+
             Viewport viewport = {};
             viewport.width = static_cast<float>(render_extent.width);
             viewport.height = static_cast<float>(render_extent.height);
 
-            commandbuffer->set_viewport(viewport);
-            
-            commandbuffer->push_group("render camera");
+            command_buffer->set_viewport(viewport);
 
-            render_camera(commandbuffer, *scene, obj, camera, render_extent, target, continuity);
+            command_buffer->push_group("render camera");
 
-            commandbuffer->pop_group();
+            render_camera(command_buffer, *scene, obj, camera, render_extent, target, continuity);
+
+            command_buffer->pop_group();
         }
-    }
-    
-    commandbuffer->pop_group();
+    });
 
-    commandbuffer->push_group("SMAA");
-    
-    smaa_pass->render(commandbuffer, target);
-    
-    commandbuffer->pop_group();
+    // the editor and debug views show the scene after the frame is done
+    graph.export_texture(color);
 
-    if(render_options.enable_depth_of_field && dof_pass != nullptr)
-        dof_pass->render(commandbuffer, *scene);
+    const auto smaa_blend = smaa_pass->add_passes(graph, target, color, depth);
 
-    commandbuffer->push_group("Post Processing");
+    const bool enable_depth_of_field = render_options.enable_depth_of_field && dof_pass != nullptr;
 
-    commandbuffer->end_render_pass();
+    DoFPass::fields dof_fields;
+    if(dof_pass != nullptr)
+        dof_fields = dof_pass->add_passes(graph, render_extent);
 
-    // begin auto exposure
-    
-    commandbuffer->set_compute_pipeline(histogram_pipeline);
-    
-    commandbuffer->bind_texture(target.offscreenColorTexture, 0);
-    commandbuffer->bind_shader_buffer(histogram_buffer, 0, 1, sizeof(uint32_t) * 256);
-    
-    const float lum_range = render_options.max_luminance - render_options.min_luminance;
+    const auto average_luminance = graph.import_texture("Average Luminance", average_luminance_texture);
 
-    prism::float4 params = prism::float4(render_options.min_luminance,
-                             1.0f / lum_range,
-                             static_cast<float>(render_extent.width),
-                             static_cast<float>(render_extent.height));
-    
-    commandbuffer->set_push_constant(&params, sizeof(prism::float4));
-    
-    commandbuffer->dispatch(static_cast<uint32_t>(std::ceil(static_cast<float>(render_extent.width) / 16.0f)),
-                            static_cast<uint32_t>(std::ceil(static_cast<float>(render_extent.height) / 16.0f)), 1);
-    
-    commandbuffer->set_compute_pipeline(histogram_average_pipeline);
+    graph.add_pass("Auto Exposure", [&](prism::render_graph_builder& builder) {
+        builder.read(color);
+        builder.write(average_luminance, prism::texture_access::storage);
+    }, [&](GFXCommandBuffer* command_buffer, prism::render_graph& graph) {
+        command_buffer->end_render_pass();
 
-    commandbuffer->bind_shader_buffer(histogram_buffer, 0, 1, sizeof(uint32_t) * 256);
+        command_buffer->set_compute_pipeline(histogram_pipeline);
 
-    params = prism::float4(render_options.min_luminance,
-                     lum_range,
-                     std::clamp(1.0f - std::exp(-(1.0f / 60.0f) * 1.1f), 0.0f, 1.0f),
-                     static_cast<float>(render_extent.width * render_extent.height));
-    
-    commandbuffer->set_push_constant(&params, sizeof(prism::float4));
-    
-    commandbuffer->bind_texture(average_luminance_texture, 0);
-    
-    commandbuffer->dispatch(1, 1, 1);
+        command_buffer->bind_texture(graph.get_texture(color), 0);
+        command_buffer->bind_shader_buffer(histogram_buffer, 0, 1, sizeof(uint32_t) * 256);
 
-    // continue post processing
-    beginInfo.framebuffer = nullptr;
-    beginInfo.render_pass = nullptr;
+        const float lum_range = render_options.max_luminance - render_options.min_luminance;
 
-    commandbuffer->set_render_pass(beginInfo);
+        prism::float4 params = prism::float4(render_options.min_luminance,
+                                 1.0f / lum_range,
+                                 static_cast<float>(render_extent.width),
+                                 static_cast<float>(render_extent.height));
 
-    Viewport viewport = {};
-    viewport.width = static_cast<float>(render_extent.width);
-    viewport.height = static_cast<float>(render_extent.height);
+        command_buffer->set_push_constant(&params, sizeof(prism::float4));
 
-    commandbuffer->set_viewport(viewport);
+        command_buffer->dispatch(static_cast<uint32_t>(std::ceil(static_cast<float>(render_extent.width) / 16.0f)),
+                                static_cast<uint32_t>(std::ceil(static_cast<float>(render_extent.height) / 16.0f)), 1);
 
-    commandbuffer->set_graphics_pipeline(post_pipeline);
-    
-    if(render_options.enable_depth_of_field)
-        commandbuffer->bind_texture(dof_pass->normal_field, 1);
-    else
-        commandbuffer->bind_texture(target.offscreenColorTexture, 1);
-    
-    commandbuffer->bind_texture(target.blend_texture, 3);
-    
-    if(auto texture = get_requested_texture(PassTextureType::SelectionSobel))
-        commandbuffer->bind_texture(texture, 5);
-    else
-        commandbuffer->bind_texture(dummy_texture, 5);
-    
-    commandbuffer->bind_texture(average_luminance_texture, 6);
-    
-    if(render_options.enable_depth_of_field)
-        commandbuffer->bind_texture(dof_pass->far_field, 7);
-    else
-        commandbuffer->bind_texture(dummy_texture, 7);
+        command_buffer->set_compute_pipeline(histogram_average_pipeline);
 
-    PostPushConstants pc;
-    pc.options.x = render_options.enable_aa;
-    pc.options.z = render_options.exposure;
-    
-    if(render_options.enable_depth_of_field)
-        pc.options.w = 2;
-    
-    pc.transform_ops.x = static_cast<float>(render_options.display_color_space);
-    pc.transform_ops.y = static_cast<float>(render_options.tonemapping);
-    
-    const auto [width, height] = render_extent;
-    pc.viewport = prism::float4(1.0f / static_cast<float>(width), 1.0f / static_cast<float>(height), static_cast<float>(width), static_cast<float>(height));
-    
-    commandbuffer->set_push_constant(&pc, sizeof(PostPushConstants));
-    
-    commandbuffer->draw(0, 4, 0, 1);
+        command_buffer->bind_shader_buffer(histogram_buffer, 0, 1, sizeof(uint32_t) * 256);
+
+        params = prism::float4(render_options.min_luminance,
+                         lum_range,
+                         std::clamp(1.0f - std::exp(-(1.0f / 60.0f) * 1.1f), 0.0f, 1.0f),
+                         static_cast<float>(render_extent.width * render_extent.height));
+
+        command_buffer->set_push_constant(&params, sizeof(prism::float4));
+
+        command_buffer->bind_texture(graph.get_texture(average_luminance), 0);
+
+        command_buffer->dispatch(1, 1, 1);
+    });
+
+    // anything post processing doesn't read is culled, which is how disabled features skip their passes and textures
+    graph.add_pass("Post Processing", [&](prism::render_graph_builder& builder) {
+        builder.read(color);
+        builder.read(average_luminance);
+
+        if(render_options.enable_aa)
+            builder.read(smaa_blend);
+
+        if(enable_depth_of_field) {
+            builder.read(dof_fields.normal_field);
+            builder.read(dof_fields.far_field);
+        }
+
+        builder.set_side_effect();
+    }, [&](GFXCommandBuffer* command_buffer, prism::render_graph& graph) {
+        GFXRenderPassBeginInfo beginInfo = {};
+        beginInfo.render_area.extent = render_extent;
+
+        command_buffer->set_render_pass(beginInfo);
+
+        Viewport viewport = {};
+        viewport.width = static_cast<float>(render_extent.width);
+        viewport.height = static_cast<float>(render_extent.height);
+
+        command_buffer->set_viewport(viewport);
+
+        command_buffer->set_graphics_pipeline(post_pipeline);
+
+        if(enable_depth_of_field)
+            command_buffer->bind_texture(graph.get_texture(dof_fields.normal_field), 1);
+        else
+            command_buffer->bind_texture(graph.get_texture(color), 1);
+
+        if(render_options.enable_aa)
+            command_buffer->bind_texture(graph.get_texture(smaa_blend), 3);
+        else
+            command_buffer->bind_texture(dummy_texture, 3);
+
+        if(auto texture = get_requested_texture(PassTextureType::SelectionSobel))
+            command_buffer->bind_texture(texture, 5);
+        else
+            command_buffer->bind_texture(dummy_texture, 5);
+
+        command_buffer->bind_texture(graph.get_texture(average_luminance), 6);
+
+        if(enable_depth_of_field)
+            command_buffer->bind_texture(graph.get_texture(dof_fields.far_field), 7);
+        else
+            command_buffer->bind_texture(dummy_texture, 7);
+
+        PostPushConstants pc;
+        pc.options.x = render_options.enable_aa;
+        pc.options.z = render_options.exposure;
+
+        if(enable_depth_of_field)
+            pc.options.w = 2;
+
+        pc.transform_ops.x = static_cast<float>(render_options.display_color_space);
+        pc.transform_ops.y = static_cast<float>(render_options.tonemapping);
+
+        const auto [width, height] = render_extent;
+        pc.viewport = prism::float4(1.0f / static_cast<float>(width), 1.0f / static_cast<float>(height), static_cast<float>(width), static_cast<float>(height));
+
+        command_buffer->set_push_constant(&pc, sizeof(PostPushConstants));
+
+        command_buffer->draw(0, 4, 0, 1);
+    });
+
+    graph.compile(gfx);
+    graph.execute(commandbuffer);
+
+    target.offscreenColorTexture = graph.get_texture(color);
 
-    commandbuffer->pop_group();
-    
     if(current_screen != nullptr)
         render_screen(commandbuffer, current_screen, extent, continuity);
     
@@ -420,6 +540,8 @@ void renderer::render(GFXCommandBuffer* commandbuffer, Scene* scene, RenderTarge
 void renderer::render_camera(GFXCommandBuffer* command_buffer, Scene& scene, Object camera_object, Camera& camera, prism::Extent extent, RenderTarget& target, controller_continuity& continuity) {
     // frustum test
     const auto frustum = normalize_frustum(camera_extract_frustum(scene, camera_object));
+    
+    statistics = {};
             
     SceneInformation sceneInfo = {};
     sceneInfo.lightspace = scene.lightSpace;
@@ -428,18 +550,19 @@ void renderer::render_camera(GFXCommandBuffer* command_buffer, Scene& scene, Obj
     sceneInfo.camPos.w = 2.0f * camera.near * std::tan(camera.fov * 0.5f) * (static_cast<float>(extent.width) / static_cast<float>(extent.height));
     sceneInfo.vp =  camera.perspective * camera.view;
     
-    for(const auto& [obj, light] : scene.get_all<Light>()) {
-        SceneLight sl;
-        sl.positionType = prism::float4(scene.get<Transform>(obj).get_world_position(), static_cast<float>(light.type));
-
-        prism::float3 front = prism::float3(0.0f, 0.0f, 1.0f) * scene.get<Transform>(obj).rotation;
-        
-        sl.directionPower = prism::float4(-front, light.power);
-        sl.colorSize = prism::float4(utility::from_srgb_to_linear(light.color), radians(light.spot_size));
-        sl.shadowsEnable = prism::float4(light.enable_shadows, radians(light.size), 0, 0);
-        
-        sceneInfo.lights[sceneInfo.numLights++] = sl;
-    }
+    const uint32_t clustered_light_count = gather_scene_lights(scene, scene_lights, light_bounds);
+    
+    light_clusters.build(camera.view, camera.perspective, camera.near, light_cluster_distance, light_bounds, *::engine->get_thread_pool());
+    target.lights[target.current_frame].upload(gfx, scene_lights, light_clusters.get_grid());
+    
+    sceneInfo.cluster_grid = prism::float4(light_clusters.get_size_x(), light_clusters.get_size_y(), light_clusters.get_size_z(), 0.0f);
+    sceneInfo.cluster_slices = prism::float4(light_clusters.get_slice_scale(), light_clusters.get_slice_bias(), 0.0f, 0.0f);
+    sceneInfo.numLights = static_cast<int>(scene_lights.size());
+    sceneInfo.numClusteredLights = static_cast<int>(clustered_light_count);
+    
+    statistics.lights = static_cast<uint32_t>(scene_lights.size());
+    statistics.light_assignments = light_clusters.get_assignment_count();
+    statistics.max_cluster_lights = light_clusters.get_max_cluster_lights();
     
     for(int i = 0; i < max_spot_shadows; i++)
         sceneInfo.spotLightSpaces[i] = scene.spotLightSpaces[i];
@@ -456,10 +579,32 @@ void renderer::render_camera(GFXCommandBuffer* command_buffer, Scene& scene, Obj
     int numMaterialsInBuffer = 0;
     std::map<Material*, int> material_indices;
     
-    const auto& meshes = scene.get_all<Renderable>();
-    for(const auto& [obj, mesh] : meshes) {
-        if(!mesh.mesh)
-            continue;
+    const auto camera_position = scene.get<Transform>(camera_object).get_world_position();
+    
+    opaque_queue.clear();
+    
+    query_renderables(scene, frustum, visible_objects, statistics.culling);
+    
+    // the parts of every visible renderable are culled together, in the same order they're visited below
+    all_part_bounds.clear();
+    for(const auto obj : visible_objects) {
+        const auto& transform = scene.get<Transform>(obj);
+        
+        for(const auto& part : scene.get<Renderable>(obj).mesh->parts)
+            all_part_bounds.push_back(get_aabb_for_part(transform, part));
+    }
+    
+    cull_aabbs(frustum, all_part_bounds, part_visibility);
+    
+    if(render_options.enable_occlusion_culling)
+        cull_occluded_parts(scene, camera, extent, camera_position);
+    
+    size_t part_offset = 0;
+    for(const auto obj : visible_objects) {
+        const auto& mesh = scene.get<Renderable>(obj);
+        
+        const size_t first_part = part_offset;
+        part_offset += mesh.mesh->parts.size();
         
         if(mesh.materials.empty())
             continue;
@@ -468,71 +613,98 @@ void renderer::render_camera(GFXCommandBuffer* command_buffer, Scene& scene, Obj
             if(!material)
                 continue;
             
-            if(material->static_pipeline == nullptr || material->skinned_pipeline == nullptr)
-                create_mesh_pipeline(*material.handle);
+            // materials that aren't ready yet are skipped below, instead of stalling the frame to compile them
+            request_mesh_pipeline(material);
             
             if(!material_indices.count(material.handle)) {
                 material_indices[material.handle] = numMaterialsInBuffer++;
             }
         }
         
-        struct PushConstant {
-            Matrix4x4 m;
-        } pc;
-        
-        pc.m = scene.get<Transform>(obj).model;
+        const Matrix4x4 model = scene.get<Transform>(obj).model;
+        const auto model_camera_position = (inverse(model) * prism::float4(camera_position, 1.0f)).xyz;
         
-        command_buffer->set_vertex_buffer(mesh.mesh->position_buffer, 0, position_buffer_index);
-        command_buffer->set_vertex_buffer(mesh.mesh->normal_buffer, 0, normal_buffer_index);
-        command_buffer->set_vertex_buffer(mesh.mesh->texture_coord_buffer, 0, texcoord_buffer_index);
-        command_buffer->set_vertex_buffer(mesh.mesh->tangent_buffer, 0, tangent_buffer_index);
-        command_buffer->set_vertex_buffer(mesh.mesh->bitangent_buffer, 0, bitangent_buffer_index);
+        // meshlet spheres are tested in world space, and scaled by the largest axis to stay conservative
+        float model_scale = 0.0f;
+        for(int i = 0; i < 3; i++)
+            model_scale = std::max(model_scale, length(prism::float3(model[i][0], model[i][1], model[i][2])));
         
-        if(!mesh.mesh->bones.empty())
-            command_buffer->set_vertex_buffer(mesh.mesh->bone_buffer, 0, bone_buffer_index);
-        
-        command_buffer->set_index_buffer(mesh.mesh->index_buffer, IndexType::UINT32);
-        
-        for(const auto& part : mesh.mesh->parts) {
+        for(size_t i = 0; i < mesh.mesh->parts.size(); i++) {
+            if(!part_visibility[first_part + i])
+                continue;
+            
+            const auto& part = mesh.mesh->parts[i];
             const int material_index = part.material_override == -1 ? 0 : part.material_override;
             
             if(material_index >= mesh.materials.size())
                 continue;
             
-            if(mesh.materials[material_index].handle == nullptr || mesh.materials[material_index]->static_pipeline == nullptr)
+            Material* material = mesh.materials[material_index].handle;
+            if(material == nullptr || material->static_pipeline == nullptr)
                 continue;
             
-            if(render_options.enable_frustum_culling && !test_aabb_frustum(frustum, get_aabb_for_part(scene.get<Transform>(obj), part)))
-                continue;
-            
-            command_buffer->set_graphics_pipeline(mesh.mesh->bones.empty() ? mesh.materials[material_index]->static_pipeline : mesh.materials[material_index]->skinned_pipeline);
+            const auto part_bounds = all_part_bounds.get(first_part + i);
             
-            command_buffer->bind_shader_buffer(target.sceneBuffer, 0, 1, sizeof(SceneInformation));
-
-            command_buffer->bind_texture(scene.depthTexture, 2);
-            command_buffer->bind_texture(scene.pointLightArray, 3);
-            command_buffer->bind_texture(scene.spotLightArray, 6);
-            command_buffer->bind_texture(scene.irradianceCubeArray, 7);
-            command_buffer->bind_texture(scene.prefilteredCubeArray, 8);
-            command_buffer->bind_texture(brdf_texture, 9);
-
-            if(!mesh.mesh->bones.empty())
-                command_buffer->bind_shader_buffer(part.bone_batrix_buffer, 0, 14, sizeof(Matrix4x4) * 128);
+            const float screen_size = calculate_screen_size(part_bounds, camera_position, camera.fov, extent.height);
             
-            command_buffer->set_push_constant(&pc, sizeof(PushConstant));
-            
-            for(const auto& [index, texture] : mesh.materials[material_index]->bound_textures) {
-                GFXTexture* texture_to_bind = dummy_texture;
+            for(const auto& [index, texture] : material->bound_textures) {
                 if(texture)
-                    texture_to_bind = texture->handle;
-                
-                command_buffer->bind_texture(texture_to_bind, index);
+                    request_texture_level(*texture.handle, screen_size);
             }
             
-            command_buffer->draw_indexed(part.index_count, part.index_offset, part.vertex_offset, 0);
+            prism::draw_item item;
+            item.pipeline = mesh.mesh->bones.empty() ? material->static_pipeline : material->skinned_pipeline;
+            item.material = material;
+            item.renderable = &mesh;
+            item.mesh = mesh.mesh.handle;
+            item.part = &part;
+            item.model = model;
+            item.lod = select_mesh_lod(part, screen_size);
+            item.model_camera_position = model_camera_position;
+            item.model_scale = model_scale;
+            
+            const auto part_center = (part_bounds.min + part_bounds.max) * 0.5f;
+            
+            opaque_queue.add(item, length(part_center - camera_position));
         }
     }
     
+    opaque_queue.sort();
+    
+    auto& instances = target.instances[target.current_frame];
+    const uint32_t first_instance = instances.upload(gfx, opaque_queue.get_models());
+    
+    // recording (and meshlet culling) is split into contiguous ranges of batches, which are put back together in order
+    const auto batch_count = opaque_queue.batches.size();
+    const auto job_count = std::clamp<size_t>(batch_count / min_batches_per_recording_job, 1, ::engine->get_thread_pool()->get_thread_count() + 1);
+    
+    if(recording_jobs.size() < job_count)
+        recording_jobs.resize(job_count);
+    
+    ::engine->get_thread_pool()->parallel_for(static_cast<uint32_t>(job_count), [&](const uint32_t i) {
+        auto& job = recording_jobs[i];
+        job.statistics = {};
+        
+        record_opaque_batches(&job.commands, scene, target, frustum, first_instance, batch_count * i / job_count, batch_count * (i + 1) / job_count, job.statistics);
+    });
+    
+    for(size_t i = 0; i < job_count; i++) {
+        auto& job = recording_jobs[i];
+        
+        command_buffer->append(job.commands);
+        
+        statistics.submitted_triangles += job.statistics.submitted_triangles;
+        statistics.drawn_triangles += job.statistics.drawn_triangles;
+        statistics.meshlets += job.statistics.meshlets;
+        statistics.culled_meshlets += job.statistics.culled_meshlets;
+        statistics.commands.pipeline_binds += job.statistics.commands.pipeline_binds;
+        statistics.commands.descriptor_binds += job.statistics.commands.descriptor_binds;
+        statistics.commands.buffer_binds += job.statistics.commands.buffer_binds;
+        statistics.commands.draw_calls += job.statistics.commands.draw_calls;
+        statistics.commands.instances += job.statistics.commands.instances;
+    }
+    
+    
     const auto& screens = scene.get_all<UI>();
     for(const auto& [obj, screen] : screens) {
         if(!screen.screen)
@@ -568,6 +740,146 @@ void renderer::render_camera(GFXCommandBuffer* command_buffer, Scene& scene, Obj
     gfx->copy_buffer(target.sceneBuffer, &sceneInfo, 0, sizeof(SceneInformation));
 }
 
+void renderer::cull_occluded_parts(Scene& scene, const Camera& camera, const prism::Extent extent, const prism::float3 camera_position) {
+    const auto buffer_width = static_cast<uint32_t>(std::max(render_options.occlusion_buffer_width, 1));
+    const auto buffer_height = static_cast<uint32_t>(std::max(static_cast<float>(buffer_width) * static_cast<float>(extent.height) / static_cast<float>(extent.width), 1.0f));
+    
+    // the storage is kept if the size didn't change, so this only costs clearing it
+    occlusion_buffer.resize(buffer_width, buffer_height);
+    occlusion_buffer.set_near_plane(camera.near);
+    
+    const Matrix4x4 view_projection = camera.perspective * camera.view;
+    
+    for(const auto obj : visible_objects) {
+        const auto& renderable = scene.get<Renderable>(obj);
+        const auto& mesh = *renderable.mesh.handle;
+        
+        if(renderable.occluder == Renderable::Occluder::Never || mesh.occluder_indices.empty())
+            continue;
+        
+        const auto& transform = scene.get<Transform>(obj);
+        
+        if(renderable.occluder == Renderable::Occluder::Automatic) {
+            const float screen_size = calculate_screen_size(get_aabb_for_renderable(transform, mesh), camera_position, camera.fov, extent.height);
+            if(screen_size < static_cast<float>(extent.height) * min_occluder_screen_fraction)
+                continue;
+        }
+        
+        occlusion_buffer.add_occluder(view_projection * transform.model, mesh.occluder_positions, mesh.occluder_indices);
+        statistics.occluders++;
+    }
+    
+    if(statistics.occluders == 0)
+        return;
+    
+    occlusion_buffer.rasterize(*::engine->get_thread_pool());
+    
+    for(size_t i = 0; i < part_visibility.size(); i++) {
+        if(!part_visibility[i])
+            continue;
+        
+        statistics.occlusion_tested++;
+        
+        if(!occlusion_buffer.is_visible(view_projection, all_part_bounds.get(i))) {
+            part_visibility[i] = 0;
+            statistics.occlusion_culled++;
+        }
+    }
+}
+
+void renderer::record_opaque_batches(GFXCommandBuffer* command_buffer, Scene& scene, RenderTarget& target, const CameraFrustum& frustum, const uint32_t first_instance, const size_t first_batch, const size_t last_batch, frame_statistics& job_statistics) const {
+    const auto& instances = target.instances[target.current_frame];
+    const auto& lights = target.lights[target.current_frame];
+    
+    prism::command_state_cache state(command_buffer);
+    
+    for(size_t i = first_batch; i < last_batch; i++) {
+        const auto& batch = opaque_queue.batches[i];
+        const auto& item = opaque_queue.items[batch.first_item];
+        const auto& part = *item.part;
+        const bool skinned = !item.mesh->bones.empty();
+        const auto base_instance = static_cast<int>(first_instance + batch.first_item);
+        const auto instance_count = static_cast<int>(batch.item_count);
+        
+        state.set_graphics_pipeline(item.pipeline);
+        
+        state.bind_shader_buffer(target.sceneBuffer, 0, 1, sizeof(SceneInformation));
+        state.bind_shader_buffer(instances.buffer, 0, instance_buffer_binding, instances.get_size());
+        state.bind_shader_buffer(lights.lights, 0, light_buffer_binding, lights.lights_size);
+        state.bind_shader_buffer(lights.grid, 0, light_grid_binding, lights.grid_size);
+        
+        state.bind_texture(scene.depthTexture, 2);
+        state.bind_texture(scene.pointLightArray, 3);
+        state.bind_texture(scene.spotLightArray, 6);
+        state.bind_texture(scene.irradianceCubeArray, 7);
+        state.bind_texture(scene.prefilteredCubeArray, 8);
+        state.bind_texture(brdf_texture, 9);
+        
+        state.bind_shader_buffer(item.material->parameter_buffer, 0, material_parameter_binding, item.material->parameter_buffer_size);
+        
+        for(const auto& [index, texture] : item.material->bound_textures)
+            state.bind_texture(texture ? texture->handle : dummy_texture, index);
+        
+        state.set_vertex_buffer(item.mesh->position_buffer, 0, position_buffer_index);
+        state.set_vertex_buffer(item.mesh->vertex_buffer, 0, vertex_buffer_index);
+        
+        if(skinned) {
+            state.set_vertex_buffer(item.mesh->bone_buffer, 0, bone_buffer_index);
+            
+            // every part has its own matrices, so this always changes
+            prism::bind_skinning_matrices(command_buffer, target.skinning[target.current_frame].buffer, *item.renderable, part);
+            state.statistics.descriptor_binds++;
+        }
+        
+        state.set_index_buffer(item.mesh->index_buffer, item.mesh->index_type);
+        
+        const auto& lod = part.lods[item.lod];
+        
+        job_statistics.submitted_triangles += lod.index_count / 3 * batch.item_count;
+        
+        // skinned parts move outside of their meshlet bounds, so they're always drawn whole
+        // instances would each cull different meshlets, and one instanced draw is cheaper than culling them separately
+        if(render_options.enable_meshlet_culling && item.lod == 0 && !part.meshlets.empty() && !skinned && batch.item_count == 1) {
+            // neighbouring visible meshlets are next to each other in the index buffer, so they're drawn together
+            uint32_t range_offset = 0, range_count = 0;
+            
+            for(const auto& meshlet : part.meshlets) {
+                job_statistics.meshlets++;
+                
+                const auto world_center = (item.model * prism::float4(meshlet.center, 1.0f)).xyz;
+                
+                const bool visible = (!render_options.enable_frustum_culling || test_sphere_frustum(frustum, world_center, meshlet.radius * item.model_scale)) &&
+                                     !prism::is_meshlet_backfacing(meshlet, item.model_camera_position);
+                
+                if(!visible) {
+                    job_statistics.culled_meshlets++;
+                    continue;
+                }
+                
+                if(range_count > 0 && range_offset + range_count != meshlet.index_offset) {
+                    state.draw_indexed(range_count, range_offset, part.vertex_offset, base_instance);
+                    range_count = 0;
+                }
+                
+                if(range_count == 0)
+                    range_offset = meshlet.index_offset;
+                
+                range_count += meshlet.index_count;
+                job_statistics.drawn_triangles += meshlet.index_count / 3;
+            }
+            
+            if(range_count > 0)
+                state.draw_indexed(range_count, range_offset, part.vertex_offset, base_instance);
+        } else {
+            state.draw_indexed(lod.index_count, lod.index_offset, part.vertex_offset, base_instance, instance_count);
+            
+            job_statistics.drawn_triangles += lod.index_count / 3 * batch.item_count;
+        }
+    }
+    
+    job_statistics.commands = state.statistics;
+}
+
 void renderer::render_screen(GFXCommandBuffer *commandbuffer, ui::Screen* screen, prism::Extent extent, controller_continuity& continuity, render_screen_options options) {
     std::array<GlyphInstance, maxInstances> instances;
     std::vector<ElementInstance> elementInstances;
@@ -699,15 +1011,110 @@ void renderer::render_screen(GFXCommandBuffer *commandbuffer, ui::Screen* screen
 }
 
 void renderer::create_mesh_pipeline(Material& material) const {
+    auto job = prepare_mesh_pipeline(material);
+    job->compile();
+    
+    apply_mesh_pipelines(material, job->pipelines.static_pipeline, job->pipelines.skinned_pipeline, job->pipelines.capture_pipeline);
+}
+
+bool renderer::request_mesh_pipeline(const AssetPtr<Material>& material, const bool blocking) {
+    if(material->static_pipeline != nullptr && material->skinned_pipeline != nullptr)
+        return true;
+    
+    auto queued_job = std::find_if(pipeline_jobs.begin(), pipeline_jobs.end(), [&material](const auto& job) {
+        return std::any_of(job->materials.begin(), job->materials.end(), [&material](const AssetPtr<Material>& other) {
+            return other.handle == material.handle;
+        });
+    });
+    
+    if(queued_job == pipeline_jobs.end()) {
+        auto job = prepare_mesh_pipeline(*material.handle);
+        
+        if(const auto shared = shared_pipelines.find(job->key); shared != shared_pipelines.end()) {
+            apply_mesh_pipelines(*material.handle, shared->second.static_pipeline, shared->second.skinned_pipeline, shared->second.capture_pipeline);
+            pipeline_stats.shared++;
+            
+            return true;
+        }
+        
+        queued_job = std::find_if(pipeline_jobs.begin(), pipeline_jobs.end(), [&job](const auto& other_job) {
+            return other_job->key == job->key;
+        });
+        
+        if(queued_job != pipeline_jobs.end()) {
+            (*queued_job)->materials.push_back(material);
+            pipeline_stats.shared++;
+        } else if(!blocking && gfx->supports_feature(GFXFeature::AsyncPipelineCreation)) {
+            job->materials.push_back(material);
+            
+            ::engine->get_thread_pool()->submit([job = job.get()] {
+                job->compile();
+                job->compiled.set_value();
+            });
+            
+            pipeline_jobs.push_back(std::move(job));
+            
+            return false;
+        } else {
+            job->compile();
+            
+            apply_mesh_pipelines(*material.handle, job->pipelines.static_pipeline, job->pipelines.skinned_pipeline, job->pipelines.capture_pipeline);
+            shared_pipelines[job->key] = job->pipelines;
+            
+            pipeline_stats.compiled_on_render_thread++;
+            
+            return true;
+        }
+    }
+    
+    if(!blocking)
+        return false;
+    
+    // the thread pool runs jobs in order, so this waits at most for everything that was queued before it
+    (*queued_job)->compiled_future.wait();
+    
+    finish_pipeline_jobs();
+    
+    return true;
+}
+
+void renderer::clear_pipeline_cache() {
+    shared_pipelines.clear();
+}
+
+void renderer::precompile_pipelines(Scene& scene) {
+    for(const auto& [obj, mesh] : scene.get_all<Renderable>()) {
+        for(auto& material : mesh.materials) {
+            if(material)
+                request_mesh_pipeline(material);
+        }
+    }
+    
+    prism::log::info(System::Renderer, "Compiling {} material pipelines in the background", std::to_string(pipeline_jobs.size()));
+}
+
+void renderer::finish_pipeline_jobs() {
+    utility::erase_if(pipeline_jobs, [this](const std::unique_ptr<mesh_pipeline_job>& job) {
+        if(!job->is_finished())
+            return false;
+        
+        for(auto& material : job->materials)
+            apply_mesh_pipelines(*material.handle, job->pipelines.static_pipeline, job->pipelines.skinned_pipeline, job->pipelines.capture_pipeline);
+        
+        shared_pipelines[job->key] = job->pipelines;
+        pipeline_stats.compiled_on_workers++;
+        
+        return true;
+    });
+}
+
+std::unique_ptr<renderer::mesh_pipeline_job> renderer::prepare_mesh_pipeline(Material& material) const {
+    auto job = std::make_unique<mesh_pipeline_job>();
+    
     GFXShaderConstant materials_constant = {};
     materials_constant.type = GFXShaderConstant::Type::Integer;
     materials_constant.value = max_scene_materials;
     
-    GFXShaderConstant lights_constant = {};
-    lights_constant.index = 1;
-    lights_constant.type = GFXShaderConstant::Type::Integer;
-    lights_constant.value = max_scene_lights;
-    
     GFXShaderConstant spot_lights_constant = {};
     spot_lights_constant.index = 2;
     spot_lights_constant.type = GFXShaderConstant::Type::Integer;
@@ -723,22 +1130,22 @@ void renderer::create_mesh_pipeline(Material& material) const {
     pipelineInfo.shaders.vertex_src = ShaderSource(prism::path("mesh.vert"));
     pipelineInfo.shaders.fragment_src = ShaderSource(prism::path("mesh.frag"));
     
-    pipelineInfo.shaders.vertex_constants = {materials_constant, lights_constant, spot_lights_constant, probes_constant};
-    pipelineInfo.shaders.fragment_constants = {materials_constant, lights_constant, spot_lights_constant, probes_constant};
-    
-    pipelineInfo.shader_input.push_constants = {
-        {sizeof(Matrix4x4), 0}
-    };
+    pipelineInfo.shaders.vertex_constants = {materials_constant, spot_lights_constant, probes_constant};
+    pipelineInfo.shaders.fragment_constants = {materials_constant, spot_lights_constant, probes_constant};
     
+    // model matrices come from the instance buffer, so there are no push constants
     pipelineInfo.shader_input.bindings = {
         {1, GFXBindingType::StorageBuffer},
-        {0, GFXBindingType::PushConstant},
         {2, GFXBindingType::Texture},
         {3, GFXBindingType::Texture},
         {6, GFXBindingType::Texture},
         {7, GFXBindingType::Texture},
         {8, GFXBindingType::Texture},
-        {9, GFXBindingType::Texture}
+        {9, GFXBindingType::Texture},
+        {material_parameter_binding, GFXBindingType::StorageBuffer},
+        {instance_buffer_binding, GFXBindingType::StorageBuffer},
+        {light_buffer_binding, GFXBindingType::StorageBuffer},
+        {light_grid_binding, GFXBindingType::StorageBuffer}
     };
     
     pipelineInfo.render_pass = offscreen_render_pass;
@@ -747,7 +1154,7 @@ void renderer::create_mesh_pipeline(Material& material) const {
     pipelineInfo.blending.src_rgb = GFXBlendFactor::SrcAlpha;
     pipelineInfo.blending.dst_rgb = GFXBlendFactor::OneMinusSrcAlpha;
     
-    pipelineInfo.shaders.fragment_src = material_compiler.compile_material_fragment(material);
+    pipelineInfo.shaders.fragment_src = ShaderSource(material_compiler.generate_material_fragment(material));
 
     for (auto [index, texture] : material.bound_textures) {
         GFXShaderBinding binding;
@@ -757,18 +1164,34 @@ void renderer::create_mesh_pipeline(Material& material) const {
         pipelineInfo.shader_input.bindings.push_back(binding);
     }
     
-    auto [static_pipeline, skinned_pipeline] = material_compiler.create_pipeline_permutations(pipelineInfo);
-    
-    material.static_pipeline = static_pipeline;
-    material.skinned_pipeline = skinned_pipeline;
+    job->mesh_info = pipelineInfo;
     
     pipelineInfo.render_pass = scene_capture->renderPass;
     
-    pipelineInfo.shaders.fragment_src = material_compiler.compile_material_fragment(material, false); // scene capture does not use IBL
+    pipelineInfo.shaders.fragment_src = ShaderSource(material_compiler.generate_material_fragment(material, false)); // scene capture does not use IBL
     
-    pipelineInfo.shader_input.push_constants[0].size += sizeof(Matrix4x4);
+    // scene capture draws one renderable at a time, and pushes its model and view matrices instead
+    pipelineInfo.shader_input.push_constants = {
+        {sizeof(Matrix4x4) * 2, 0}
+    };
+    pipelineInfo.shader_input.bindings.push_back({0, GFXBindingType::PushConstant});
 
-    material.capture_pipeline = material_compiler.create_static_pipeline(pipelineInfo, false, true);
+    job->capture_info = pipelineInfo;
+    
+    job->key = std::string(job->mesh_info.shaders.fragment_src.as_string()) + std::string(job->capture_info.shaders.fragment_src.as_string());
+    
+    // the buffer can't be empty, even if the material has no parameters
+    if(material.parameters.empty())
+        material.parameters.emplace_back();
+    
+    // frames in flight may still be reading the old parameters, so they get a new buffer and the old one is retired once they're done
+    const size_t parameters_size = sizeof(prism::float4) * material.parameters.size();
+    gfx->destroy_buffer(material.parameter_buffer);
+    
+    material.parameter_buffer = gfx->create_buffer(material.parameters.data(), parameters_size, false, GFXBufferUsage::Storage);
+    material.parameter_buffer_size = parameters_size;
+    
+    return job;
 }
 
 void renderer::create_dummy_texture() {
@@ -787,31 +1210,6 @@ void renderer::create_dummy_texture() {
 }
 
 void renderer::create_render_target_resources(RenderTarget& target) {
-    const auto extent = target.get_render_extent();
-    
-    GFXTextureCreateInfo textureInfo = {};
-    textureInfo.label = "Offscreen Color";
-    textureInfo.width = extent.width;
-    textureInfo.height = extent.height;
-    textureInfo.format = GFXPixelFormat::RGBA_32F;
-    textureInfo.usage = GFXTextureUsage::Attachment | GFXTextureUsage::Sampled | GFXTextureUsage::Storage;
-    textureInfo.samplingMode = SamplingMode::ClampToEdge;
-
-    target.offscreenColorTexture = gfx->create_texture(textureInfo);
-
-    textureInfo.label = "Offscreen Depth";
-    textureInfo.format = GFXPixelFormat::DEPTH_32F;
-    textureInfo.usage = GFXTextureUsage::Attachment | GFXTextureUsage::Sampled;
-
-    target.offscreenDepthTexture = gfx->create_texture(textureInfo);
-
-    GFXFramebufferCreateInfo framebufferInfo = {};
-	framebufferInfo.render_pass = offscreen_render_pass;
-    framebufferInfo.attachments.push_back(target.offscreenColorTexture);
-    framebufferInfo.attachments.push_back(target.offscreenDepthTexture);
-
-    target.offscreenFramebuffer = gfx->create_framebuffer(framebufferInfo);
-    
     if(post_pipeline == nullptr) {
         GFXGraphicsPipelineCreateInfo pipelineInfo = {};
         pipelineInfo.label = "Post";
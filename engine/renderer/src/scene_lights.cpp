@@ -0,0 +1,91 @@
+#include "scene_lights.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "gfx.hpp"
+#include "scene.hpp"
+#include "render_options.hpp"
+#include "utility.hpp"
+#include "math.hpp"
+
+float calculate_light_range(const Light& light) {
+    // radiance falls off with the square of the distance
+    return std::sqrt(std::max(light.power, 0.0f) / min_light_radiance);
+}
+
+uint32_t gather_scene_lights(Scene& scene, std::vector<SceneLight>& lights, std::vector<prism::float4>& bounds) {
+    lights.clear();
+    bounds.clear();
+
+    std::vector<SceneLight> sun_lights;
+
+    int last_spot_light = 0, last_point_light = 0;
+
+    for(const auto& [obj, light] : scene.get_all<Light>()) {
+        const auto& transform = scene.get<Transform>(obj);
+        const prism::float3 position = transform.get_world_position();
+        const prism::float3 front = prism::float3(0.0f, 0.0f, 1.0f) * transform.rotation;
+
+        int shadow_layer = -1;
+        switch(light.type) {
+            case Light::Type::Spot:
+                if(last_spot_light + 1 != max_spot_shadows)
+                    shadow_layer = last_spot_light++;
+                break;
+            case Light::Type::Point:
+                if(render_options.enable_point_shadows && last_point_light + 1 != max_point_shadows)
+                    shadow_layer = last_point_light++;
+                break;
+            case Light::Type::Sun:
+                break;
+        }
+
+        const float range = calculate_light_range(light);
+        const bool has_shadows = light.enable_shadows && (light.type == Light::Type::Sun || shadow_layer != -1);
+
+        SceneLight sl;
+        sl.positionType = prism::float4(position, static_cast<float>(light.type));
+        sl.directionPower = prism::float4(-front, light.power);
+        sl.colorSize = prism::float4(utility::from_srgb_to_linear(light.color), radians(light.spot_size));
+        sl.shadowsEnable = prism::float4(has_shadows, radians(light.size), static_cast<float>(shadow_layer), range);
+
+        if(light.type == Light::Type::Sun) {
+            sun_lights.push_back(sl);
+        } else {
+            lights.push_back(sl);
+            bounds.emplace_back(position, range);
+        }
+    }
+
+    const auto clustered_count = static_cast<uint32_t>(lights.size());
+
+    lights.insert(lights.end(), sun_lights.begin(), sun_lights.end());
+
+    return clustered_count;
+}
+
+void light_buffers::upload(GFX* gfx, const std::vector<SceneLight>& scene_lights, const std::vector<uint32_t>& light_grid) {
+    // the buffers can't be empty, even if there aren't any lights
+    const size_t new_lights_size = sizeof(SceneLight) * std::max<size_t>(scene_lights.size(), 1);
+    const size_t new_grid_size = sizeof(uint32_t) * std::max<size_t>(light_grid.size(), 1);
+
+    // the old buffers are retired instead of deleted, since frames in flight may still be reading them
+    if(lights == nullptr || new_lights_size > lights_size) {
+        gfx->destroy_buffer(lights);
+        lights = gfx->create_buffer(nullptr, new_lights_size, true, GFXBufferUsage::Storage);
+        lights_size = new_lights_size;
+    }
+
+    if(grid == nullptr || new_grid_size > grid_size) {
+        gfx->destroy_buffer(grid);
+        grid = gfx->create_buffer(nullptr, new_grid_size, true, GFXBufferUsage::Storage);
+        grid_size = new_grid_size;
+    }
+
+    if(!scene_lights.empty())
+        gfx->copy_buffer(lights, const_cast<SceneLight*>(scene_lights.data()), 0, sizeof(SceneLight) * scene_lights.size());
+
+    if(!light_grid.empty())
+        gfx->copy_buffer(grid, const_cast<uint32_t*>(light_grid.data()), 0, sizeof(uint32_t) * light_grid.size());
+}
@@ -10,6 +10,8 @@
 #include "materialcompiler.hpp"
 #include "frustum.hpp"
 #include "asset.hpp"
+#include "texturestreaming.hpp"
+#include "meshlod.hpp"
 
 struct PushConstant {
     Matrix4x4 m, v;
@@ -19,13 +21,6 @@ struct SceneMaterial {
     prism::float4 color, info;
 };
 
-struct SceneLight {
-    prism::float4 positionType;
-    prism::float4 directionPower;
-    prism::float4 colorSize;
-    prism::float4 shadowsEnable;
-};
-
 struct SceneProbe {
     prism::float4 position, size;
 };
@@ -36,10 +31,12 @@ struct SceneInformation {
     Matrix4x4 vp, lightspace;
     Matrix4x4 spotLightSpaces[max_spot_shadows];
     SceneMaterial materials[max_scene_materials];
-    SceneLight lights[max_scene_lights];
     SceneProbe probes[max_environment_probes];
+    prism::float4 cluster_grid;
+    prism::float4 cluster_slices;
     int numLights;
-    int p[3];
+    int numClusteredLights;
+    int p[2];
 };
 
 struct SkyPushConstant {
@@ -156,6 +153,9 @@ void SceneCapture::create_scene_resources(Scene& scene) {
 }
 
 void SceneCapture::render(GFXCommandBuffer* command_buffer, Scene* scene) {
+    statistics = {};
+    current_frame = (current_frame + 1) % RT_MAX_FRAMES_IN_FLIGHT;
+    
     if(scene->probe_refresh_timer > 0) {
         scene->probe_refresh_timer--;
         return;
@@ -178,22 +178,17 @@ void SceneCapture::render(GFXCommandBuffer* command_buffer, Scene* scene) {
             
             SceneInformation sceneInfo = {};
             sceneInfo.lightspace = scene->lightSpace;
-            sceneInfo.numLights = 0;
             sceneInfo.camPos = lightPos;
             sceneInfo.vp = projection;
             
-            for(const auto [obj, light] : scene->get_all<Light>()) {
-                SceneLight sl;
-                sl.positionType = prism::float4(scene->get<Transform>(obj).get_world_position(), (int)light.type);
-
-                prism::float3 front = prism::float3(0.0f, 0.0f, 1.0f) * scene->get<Transform>(obj).rotation;
-                
-                sl.directionPower = prism::float4(-front, light.power);
-                sl.colorSize = prism::float4(utility::from_srgb_to_linear(light.color), radians(light.spot_size));
-                sl.shadowsEnable = prism::float4(light.enable_shadows, radians(light.size), 0, 0);
-                
-                sceneInfo.lights[sceneInfo.numLights++] = sl;
-            }
+            const uint32_t clustered_light_count = gather_scene_lights(*scene, scene_lights, light_bounds);
+            
+            light_clusters.build_single(clustered_light_count);
+            lights[current_frame].upload(engine->get_gfx(), scene_lights, light_clusters.get_grid());
+            
+            sceneInfo.cluster_grid = prism::float4(1.0f, 1.0f, 1.0f, 0.0f);
+            sceneInfo.numLights = static_cast<int>(scene_lights.size());
+            sceneInfo.numClusteredLights = static_cast<int>(clustered_light_count);
             
             for(int i = 0; i < max_spot_shadows; i++)
                 sceneInfo.spotLightSpaces[i] = scene->spotLightSpaces[i];
@@ -211,8 +206,8 @@ void SceneCapture::render(GFXCommandBuffer* command_buffer, Scene* scene) {
                     if(!material)
                         continue;
                     
-                    if(material->static_pipeline == nullptr || material->skinned_pipeline == nullptr)
-                        engine->get_renderer()->create_mesh_pipeline(*material.handle);
+                    // a probe is only rendered once, so it has to wait for every material
+                    engine->get_renderer()->request_mesh_pipeline(material, true);
 
                     if(!material_indices.count(material.handle)) {
                         material_indices[material.handle] = numMaterialsInBuffer++;
@@ -220,7 +215,7 @@ void SceneCapture::render(GFXCommandBuffer* command_buffer, Scene* scene) {
                 }
             }
             
-            const auto render_face = [this, command_buffer, scene, &meshes, &model, &probe = probe](int face) {
+            const auto render_face = [this, command_buffer, scene, &model, &probe = probe, lightPos](int face) {
                 const auto frustum = normalize_frustum(extract_frustum(sceneTransforms[face]));
                 
                 GFXRenderPassBeginInfo info = {};
@@ -237,9 +232,24 @@ void SceneCapture::render(GFXCommandBuffer* command_buffer, Scene* scene) {
                 command_buffer->set_viewport(viewport);
                 
                 if(probe.is_sized) {
-                    for(const auto [obj, mesh] : meshes) {
-                        if(!mesh.mesh)
-                            continue;
+                    query_renderables(*scene, frustum, visible_objects, statistics);
+                    
+                    part_bounds.clear();
+                    for(const auto obj : visible_objects) {
+                        const auto& transform = scene->get<Transform>(obj);
+                        
+                        for(const auto& part : scene->get<Renderable>(obj).mesh->parts)
+                            part_bounds.push_back(get_aabb_for_part(transform, part));
+                    }
+                    
+                    cull_aabbs(frustum, part_bounds, part_visibility);
+                    
+                    size_t part_offset = 0;
+                    for(const auto obj : visible_objects) {
+                        const auto& mesh = scene->get<Renderable>(obj);
+                        
+                        const size_t first_part = part_offset;
+                        part_offset += mesh.mesh->parts.size();
                         
                         if(mesh.materials.empty())
                             continue;
@@ -249,15 +259,16 @@ void SceneCapture::render(GFXCommandBuffer* command_buffer, Scene* scene) {
                         pc.v = sceneTransforms[face] * model;
                         
                         command_buffer->set_vertex_buffer(mesh.mesh->position_buffer, 0, position_buffer_index);
-                        command_buffer->set_vertex_buffer(mesh.mesh->normal_buffer, 0, normal_buffer_index);
-                        command_buffer->set_vertex_buffer(mesh.mesh->texture_coord_buffer, 0, texcoord_buffer_index);
-                        command_buffer->set_vertex_buffer(mesh.mesh->tangent_buffer, 0, tangent_buffer_index);
-                        command_buffer->set_vertex_buffer(mesh.mesh->bitangent_buffer, 0, bitangent_buffer_index);
+                        command_buffer->set_vertex_buffer(mesh.mesh->vertex_buffer, 0, vertex_buffer_index);
                         
-                        command_buffer->set_index_buffer(mesh.mesh->index_buffer, IndexType::UINT32);
+                        command_buffer->set_index_buffer(mesh.mesh->index_buffer, mesh.mesh->index_type);
 
                         if(mesh.mesh->bones.empty()) {
-                            for (auto& part : mesh.mesh->parts) {
+                            for(size_t i = 0; i < mesh.mesh->parts.size(); i++) {
+                                if(!part_visibility[first_part + i])
+                                    continue;
+                                
+                                const auto& part = mesh.mesh->parts[i];
                                 const int material_index = part.material_override == -1 ? 0 : part.material_override;
                                 
                                 if(material_index >= mesh.materials.size())
@@ -266,15 +277,18 @@ void SceneCapture::render(GFXCommandBuffer* command_buffer, Scene* scene) {
                                 if(mesh.materials[material_index].handle == nullptr || mesh.materials[material_index]->static_pipeline == nullptr)
                                     continue;
                                 
-                                if(render_options.enable_frustum_culling && !test_aabb_frustum(frustum, get_aabb_for_part(scene->get<Transform>(obj), part)))
-                                    continue;
+                                const auto bounds = part_bounds.get(first_part + i);
                                 
                                 command_buffer->set_graphics_pipeline(mesh.materials[material_index]->capture_pipeline);
              
                                 command_buffer->bind_shader_buffer(sceneBuffer, 0, 1, sizeof(SceneInformation));
+                                command_buffer->bind_shader_buffer(lights[current_frame].lights, 0, light_buffer_binding, lights[current_frame].lights_size);
+                                command_buffer->bind_shader_buffer(lights[current_frame].grid, 0, light_grid_binding, lights[current_frame].grid_size);
                                 command_buffer->bind_texture(scene->depthTexture, 2);
                                 command_buffer->bind_texture(scene->pointLightArray, 3);
                                 command_buffer->bind_texture(scene->spotLightArray, 6);
+                                
+                                command_buffer->bind_shader_buffer(mesh.materials[material_index]->parameter_buffer, 0, material_parameter_binding, mesh.materials[material_index]->parameter_buffer_size);
 
                                 command_buffer->set_push_constant(&pc, sizeof(PushConstant));
                                 
@@ -286,7 +300,9 @@ void SceneCapture::render(GFXCommandBuffer* command_buffer, Scene* scene) {
                                     command_buffer->bind_texture(texture_to_bind, index);
                                 }
                                 
-                                command_buffer->draw_indexed(part.index_count, part.index_offset, part.vertex_offset, 0);
+                                const auto& lod = part.lods[select_mesh_lod(part, calculate_screen_size(bounds, lightPos, 90.0f, scene_cubemap_resolution))];
+                                
+                                command_buffer->draw_indexed(lod.index_count, lod.index_offset, part.vertex_offset, 0);
                             }
                         }
                     }
@@ -338,7 +354,7 @@ void SceneCapture::render(GFXCommandBuffer* command_buffer, Scene* scene) {
                 Matrix4x4 mvp = projection * sceneTransforms[face];
                 
                 command_buffer->set_vertex_buffer(cubeMesh->position_buffer, 0, 0);
-                command_buffer->set_index_buffer(cubeMesh->index_buffer, IndexType::UINT32);
+                command_buffer->set_index_buffer(cubeMesh->index_buffer, cubeMesh->index_type);
                 
                 command_buffer->set_graphics_pipeline(irradiancePipeline);
                 command_buffer->bind_texture(environmentCube, 2);
@@ -377,7 +393,7 @@ void SceneCapture::render(GFXCommandBuffer* command_buffer, Scene* scene) {
                 command_buffer->set_viewport(viewport);
                 
                 command_buffer->set_vertex_buffer(cubeMesh->position_buffer, 0, 0);
-                command_buffer->set_index_buffer(cubeMesh->index_buffer, IndexType::UINT32);
+                command_buffer->set_index_buffer(cubeMesh->index_buffer, cubeMesh->index_type);
                 
                 FilterPushConstant pc;
                 pc.mvp = projection * sceneTransforms[face];
@@ -1,5 +1,8 @@
 #include "shadowpass.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 #include "gfx_commandbuffer.hpp"
 #include "scene.hpp"
 #include "gfx.hpp"
@@ -9,11 +12,19 @@
 #include "assertions.hpp"
 #include "frustum.hpp"
 #include "renderer.hpp"
+#include "animation_system.hpp"
+#include "texturestreaming.hpp"
+#include "meshlod.hpp"
+#include "thread_pool.hpp"
 
 struct PushConstant {
-    Matrix4x4 mvp, model;
+    Matrix4x4 light_matrix;
+    int light_index = 0; // for point lights, where the fragment shader finds the light's position
 };
 
+// the size of the orthographic projection used for sun shadows, in world units
+constexpr float sun_shadow_size = 50.0f;
+
 const std::array<Matrix4x4, 6> shadowTransforms = {
         prism::look_at(prism::float3(0), prism::float3(1.0, 0.0, 0.0), prism::float3(0.0, 1.0, 0.0)), // right
         prism::look_at(prism::float3(0), prism::float3(-1.0, 0.0, 0.0), prism::float3(0.0, 1.0, 0.0)), // left
@@ -53,6 +64,14 @@ void ShadowPass::create_scene_resources(Scene& scene) {
         info.render_pass = render_pass;
         
         scene.framebuffer = gfx->create_framebuffer(info);
+        
+        textureInfo.label = "Static Shadow Depth";
+        
+        scene.staticDepthTexture = gfx->create_texture(textureInfo);
+        
+        info.attachments = {scene.staticDepthTexture};
+        
+        scene.staticFramebuffer = gfx->create_framebuffer(info);
     }
     
     // point lights
@@ -69,6 +88,18 @@ void ShadowPass::create_scene_resources(Scene& scene) {
         cubeTextureInfo.border_color = GFXBorderColor::OpaqueWhite;
 
         scene.pointLightArray = gfx->create_texture(cubeTextureInfo);
+        
+        // the cache is never sampled as a cubemap, every face is only copied in and out
+        cubeTextureInfo.label = "Static Point Light Array";
+        cubeTextureInfo.type = GFXTextureType::Array2D;
+        cubeTextureInfo.array_length = max_point_shadows * 6;
+        
+        scene.staticPointLightArray = gfx->create_texture(cubeTextureInfo);
+        
+        cubeTextureInfo.label = "Static Point Light Depth Array";
+        cubeTextureInfo.format = GFXPixelFormat::DEPTH_32F;
+        
+        scene.staticPointLightDepthArray = gfx->create_texture(cubeTextureInfo);
     }
     
     // spot lights
@@ -85,12 +116,24 @@ void ShadowPass::create_scene_resources(Scene& scene) {
         spotTextureInfo.border_color = GFXBorderColor::OpaqueWhite;
 
         scene.spotLightArray = gfx->create_texture(spotTextureInfo);
+        
+        spotTextureInfo.label = "Static Spot Light Array";
+        
+        scene.staticSpotLightArray = gfx->create_texture(spotTextureInfo);
     }
 }
 
-void ShadowPass::render(GFXCommandBuffer* command_buffer, Scene& scene) {
+void ShadowPass::render(GFXCommandBuffer* command_buffer, Scene& scene, prism::instance_buffer& frame_instances, GFXBuffer* frame_skinning) {
     last_spot_light = 0;
     last_point_light = 0;
+    view_count = 0;
+    statistics = {};
+    static_commands = {};
+    dynamic_commands = {};
+    
+    instances = &frame_instances;
+    instances->reset();
+    skinning_buffer = frame_skinning;
 
     if(scene.shadow_refresh_timer > 0) {
         scene.shadow_refresh_timer--;
@@ -101,154 +144,303 @@ void ShadowPass::render(GFXCommandBuffer* command_buffer, Scene& scene) {
     for(auto [obj, light] : lights) {
         switch(light.type) {
             case Light::Type::Sun:
-                render_sun(command_buffer, scene, obj, light);
+                prepare_sun(scene, obj, light);
                 break;
             case Light::Type::Spot:
-                render_spot(command_buffer, scene, obj, light);
+                prepare_spot(scene, obj, light);
                 break;
             case Light::Type::Point:
-                render_point(command_buffer, scene, obj, light);
+                prepare_point(scene, obj, light);
                 break;
         }
     }
+    
+    // every view is culled and recorded on its own, only uploading instances has to happen in order
+    auto thread_pool = engine->get_thread_pool();
+    
+    thread_pool->parallel_for(static_cast<uint32_t>(view_count), [this, &scene](const uint32_t i) {
+        build_queue(scene, views[i]);
+    });
+    
+    for(size_t i = 0; i < view_count; i++) {
+        const auto& culling = views[i].culling;
+        
+        statistics.nodes_tested += culling.nodes_tested;
+        statistics.objects_traversed += culling.objects_traversed;
+        statistics.objects_visible += culling.objects_visible;
+        statistics.objects_culled += culling.objects_culled;
+    }
+    
+    for(size_t i = 0; i < view_count; i++)
+        views[i].first_instance = instances->upload(engine->get_gfx(), views[i].queue.get_models());
+    
+    thread_pool->parallel_for(static_cast<uint32_t>(view_count), [this](const uint32_t i) {
+        record_view(views[i]);
+    });
+    
+    for(size_t i = 0; i < view_count; i++) {
+        auto& commands = views[i].static_casters ? static_commands : dynamic_commands;
+        const auto& view_commands = views[i].command_statistics;
+        
+        commands.pipeline_binds += view_commands.pipeline_binds;
+        commands.descriptor_binds += view_commands.descriptor_binds;
+        commands.buffer_binds += view_commands.buffer_binds;
+        commands.draw_calls += view_commands.draw_calls;
+        commands.instances += view_commands.instances;
+    }
+    
+    // appended in the same order the lights were visited, so the result doesn't depend on which thread finished first
+    for(size_t i = 0; i < view_count; i++)
+        command_buffer->append(views[i].commands);
 }
 
-void ShadowPass::render_meshes(GFXCommandBuffer* command_buffer, Scene& scene, const Matrix4x4 light_matrix, const Matrix4x4 model, const prism::float3 light_position, const Light::Type type, const CameraFrustum& frustum, const int base_instance) {
-    for(auto [obj, mesh] : scene.get_all<Renderable>()) {
-        if(!mesh.mesh)
-            continue;
-        
-        command_buffer->set_vertex_buffer(mesh.mesh->position_buffer, 0, position_buffer_index);
-        
-        command_buffer->set_index_buffer(mesh.mesh->index_buffer, IndexType::UINT32);
-        
-        PushConstant pc;
-        pc.mvp = light_matrix * model * scene.get<Transform>(obj).model;
-        pc.model = scene.get<Transform>(obj).model;
-        
-        if(mesh.mesh->bones.empty()) {
-            switch(type) {
-                case Light::Type::Sun:
-                    command_buffer->set_graphics_pipeline(static_sun_pipeline);
-                    break;
-                case Light::Type::Spot:
-                    command_buffer->set_graphics_pipeline(static_spot_pipeline);
-                    break;
-                case Light::Type::Point:
-                    command_buffer->set_graphics_pipeline(static_point_pipeline);
-                    break;
-            }
-            
-            command_buffer->bind_shader_buffer(point_location_buffer, 0, 2, sizeof(prism::float3) * max_point_shadows);
-
-            command_buffer->set_push_constant(&pc, sizeof(PushConstant));
-            command_buffer->set_depth_bias(1.25f, 0.00f, 1.75f);
-
-            for (auto& part : mesh.mesh->parts) {
-                if(render_options.enable_frustum_culling && !test_aabb_frustum(frustum, get_aabb_for_part(scene.get<Transform>(obj), part)))
-                    continue;
-                
-                command_buffer->draw_indexed(part.index_count, part.index_offset, part.vertex_offset, base_instance);
-            }
-        } else {
-            switch(type) {
-                case Light::Type::Sun:
-                    command_buffer->set_graphics_pipeline(skinned_sun_pipeline);
-                    break;
-                case Light::Type::Spot:
-                    command_buffer->set_graphics_pipeline(skinned_spot_pipeline);
-                    break;
-                case Light::Type::Point:
-                    command_buffer->set_graphics_pipeline(skinned_point_pipeline);
-                    break;
-            }
+ShadowPass::shadow_view& ShadowPass::add_view(const GFXRenderPassBeginInfo& begin_info) {
+    if(view_count == views.size())
+        views.emplace_back();
+    
+    // the queue and command buffer are left alone, they're cleared once they've been used
+    auto& view = views[view_count++];
+    view.begin_info = begin_info;
+    view.draw_meshes = false;
+    view.static_casters = false;
+    view.light_index = 0;
+    view.copies_before.clear();
+    view.copies_after.clear();
+    
+    return view;
+}
 
-            command_buffer->bind_shader_buffer(point_location_buffer, 0, 2, sizeof(prism::float3) * max_point_shadows);
+void ShadowPass::build_queue(Scene& scene, shadow_view& view) const {
+    view.queue.clear();
+    view.culling = {};
+    
+    if(!view.draw_meshes)
+        return;
+    
+    // levels of detail are picked by how large the part is in the shadow map, not on screen
+    const auto select_lod = [&view](const Mesh::Part& part, const prism::aabb& part_bounds) {
+        const auto resolution = static_cast<uint32_t>(render_options.shadow_resolution);
+        
+        if(view.type == Light::Type::Sun)
+            return select_mesh_lod(part, calculate_orthographic_screen_size(part_bounds, sun_shadow_size, resolution));
+        
+        return select_mesh_lod(part, calculate_screen_size(part_bounds, view.light_position, 90.0f, resolution));
+    };
+    
+    const auto get_pipeline = [this, &view](const bool skinned) {
+        switch(view.type) {
+            case Light::Type::Sun:
+                return skinned ? skinned_sun_pipeline : static_sun_pipeline;
+            case Light::Type::Spot:
+                return skinned ? skinned_spot_pipeline : static_spot_pipeline;
+            default:
+                return skinned ? skinned_point_pipeline : static_point_pipeline;
+        }
+    };
+    
+    query_renderables(scene, view.frustum, view.visible_objects, view.culling);
+    
+    view.visible_objects.erase(std::remove_if(view.visible_objects.begin(), view.visible_objects.end(), [&scene, &view](const Object obj) {
+        const auto proxy = scene.renderable_proxies.find(obj);
+        return (proxy != scene.renderable_proxies.end() && proxy->second.is_static) != view.static_casters;
+    }), view.visible_objects.end());
+    
+    view.part_bounds.clear();
+    for(const auto obj : view.visible_objects) {
+        const auto& transform = scene.get<Transform>(obj);
+        
+        for(const auto& part : scene.get<Renderable>(obj).mesh->parts)
+            view.part_bounds.push_back(get_aabb_for_part(transform, part));
+    }
+    
+    cull_aabbs(view.frustum, view.part_bounds, view.part_visibility);
+    
+    size_t part_index = 0;
+    for(const auto obj : view.visible_objects) {
+        const auto& mesh = scene.get<Renderable>(obj);
+        const auto& transform = scene.get<Transform>(obj);
+        
+        for(const auto& part : mesh.mesh->parts) {
+            const size_t index = part_index++;
+            if(!view.part_visibility[index])
+                continue;
             
-            command_buffer->set_push_constant(&pc, sizeof(PushConstant));
+            const auto part_bounds = view.part_bounds.get(index);
             
-            command_buffer->set_vertex_buffer(mesh.mesh->bone_buffer, 0, bone_buffer_index);
-            command_buffer->set_depth_bias(1.25f, 0.00f, 1.75f);
-
-            for (auto& part : mesh.mesh->parts) {
-                if(render_options.enable_frustum_culling && !test_aabb_frustum(frustum, get_aabb_for_part(scene.get<Transform>(obj), part)))
-                    continue;
-                
-                command_buffer->bind_shader_buffer(part.bone_batrix_buffer, 0, 14, sizeof(Matrix4x4) * 128);
-                command_buffer->draw_indexed(part.index_count, part.index_offset, part.vertex_offset, base_instance);
-            }
+            prism::draw_item item;
+            item.pipeline = get_pipeline(!mesh.mesh->bones.empty());
+            item.renderable = &mesh;
+            item.mesh = mesh.mesh.handle;
+            item.part = &part;
+            item.model = transform.model;
+            item.lod = select_lod(part, part_bounds);
+            
+            const auto part_center = (part_bounds.min + part_bounds.max) * 0.5f;
+            
+            view.queue.add(item, length(part_center - view.light_position));
         }
     }
+    
+    view.queue.sort();
 }
 
-void ShadowPass::render_sun(GFXCommandBuffer* command_buffer, Scene& scene, Object light_object, Light& light) {
-    if(scene.sun_light_dirty || light.use_dynamic_shadows) {
-        GFXRenderPassBeginInfo info = {};
-        info.framebuffer = scene.framebuffer;
-        info.render_pass = render_pass;
-        info.render_area.extent = {static_cast<uint32_t>(render_options.shadow_resolution), static_cast<uint32_t>(render_options.shadow_resolution)};
+void ShadowPass::record_view(shadow_view& view) const {
+    GFXCommandBuffer* command_buffer = &view.commands;
+    
+    const auto record_copy = [command_buffer](const texture_copy& copy) {
+        if(copy.source == nullptr || copy.target == nullptr)
+            return;
         
-        command_buffer->set_render_pass(info);
+        if(copy.cubemap)
+            command_buffer->copy_texture(copy.source, render_options.shadow_resolution, render_options.shadow_resolution, copy.target, copy.target_slice, copy.target_layer, 0, copy.source_slice, copy.source_layer);
+        else
+            command_buffer->copy_array_texture(copy.source, render_options.shadow_resolution, render_options.shadow_resolution, copy.target, copy.target_layer, copy.source_layer);
+    };
+    
+    for(const auto& texture_copy : view.copies_before)
+        record_copy(texture_copy);
+    
+    command_buffer->set_render_pass(view.begin_info);
+    
+    Viewport viewport = {};
+    viewport.width = render_options.shadow_resolution;
+    viewport.height = render_options.shadow_resolution;
+    
+    command_buffer->set_viewport(viewport);
+    
+    PushConstant pc;
+    pc.light_matrix = view.light_matrix;
+    pc.light_index = view.light_index;
+    
+    prism::command_state_cache state(command_buffer);
+    
+    GFXPipeline* last_pipeline = nullptr;
+    for(const auto& batch : view.queue.batches) {
+        const auto& item = view.queue.items[batch.first_item];
+        const auto& part = *item.part;
         
-        Viewport viewport = {};
-        viewport.width = render_options.shadow_resolution;
-        viewport.height = render_options.shadow_resolution;
+        state.set_graphics_pipeline(item.pipeline);
         
-        command_buffer->set_viewport(viewport);
+        if(item.pipeline != last_pipeline) {
+            command_buffer->set_push_constant(&pc, sizeof(PushConstant));
+            command_buffer->set_depth_bias(1.25f, 0.00f, 1.75f);
+            
+            last_pipeline = item.pipeline;
+        }
         
-        const prism::float3 lightPos = scene.get<Transform>(light_object).position;
+        state.bind_shader_buffer(point_location_buffer, 0, 2, sizeof(prism::float3) * max_point_shadows);
+        state.bind_shader_buffer(instances->buffer, 0, instance_buffer_binding, instances->get_size());
         
-        const Matrix4x4 projection = prism::orthographic(-25.0f, 25.0f, -25.0f, 25.0f, 0.1f, 100.0f);
-        const Matrix4x4 view = prism::look_at(lightPos, prism::float3(0), prism::float3(0, 1, 0));
+        state.set_vertex_buffer(item.mesh->position_buffer, 0, position_buffer_index);
         
-        const Matrix4x4 realMVP = projection * view;
+        if(!item.mesh->bones.empty()) {
+            state.set_vertex_buffer(item.mesh->bone_buffer, 0, bone_buffer_index);
+            
+            prism::bind_skinning_matrices(command_buffer, skinning_buffer, *item.renderable, part);
+        }
         
-        scene.lightSpace = projection;
-        scene.lightSpace[1][1] *= -1;
-        scene.lightSpace = scene.lightSpace * view;
+        state.set_index_buffer(item.mesh->index_buffer, item.mesh->index_type);
         
-        const auto frustum = normalize_frustum(extract_frustum(projection * view));
-                
-        if(light.enable_shadows)
-            render_meshes(command_buffer, scene, realMVP, Matrix4x4(), lightPos, Light::Type::Sun, frustum, 0);
+        const auto& lod = part.lods[item.lod];
         
-        scene.sun_light_dirty = false;
+        state.draw_indexed(lod.index_count, lod.index_offset, part.vertex_offset, static_cast<int>(view.first_instance + batch.first_item), static_cast<int>(batch.item_count));
     }
+    
+    // the next view may start by copying, which can't happen inside of a render pass
+    command_buffer->end_render_pass();
+    
+    for(const auto& texture_copy : view.copies_after)
+        record_copy(texture_copy);
+    
+    view.command_statistics = state.statistics;
 }
 
-void ShadowPass::render_spot(GFXCommandBuffer* command_buffer, Scene& scene, Object light_object, Light& light) {
-    if((last_spot_light + 1) == max_spot_shadows)
+void ShadowPass::prepare_sun(Scene& scene, Object light_object, Light& light) {
+    const prism::float3 lightPos = scene.get<Transform>(light_object).position;
+    
+    const Matrix4x4 projection = prism::orthographic(-sun_shadow_size / 2.0f, sun_shadow_size / 2.0f, -sun_shadow_size / 2.0f, sun_shadow_size / 2.0f, 0.1f, 100.0f);
+    const Matrix4x4 view_matrix = prism::look_at(lightPos, prism::float3(0), prism::float3(0, 1, 0));
+    
+    Matrix4x4 light_space = projection;
+    light_space[1][1] *= -1;
+    light_space = light_space * view_matrix;
+    
+    // the cache was drawn from wherever the light was before
+    if(std::memcmp(&light_space, &scene.lightSpace, sizeof(Matrix4x4)) != 0)
+        scene.sun_light_dirty = true;
+    
+    if(!scene.sun_light_dirty && !light.use_dynamic_shadows)
         return;
     
-    if(scene.spot_light_dirty[last_spot_light] || light.use_dynamic_shadows) {
+    scene.lightSpace = light_space;
+    
+    const auto add_sun_view = [&](GFXFramebuffer* framebuffer, GFXRenderPass* pass) -> shadow_view& {
         GFXRenderPassBeginInfo info = {};
-        info.framebuffer = offscreen_framebuffer;
-        info.render_pass = cube_render_pass;
+        info.framebuffer = framebuffer;
+        info.render_pass = pass;
         info.render_area.extent = {static_cast<uint32_t>(render_options.shadow_resolution), static_cast<uint32_t>(render_options.shadow_resolution)};
         
-        command_buffer->set_render_pass(info);
+        auto& view = add_view(info);
+        view.draw_meshes = light.enable_shadows;
+        view.type = Light::Type::Sun;
+        view.light_matrix = projection * view_matrix;
+        view.light_position = lightPos;
+        view.frustum = normalize_frustum(extract_frustum(projection * view_matrix));
         
-        Viewport viewport = {};
-        viewport.width = render_options.shadow_resolution;
-        viewport.height = render_options.shadow_resolution;
-        
-        command_buffer->set_viewport(viewport);
-        
-        const Matrix4x4 perspective = prism::perspective(radians(90.0f), 1.0f, 0.1f, 100.0f);
-        
-        const Matrix4x4 realMVP = perspective * inverse(scene.get<Transform>(light_object).model);
-        
-        scene.spotLightSpaces[last_spot_light] = perspective;
-        scene.spotLightSpaces[last_spot_light][1][1] *= -1;
-        scene.spotLightSpaces[last_spot_light] = scene.spotLightSpaces[last_spot_light] * inverse(scene.get<Transform>(light_object).model);
+        return view;
+    };
+    
+    if(scene.sun_light_dirty)
+        add_sun_view(scene.staticFramebuffer, render_pass).static_casters = true;
+    
+    auto& view = add_sun_view(scene.framebuffer, keep_render_pass);
+    view.copies_before.push_back({scene.staticDepthTexture, scene.depthTexture});
+    
+    scene.sun_light_dirty = false;
+}
+
+void ShadowPass::prepare_spot(Scene& scene, Object light_object, Light& light) {
+    if((last_spot_light + 1) == max_spot_shadows)
+        return;
+    
+    const Matrix4x4 perspective = prism::perspective(radians(90.0f), 1.0f, 0.1f, 100.0f);
+    const Matrix4x4 light_matrix = perspective * inverse(scene.get<Transform>(light_object).model);
+    
+    Matrix4x4 light_space = perspective;
+    light_space[1][1] *= -1;
+    light_space = light_space * inverse(scene.get<Transform>(light_object).model);
+    
+    if(std::memcmp(&light_space, &scene.spotLightSpaces[last_spot_light], sizeof(Matrix4x4)) != 0)
+        scene.spot_light_dirty[last_spot_light] = true;
+    
+    if(scene.spot_light_dirty[last_spot_light] || light.use_dynamic_shadows) {
+        scene.spotLightSpaces[last_spot_light] = light_space;
         
-        const auto frustum = normalize_frustum(extract_frustum(perspective * inverse(scene.get<Transform>(light_object).model)));
+        const auto add_spot_view = [&](GFXRenderPass* pass) -> shadow_view& {
+            GFXRenderPassBeginInfo info = {};
+            info.framebuffer = offscreen_framebuffer;
+            info.render_pass = pass;
+            info.render_area.extent = {static_cast<uint32_t>(render_options.shadow_resolution), static_cast<uint32_t>(render_options.shadow_resolution)};
+            
+            auto& view = add_view(info);
+            view.draw_meshes = light.enable_shadows;
+            view.type = Light::Type::Spot;
+            view.light_matrix = light_matrix;
+            view.light_position = scene.get<Transform>(light_object).get_world_position();
+            view.frustum = normalize_frustum(extract_frustum(light_matrix));
+            
+            return view;
+        };
         
-        if(light.enable_shadows)
-            render_meshes(command_buffer, scene, realMVP, Matrix4x4(), scene.get<Transform>(light_object).get_world_position(), Light::Type::Spot, frustum, 0);
+        if(scene.spot_light_dirty[last_spot_light]) {
+            auto& view = add_spot_view(cube_render_pass);
+            view.static_casters = true;
+            view.copies_after.push_back({offscreen_depth, scene.staticSpotLightArray, 0, 0, 0, last_spot_light, false});
+        }
         
-        command_buffer->end_render_pass();
-        command_buffer->copy_texture(offscreen_depth, render_options.shadow_resolution, render_options.shadow_resolution, scene.spotLightArray, 0, last_spot_light, 0);
+        auto& view = add_spot_view(cube_keep_render_pass);
+        view.copies_before.push_back({scene.staticSpotLightArray, offscreen_depth, 0, last_spot_light, 0, 0, false});
+        view.copies_after.push_back({offscreen_depth, scene.spotLightArray, 0, 0, 0, last_spot_light, false});
         
         scene.spot_light_dirty[last_spot_light] = false;
     }
@@ -256,41 +448,54 @@ void ShadowPass::render_spot(GFXCommandBuffer* command_buffer, Scene& scene, Obj
     last_spot_light++;
 }
 
-void ShadowPass::render_point(GFXCommandBuffer* command_buffer, Scene& scene, Object light_object, Light& light) {
+void ShadowPass::prepare_point(Scene& scene, Object light_object, Light& light) {
     if(!render_options.enable_point_shadows)
         return;
     
     if((last_point_light + 1) == max_point_shadows)
         return;
     
+    const prism::float3 position = scene.get<Transform>(light_object).get_world_position();
+    
+    if(std::memcmp(&position, point_location_map + last_point_light, sizeof(prism::float3)) != 0)
+        scene.point_light_dirty[last_point_light] = true;
+    
     if(scene.point_light_dirty[last_point_light] || light.use_dynamic_shadows) {
-        *(point_location_map + last_point_light) = scene.get<Transform>(light_object).get_world_position();
-
-        for(int face = 0; face < 6; face++) {
+        *(point_location_map + last_point_light) = position;
+        
+        const Matrix4x4 projection = prism::perspective(radians(90.0f), 1.0f, 0.1f, 100.0f);
+        const Matrix4x4 model = inverse(scene.get<Transform>(light_object).model);
+        
+        const auto add_point_view = [&](GFXRenderPass* pass, const int face) -> shadow_view& {
             GFXRenderPassBeginInfo info = {};
             info.framebuffer = offscreen_framebuffer;
-            info.render_pass = cube_render_pass;
+            info.render_pass = pass;
             info.render_area.extent = {static_cast<uint32_t>(render_options.shadow_resolution), static_cast<uint32_t>(render_options.shadow_resolution)};
-
-            command_buffer->set_render_pass(info);
-            
-            Viewport viewport = {};
-            viewport.width = render_options.shadow_resolution;
-            viewport.height = render_options.shadow_resolution;
-            
-            command_buffer->set_viewport(viewport);
             
-            const prism::float3 lightPos = scene.get<Transform>(light_object).get_world_position();
+            auto& view = add_view(info);
+            view.draw_meshes = true;
+            view.type = Light::Type::Point;
+            view.light_matrix = projection * shadowTransforms[face] * model;
+            view.light_position = position;
+            view.light_index = last_point_light;
+            view.frustum = normalize_frustum(extract_frustum(view.light_matrix));
             
-            const Matrix4x4 projection = prism::perspective(radians(90.0f), 1.0f, 0.1f, 100.0f);
-            const Matrix4x4 model = inverse(scene.get<Transform>(light_object).model);
-            
-            const auto frustum = normalize_frustum(extract_frustum(projection * shadowTransforms[face] * model));
-            
-            render_meshes(command_buffer, scene, projection * shadowTransforms[face], model, lightPos, Light::Type::Point, frustum, last_point_light);
+            return view;
+        };
+
+        for(int face = 0; face < 6; face++) {
+            // depth is cached with the distances, otherwise movable renderables behind static ones would overwrite them
+            if(scene.point_light_dirty[last_point_light]) {
+                auto& view = add_point_view(cube_render_pass, face);
+                view.static_casters = true;
+                view.copies_after.push_back({offscreen_color_texture, scene.staticPointLightArray, 0, 0, face, last_point_light});
+                view.copies_after.push_back({offscreen_depth, scene.staticPointLightDepthArray, 0, 0, face, last_point_light});
+            }
             
-            command_buffer->end_render_pass();
-            command_buffer->copy_texture(offscreen_color_texture, render_options.shadow_resolution, render_options.shadow_resolution, scene.pointLightArray, face, last_point_light, 0);
+            auto& view = add_point_view(cube_keep_render_pass, face);
+            view.copies_before.push_back({scene.staticPointLightArray, offscreen_color_texture, face, last_point_light, 0, 0});
+            view.copies_before.push_back({scene.staticPointLightDepthArray, offscreen_depth, face, last_point_light, 0, 0});
+            view.copies_after.push_back({offscreen_color_texture, scene.pointLightArray, 0, 0, face, last_point_light});
         }
         
         scene.point_light_dirty[last_point_light] = false;
@@ -316,6 +521,15 @@ void ShadowPass::create_render_passes() {
     renderPassInfo.attachments.push_back(GFXPixelFormat::DEPTH_32F);
     
     cube_render_pass = gfx->create_render_pass(renderPassInfo);
+    
+    renderPassInfo.keep_contents = true;
+    
+    renderPassInfo.label = "Shadow Cube (Keep)";
+    cube_keep_render_pass = gfx->create_render_pass(renderPassInfo);
+    
+    renderPassInfo.label = "Shadow (Keep)";
+    renderPassInfo.attachments = {GFXPixelFormat::DEPTH_32F};
+    keep_render_pass = gfx->create_render_pass(renderPassInfo);
 }
 
 void ShadowPass::create_pipelines() {
@@ -331,7 +545,8 @@ void ShadowPass::create_pipelines() {
     pipelineInfo.shader_input.bindings = {
         {0, GFXBindingType::PushConstant},
         {1, GFXBindingType::StorageBuffer},
-        {2, GFXBindingType::StorageBuffer}
+        {2, GFXBindingType::StorageBuffer},
+        {instance_buffer_binding, GFXBindingType::StorageBuffer}
     };
     
     pipelineInfo.shader_input.push_constants = {
@@ -18,33 +18,13 @@ SMAAPass::SMAAPass(GFX* gfx, prism::renderer* renderer) : renderer(renderer) {
     create_pipelines();
 }
 
-void SMAAPass::create_render_target_resources(RenderTarget& target) {
-    auto gfx = engine->get_gfx();
-    
-    GFXTextureCreateInfo textureInfo = {};
-    textureInfo.label = "SMAA Edge";
-    textureInfo.width = target.extent.width;
-    textureInfo.height = target.extent.height;
-    textureInfo.format = GFXPixelFormat::R16G16B16A16_SFLOAT;
-    textureInfo.usage = GFXTextureUsage::Attachment | GFXTextureUsage::Sampled;
-    
-    target.edge_texture = gfx->create_texture(textureInfo);
-    
-    textureInfo.label = "SMAA Blend";
-    target.blend_texture = gfx->create_texture(textureInfo);
-    
-    GFXFramebufferCreateInfo framebufferInfo = {};
-    framebufferInfo.attachments = {target.edge_texture};
-    framebufferInfo.render_pass = render_pass;
-    
-    target.edge_framebuffer = gfx->create_framebuffer(framebufferInfo);
-    
-    framebufferInfo.attachments = {target.blend_texture};
+prism::render_texture SMAAPass::add_passes(prism::render_graph& graph, RenderTarget& target, const prism::render_texture color, const prism::render_texture depth) {
+    prism::render_texture_desc desc;
+    desc.label = "SMAA Edge";
+    desc.extent = target.extent;
+    desc.format = GFXPixelFormat::R16G16B16A16_SFLOAT;
+    desc.usage = GFXTextureUsage::Attachment | GFXTextureUsage::Sampled;
     
-    target.blend_framebuffer = gfx->create_framebuffer(framebufferInfo);
-}
-
-void SMAAPass::render(GFXCommandBuffer* command_buffer, RenderTarget& target) {
     GFXRenderPassBeginInfo beginInfo = {};
     beginInfo.clear_color.a = 0.0f;
     beginInfo.render_area.extent = target.extent;
@@ -57,40 +37,53 @@ void SMAAPass::render(GFXCommandBuffer* command_buffer, RenderTarget& target) {
     
     pc.viewport = prism::float4(1.0f / static_cast<float>(target.extent.width), 1.0f / static_cast<float>(target.extent.height), target.extent.width, target.extent.height);
 
-    // edge
-    {
-        beginInfo.framebuffer = target.edge_framebuffer;
+    const auto edge = graph.create_texture(desc);
+    
+    graph.add_pass("SMAA Edge", [color, depth, edge](prism::render_graph_builder& builder) {
+        builder.read(color);
+        builder.read(depth);
+        builder.write(edge);
+    }, [this, beginInfo, pc, color, depth, edge](GFXCommandBuffer* command_buffer, prism::render_graph& graph) mutable {
+        beginInfo.framebuffer = graph.get_framebuffer(render_pass, {edge});
         command_buffer->set_render_pass(beginInfo);
         
         Viewport viewport = {};
-        viewport.width = target.extent.width;
-        viewport.height = target.extent.height;
+        viewport.width = beginInfo.render_area.extent.width;
+        viewport.height = beginInfo.render_area.extent.height;
         
         command_buffer->set_viewport(viewport);
         
         command_buffer->set_graphics_pipeline(edge_pipeline);
         command_buffer->set_push_constant(&pc, sizeof(PushConstant));
 
-        command_buffer->bind_texture(target.offscreenColorTexture, 0); // color
-        command_buffer->bind_texture(target.offscreenDepthTexture, 1); // depth
+        command_buffer->bind_texture(graph.get_texture(color), 0); // color
+        command_buffer->bind_texture(graph.get_texture(depth), 1); // depth
 
         command_buffer->draw(0, 3, 0, 1);
-    }
+    });
 
-    // blend
-    {
-        beginInfo.framebuffer = target.blend_framebuffer;
+    desc.label = "SMAA Blend";
+
+    const auto blend = graph.create_texture(desc);
+
+    graph.add_pass("SMAA Blend", [edge, blend](prism::render_graph_builder& builder) {
+        builder.read(edge);
+        builder.write(blend);
+    }, [this, beginInfo, pc, edge, blend](GFXCommandBuffer* command_buffer, prism::render_graph& graph) mutable {
+        beginInfo.framebuffer = graph.get_framebuffer(render_pass, {blend});
         command_buffer->set_render_pass(beginInfo);
 
         command_buffer->set_graphics_pipeline(blend_pipeline);
         command_buffer->set_push_constant(&pc, sizeof(PushConstant));
 
-        command_buffer->bind_texture(target.edge_texture, 0);
+        command_buffer->bind_texture(graph.get_texture(edge), 0);
         command_buffer->bind_texture(area_image, 1);
         command_buffer->bind_texture(search_image, 3);
 
         command_buffer->draw(0, 3, 0, 1);
-    }
+    });
+    
+    return blend;
 }
 
 void SMAAPass::create_textures() {
@@ -0,0 +1,204 @@
+#include "texturestreaming.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "asset.hpp"
+#include "engine.hpp"
+#include "gfx.hpp"
+#include "render_options.hpp"
+#include "thread_pool.hpp"
+
+struct texture_streaming_job {
+    // copied from the texture, the job only reads from these
+    std::string path;
+    prism::texture_header header;
+    std::vector<prism::texture_level> levels;
+
+    int level = 0;
+
+    texture_levels decoded;
+    bool succeeded = false;
+    std::atomic<bool> finished = false;
+};
+
+int get_initial_texture_level(const Texture& texture) {
+    const int mip_count = static_cast<int>(texture.levels.size());
+
+    for(int i = 0; i < mip_count; i++) {
+        const uint32_t width = prism::calculate_mip_extent(texture.header.width, i);
+        const uint32_t height = prism::calculate_mip_extent(texture.header.height, i);
+
+        if(std::max(width, height) <= texture_streaming_initial_size)
+            return i;
+    }
+
+    return std::max(mip_count - 1, 0);
+}
+
+float calculate_screen_size(const prism::aabb& bounds, const prism::float3 camera_position, const float fov, const uint32_t screen_height) {
+    const prism::float3 center = (bounds.min + bounds.max) / 2.0f;
+    const float radius = length(bounds.max - bounds.min) / 2.0f;
+    const float distance = length(center - camera_position);
+
+    // the camera is inside of the bounds, so the object could cover the entire screen
+    if(distance <= radius)
+        return static_cast<float>(screen_height);
+
+    return radius / (distance * std::tan(radians(fov) / 2.0f)) * static_cast<float>(screen_height);
+}
+
+void request_texture_level(Texture& texture, const float screen_size) {
+    if(!texture.streamable || texture.levels.empty())
+        return;
+
+    const int last_level = static_cast<int>(texture.levels.size()) - 1;
+
+    int level = last_level;
+    if(screen_size > 0.0f) {
+        const float texture_size = static_cast<float>(std::max(texture.width, texture.height));
+
+        // every level halves the texture size, so pick the first one that doesn't have more texels than pixels
+        level = static_cast<int>(std::floor(std::log2(texture_size / screen_size)));
+        level = std::clamp(level, 0, last_level);
+    }
+
+    texture.next_requested_level = std::min(texture.next_requested_level, level);
+}
+
+uint64_t get_texture_levels_size(const Texture& texture, const int first_level) {
+    uint64_t size = 0;
+    for(size_t i = first_level; i < texture.levels.size(); i++)
+        size += texture.levels[i].size;
+
+    return size;
+}
+
+uint64_t get_resident_texture_memory() {
+    uint64_t size = 0;
+    for(auto texture : assetm->get_all<Texture>()) {
+        if(texture != nullptr && texture->streamable)
+            size += get_texture_levels_size(*texture, texture->resident_level);
+    }
+
+    return size;
+}
+
+struct StreamingTarget {
+    Texture* texture = nullptr;
+    int desired_level = 0, level = 0;
+};
+
+namespace {
+    // only the upload is left for the main thread, the old levels are released by the gfx backend once the gpu is done with them
+    void finish_streaming_job(Texture& texture) {
+        auto& job = *texture.streaming_job;
+
+        if(job.succeeded) {
+            if(GFXTexture* handle = upload_texture(job.decoded); handle != nullptr) {
+                engine->get_gfx()->destroy_texture(texture.handle);
+
+                texture.handle = handle;
+                texture.resident_level = job.level;
+            }
+        }
+
+        texture.streaming_job.reset();
+    }
+}
+
+void update_texture_streaming() {
+    std::vector<StreamingTarget> targets;
+    uint64_t total_size = 0;
+
+    int pending_jobs = 0;
+
+    for(auto texture : assetm->get_all<Texture>()) {
+        if(texture == nullptr || !texture->streamable)
+            continue;
+
+        if(texture->streaming_job != nullptr && texture->streaming_job->finished)
+            finish_streaming_job(*texture);
+
+        if(texture->streaming_job != nullptr)
+            pending_jobs++;
+
+        texture->requested_level = texture->next_requested_level;
+        texture->next_requested_level = static_cast<int>(texture->levels.size()) - 1;
+
+        StreamingTarget target;
+        target.texture = texture;
+
+        if(render_options.enable_texture_streaming) {
+            target.desired_level = std::min(texture->requested_level, get_initial_texture_level(*texture));
+
+            // levels that are no longer requested stay resident until the budget needs the memory back
+            target.level = std::min(target.desired_level, texture->resident_level);
+        }
+
+        total_size += get_texture_levels_size(*texture, target.level);
+
+        targets.push_back(target);
+    }
+
+    if(render_options.enable_texture_streaming) {
+        const uint64_t budget = static_cast<uint64_t>(render_options.texture_memory_budget) * 1024 * 1024;
+
+        // drops the largest level out of all the textures, first from ones that aren't requested anymore
+        const auto evict_largest_level = [&targets, &total_size](const bool unrequested_only) {
+            StreamingTarget* largest = nullptr;
+            uint64_t largest_size = 0;
+
+            for(auto& target : targets) {
+                const int limit = unrequested_only ? target.desired_level : get_initial_texture_level(*target.texture);
+                if(target.level >= limit)
+                    continue;
+
+                const uint64_t size = target.texture->levels[target.level].size;
+                if(size > largest_size) {
+                    largest = &target;
+                    largest_size = size;
+                }
+            }
+
+            if(largest == nullptr)
+                return false;
+
+            largest->level++;
+            total_size -= largest_size;
+
+            return true;
+        };
+
+        while(total_size > budget && evict_largest_level(true)) {}
+        while(total_size > budget && evict_largest_level(false)) {}
+    }
+
+    // the textures that are the furthest away from their target are changed first
+    std::sort(targets.begin(), targets.end(), [](const StreamingTarget& a, const StreamingTarget& b) {
+        return std::abs(a.level - a.texture->resident_level) > std::abs(b.level - b.texture->resident_level);
+    });
+
+    // reading and decoding happens on the thread pool, so nothing here waits on the disk
+    for(auto& target : targets) {
+        if(target.level == target.texture->resident_level || target.texture->streaming_job != nullptr)
+            continue;
+
+        if(pending_jobs++ >= max_texture_streaming_changes_per_frame)
+            break;
+
+        auto job = std::make_shared<texture_streaming_job>();
+        job->path = target.texture->path;
+        job->header = target.texture->header;
+        job->levels = target.texture->levels;
+        job->level = target.level;
+
+        target.texture->streaming_job = job;
+
+        engine->get_thread_pool()->submit([job] {
+            job->succeeded = decode_texture_levels(job->path, job->header, job->levels, job->level, job->decoded);
+            job->finished = true;
+        });
+    }
+}
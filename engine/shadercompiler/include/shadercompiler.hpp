@@ -83,6 +83,15 @@ public:
     /// Sets the include directory used to search for files inside of #include directives.
     void set_include_path(std::string_view path);
     
+    /// Caches compiled shaders in this directory, keyed by their source (including any included files), options and the compiler version.
+    void set_cache_directory(const prism::path& path);
+    
+    /// Returns how many shaders were actually compiled from GLSL, instead of being loaded from the cache.
+    uint32_t get_compile_count() const;
+    
+    /// Returns how many shaders were loaded from the cache.
+    uint32_t get_cache_hit_count() const;
+    
     /**
      Compiles from one shader language to another shader language.
      @param from_language The language the shader passed by shader_source is written in.
@@ -1,15 +1,28 @@
 #include "shadercompiler.hpp"
 
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
 #include <spirv_cpp.hpp>
 #include <spirv_msl.hpp>
 #include <SPIRV/GlslangToSpv.h>
 
 #include "log.hpp"
 #include "string_utils.hpp"
+#include "utility.hpp"
 #include "includer.hpp"
 #include "defaultresources.hpp"
 
 static inline std::vector<std::string> include_path;
+static inline prism::path cache_directory;
+
+static inline std::atomic<uint32_t> compile_count = 0, cache_hit_count = 0;
+
+// change this whenever the way shaders are compiled changes (like the target SPIR-V version), which invalidates every cached shader
+constexpr uint32_t shader_cache_version = 1;
 
 ShaderCompiler::ShaderCompiler() {
     glslang::InitializeProcess();
@@ -19,6 +32,149 @@ void ShaderCompiler::set_include_path(const std::string_view path) {
     include_path.emplace_back(path.data());
 }
 
+void ShaderCompiler::set_cache_directory(const prism::path& path) {
+    cache_directory = path;
+    
+    std::error_code error;
+    std::filesystem::create_directories(cache_directory, error);
+    
+    if(error) {
+        prism::log::error(System::Renderer, "Failed to create shader cache directory {}, shaders won't be cached!", cache_directory.string());
+        cache_directory.clear();
+    }
+}
+
+uint32_t ShaderCompiler::get_compile_count() const {
+    return compile_count;
+}
+
+uint32_t ShaderCompiler::get_cache_hit_count() const {
+    return cache_hit_count;
+}
+
+constexpr uint64_t fnv_offset_basis = 14695981039346656037ull;
+
+uint64_t hash_bytes(uint64_t hash, const void* data, const size_t size) {
+    const auto bytes = static_cast<const uint8_t*>(data);
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    
+    return hash;
+}
+
+uint64_t hash_string(const uint64_t hash, const std::string_view string) {
+    // the length is hashed too, so "ab" + "c" and "a" + "bc" don't collide
+    const uint64_t size = string.size();
+    
+    return hash_bytes(hash_bytes(hash, &size, sizeof(uint64_t)), string.data(), string.size());
+}
+
+// included files aren't part of the source string, but changing them has to invalidate the cache too
+uint64_t hash_includes(uint64_t hash, const std::string_view source, std::vector<std::string>& visited) {
+    size_t position = 0;
+    while((position = source.find("#include", position)) != std::string_view::npos) {
+        const size_t start = source.find_first_of("\"<", position);
+        const size_t end = start == std::string_view::npos ? start : source.find_first_of("\">", start + 1);
+        if(end == std::string_view::npos)
+            break;
+        
+        position = end;
+        
+        const std::string name(source.substr(start + 1, end - start - 1));
+        if(utility::contains(visited, name))
+            continue;
+        
+        visited.push_back(name);
+        
+        for(const auto& directory : include_path) {
+            std::ifstream file(prism::path(directory) / name);
+            if(!file)
+                continue;
+            
+            const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            
+            hash = hash_includes(hash_string(hash, contents), contents, visited);
+            break;
+        }
+    }
+    
+    return hash;
+}
+
+prism::path get_cache_path(const ShaderStage shader_stage, const ShaderSource& shader_source, const ShaderLanguage to_language, const CompileOptions& options) {
+    uint64_t hash = hash_bytes(fnv_offset_basis, &shader_cache_version, sizeof(uint32_t));
+    hash = hash_string(hash, GetGlslVersionString());
+    hash = hash_bytes(hash, &shader_stage, sizeof(ShaderStage));
+    hash = hash_bytes(hash, &to_language, sizeof(ShaderLanguage));
+    hash = hash_bytes(hash, &options.is_apple_mobile, sizeof(bool));
+    
+    for(const auto& definition : options.definitions)
+        hash = hash_string(hash, definition);
+    
+    hash = hash_string(hash, shader_source.as_string());
+    
+    std::vector<std::string> visited;
+    hash = hash_includes(hash, shader_source.as_string(), visited);
+    
+    std::stringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash;
+    
+    return cache_directory / (name.str() + (to_language == ShaderLanguage::SPIRV ? ".spv" : ".metal"));
+}
+
+std::optional<ShaderSource> load_cached_shader(const prism::path& cache_path, const ShaderLanguage to_language) {
+    std::ifstream file(cache_path, std::ios::binary);
+    if(!file)
+        return std::nullopt;
+    
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    
+    if(to_language == ShaderLanguage::SPIRV) {
+        // a partially written file from a crash shouldn't be used
+        constexpr uint32_t spirv_magic = 0x07230203;
+        if(contents.size() < sizeof(uint32_t) || contents.size() % sizeof(uint32_t) != 0)
+            return std::nullopt;
+        
+        std::vector<uint32_t> spirv(contents.size() / sizeof(uint32_t));
+        memcpy(spirv.data(), contents.data(), contents.size());
+        
+        if(spirv[0] != spirv_magic)
+            return std::nullopt;
+        
+        return ShaderSource(spirv);
+    }
+    
+    if(contents.empty())
+        return std::nullopt;
+    
+    return ShaderSource(contents);
+}
+
+void save_cached_shader(const prism::path& cache_path, const ShaderSource& shader) {
+    // written to a temporary file first, so the cache never has a half written shader in it. shaders can be compiled on several threads at once, so each gets its own
+    auto temporary_path = cache_path;
+    temporary_path += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    
+    {
+        std::ofstream file(temporary_path, std::ios::binary);
+        if(!file)
+            return;
+        
+        if(shader.is_string()) {
+            const auto source = shader.as_string();
+            file.write(source.data(), static_cast<std::streamsize>(source.size()));
+        } else {
+            const auto spirv = shader.as_bytecode();
+            file.write(reinterpret_cast<const char*>(spirv.data()), static_cast<std::streamsize>(spirv.size() * sizeof(uint32_t)));
+        }
+    }
+    
+    std::error_code error;
+    std::filesystem::rename(temporary_path, cache_path, error);
+}
+
 std::vector<uint32_t> compile_glsl_to_spv(const std::string_view source_string, const EShLanguage shader_language, const CompileOptions& options) {
     std::string newString = "#version 460 core\n";
     
@@ -81,6 +237,18 @@ std::optional<ShaderSource> ShaderCompiler::compile(const ShaderLanguage from_la
         return std::nullopt;
     }
     
+    prism::path cache_path;
+    if(!cache_directory.empty() && (to_language == ShaderLanguage::SPIRV || to_language == ShaderLanguage::MSL)) {
+        cache_path = get_cache_path(shader_stage, shader_source, to_language, options);
+        
+        if(auto cached_shader = load_cached_shader(cache_path, to_language)) {
+            cache_hit_count++;
+            return cached_shader;
+        }
+    }
+    
+    compile_count++;
+    
     EShLanguage lang = EShLangMiss;
     switch(shader_stage) {
         case ShaderStage::Vertex:
@@ -115,10 +283,22 @@ std::optional<ShaderSource> ShaderCompiler::compile(const ShaderLanguage from_la
             
             msl.set_msl_options(opts);
             
-            return ShaderSource(msl.compile());
+            const auto shader = ShaderSource(msl.compile());
+            
+            if(!cache_path.empty())
+                save_cached_shader(cache_path, shader);
+            
+            return shader;
         }
         case ShaderLanguage::SPIRV:
-            return ShaderSource(spirv);
+        {
+            const auto shader = ShaderSource(spirv);
+            
+            if(!cache_path.empty())
+                save_cached_shader(cache_path, shader);
+            
+            return shader;
+        }
         default:
             return {};
     }
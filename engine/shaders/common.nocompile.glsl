@@ -159,3 +159,21 @@ vec3 from_srgb_to_linear(const vec3 sRGB) {
 
     return mix(higher, lower, cutoff);
 }
+
+// normal maps may be stored as two channels (bc5), so z is always reconstructed from xy
+vec3 decode_normal_map(const vec3 sampled) {
+    const vec2 xy = sampled.xy * 2.0 - 1.0;
+
+    return vec3(xy, sqrt(clamp(1.0 - dot(xy, xy), 0.0, 1.0)));
+}
+
+// mesh normals and tangents are stored octahedral encoded, e is expected to be in [-1, 1]
+vec3 decode_octahedral(const vec2 e) {
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+
+    const float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+
+    return normalize(v);
+}
@@ -1,13 +1,13 @@
 layout (constant_id = 0) const int max_materials = 25;
-layout (constant_id = 1) const int max_lights = 25;
 layout (constant_id = 2) const int max_spot_lights = 4;
 layout (constant_id = 3) const int max_probes = 4;
 
+#include "common.glsl"
+
 layout (location = 0) in vec3 inPosition;
-layout (location = 1) in vec3 inNormal;
+layout (location = 1) in vec2 inNormal; // octahedral encoded
 layout (location = 2) in vec2 inUV;
-layout (location = 3) in vec3 inTangent;
-layout (location = 4) in vec3 inBitangent;
+layout (location = 3) in vec4 inTangent; // octahedral encoded in xy, bitangent sign in w
 
 #ifdef BONE
 layout (location = 5) in ivec4 inBoneID;
@@ -25,12 +25,6 @@ struct Material {
     vec4 color, info;
 };
 
-struct Light {
-    vec4 positionType;
-    vec4 directionPower;
-    vec4 color;
-};
-
 struct Probe {
     vec4 position, size;
 };
@@ -41,9 +35,11 @@ layout(std430, binding = 1) buffer readonly SceneInformation {
     mat4 vp, lightSpace;
     mat4 spotLightSpaces[max_spot_lights];
     Material materials[max_materials];
-    Light lights[max_lights];
     Probe probes[max_probes];
+    vec4 cluster_grid;
+    vec4 cluster_slices;
     int numLights;
+    int numClusteredLights;
 } scene;
 
 #ifdef CUBEMAP
@@ -51,8 +47,8 @@ layout(push_constant, binding = 0) uniform readonly PushConstant{
     mat4 model, view;
 };
 #else
-layout(push_constant, binding = 0) uniform readonly PushConstant{
-    mat4 model;
+layout(std430, binding = 5) buffer readonly InstanceInformation {
+    mat4 instance_models[];
 };
 #endif
 
@@ -69,10 +65,18 @@ layout(std430, binding = 14) buffer readonly BoneInformation {
 #endif
 
 void main() {
+#ifndef CUBEMAP
+    const mat4 model = instance_models[gl_InstanceIndex];
+#endif
+
+    const vec3 normal = decode_octahedral(inNormal);
+    const vec3 tangent = decode_octahedral(inTangent.xy * 2.0 - 1.0);
+    const vec3 bitangent = cross(normal, tangent) * (inTangent.w > 0.5 ? 1.0 : -1.0);
+
     const mat3 mat = mat3(model);
-    const vec3 T = normalize(mat * inTangent);
-    const vec3 N = normalize(mat * inNormal);
-    const vec3 B = normalize(mat * inBitangent);
+    const vec3 T = normalize(mat * tangent);
+    const vec3 N = normalize(mat * normal);
+    const vec3 B = normalize(mat * bitangent);
     const mat3 TBN = mat3(T, B, N);
     
 #ifdef BONE
@@ -84,7 +88,7 @@ void main() {
     BoneTransform = model * BoneTransform;
     
     vec4 bPos = BoneTransform * vec4(inPosition, 1.0);
-    vec4 bNor = BoneTransform * vec4(inNormal, 0.0);
+    vec4 bNor = BoneTransform * vec4(normal, 0.0);
     
     gl_Position = scene.vp * bPos;
     outFragPos = vec3(model * vec4(inPosition, 1.0));
@@ -99,7 +103,7 @@ void main() {
 #ifdef CUBEMAP
     gl_Position = scene.vp * view * model * vec4(inPosition, 1.0);
     outFragPos = vec3(model * vec4(inPosition, 1.0));
-    outNormal = mat3(model) * inNormal;
+    outNormal = mat3(model) * normal;
     outUV = inUV;
     fragPosLightSpace = (biasMat * scene.lightSpace * model) * vec4(inPosition, 1.0);
     
@@ -110,7 +114,7 @@ void main() {
     gl_Position = scene.vp * model * vec4(inPosition, 1.0);
     
     outFragPos = vec3(model * vec4(inPosition, 1.0));
-    outNormal = mat3(model) * inNormal;
+    outNormal = mat3(model) * normal;
     outUV = inUV;
     fragPosLightSpace = (biasMat * scene.lightSpace * model) * vec4(inPosition, 1.0);
     
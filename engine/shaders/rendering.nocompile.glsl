@@ -63,6 +63,28 @@ struct ComputedLightInformation {
     float radiance;
 };
 
+// the offset into light_grid and the number of point and spot lights in the cluster of this fragment
+uvec2 get_light_cluster() {
+    const vec4 clip = scene.vp * vec4(in_frag_pos, 1.0);
+    const ivec3 size = ivec3(scene.cluster_grid.xyz);
+    
+    const int x = clamp(int((clip.x / clip.w * 0.5 + 0.5) * size.x), 0, size.x - 1);
+    const int y = clamp(int((clip.y / clip.w * 0.5 + 0.5) * size.y), 0, size.y - 1);
+    const int z = clamp(int(log(clip.w) * scene.cluster_slices.x - scene.cluster_slices.y), 0, size.z - 1);
+    
+    const int cluster = (z * size.y + y) * size.x + x;
+    
+    return uvec2(light_grid[cluster * 2], light_grid[cluster * 2 + 1]);
+}
+
+// fades lights out smoothly before they reach the end of their range, so the edges of the clusters they're in don't show
+float range_falloff(const float distance, const float range) {
+    const float ratio = distance / range;
+    const float falloff = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    
+    return falloff * falloff;
+}
+
 float pcf_sun(const vec4 shadowCoords, const float uvRadius) {
     float sum = 0;
     for(int i = 0; i < 16; i++) {
@@ -186,27 +208,24 @@ float pcss_spot(const vec4 shadowCoords, const int index, float light_size_uv) {
 
 #endif
 
-int last_spot_light = 0;
-
 ComputedLightInformation calculate_spot(Light light) {
     ComputedLightInformation light_info;
     light_info.direction = normalize(light.positionType.xyz - in_frag_pos);
     
     float shadow = 1.0;
     if(light.shadowsEnable.x == 1.0) {
-        const vec4 shadowCoord = fragPostSpotLightSpace[last_spot_light] / fragPostSpotLightSpace[last_spot_light].w;
+        const int shadow_layer = int(light.shadowsEnable.z);
+        const vec4 shadowCoord = fragPostSpotLightSpace[shadow_layer] / fragPostSpotLightSpace[shadow_layer].w;
 
 #ifdef SHADOW_FILTER_NONE
-            shadow = (texture(spot_shadow, vec3(shadowCoord.xy, last_spot_light)).r < shadowCoord.z) ? 0.0 : 1.0;
+            shadow = (texture(spot_shadow, vec3(shadowCoord.xy, shadow_layer)).r < shadowCoord.z) ? 0.0 : 1.0;
 #endif
 #ifdef SHADOW_FILTER_PCF
-            shadow = pcf_spot(shadowCoord, last_spot_light, 0.01);
+            shadow = pcf_spot(shadowCoord, shadow_layer, 0.01);
 #endif
 #ifdef SHADOW_FILTER_PCSS
-            shadow = pcss_spot(shadowCoord, last_spot_light, light.shadowsEnable.y);
+            shadow = pcss_spot(shadowCoord, shadow_layer, light.shadowsEnable.y);
 #endif
-        
-        last_spot_light++;
     }
     
     const float inner_cutoff = light.colorSize.w + radians(5);
@@ -216,7 +235,9 @@ ComputedLightInformation calculate_spot(Light light) {
     const float epsilon = inner_cutoff - outer_cutoff;
     const float intensity = clamp((theta - outer_cutoff) / epsilon, 0.0, 1.0);
     
-    light_info.radiance = light.directionPower.w * shadow * intensity;
+    const float distance = length(light.positionType.xyz - in_frag_pos);
+    
+    light_info.radiance = light.directionPower.w * shadow * intensity * range_falloff(distance, light.shadowsEnable.w);
     
     return light_info;
 }
@@ -269,8 +290,6 @@ float pcss_point(const vec3 shadowCoords, const int index, float light_size_uv)
 
 #endif
 
-int last_point_light = 0;
-
 ComputedLightInformation calculate_point(Light light) {
     ComputedLightInformation light_info;
     light_info.direction = normalize(light.positionType.xyz - in_frag_pos);
@@ -281,23 +300,25 @@ ComputedLightInformation calculate_point(Light light) {
     float shadow = 1.0;
 #ifdef POINT_SHADOWS_SUPPORTED
     if(light.shadowsEnable.x == 1.0) {
+        const int shadow_layer = int(light.shadowsEnable.z);
+        
 #ifdef SHADOW_FILTER_NONE
-        const float sampledDist = texture(point_shadow, vec4(lightVec, last_point_light++)).r;
+        const float sampledDist = texture(point_shadow, vec4(lightVec, shadow_layer)).r;
         const float dist = length(lightVec);
         
         shadow = (dist <= sampledDist + 0.05) ? 1.0 : 0.0;
 #endif
 #ifdef SHADOW_FILTER_PCF
-        shadow = pcf_point(lightVec, last_point_light++, 1.0);
+        shadow = pcf_point(lightVec, shadow_layer, 1.0);
 #endif
 #ifdef SHADOW_FILTER_PCSS
-        shadow = pcss_point(lightVec, last_point_light++, light.shadowsEnable.y);
+        shadow = pcss_point(lightVec, shadow_layer, light.shadowsEnable.y);
 #endif
     }
 #endif
     
     const float distance = length(light.positionType.xyz - in_frag_pos);
-    const float attenuation = 1.0 / (distance * distance);
+    const float attenuation = range_falloff(distance, light.shadowsEnable.w) / (distance * distance);
     
     light_info.radiance = attenuation * light.directionPower.w * shadow;
     
@@ -2,8 +2,10 @@ layout (constant_id = 0) const int max_materials = 25;
 layout (constant_id = 1) const int max_lights = 25;
 layout (constant_id = 2) const int max_spot_lights = 4;
 
+#include "common.glsl"
+
 layout (location = 0) in vec3 inPosition;
-layout (location = 1) in vec3 inNormal;
+layout (location = 1) in vec2 inNormal; // octahedral encoded
 layout (location = 2) in vec2 inUV;
 
 layout (location = 0) out vec3 outFragPos;
@@ -47,7 +49,7 @@ const mat4 biasMat = mat4(
 void main() {
     gl_Position = scene.projection * view * model * vec4(inPosition, 1.0);
     outFragPos = vec3(model * vec4(inPosition, 1.0));
-    outNormal = mat3(model) * inNormal;
+    outNormal = mat3(model) * decode_octahedral(inNormal);
     outUV = inUV;
     outMaterialId = materialOffset;
     fragPosLightSpace = (biasMat * scene.lightSpace * model) * vec4(inPosition, 1.0);
@@ -11,7 +11,12 @@ layout (location = 0) out vec3 outPos;
 layout (location = 1) flat out int index;
 
 layout(push_constant, binding = 0) uniform PushConstant {
-    mat4 mvp, model;
+    mat4 light_matrix;
+    int light_index;
+};
+
+layout(std430, binding = 5) buffer readonly InstanceInformation {
+    mat4 instance_models[];
 };
 
 #ifdef BONE
@@ -25,6 +30,8 @@ layout(std430, binding = 2) buffer readonly LightInformation {
 };
 
 void main() {
+    const mat4 model = instance_models[gl_InstanceIndex];
+
 #ifdef BONE
     mat4 BoneTransform;
 
@@ -33,11 +40,11 @@ void main() {
     BoneTransform += bones[inBoneID[2]] * inBoneWeight[2];
     BoneTransform += bones[inBoneID[3]] * inBoneWeight[3];
     
-    gl_Position = mvp * BoneTransform * vec4(inPosition, 1.0);
+    gl_Position = light_matrix * model * BoneTransform * vec4(inPosition, 1.0);
     outPos = vec3(model * vec4(inPosition, 1.0));
 #else
-    gl_Position =  mvp * vec4(inPosition, 1.0);
+    gl_Position = light_matrix * model * vec4(inPosition, 1.0);
     outPos = vec3(model * vec4(inPosition, 1.0));    
 #endif
-    index = gl_BaseInstance;
+    index = light_index;
 }
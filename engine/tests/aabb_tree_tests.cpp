@@ -0,0 +1,177 @@
+#include <doctest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "aabb_tree.hpp"
+#include "random_scene.hpp"
+
+TEST_SUITE_BEGIN("AABB Tree");
+
+namespace {
+    struct test_object {
+        prism::aabb bounds;
+        int leaf = prism::aabb_tree::null_node;
+    };
+
+    // what the tree has to find, every object whose actual bounds overlap the query
+    std::vector<uint64_t> query_brute_force(const std::vector<test_object>& objects, const prism::aabb& query) {
+        std::vector<uint64_t> result;
+        for(size_t i = 0; i < objects.size(); i++) {
+            if(objects[i].leaf != prism::aabb_tree::null_node && prism::overlaps(objects[i].bounds, query))
+                result.push_back(i);
+        }
+
+        return result;
+    }
+
+    // the leaves are enlarged, so the tree can return objects that only overlap the query with their margin
+    std::vector<uint64_t> query_tree(const prism::aabb_tree& tree, const std::vector<test_object>& objects, const prism::aabb& query, prism::aabb_tree_statistics* statistics = nullptr) {
+        std::vector<uint64_t> result;
+        tree.query([&query](const prism::aabb& bounds) {
+            return prism::overlaps(bounds, query);
+        }, [&](const uint64_t user_data) {
+            if(prism::overlaps(objects[user_data].bounds, query))
+                result.push_back(user_data);
+        }, statistics);
+
+        std::sort(result.begin(), result.end());
+
+        return result;
+    }
+
+    // a balanced tree is at most about 1.44 log2(n) tall
+    int get_max_height(const size_t count) {
+        return static_cast<int>(std::ceil(1.44f * std::log2(static_cast<float>(count) + 2.0f)));
+    }
+}
+
+TEST_CASE("Empty") {
+    prism::aabb_tree tree;
+
+    int visited = 0;
+    prism::aabb_tree_statistics statistics;
+    tree.query([](const prism::aabb&) {
+        return true;
+    }, [&visited](uint64_t) {
+        visited++;
+    }, &statistics);
+
+    CHECK(visited == 0);
+    CHECK(tree.size() == 0);
+    CHECK(tree.get_height() == 0);
+    CHECK(statistics.nodes_tested == 0);
+}
+
+TEST_CASE("Leaves are enlarged") {
+    prism::aabb_tree tree(0.5f);
+
+    const int leaf = tree.insert({prism::float3(0.0f), prism::float3(1.0f)}, 7);
+
+    CHECK(tree.get_user_data(leaf) == 7);
+    CHECK((tree.get_bounds(leaf).min == prism::float3(-0.5f)));
+    CHECK((tree.get_bounds(leaf).max == prism::float3(1.5f)));
+
+    // small moves stay inside of the leaf
+    CHECK_FALSE(tree.update(leaf, {prism::float3(0.25f), prism::float3(1.25f)}));
+    CHECK((tree.get_bounds(leaf).min == prism::float3(-0.5f)));
+
+    CHECK(tree.update(leaf, {prism::float3(10.0f), prism::float3(11.0f)}));
+    CHECK((tree.get_bounds(leaf).min == prism::float3(9.5f)));
+    CHECK((tree.get_bounds(leaf).max == prism::float3(11.5f)));
+}
+
+TEST_CASE("Queries match brute force") {
+    uint32_t seed = 1234;
+
+    prism::aabb_tree tree;
+
+    std::vector<test_object> objects(1000);
+    for(size_t i = 0; i < objects.size(); i++) {
+        objects[i].bounds = random_box(seed);
+        objects[i].leaf = tree.insert(objects[i].bounds, i);
+    }
+
+    CHECK(tree.size() == objects.size());
+    CHECK(tree.get_height() <= get_max_height(objects.size()));
+
+    const auto check_queries = [&] {
+        for(int i = 0; i < 50; i++) {
+            prism::aabb query = random_box(seed);
+            query.min = query.min - prism::float3(20.0f);
+            query.max = query.max + prism::float3(20.0f);
+
+            CHECK(query_tree(tree, objects, query) == query_brute_force(objects, query));
+        }
+    };
+
+    check_queries();
+
+    // move everything, some only a little so they stay inside of their leaf
+    for(auto& object : objects) {
+        if(next_random(seed) % 2 == 0) {
+            const prism::float3 offset(random_float(seed, -0.05f, 0.05f));
+            object.bounds.min = object.bounds.min + offset;
+            object.bounds.max = object.bounds.max + offset;
+        } else {
+            object.bounds = random_box(seed);
+        }
+
+        tree.update(object.leaf, object.bounds);
+    }
+
+    CHECK(tree.get_height() <= get_max_height(objects.size()));
+
+    check_queries();
+
+    // removed leaves are reused by the next insertions
+    for(size_t i = 0; i < objects.size(); i += 3) {
+        tree.remove(objects[i].leaf);
+        objects[i].leaf = prism::aabb_tree::null_node;
+    }
+
+    check_queries();
+
+    for(size_t i = 0; i < objects.size(); i += 6) {
+        objects[i].bounds = random_box(seed);
+        objects[i].leaf = tree.insert(objects[i].bounds, i);
+    }
+
+    const auto remaining = std::count_if(objects.begin(), objects.end(), [](const test_object& object) {
+        return object.leaf != prism::aabb_tree::null_node;
+    });
+
+    CHECK(tree.size() == static_cast<size_t>(remaining));
+    CHECK(tree.get_height() <= get_max_height(tree.size()));
+
+    check_queries();
+}
+
+TEST_CASE("Queries skip what they don't overlap") {
+    uint32_t seed = 99;
+
+    prism::aabb_tree tree;
+
+    std::vector<test_object> objects(4096);
+    for(size_t i = 0; i < objects.size(); i++) {
+        objects[i].bounds = random_box(seed);
+        objects[i].leaf = tree.insert(objects[i].bounds, i);
+    }
+
+    const prism::aabb query = {prism::float3(-10.0f), prism::float3(10.0f)};
+
+    prism::aabb_tree_statistics statistics;
+    const auto result = query_tree(tree, objects, query, &statistics);
+
+    CHECK(result == query_brute_force(objects, query));
+
+    CHECK(statistics.objects_visible >= result.size());
+    CHECK(statistics.objects_visible + statistics.objects_culled == objects.size());
+
+    // only a small corner of the scene is queried, so most leaves are never reached
+    CHECK(statistics.objects_traversed < objects.size() / 4);
+    CHECK(statistics.nodes_tested < objects.size() / 2);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,177 @@
+#include <doctest.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "animation_format.hpp"
+
+TEST_SUITE_BEGIN("Animation Format");
+
+namespace {
+    Quaternion axis_angle(const prism::float3 axis, const float angle) {
+        const auto n = prism::normalize(axis);
+        const float s = std::sin(angle / 2.0f);
+
+        return Quaternion(n.x * s, n.y * s, n.z * s, std::cos(angle / 2.0f));
+    }
+
+    // samples the same way the engine does, holding the last key and interpolating between the others
+    template<typename Key, typename Interpolate>
+    auto sample(const std::vector<Key>& keys, const float time, Interpolate interpolate) {
+        size_t index = 0;
+        while(index + 1 < keys.size() && keys[index + 1].time <= time)
+            index++;
+
+        if(index + 1 >= keys.size() || time <= keys[index].time)
+            return keys[index].value;
+
+        const auto& start = keys[index];
+        const auto& end = keys[index + 1];
+
+        return interpolate(start.value, end.value, (time - start.time) / (end.time - start.time));
+    }
+
+    prism::float3 sample_vector(const std::vector<prism::vector_key>& keys, const float time) {
+        return sample(keys, time, [](const prism::float3 a, const prism::float3 b, const float t) {
+            return prism::lerp(a, b, t);
+        });
+    }
+
+    Quaternion sample_rotation(const std::vector<prism::rotation_key>& keys, const float time) {
+        return normalize(sample(keys, time, [](const Quaternion& a, const Quaternion& b, const float t) {
+            return lerp(a, b, t);
+        }));
+    }
+
+    // roughly what a 10 second mocap clip at 30 fps looks like: every key is baked, even where nothing moves
+    prism::animation_clip create_clip() {
+        prism::animation_clip clip;
+        clip.duration = 300.0;
+        clip.ticks_per_second = 30.0;
+
+        prism::animation_clip::channel root, arm, prop;
+        root.name = "root";
+        arm.name = "arm";
+        prop.name = "prop";
+
+        for(int i = 0; i <= 300; i++) {
+            const float time = static_cast<float>(i);
+            const float phase = time / 30.0f;
+
+            // walking forward while bobbing up and down
+            root.positions.push_back({time, prism::float3(phase * 1.5f, 0.05f * std::sin(phase * 12.0f), 0.0f)});
+            root.rotations.push_back({time, axis_angle(prism::float3(0, 1, 0), 0.2f * std::sin(phase * 2.0f))});
+            root.scales.push_back({time, prism::float3(1.0f, 1.0f, 1.0f)});
+
+            // swinging around an axis that drifts, with a flip through the other hemisphere
+            arm.positions.push_back({time, prism::float3(0.0f, 0.4f, 0.1f)});
+            arm.rotations.push_back({time, axis_angle(prism::float3(1.0f, std::sin(phase), 0.3f), 1.2f * std::sin(phase * 4.0f) + 3.0f)});
+            arm.scales.push_back({time, prism::float3(1.0f, 1.0f, 1.0f)});
+
+            // moves in a straight line and grows linearly, so everything between the first and last key can go
+            prop.positions.push_back({time, prism::float3(phase, -phase * 2.0f, 3.0f)});
+            prop.rotations.push_back({time, axis_angle(prism::float3(0, 0, 1), 0.0f)});
+            prop.scales.push_back({time, prism::float3(1.0f + phase * 0.1f, 1.0f, 1.0f)});
+        }
+
+        clip.channels = {root, arm, prop};
+
+        return clip;
+    }
+
+    size_t key_count(const prism::animation_clip::channel& channel) {
+        return channel.positions.size() + channel.rotations.size() + channel.scales.size();
+    }
+}
+
+TEST_CASE("Rotation quantization") {
+    float worst = 0.0f;
+    for(int i = 0; i < 1000; i++) {
+        const float f = static_cast<float>(i);
+        const auto rotation = axis_angle(prism::float3(std::sin(f), std::cos(f * 1.3f), std::sin(f * 0.7f) + 0.1f), f * 0.37f);
+
+        worst = std::max(worst, prism::rotation_difference(rotation, prism::dequantize_rotation(prism::quantize_rotation(rotation))));
+    }
+
+    MESSAGE("worst rotation quantization error = " << worst << " radians");
+
+    CHECK(worst < 0.0002f);
+
+    // q and -q are the same rotation
+    const auto rotation = axis_angle(prism::float3(0, 1, 0), 1.0f);
+    CHECK(prism::rotation_difference(rotation, rotation * -1.0f) == doctest::Approx(0.0f));
+}
+
+TEST_CASE("Compression error") {
+    const auto clip = create_clip();
+
+    const prism::animation_tolerance tolerance;
+    const auto data = prism::write_animation_file(prism::compress_animation(clip, tolerance));
+
+    REQUIRE(prism::is_compressed_animation(data.data(), data.size()));
+
+    const auto compressed = prism::read_animation_file(data.data(), data.size());
+    REQUIRE(compressed.has_value());
+
+    const auto result = prism::decompress_animation(*compressed);
+    REQUIRE(result.channels.size() == clip.channels.size());
+
+    CHECK(result.duration == clip.duration);
+    CHECK(result.ticks_per_second == clip.ticks_per_second);
+
+    size_t original_size = 0;
+    for(size_t c = 0; c < clip.channels.size(); c++) {
+        const auto& original = clip.channels[c];
+        const auto& channel = result.channels[c];
+
+        CHECK(channel.name == original.name);
+
+        float position_error = 0.0f, rotation_error = 0.0f, scale_error = 0.0f;
+        for(size_t i = 0; i < original.positions.size(); i++) {
+            const float time = original.positions[i].time;
+
+            position_error = std::max(position_error, prism::length(sample_vector(channel.positions, time) - original.positions[i].value));
+            rotation_error = std::max(rotation_error, prism::rotation_difference(sample_rotation(channel.rotations, time), normalize(original.rotations[i].value)));
+            scale_error = std::max(scale_error, prism::length(sample_vector(channel.scales, time) - original.scales[i].value));
+        }
+
+        MESSAGE(channel.name << ": " << key_count(original) << " -> " << key_count(channel) << " keys, errors " << position_error << ", " << rotation_error << ", " << scale_error);
+
+        // a little slack for float rounding while checking
+        CHECK(position_error <= tolerance.position * 1.01f);
+        CHECK(rotation_error <= tolerance.rotation * 1.01f);
+        CHECK(scale_error <= tolerance.scale * 1.01f);
+
+        CHECK(key_count(channel) < key_count(original));
+
+        original_size += sizeof(float) * 4 * original.positions.size() + sizeof(float) * 5 * original.rotations.size() + sizeof(float) * 4 * original.scales.size();
+    }
+
+    // constant tracks keep a single key, and straight lines only keep their ends
+    CHECK(result.channels[0].scales.size() == 1);
+    CHECK(result.channels[1].positions.size() == 1);
+    CHECK(result.channels[2].positions.size() == 2);
+    CHECK(result.channels[2].rotations.size() == 1);
+    CHECK(result.channels[2].scales.size() == 2);
+
+    MESSAGE("compressed " << original_size << " bytes of keys into " << data.size() << " bytes");
+
+    CHECK(data.size() * 4 < original_size);
+}
+
+TEST_CASE("Invalid animations") {
+    const auto data = prism::write_animation_file(prism::compress_animation(create_clip()));
+
+    // every truncation has to be caught, not read past the end
+    bool all_rejected = true;
+    for(size_t size = 0; size < data.size(); size++)
+        all_rejected &= !prism::read_animation_file(data.data(), size).has_value();
+
+    CHECK(all_rejected);
+
+    // older animations start with the duration instead
+    const double duration = 300.0;
+    CHECK_FALSE(prism::is_compressed_animation(reinterpret_cast<const std::byte*>(&duration), sizeof(double)));
+}
+
+TEST_SUITE_END();
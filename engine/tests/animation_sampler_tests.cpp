@@ -0,0 +1,172 @@
+#include <doctest.h>
+
+#include <cmath>
+
+#include "animation_sampler.hpp"
+#include "animation_format.hpp"
+
+TEST_SUITE_BEGIN("Animation Sampler");
+
+namespace {
+    // keys aren't evenly spaced, like after keyframe reduction
+    prism::animation_clip::channel create_channel(const int key_count) {
+        prism::animation_clip::channel channel;
+
+        float time = 0.0f;
+        for(int i = 0; i < key_count; i++) {
+            const float f = static_cast<float>(i);
+
+            channel.positions.push_back({time, prism::float3(f, std::sin(f), 0.0f)});
+            channel.rotations.push_back({time, normalize(Quaternion(0.0f, std::sin(f * 0.1f), 0.0f, std::cos(f * 0.1f)))});
+
+            time += 0.5f + static_cast<float>(i % 3);
+        }
+
+        return channel;
+    }
+
+    // the old way of finding a key, scanning every one of them
+    template<typename Key>
+    uint32_t scan_key(const std::vector<Key>& keys, const float time) {
+        uint32_t index = 0;
+        for(uint32_t i = 0; i < keys.size(); i++) {
+            if(time >= keys[i].time)
+                index = i;
+        }
+
+        return index;
+    }
+}
+
+TEST_CASE("Finding keys") {
+    const auto channel = create_channel(100);
+    const float end_time = channel.positions.back().time;
+
+    uint32_t cursor = 0;
+
+    bool matches = true;
+
+    // playing forward, including past the end
+    for(float time = -1.0f; time < end_time + 2.0f; time += 0.1f)
+        matches &= prism::find_key(channel.positions, time, cursor) == scan_key(channel.positions, time);
+
+    // playing backwards and seeking around
+    for(float time = end_time; time > 0.0f; time -= 0.7f)
+        matches &= prism::find_key(channel.positions, time, cursor) == scan_key(channel.positions, time);
+
+    for(int i = 0; i < 100; i++) {
+        const float time = std::fmod(static_cast<float>(i) * 37.3f, end_time);
+        matches &= prism::find_key(channel.positions, time, cursor) == scan_key(channel.positions, time);
+    }
+
+    CHECK(matches);
+
+    // an out of range cursor, like after switching to a shorter animation
+    cursor = 1000;
+    CHECK(prism::find_key(channel.positions, 0.0f, cursor) == 0);
+    CHECK(cursor == 0);
+
+    const std::vector<prism::vector_key> single = {{1.0f, prism::float3(1.0f)}};
+    CHECK(prism::find_key(single, 5.0f, cursor) == 0);
+}
+
+TEST_CASE("Sampling poses") {
+    std::vector<prism::animation_clip::channel> channels = {create_channel(50), create_channel(10)};
+
+    // a channel without rotation keys keeps whatever rotation its pose already had
+    channels[1].rotations.clear();
+    channels[1].scales.push_back({0.0f, prism::float3(2.0f)});
+
+    prism::animation_sampler<prism::animation_clip::channel> sampler;
+
+    std::vector<prism::transform_pose> poses(2);
+    poses[1].rotation = Quaternion(0.0f, 1.0f, 0.0f, 0.0f);
+
+    sampler.sample(channels, 1.25f, poses);
+
+    REQUIRE(poses.size() == 2);
+
+    // halfway between the second (t = 0.5) and third (t = 2) keys
+    CHECK(poses[0].position.x == doctest::Approx(1.5f));
+    CHECK(poses[0].scale.x == 1.0f);
+
+    CHECK(poses[1].rotation.y == 1.0f);
+    CHECK(poses[1].scale.y == 2.0f);
+
+    // before the first key and after the last key are held
+    sampler.sample(channels, -1.0f, poses);
+    CHECK(poses[0].position.x == 0.0f);
+
+    sampler.sample(channels, 10000.0f, poses);
+    CHECK(poses[0].position.x == 49.0f);
+
+    // nlerp stays close to slerp for keys this close together
+    prism::animation_sampler<prism::animation_clip::channel> nlerp_sampler;
+    nlerp_sampler.interpolation = prism::rotation_interpolation::nlerp;
+
+    std::vector<prism::transform_pose> nlerp_poses;
+
+    float worst = 0.0f;
+    for(float time = 0.0f; time < 50.0f; time += 0.25f) {
+        sampler.sample(channels, time, poses);
+        nlerp_sampler.sample(channels, time, nlerp_poses);
+
+        worst = std::max(worst, prism::rotation_difference(poses[0].rotation, nlerp_poses[0].rotation));
+    }
+
+    CHECK(worst < 0.001f);
+}
+
+TEST_CASE("Blending poses") {
+    const auto turn = [](const float angle) {
+        return Quaternion(0.0f, std::sin(angle / 2.0f), 0.0f, std::cos(angle / 2.0f));
+    };
+
+    prism::transform_pose a, b;
+    a.position = prism::float3(0.0f, 0.0f, 0.0f);
+    a.rotation = turn(0.0f);
+    b.position = prism::float3(2.0f, 0.0f, 0.0f);
+    b.rotation = turn(1.0f);
+    b.scale = prism::float3(3.0f);
+
+    auto result = a;
+    prism::blend_pose(result, b, 0.5f);
+
+    CHECK(result.position.x == doctest::Approx(1.0f));
+    CHECK(result.scale.x == doctest::Approx(2.0f));
+    CHECK(prism::rotation_difference(result.rotation, turn(0.5f)) < 0.001f);
+
+    // blending all the way replaces the pose
+    result = a;
+    prism::blend_pose(result, b, 1.0f);
+
+    CHECK(result.position.x == doctest::Approx(2.0f));
+    CHECK(prism::rotation_difference(result.rotation, b.rotation) < 0.001f);
+
+    // an additive pose only applies its difference from the reference
+    prism::transform_pose reference, additive;
+    reference.position = prism::float3(5.0f, 0.0f, 0.0f);
+    reference.rotation = turn(0.2f);
+    reference.scale = prism::float3(2.0f);
+
+    additive.position = prism::float3(5.0f, 1.0f, 0.0f);
+    additive.rotation = turn(0.7f);
+    additive.scale = prism::float3(4.0f);
+
+    result = b;
+    prism::add_pose(result, additive, reference, 1.0f);
+
+    CHECK(result.position.x == doctest::Approx(2.0f));
+    CHECK(result.position.y == doctest::Approx(1.0f));
+    CHECK(result.scale.x == doctest::Approx(6.0f));
+    CHECK(prism::rotation_difference(result.rotation, turn(1.5f)) < 0.001f);
+
+    // and a weight of 0 leaves it alone
+    result = b;
+    prism::add_pose(result, additive, reference, 0.0f);
+
+    CHECK(result.position.y == 0.0f);
+    CHECK(prism::rotation_difference(result.rotation, b.rotation) < 0.001f);
+}
+
+TEST_SUITE_END();
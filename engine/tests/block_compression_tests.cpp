@@ -0,0 +1,153 @@
+#include <doctest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "block_compression.hpp"
+
+TEST_SUITE_BEGIN("Block Compression");
+
+namespace {
+    constexpr uint32_t image_width = 256, image_height = 256;
+
+    // smooth gradients with some noise and hard edges, roughly what a photographed albedo map looks like
+    std::vector<uint8_t> generate_test_image() {
+        std::vector<uint8_t> image(image_width * image_height * 4);
+
+        uint32_t seed = 1234;
+        const auto noise = [&seed]() {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<int>((seed >> 24) % 17) - 8;
+        };
+
+        for(uint32_t y = 0; y < image_height; y++) {
+            for(uint32_t x = 0; x < image_width; x++) {
+                const bool edge = ((x / 32) + (y / 32)) % 2 == 0;
+                const int base[4] = {
+                    static_cast<int>(x),
+                    static_cast<int>(y),
+                    static_cast<int>(128 + 100 * std::sin(x * 0.05f) * std::cos(y * 0.05f)),
+                    static_cast<int>((x + y) / 2)
+                };
+
+                for(int c = 0; c < 4; c++) {
+                    const int value = base[c] + noise() + (edge && c < 3 ? 40 : 0);
+                    image[(y * image_width + x) * 4 + c] = static_cast<uint8_t>(std::clamp(value, 0, 255));
+                }
+            }
+        }
+
+        return image;
+    }
+
+    double calculate_psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, const int first_channel, const int channel_count) {
+        double squared_error = 0.0;
+        for(size_t i = 0; i < a.size(); i += 4) {
+            for(int c = first_channel; c < first_channel + channel_count; c++) {
+                const double d = static_cast<double>(a[i + c]) - static_cast<double>(b[i + c]);
+                squared_error += d * d;
+            }
+        }
+
+        const double mse = squared_error / (static_cast<double>(image_width) * image_height * channel_count);
+        if(mse == 0.0)
+            return 100.0;
+
+        return 10.0 * std::log10(255.0 * 255.0 / mse);
+    }
+
+    double round_trip_psnr(const prism::texture_format format, const int first_channel, const int channel_count) {
+        const auto image = generate_test_image();
+
+        std::vector<uint8_t> blocks(prism::calculate_level_size(format, image_width, image_height));
+        prism::compress_blocks(format, image.data(), image_width, image_height, blocks.data());
+
+        std::vector<uint8_t> decoded(image.size());
+        prism::decompress_blocks(format, blocks.data(), image_width, image_height, decoded.data());
+
+        const double psnr = calculate_psnr(image, decoded, first_channel, channel_count);
+        MESSAGE(prism::get_block_size(format) * 8 / 16 << " bpp, PSNR = " << psnr << " dB");
+
+        return psnr;
+    }
+}
+
+TEST_CASE("BC1 quality") {
+    CHECK(round_trip_psnr(prism::texture_format::bc1, 0, 3) > 32.0);
+}
+
+TEST_CASE("BC3 quality") {
+    CHECK(round_trip_psnr(prism::texture_format::bc3, 0, 4) > 32.0);
+}
+
+TEST_CASE("BC4 quality") {
+    CHECK(round_trip_psnr(prism::texture_format::bc4, 0, 1) > 38.0);
+}
+
+TEST_CASE("BC5 quality") {
+    CHECK(round_trip_psnr(prism::texture_format::bc5, 0, 2) > 38.0);
+}
+
+TEST_CASE("BC7 quality") {
+    CHECK(round_trip_psnr(prism::texture_format::bc7, 0, 4) > 34.0);
+
+    // bc7 spends twice the bits of bc1, so color should never come out worse
+    CHECK(round_trip_psnr(prism::texture_format::bc7, 0, 3) > round_trip_psnr(prism::texture_format::bc1, 0, 3));
+}
+
+TEST_CASE("Partial blocks") {
+    constexpr uint32_t width = 3, height = 2;
+
+    uint8_t pixels[width * height * 4];
+    for(uint32_t i = 0; i < width * height; i++) {
+        // two colors fit on a single line, so every format should reproduce them almost exactly
+        const uint8_t value = i % 2 == 0 ? 32 : 224;
+        pixels[i * 4 + 0] = value;
+        pixels[i * 4 + 1] = value;
+        pixels[i * 4 + 2] = value;
+        pixels[i * 4 + 3] = 255;
+    }
+
+    for(const auto format : {prism::texture_format::bc1, prism::texture_format::bc3, prism::texture_format::bc7}) {
+        REQUIRE(prism::calculate_level_size(format, width, height) == prism::get_block_size(format));
+
+        uint8_t block[16] = {};
+        prism::compress_blocks(format, pixels, width, height, block);
+
+        // the extra bytes catch any writes past the end of the image
+        uint8_t decoded[width * height * 4 + 4];
+        std::fill(std::begin(decoded), std::end(decoded), 0xCD);
+
+        prism::decompress_blocks(format, block, width, height, decoded);
+
+        for(uint32_t i = 0; i < width * height * 4; i++)
+            CHECK(std::abs(decoded[i] - pixels[i]) <= 8);
+
+        for(uint32_t i = width * height * 4; i < sizeof(decoded); i++)
+            CHECK(decoded[i] == 0xCD);
+    }
+}
+
+TEST_CASE("Encoder throughput") {
+    const auto image = generate_test_image();
+
+    for(const auto format : {prism::texture_format::bc1, prism::texture_format::bc4, prism::texture_format::bc5, prism::texture_format::bc7}) {
+        std::vector<uint8_t> blocks(prism::calculate_level_size(format, image_width, image_height));
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        prism::compress_blocks(format, image.data(), image_width, image_height, blocks.data());
+        const auto end = std::chrono::high_resolution_clock::now();
+
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        const double megapixels_per_second = (image_width * image_height) / 1000000.0 / std::max(seconds, 1e-9);
+
+        MESSAGE(static_cast<int>(format) << ": " << megapixels_per_second << " MPix/s");
+
+        // deliberately loose so unoptimized builds pass, this only catches pathological slowdowns
+        CHECK(megapixels_per_second > 0.05);
+    }
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,127 @@
+#include <doctest.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "gfx_commandbuffer.hpp"
+
+TEST_SUITE_BEGIN("Command Buffer");
+
+TEST_CASE("Command stream") {
+    GFXCommandBuffer command_buffer;
+    CHECK(command_buffer.empty());
+
+    auto pipeline = reinterpret_cast<GFXPipeline*>(0x10);
+    auto buffer = reinterpret_cast<GFXBuffer*>(0x20);
+
+    GFXRenderPassBeginInfo begin_info = {};
+    begin_info.clear_color.g = 0.5f;
+    begin_info.render_area = prism::Rectangle(1, 2, 3, 4);
+
+    // an odd size, so the command after it has to be realigned
+    const std::array<unsigned char, 13> push_bytes = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13};
+
+    command_buffer.set_render_pass(begin_info);
+    command_buffer.set_graphics_pipeline(pipeline);
+    command_buffer.set_push_constant(push_bytes.data(), push_bytes.size());
+    command_buffer.bind_shader_buffer(buffer, 64, 2, 128);
+    command_buffer.draw_indexed(36, 6, 3, 7, 9);
+    command_buffer.end_render_pass();
+
+    std::vector<GFXDrawCommand> commands(command_buffer.begin(), command_buffer.end());
+    REQUIRE(commands.size() == 6);
+
+    CHECK(commands[0].type == GFXCommandType::SetRenderPass);
+    CHECK(commands[0].set_render_pass().clear_color.g == 0.5f);
+    CHECK(commands[0].set_render_pass().render_area.extent.height == 4);
+
+    CHECK(commands[1].type == GFXCommandType::SetGraphicsPipeline);
+    CHECK(commands[1].set_graphics_pipeline().pipeline == pipeline);
+
+    CHECK(commands[2].type == GFXCommandType::SetPushConstant);
+    REQUIRE(commands[2].set_push_constant().size == push_bytes.size());
+    CHECK(std::equal(push_bytes.begin(), push_bytes.end(), commands[2].set_push_constant().bytes));
+
+    CHECK(commands[3].type == GFXCommandType::BindShaderBuffer);
+    CHECK(commands[3].bind_shader_buffer().buffer == buffer);
+    CHECK(commands[3].bind_shader_buffer().offset == 64);
+    CHECK(commands[3].bind_shader_buffer().size == 128);
+
+    CHECK(commands[4].type == GFXCommandType::DrawIndexed);
+    CHECK(commands[4].draw_indexed().index_count == 36);
+    CHECK(commands[4].draw_indexed().base_instance == 7);
+    CHECK(commands[4].draw_indexed().instance_count == 9);
+
+    CHECK(commands[5].type == GFXCommandType::EndRenderPass);
+
+    // payloads are read in place, so they must stay aligned
+    bool aligned = true;
+    for(const auto& command : commands)
+        aligned &= reinterpret_cast<uintptr_t>(command.payload) % alignof(void*) == 0;
+
+    CHECK(aligned);
+}
+
+TEST_CASE("Appending and reuse") {
+    GFXCommandBuffer first, second;
+
+    first.set_viewport(Viewport{0.0f, 0.0f, 100.0f, 50.0f});
+    second.draw(0, 3, 0, 1);
+    second.pop_group();
+
+    first.append(second);
+    CHECK(second.empty());
+
+    std::vector<GFXCommandType> types;
+    for(const auto command : first)
+        types.push_back(command.type);
+
+    CHECK(types == std::vector<GFXCommandType>{GFXCommandType::SetViewport, GFXCommandType::Draw, GFXCommandType::PopGroup});
+
+    // recording the same frame again after a reset reuses the arena instead of allocating
+    for(int i = 0; i < 1000; i++)
+        first.draw_indexed(3, 0, 0, i);
+
+    const auto arena = first.begin();
+
+    first.reset();
+    CHECK(first.empty());
+
+    for(int i = 0; i < 1000; i++)
+        first.draw_indexed(3, 0, 0, i);
+
+    CHECK(first.begin() == arena);
+    CHECK((*first.begin()).draw_indexed().base_instance == 0);
+}
+
+TEST_CASE("Texture copy layers") {
+    GFXCommandBuffer command_buffer;
+
+    auto depth = reinterpret_cast<GFXTexture*>(0x10);
+    auto spot_array = reinterpret_cast<GFXTexture*>(0x20);
+    auto point_array = reinterpret_cast<GFXTexture*>(0x30);
+
+    // into the second spot light, and back out of it
+    command_buffer.copy_array_texture(depth, 512, 512, spot_array, 1);
+    command_buffer.copy_array_texture(spot_array, 512, 512, depth, 0, 1);
+
+    // the third face of the second point light
+    command_buffer.copy_texture(depth, 512, 512, point_array, 2, 1, 0);
+
+    std::vector<GFXDrawCommand> commands(command_buffer.begin(), command_buffer.end());
+    REQUIRE(commands.size() == 3);
+
+    CHECK(commands[0].copy_texture().dst == spot_array);
+    CHECK(commands[0].copy_texture().get_to_array_layer() == 1);
+    CHECK(commands[0].copy_texture().get_from_array_layer() == 0);
+
+    CHECK(commands[1].copy_texture().src == spot_array);
+    CHECK(commands[1].copy_texture().get_from_array_layer() == 1);
+    CHECK(commands[1].copy_texture().get_to_array_layer() == 0);
+
+    CHECK(commands[2].copy_texture().get_to_array_layer() == 8);
+    CHECK(commands[2].copy_texture().get_from_array_layer() == 0);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,167 @@
+#include <doctest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "culling.hpp"
+#include "math.hpp"
+#include "transform.hpp"
+#include "random_scene.hpp"
+
+TEST_SUITE_BEGIN("Culling");
+
+namespace {
+    // a camera at the origin looking down -Z with a 90 degree field of view, the planes aren't normalized
+    prism::frustum_planes get_test_frustum() {
+        prism::frustum_planes planes;
+        planes[0] = {1.0f, 0.0f, -1.0f, 0.0f}; // left
+        planes[1] = {-1.0f, 0.0f, -1.0f, 0.0f}; // right
+        planes[2] = {0.0f, -1.0f, -1.0f, 0.0f}; // top
+        planes[3] = {0.0f, 1.0f, -1.0f, 0.0f}; // bottom
+        planes[4] = {0.0f, 0.0f, -1.0f, -0.1f}; // near
+        planes[5] = {0.0f, 0.0f, 1.0f, 100.0f}; // far
+
+        return planes;
+    }
+
+    // what the renderer used to do, a box is only culled if all 8 of its corners are behind the same plane
+    bool test_corners(const prism::frustum_planes& planes, const prism::aabb& aabb, const float epsilon, bool* ambiguous) {
+        bool visible = true;
+        for(const auto& plane : planes) {
+            float furthest = -INFINITY;
+            for(const auto point : prism::get_points(aabb))
+                furthest = std::max(furthest, distance_to_point(plane, point));
+
+            if(ambiguous != nullptr && std::abs(furthest) < epsilon)
+                *ambiguous = true;
+
+            if(furthest < 0.0f)
+                visible = false;
+        }
+
+        return visible;
+    }
+
+    prism::aabb transform_corners(const prism::aabb& aabb, const Matrix4x4& matrix) {
+        prism::aabb result = {prism::float3(INFINITY), prism::float3(-INFINITY)};
+        for(const auto point : prism::get_points(aabb)) {
+            const auto transformed = (matrix * prism::float4(point, 1.0f)).xyz;
+
+            result.min = prism::float3(std::min(result.min.x, transformed.x), std::min(result.min.y, transformed.y), std::min(result.min.z, transformed.z));
+            result.max = prism::float3(std::max(result.max.x, transformed.x), std::max(result.max.y, transformed.y), std::max(result.max.z, transformed.z));
+        }
+
+        return result;
+    }
+}
+
+TEST_CASE("Transformed bounds") {
+    uint32_t seed = 7;
+
+    for(int i = 0; i < 200; i++) {
+        const auto box = random_box(seed, 10.0f, 5.0f);
+
+        const prism::float3 axis = normalize(prism::float3(random_float(seed, -1.0f, 1.0f), random_float(seed, -1.0f, 1.0f), 0.5f));
+        const Quaternion rotation = angle_axis(random_float(seed, 0.0f, 6.28f), axis);
+
+        Matrix4x4 model = prism::translate(Matrix4x4(), prism::float3(random_float(seed, -50.0f, 50.0f), random_float(seed, -50.0f, 50.0f), random_float(seed, -50.0f, 50.0f)));
+        model *= matrix_from_quat(rotation);
+        model *= prism::scale(Matrix4x4(), prism::float3(random_float(seed, 0.5f, 3.0f), random_float(seed, 0.5f, 3.0f), random_float(seed, 0.5f, 3.0f)));
+
+        const auto result = prism::transform_aabb(box, model);
+        const auto expected = transform_corners(box, model);
+
+        for(int axis_index = 0; axis_index < 3; axis_index++) {
+            CHECK(result.min[axis_index] == doctest::Approx(expected.min[axis_index]).epsilon(0.001));
+            CHECK(result.max[axis_index] == doctest::Approx(expected.max[axis_index]).epsilon(0.001));
+        }
+    }
+}
+
+TEST_CASE("Batched tests match single tests") {
+    uint32_t seed = 42;
+
+    // some frustums that aren't axis aligned, with planes that aren't normalized
+    std::vector<prism::frustum_planes> frustums = {get_test_frustum()};
+    for(int i = 0; i < 4; i++) {
+        prism::frustum_planes planes;
+        for(auto& plane : planes)
+            plane = {random_float(seed, -2.0f, 2.0f), random_float(seed, -2.0f, 2.0f), random_float(seed, -2.0f, 2.0f), random_float(seed, -20.0f, 20.0f)};
+
+        frustums.push_back(planes);
+    }
+
+    // not a multiple of any batch size, so the leftovers are tested too
+    prism::aabb_soa bounds;
+    std::vector<prism::aabb> boxes;
+    for(int i = 0; i < 1003; i++) {
+        boxes.push_back(random_box(seed, 60.0f, 5.0f));
+        bounds.push_back(boxes.back());
+    }
+
+    std::vector<uint8_t> visible;
+    for(const auto& planes : frustums) {
+        prism::test_aabbs_planes(planes, bounds, visible);
+
+        REQUIRE(visible.size() == boxes.size());
+
+        int mismatches = 0, ambiguous_count = 0;
+        for(size_t i = 0; i < boxes.size(); i++) {
+            if(static_cast<bool>(visible[i]) != prism::test_aabb_planes(planes, boxes[i]))
+                mismatches++;
+
+            // rounding can tip boxes right on a plane either way, so those aren't compared against the corners
+            bool ambiguous = false;
+            const bool expected = test_corners(planes, boxes[i], 0.001f, &ambiguous);
+
+            if(ambiguous)
+                ambiguous_count++;
+            else if(static_cast<bool>(visible[i]) != expected)
+                mismatches++;
+        }
+
+        CHECK(mismatches == 0);
+        CHECK(ambiguous_count < 10);
+    }
+}
+
+TEST_CASE("Culling throughput") {
+    uint32_t seed = 1;
+
+    const auto planes = get_test_frustum();
+
+    std::vector<prism::aabb> boxes;
+    prism::aabb_soa bounds;
+    for(int i = 0; i < 100000; i++) {
+        boxes.push_back(random_box(seed, 100.0f, 5.0f));
+        bounds.push_back(boxes.back());
+    }
+
+    const auto start_corners = std::chrono::high_resolution_clock::now();
+
+    size_t visible_corners = 0;
+    for(const auto& box : boxes)
+        visible_corners += test_corners(planes, box, 0.0f, nullptr) ? 1 : 0;
+
+    const auto start_batched = std::chrono::high_resolution_clock::now();
+
+    std::vector<uint8_t> visible;
+    prism::test_aabbs_planes(planes, bounds, visible);
+
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    const size_t visible_batched = std::count(visible.begin(), visible.end(), 1);
+
+    const double corner_seconds = std::chrono::duration<double>(start_batched - start_corners).count();
+    const double batched_seconds = std::chrono::duration<double>(end - start_batched).count();
+
+    MESSAGE(boxes.size() << " boxes: " << corner_seconds * 1000.0 << " ms testing corners, " << batched_seconds * 1000.0 << " ms batched (" << corner_seconds / std::max(batched_seconds, 1e-9) << "x)");
+
+    // the timings are only reported, since they depend too much on the machine and whatever else it's running
+    // both can disagree on boxes touching a plane, but there shouldn't be many
+    CHECK(std::abs(static_cast<double>(visible_corners) - static_cast<double>(visible_batched)) < 10.0);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,116 @@
+#include <doctest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "light_clusters.hpp"
+#include "thread_pool.hpp"
+#include "transform.hpp"
+#include "math.hpp"
+#include "random_scene.hpp"
+
+TEST_SUITE_BEGIN("Light Clusters");
+
+namespace {
+    // finds the cluster of a view space point the same way the shaders do, from its clip space position
+    uint32_t find_cluster(const prism::light_clusters& clusters, const Matrix4x4& projection, const prism::float3 point) {
+        const auto clip = projection * prism::float4(point, 1.0f);
+
+        const auto clamp_cluster = [](const float value, const uint32_t size) {
+            return static_cast<uint32_t>(std::clamp(static_cast<int>(std::floor(value)), 0, static_cast<int>(size) - 1));
+        };
+
+        const uint32_t x = clamp_cluster((clip.x / clip.w * 0.5f + 0.5f) * static_cast<float>(clusters.get_size_x()), clusters.get_size_x());
+        const uint32_t y = clamp_cluster((clip.y / clip.w * 0.5f + 0.5f) * static_cast<float>(clusters.get_size_y()), clusters.get_size_y());
+        const uint32_t z = clamp_cluster(std::log(clip.w) * clusters.get_slice_scale() - clusters.get_slice_bias(), clusters.get_size_z());
+
+        return (z * clusters.get_size_y() + y) * clusters.get_size_x() + x;
+    }
+
+    bool cluster_contains(const prism::light_clusters& clusters, const uint32_t cluster, const uint32_t light) {
+        const auto& grid = clusters.get_grid();
+        const auto first = grid.begin() + grid[cluster * 2];
+
+        return std::find(first, first + grid[cluster * 2 + 1], light) != first + grid[cluster * 2 + 1];
+    }
+}
+
+TEST_CASE("Every light reaching a point is in its cluster") {
+    uint32_t seed = 3;
+
+    prism::thread_pool pool(2);
+
+    // the camera is at the origin looking down +Z, so view space is world space
+    const Matrix4x4 view;
+    const Matrix4x4 projection = prism::infinite_perspective(radians(75.0f), 16.0f / 9.0f, 0.1f);
+
+    std::vector<prism::float4> lights;
+    for(int i = 0; i < 500; i++)
+        lights.emplace_back(random_float(seed, -60.0f, 60.0f), random_float(seed, -40.0f, 40.0f), random_float(seed, -10.0f, 150.0f), random_float(seed, 0.5f, 8.0f));
+
+    prism::light_clusters clusters;
+    clusters.build(view, projection, 0.1f, 100.0f, lights, pool);
+
+    CHECK(clusters.get_grid().size() == prism::light_clusters::tiles_x * prism::light_clusters::tiles_y * prism::light_clusters::slices * 2 + clusters.get_assignment_count());
+
+    int missing = 0, tested = 0;
+    for(int i = 0; i < 20000; i++) {
+        // somewhere on screen, in front of the camera
+        const float depth = random_float(seed, 0.2f, 140.0f);
+        const prism::float3 point(random_float(seed, -1.0f, 1.0f) * depth / projection[0][0], random_float(seed, -1.0f, 1.0f) * depth / projection[1][1], depth);
+
+        const uint32_t cluster = find_cluster(clusters, projection, point);
+
+        for(uint32_t light = 0; light < lights.size(); light++) {
+            if(length(point - lights[light].xyz) < lights[light].w) {
+                tested++;
+
+                if(!cluster_contains(clusters, cluster, light))
+                    missing++;
+            }
+        }
+    }
+
+    CHECK(tested > 0);
+    CHECK(missing == 0);
+
+    // most lights are only in a few of the clusters
+    CHECK(clusters.get_assignment_count() < lights.size() * prism::light_clusters::tiles_x * prism::light_clusters::tiles_y * prism::light_clusters::slices / 20);
+    CHECK(clusters.get_max_cluster_lights() < lights.size());
+}
+
+TEST_CASE("Building again replaces the old lights") {
+    prism::thread_pool pool(2);
+
+    const Matrix4x4 view = prism::translate(Matrix4x4(), prism::float3(0.0f, 0.0f, 10.0f)); // the camera is at z = -10
+    const Matrix4x4 projection = prism::infinite_perspective(radians(90.0f), 1.0f, 0.1f);
+
+    prism::light_clusters clusters;
+    clusters.build(view, projection, 0.1f, 100.0f, {prism::float4(0.0f, 0.0f, 0.0f, 1.0f), prism::float4(0.0f, 0.0f, 20.0f, 1.0f)}, pool);
+
+    // the first light is 10 units in front of the camera, the second one 30
+    CHECK(cluster_contains(clusters, find_cluster(clusters, projection, prism::float3(0.0f, 0.0f, 10.0f)), 0));
+    CHECK_FALSE(cluster_contains(clusters, find_cluster(clusters, projection, prism::float3(0.0f, 0.0f, 10.0f)), 1));
+    CHECK(cluster_contains(clusters, find_cluster(clusters, projection, prism::float3(0.0f, 0.0f, 30.0f)), 1));
+    CHECK(clusters.get_assignment_count() > 0);
+
+    clusters.build(view, projection, 0.1f, 100.0f, {}, pool);
+
+    CHECK(clusters.get_assignment_count() == 0);
+    CHECK(clusters.get_max_cluster_lights() == 0);
+}
+
+TEST_CASE("A single cluster has every light") {
+    prism::light_clusters clusters;
+    clusters.build_single(3);
+
+    CHECK(clusters.get_size_x() == 1);
+    CHECK(clusters.get_size_y() == 1);
+    CHECK(clusters.get_size_z() == 1);
+
+    const std::vector<uint32_t> expected = {2, 3, 0, 1, 2};
+    CHECK(clusters.get_grid() == expected);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,97 @@
+#include <doctest.h>
+
+#include "material_format.hpp"
+
+TEST_SUITE_BEGIN("Material Format");
+
+namespace {
+    // a texture and a constant both connected to an output node
+    prism::material_file create_material() {
+        prism::material_file file;
+
+        prism::material_node output;
+        output.name = file.add_string("Material Output");
+        output.x = 100.0f;
+
+        prism::material_node texture;
+        texture.name = file.add_string("Texture");
+        texture.property_count = 1;
+
+        prism::material_property texture_property;
+        texture_property.texture = file.add_string("textures/brick.texture");
+
+        prism::material_node constant;
+        constant.name = file.add_string("Float Constant");
+        constant.property_count = 1;
+        constant.y = -50.0f;
+
+        prism::material_property constant_property;
+        constant_property.float_value = 0.75f;
+
+        file.nodes = {output, texture, constant};
+        file.properties = {texture_property, constant_property};
+        file.connections = {
+            {1, 0, 0, 0},
+            {2, 0, 0, 1}
+        };
+
+        return file;
+    }
+}
+
+TEST_CASE("Round trip") {
+    const auto original = create_material();
+    const auto data = prism::write_material_file(original);
+
+    REQUIRE(prism::is_binary_material(data.data(), data.size()));
+
+    const auto file = prism::read_material_file(data.data(), data.size());
+    REQUIRE(file.has_value());
+
+    REQUIRE(file->nodes.size() == 3);
+    CHECK(file->get_string(file->nodes[0].name) == "Material Output");
+    CHECK(file->get_string(file->nodes[1].name) == "Texture");
+    CHECK(file->get_string(file->nodes[2].name) == "Float Constant");
+    CHECK(file->nodes[0].x == 100.0f);
+    CHECK(file->nodes[2].y == -50.0f);
+
+    REQUIRE(file->properties.size() == 2);
+    CHECK(file->get_string(file->properties[0].texture) == "textures/brick.texture");
+    CHECK(file->get_string(file->properties[1].texture).empty());
+    CHECK(file->properties[1].float_value == 0.75f);
+
+    REQUIRE(file->connections.size() == 2);
+    CHECK(file->connections[1].output_node == 2);
+    CHECK(file->connections[1].input == 1);
+}
+
+TEST_CASE("Invalid data") {
+    const auto data = prism::write_material_file(create_material());
+
+    // JSON materials are told apart by the magic
+    const std::string json = "{\"version\": 2}";
+    CHECK_FALSE(prism::is_binary_material(reinterpret_cast<const std::byte*>(json.data()), json.size()));
+
+    // every truncation has to be caught, not read past the end
+    bool all_rejected = true;
+    for(size_t size = 0; size < data.size(); size++)
+        all_rejected &= !prism::read_material_file(data.data(), size).has_value();
+
+    CHECK(all_rejected);
+
+    // connections have to point at existing nodes
+    auto file = create_material();
+    file.connections[0].output_node = 3;
+
+    const auto bad_connection = prism::write_material_file(file);
+    CHECK_FALSE(prism::read_material_file(bad_connection.data(), bad_connection.size()).has_value());
+
+    // and properties have to add up
+    file = create_material();
+    file.nodes[1].property_count = 2;
+
+    const auto bad_properties = prism::write_material_file(file);
+    CHECK_FALSE(prism::read_material_file(bad_properties.data(), bad_properties.size()).has_value());
+}
+
+TEST_SUITE_END();
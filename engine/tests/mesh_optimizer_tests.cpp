@@ -0,0 +1,319 @@
+#include <doctest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "mesh_optimizer.hpp"
+#include "vertex_format.hpp"
+
+TEST_SUITE_BEGIN("Mesh Optimizer");
+
+namespace {
+    struct test_mesh {
+        std::vector<prism::float3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    uint32_t next_random(uint32_t& seed) {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 8;
+    }
+
+    // a flat square grid, every interior vertex can be removed without changing the surface
+    test_mesh generate_grid(const uint32_t size) {
+        test_mesh mesh;
+
+        for(uint32_t y = 0; y <= size; y++) {
+            for(uint32_t x = 0; x <= size; x++)
+                mesh.positions.emplace_back(static_cast<float>(x), 0.0f, static_cast<float>(y));
+        }
+
+        for(uint32_t y = 0; y < size; y++) {
+            for(uint32_t x = 0; x < size; x++) {
+                const uint32_t a = y * (size + 1) + x;
+                const uint32_t b = a + size + 1;
+
+                mesh.indices.insert(mesh.indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+            }
+        }
+
+        return mesh;
+    }
+
+    // a uv sphere with its triangles and vertices shuffled, roughly what an unoptimized exporter hands us
+    test_mesh generate_shuffled_sphere(const uint32_t rings, const uint32_t segments) {
+        test_mesh mesh;
+
+        for(uint32_t r = 0; r <= rings; r++) {
+            const float theta = static_cast<float>(r) / static_cast<float>(rings) * 3.14159265f;
+            for(uint32_t s = 0; s <= segments; s++) {
+                const float phi = static_cast<float>(s) / static_cast<float>(segments) * 2.0f * 3.14159265f;
+                mesh.positions.emplace_back(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            }
+        }
+
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for(uint32_t r = 0; r < rings; r++) {
+            for(uint32_t s = 0; s < segments; s++) {
+                const uint32_t a = r * (segments + 1) + s;
+                const uint32_t b = a + segments + 1;
+
+                triangles.push_back({a, b, a + 1});
+                triangles.push_back({a + 1, b, b + 1});
+            }
+        }
+
+        uint32_t seed = 42;
+        for(size_t i = triangles.size() - 1; i > 0; i--)
+            std::swap(triangles[i], triangles[next_random(seed) % (i + 1)]);
+
+        std::vector<uint32_t> permutation(mesh.positions.size());
+        for(uint32_t i = 0; i < permutation.size(); i++)
+            permutation[i] = i;
+
+        for(size_t i = permutation.size() - 1; i > 0; i--)
+            std::swap(permutation[i], permutation[next_random(seed) % (i + 1)]);
+
+        mesh.positions = prism::remap_vertices(mesh.positions, permutation);
+
+        for(const auto& triangle : triangles) {
+            for(const auto index : triangle)
+                mesh.indices.push_back(permutation[index]);
+        }
+
+        return mesh;
+    }
+
+    // triangles can be reordered and rotated, but never lost or flipped
+    std::vector<std::array<uint32_t, 3>> canonical_triangles(const std::vector<uint32_t>& indices) {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for(size_t i = 0; i < indices.size(); i += 3) {
+            std::array<uint32_t, 3> triangle = {indices[i], indices[i + 1], indices[i + 2]};
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+
+            triangles.push_back(triangle);
+        }
+
+        std::sort(triangles.begin(), triangles.end());
+
+        return triangles;
+    }
+}
+
+TEST_CASE("Cache statistics") {
+    // a single triangle always transforms all of its vertices
+    const auto single = prism::analyze_vertex_cache({0, 1, 2}, 3);
+    CHECK(single.acmr == doctest::Approx(3.0f));
+    CHECK(single.atvr == doctest::Approx(1.0f));
+
+    // a quad shares two vertices
+    const auto quad = prism::analyze_vertex_cache({0, 1, 2, 2, 1, 3}, 4);
+    CHECK(quad.acmr == doctest::Approx(2.0f));
+    CHECK(quad.atvr == doctest::Approx(1.0f));
+}
+
+TEST_CASE("Optimization pipeline") {
+    const auto mesh = generate_shuffled_sphere(48, 96);
+    const auto vertex_count = static_cast<uint32_t>(mesh.positions.size());
+    const uint32_t vertex_size = sizeof(prism::packed_vertex);
+
+    const auto cache_before = prism::analyze_vertex_cache(mesh.indices, vertex_count);
+    const auto fetch_before = prism::analyze_vertex_fetch(mesh.indices, vertex_count, vertex_size);
+
+    auto indices = prism::optimize_vertex_cache(mesh.indices, vertex_count);
+    const auto cache_optimized = prism::analyze_vertex_cache(indices, vertex_count);
+
+    indices = prism::optimize_overdraw(indices, mesh.positions, 1.05f);
+    const auto overdraw_optimized = prism::analyze_vertex_cache(indices, vertex_count);
+
+    const auto remap = prism::optimize_vertex_fetch_remap(indices, vertex_count);
+    indices = prism::remap_indices(indices, remap);
+    const auto positions = prism::remap_vertices(mesh.positions, remap);
+
+    const auto cache_after = prism::analyze_vertex_cache(indices, vertex_count);
+    const auto fetch_after = prism::analyze_vertex_fetch(indices, vertex_count, vertex_size);
+
+    MESSAGE("ACMR " << cache_before.acmr << " -> " << cache_optimized.acmr << " (cache) -> " << overdraw_optimized.acmr << " (overdraw)");
+    MESSAGE("ATVR " << cache_before.atvr << " -> " << cache_after.atvr);
+    MESSAGE("Overfetch " << fetch_before.overfetch << " -> " << fetch_after.overfetch);
+
+    CHECK(cache_optimized.acmr < 0.8f);
+    CHECK(cache_optimized.atvr < 1.6f);
+    CHECK(cache_optimized.acmr < cache_before.acmr / 2.0f);
+
+    // the overdraw pass is allowed to give back a little of the cache efficiency, but not much
+    CHECK(overdraw_optimized.acmr <= cache_optimized.acmr * 1.1f);
+
+    // remapping vertices doesn't change what the post-transform cache sees
+    CHECK(cache_after.acmr == doctest::Approx(overdraw_optimized.acmr));
+
+    // vertices transformed more than once are fetched more than once too, so this can't get far below the atvr
+    CHECK(fetch_after.overfetch < 2.0f);
+    CHECK(fetch_after.overfetch < fetch_before.overfetch);
+
+    // the result still has to be the same mesh
+    REQUIRE(indices.size() == mesh.indices.size());
+
+    std::vector<uint32_t> original_indices = mesh.indices;
+    for(auto& index : original_indices)
+        index = remap[index];
+
+    CHECK(canonical_triangles(indices) == canonical_triangles(original_indices));
+
+    bool positions_match = true;
+    for(uint32_t i = 0; i < vertex_count; i++)
+        positions_match &= positions[remap[i]] == mesh.positions[i];
+
+    CHECK(positions_match);
+}
+
+TEST_CASE("Fetch remap") {
+    // vertex 3 is never referenced, so it ends up last
+    const auto remap = prism::optimize_vertex_fetch_remap({4, 2, 0, 0, 2, 1}, 5);
+
+    CHECK(remap == std::vector<uint32_t>{2, 3, 1, 4, 0});
+}
+
+TEST_CASE("Simplification") {
+    SUBCASE("Flat grid") {
+        const auto grid = generate_grid(32);
+
+        float error = 1.0f;
+        const auto indices = prism::simplify(grid.indices, grid.positions, 0, 0.001f, &error);
+
+        MESSAGE("Grid simplified from " << grid.indices.size() / 3 << " to " << indices.size() / 3 << " triangles");
+
+        // only the border is locked, which still needs a fan of triangles to cover the inside
+        CHECK(indices.size() < grid.indices.size() / 4);
+        CHECK(error < 0.001f);
+
+        // nothing was flipped over
+        bool facing_up = true;
+        for(size_t i = 0; i < indices.size(); i += 3) {
+            const auto& a = grid.positions[indices[i]];
+            const auto n = prism::cross(grid.positions[indices[i + 1]] - a, grid.positions[indices[i + 2]] - a);
+
+            facing_up &= n.y > 0.0f;
+        }
+
+        CHECK(facing_up);
+    }
+
+    SUBCASE("Sphere") {
+        const auto sphere = generate_shuffled_sphere(48, 96);
+        const size_t target = sphere.indices.size() / 4;
+
+        float error = 0.0f;
+        const auto indices = prism::simplify(sphere.indices, sphere.positions, target, 0.05f, &error);
+
+        MESSAGE("Sphere simplified from " << sphere.indices.size() / 3 << " to " << indices.size() / 3 << " triangles, error " << error);
+
+        CHECK(indices.size() <= target);
+        CHECK(indices.size() % 3 == 0);
+        CHECK(error > 0.0f);
+        CHECK(error <= 0.05f);
+
+        // a tiny error budget barely allows anything on a curved surface
+        float tight_error = 0.0f;
+        const auto tight = prism::simplify(sphere.indices, sphere.positions, 0, 0.0001f, &tight_error);
+
+        CHECK(tight.size() > sphere.indices.size() / 2);
+        CHECK(tight_error <= 0.0001f);
+    }
+}
+
+TEST_CASE("Meshlets") {
+    const auto sphere = generate_shuffled_sphere(48, 96);
+    auto indices = prism::optimize_vertex_cache(sphere.indices, static_cast<uint32_t>(sphere.positions.size()));
+    const auto original_triangles = canonical_triangles(indices);
+
+    const auto meshlets = prism::build_meshlets(indices, sphere.positions);
+    REQUIRE(!meshlets.empty());
+
+    MESSAGE(meshlets.size() << " meshlets for " << indices.size() / 3 << " triangles");
+
+    // the meshlets cover every triangle exactly once, in order
+    uint32_t next_index = 0;
+    bool within_limits = true, within_bounds = true;
+    for(const auto& meshlet : meshlets) {
+        CHECK(meshlet.index_offset == next_index);
+        next_index = meshlet.index_offset + meshlet.index_count;
+
+        std::vector<uint32_t> vertices(indices.begin() + meshlet.index_offset, indices.begin() + next_index);
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+        within_limits &= vertices.size() <= prism::max_meshlet_vertices && meshlet.index_count / 3 <= prism::max_meshlet_triangles;
+
+        for(const auto v : vertices)
+            within_bounds &= prism::length(sphere.positions[v] - meshlet.center) <= meshlet.radius + 0.0001f;
+    }
+
+    CHECK(next_index == indices.size());
+    CHECK(canonical_triangles(indices) == original_triangles);
+    CHECK(within_limits);
+    CHECK(within_bounds);
+
+    // culled meshlets must not have a single triangle facing the camera
+    const prism::float3 camera_position(5.0f, 1.0f, 0.0f);
+
+    size_t culled = 0;
+    bool conservative = true;
+    for(const auto& meshlet : meshlets) {
+        if(!prism::is_meshlet_backfacing(meshlet, camera_position))
+            continue;
+
+        culled++;
+
+        for(uint32_t i = meshlet.index_offset; i < meshlet.index_offset + meshlet.index_count; i += 3) {
+            const auto& a = sphere.positions[indices[i]];
+            const auto n = prism::cross(sphere.positions[indices[i + 1]] - a, sphere.positions[indices[i + 2]] - a);
+
+            conservative &= prism::dot(n, a - camera_position) >= 0.0f;
+        }
+    }
+
+    MESSAGE(culled << " meshlets are backfacing");
+
+    CHECK(conservative);
+
+    // about half of a sphere faces away, a good chunk of that should be caught
+    CHECK(culled > meshlets.size() / 4);
+}
+
+TEST_CASE("Meshlet overdraw") {
+    const auto sphere = generate_shuffled_sphere(48, 96);
+    auto indices = prism::optimize_vertex_cache(sphere.indices, static_cast<uint32_t>(sphere.positions.size()));
+
+    auto meshlets = prism::build_meshlets(indices, sphere.positions);
+
+    const auto original_indices = indices;
+    const auto original_meshlets = meshlets;
+
+    prism::optimize_meshlet_overdraw(indices, meshlets, sphere.positions);
+
+    REQUIRE(meshlets.size() == original_meshlets.size());
+    CHECK(canonical_triangles(indices) == canonical_triangles(original_indices));
+
+    // whole meshlets move, but the triangles inside of them keep the order they were built with
+    uint32_t next_index = 0;
+    bool kept_order = true;
+    for(const auto& meshlet : meshlets) {
+        CHECK(meshlet.index_offset == next_index);
+        next_index = meshlet.index_offset + meshlet.index_count;
+
+        const auto original = std::find_if(original_meshlets.begin(), original_meshlets.end(), [&meshlet](const prism::meshlet& other) {
+            return other.center == meshlet.center && other.index_count == meshlet.index_count;
+        });
+        REQUIRE(original != original_meshlets.end());
+
+        kept_order &= std::equal(indices.begin() + meshlet.index_offset, indices.begin() + next_index, original_indices.begin() + original->index_offset);
+    }
+
+    CHECK(next_index == indices.size());
+    CHECK(kept_order);
+}
+
+TEST_SUITE_END();
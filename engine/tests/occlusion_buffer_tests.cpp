@@ -0,0 +1,215 @@
+#include <doctest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "occlusion_buffer.hpp"
+#include "thread_pool.hpp"
+#include "transform.hpp"
+#include "math.hpp"
+#include "random_scene.hpp"
+
+TEST_SUITE_BEGIN("Occlusion Buffer");
+
+namespace {
+    struct test_occluder {
+        std::vector<prism::float3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    // the camera is at the origin looking down +Z
+    Matrix4x4 get_projection() {
+        return prism::perspective(radians(90.0f), 1.0f, 0.1f, 100.0f);
+    }
+
+    test_occluder make_quad(const prism::float3 a, const prism::float3 b, const prism::float3 c, const prism::float3 d) {
+        test_occluder quad;
+        quad.positions = {a, b, c, d};
+        quad.indices = {0, 1, 2, 0, 2, 3};
+
+        return quad;
+    }
+
+    prism::aabb make_box(const prism::float3 center, const float extent) {
+        return {center - prism::float3(extent), center + prism::float3(extent)};
+    }
+
+    // Möller-Trumbore, returns the distance along the ray or a negative value if it misses
+    float intersect_triangle(const prism::float3 origin, const prism::float3 direction, const prism::float3 a, const prism::float3 b, const prism::float3 c) {
+        const auto edge1 = b - a;
+        const auto edge2 = c - a;
+
+        const auto p = cross(direction, edge2);
+        const float determinant = dot(edge1, p);
+        if(std::abs(determinant) < 1e-8f)
+            return -1.0f;
+
+        const auto t = origin - a;
+        const float u = dot(t, p) / determinant;
+        if(u < 0.0f || u > 1.0f)
+            return -1.0f;
+
+        const auto q = cross(t, edge1);
+        const float v = dot(direction, q) / determinant;
+        if(v < 0.0f || u + v > 1.0f)
+            return -1.0f;
+
+        return dot(edge2, q) / determinant;
+    }
+
+    // true if a ray from the camera reaches any of the sample points on the surface of the box, only counting the ones in the 90 degree field of view
+    bool is_visible_by_rays(const std::vector<test_occluder>& occluders, const prism::aabb& box) {
+        constexpr int samples = 6;
+
+        for(int face = 0; face < 6; face++) {
+            const int axis = face / 2;
+            for(int i = 0; i <= samples; i++) {
+                for(int j = 0; j <= samples; j++) {
+                    prism::float3 point;
+                    point[axis] = face % 2 == 0 ? box.min[axis] : box.max[axis];
+                    point[(axis + 1) % 3] = box.min[(axis + 1) % 3] + (box.max[(axis + 1) % 3] - box.min[(axis + 1) % 3]) * static_cast<float>(i) / samples;
+                    point[(axis + 2) % 3] = box.min[(axis + 2) % 3] + (box.max[(axis + 2) % 3] - box.min[(axis + 2) % 3]) * static_cast<float>(j) / samples;
+
+                    if(std::abs(point.x) > point.z || std::abs(point.y) > point.z)
+                        continue;
+
+                    const float distance = length(point);
+                    const auto direction = point / distance;
+
+                    bool blocked = false;
+                    for(const auto& occluder : occluders) {
+                        for(size_t k = 0; k < occluder.indices.size() && !blocked; k += 3) {
+                            const float hit = intersect_triangle(prism::float3(0.0f), direction, occluder.positions[occluder.indices[k]], occluder.positions[occluder.indices[k + 1]], occluder.positions[occluder.indices[k + 2]]);
+                            blocked = hit > 0.0f && hit < distance;
+                        }
+                    }
+
+                    if(!blocked)
+                        return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void rasterize_all(prism::occlusion_buffer& buffer) {
+        for(uint32_t tile = 0; tile < buffer.get_tile_count(); tile++)
+            buffer.rasterize_tile(tile);
+    }
+}
+
+TEST_CASE("Size is rounded up to whole tiles") {
+    prism::occlusion_buffer buffer;
+    buffer.resize(100, 50);
+
+    CHECK(buffer.get_width() == 128);
+    CHECK(buffer.get_height() == 64);
+    CHECK(buffer.get_tile_count() == 8);
+}
+
+TEST_CASE("Nothing is hidden without occluders") {
+    prism::occlusion_buffer buffer;
+    buffer.resize(64, 64);
+
+    rasterize_all(buffer);
+
+    CHECK(buffer.is_visible(get_projection(), make_box(prism::float3(0.0f, 0.0f, 10.0f), 1.0f)));
+}
+
+TEST_CASE("Walls hide what's behind them") {
+    prism::occlusion_buffer buffer;
+    buffer.resize(128, 128);
+
+    const auto wall = make_quad(prism::float3(-5.0f, -5.0f, 10.0f), prism::float3(5.0f, -5.0f, 10.0f), prism::float3(5.0f, 5.0f, 10.0f), prism::float3(-5.0f, 5.0f, 10.0f));
+
+    buffer.add_occluder(get_projection(), wall.positions, wall.indices);
+    rasterize_all(buffer);
+
+    CHECK(buffer.get_triangle_count() == 2);
+
+    CHECK_FALSE(buffer.is_visible(get_projection(), make_box(prism::float3(0.0f, 0.0f, 20.0f), 1.0f)));
+
+    // in front of the wall, poking through it, and beside it
+    CHECK(buffer.is_visible(get_projection(), make_box(prism::float3(0.0f, 0.0f, 5.0f), 1.0f)));
+    CHECK(buffer.is_visible(get_projection(), make_box(prism::float3(0.0f, 0.0f, 10.0f), 1.0f)));
+    CHECK(buffer.is_visible(get_projection(), make_box(prism::float3(12.0f, 0.0f, 20.0f), 1.0f)));
+
+    // partially behind the edge of the wall
+    CHECK(buffer.is_visible(get_projection(), make_box(prism::float3(10.0f, 0.0f, 20.0f), 1.0f)));
+
+    // crossing the camera plane
+    CHECK(buffer.is_visible(get_projection(), make_box(prism::float3(0.0f, 0.0f, 0.0f), 1.0f)));
+}
+
+TEST_CASE("Occluders crossing the camera plane are clipped") {
+    prism::occlusion_buffer buffer;
+    buffer.resize(128, 128);
+
+    // a wall to the right of the camera, running from behind it into the distance
+    const auto wall = make_quad(prism::float3(1.0f, -50.0f, -10.0f), prism::float3(1.0f, -50.0f, 90.0f), prism::float3(1.0f, 50.0f, 90.0f), prism::float3(1.0f, 50.0f, -10.0f));
+
+    buffer.add_occluder(get_projection(), wall.positions, wall.indices);
+    rasterize_all(buffer);
+
+    CHECK_FALSE(buffer.is_visible(get_projection(), make_box(prism::float3(4.0f, 0.0f, 6.0f), 0.5f)));
+    CHECK(buffer.is_visible(get_projection(), make_box(prism::float3(-4.0f, 0.0f, 6.0f), 0.5f)));
+}
+
+TEST_CASE("Occluders in front of the near plane are clipped away") {
+    prism::occlusion_buffer buffer;
+    buffer.resize(128, 128);
+    buffer.set_near_plane(0.1f);
+
+    // closer than the projection's near plane, so it's never drawn and can't hide anything either
+    const auto wall = make_quad(prism::float3(-1.0f, -1.0f, 0.05f), prism::float3(1.0f, -1.0f, 0.05f), prism::float3(1.0f, 1.0f, 0.05f), prism::float3(-1.0f, 1.0f, 0.05f));
+
+    buffer.add_occluder(get_projection(), wall.positions, wall.indices);
+    rasterize_all(buffer);
+
+    CHECK(buffer.get_triangle_count() == 0);
+    CHECK(buffer.is_visible(get_projection(), make_box(prism::float3(0.0f, 0.0f, 10.0f), 1.0f)));
+}
+
+TEST_CASE("Hidden boxes are never visible to rays") {
+    uint32_t seed = 5;
+
+    prism::occlusion_buffer buffer;
+    buffer.resize(256, 256);
+
+    prism::thread_pool pool(2);
+
+    for(int scene = 0; scene < 4; scene++) {
+        std::vector<test_occluder> occluders;
+        for(int i = 0; i < 6; i++) {
+            const prism::float3 center(random_float(seed, -15.0f, 15.0f), random_float(seed, -15.0f, 15.0f), random_float(seed, 5.0f, 30.0f));
+            const float width = random_float(seed, 2.0f, 10.0f), height = random_float(seed, 2.0f, 10.0f), slant = random_float(seed, -5.0f, 5.0f);
+
+            occluders.push_back(make_quad(center + prism::float3(-width, -height, -slant), center + prism::float3(width, -height, slant),
+                                          center + prism::float3(width, height, slant), center + prism::float3(-width, height, -slant)));
+        }
+
+        buffer.clear();
+        for(const auto& occluder : occluders)
+            buffer.add_occluder(get_projection(), occluder.positions, occluder.indices);
+
+        buffer.rasterize(pool);
+
+        int hidden = 0, wrongly_hidden = 0;
+        for(int i = 0; i < 300; i++) {
+            const auto box = make_box(prism::float3(random_float(seed, -30.0f, 30.0f), random_float(seed, -30.0f, 30.0f), random_float(seed, 10.0f, 60.0f)), random_float(seed, 0.2f, 2.0f));
+
+            if(!buffer.is_visible(get_projection(), box)) {
+                hidden++;
+
+                if(is_visible_by_rays(occluders, box))
+                    wrongly_hidden++;
+            }
+        }
+
+        CHECK(hidden > 0);
+        CHECK(wrongly_hidden == 0);
+    }
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+#include "aabb.hpp"
+
+// a small LCG instead of <random>, so the generated scenes are the same on every platform
+
+inline uint32_t next_random(uint32_t& seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+inline float random_float(uint32_t& seed, const float min, const float max) {
+    return min + (max - min) * static_cast<float>(next_random(seed) % 10000) / 10000.0f;
+}
+
+/// A box somewhere in [-range, range] on every axis, with a half extent of at least 0.1 and at most max_extent.
+inline prism::aabb random_box(uint32_t& seed, const float range = 100.0f, const float max_extent = 3.0f) {
+    const prism::float3 center(random_float(seed, -range, range), random_float(seed, -range, range), random_float(seed, -range, range));
+    const prism::float3 extent(random_float(seed, 0.1f, max_extent), random_float(seed, 0.1f, max_extent), random_float(seed, 0.1f, max_extent));
+
+    return {center - extent, center + extent};
+}
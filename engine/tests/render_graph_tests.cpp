@@ -0,0 +1,220 @@
+#include <doctest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "render_graph.hpp"
+#include "gfx_commandbuffer.hpp"
+#include "gfx_texture.hpp"
+#include "gfx_framebuffer.hpp"
+
+TEST_SUITE_BEGIN("Render Graph");
+
+namespace {
+    // only keeps track of what the graph creates, nothing is ever drawn
+    class stub_gfx : public GFX {
+    public:
+        GFXTexture* create_texture(const GFXTextureCreateInfo& info) override {
+            auto texture = std::make_unique<GFXTexture>();
+            texture->width = static_cast<int>(info.width);
+            texture->height = static_cast<int>(info.height);
+
+            return textures.emplace_back(std::move(texture)).get();
+        }
+
+        void destroy_texture(GFXTexture*) override {
+            destroyed_textures++;
+        }
+
+        GFXFramebuffer* create_framebuffer(const GFXFramebufferCreateInfo&) override {
+            return framebuffers.emplace_back(std::make_unique<GFXFramebuffer>()).get();
+        }
+
+        std::vector<std::unique_ptr<GFXTexture>> textures;
+        std::vector<std::unique_ptr<GFXFramebuffer>> framebuffers;
+        int destroyed_textures = 0;
+    };
+
+    prism::render_texture_desc color_desc() {
+        prism::render_texture_desc desc;
+        desc.label = "Color";
+        desc.extent = {64, 32};
+        desc.format = GFXPixelFormat::RGBA8_UNORM;
+
+        return desc;
+    }
+
+    // records the name of every pass that's executed, in order
+    prism::render_graph::execute_function record_name(std::vector<std::string>& executed, const std::string& name) {
+        return [&executed, name](GFXCommandBuffer*, prism::render_graph&) {
+            executed.push_back(name);
+        };
+    }
+}
+
+TEST_CASE("Culled passes") {
+    stub_gfx gfx;
+    prism::render_graph graph;
+    std::vector<std::string> executed;
+
+    const auto unread = graph.create_texture(color_desc());
+    const auto chain_first = graph.create_texture(color_desc());
+    const auto chain_second = graph.create_texture(color_desc());
+    const auto scene = graph.create_texture(color_desc());
+
+    // nothing reads this
+    graph.add_pass("Unread", [unread](prism::render_graph_builder& builder) {
+        builder.write(unread);
+    }, record_name(executed, "Unread"));
+
+    // only read by a pass that gets culled itself, so both go
+    graph.add_pass("Chain First", [chain_first](prism::render_graph_builder& builder) {
+        builder.write(chain_first);
+    }, record_name(executed, "Chain First"));
+
+    graph.add_pass("Chain Second", [chain_first, chain_second](prism::render_graph_builder& builder) {
+        builder.read(chain_first);
+        builder.write(chain_second);
+    }, record_name(executed, "Chain Second"));
+
+    graph.add_pass("Scene", [scene](prism::render_graph_builder& builder) {
+        builder.write(scene);
+    }, record_name(executed, "Scene"));
+
+    graph.add_pass("Present", [scene](prism::render_graph_builder& builder) {
+        builder.read(scene);
+        builder.set_side_effect();
+    }, record_name(executed, "Present"));
+
+    graph.compile(&gfx);
+
+    CHECK(graph.statistics.passes == 2);
+    CHECK(graph.statistics.culled_passes == 3);
+
+    // textures only used by culled passes are never allocated
+    CHECK(graph.statistics.transient_textures == 1);
+    CHECK(gfx.textures.size() == 1);
+
+    GFXCommandBuffer command_buffer;
+    graph.execute(&command_buffer);
+
+    CHECK(executed == std::vector<std::string>{"Scene", "Present"});
+}
+
+TEST_CASE("Transient aliasing") {
+    stub_gfx gfx;
+    prism::render_graph graph;
+
+    prism::render_texture first, second, third;
+    GFXTexture* first_handle = nullptr;
+    GFXTexture* third_handle = nullptr;
+
+    const auto build = [&] {
+        graph.reset();
+
+        first = graph.create_texture(color_desc());
+        second = graph.create_texture(color_desc());
+        third = graph.create_texture(color_desc());
+
+        graph.add_pass("First", [&](prism::render_graph_builder& builder) {
+            builder.write(first);
+        }, [](GFXCommandBuffer*, prism::render_graph&) {});
+
+        graph.add_pass("Second", [&](prism::render_graph_builder& builder) {
+            builder.read(first);
+            builder.write(second);
+        }, [](GFXCommandBuffer*, prism::render_graph&) {});
+
+        // first is done by now, so third can take its place
+        graph.add_pass("Third", [&](prism::render_graph_builder& builder) {
+            builder.read(second);
+            builder.write(third);
+        }, [](GFXCommandBuffer*, prism::render_graph&) {});
+
+        graph.add_pass("Present", [&](prism::render_graph_builder& builder) {
+            builder.read(third);
+            builder.set_side_effect();
+        }, [&](GFXCommandBuffer*, prism::render_graph& executing) {
+            first_handle = executing.get_texture(first);
+            third_handle = executing.get_texture(third);
+        });
+
+        graph.compile(&gfx);
+
+        GFXCommandBuffer command_buffer;
+        graph.execute(&command_buffer);
+    };
+
+    build();
+
+    CHECK(graph.statistics.transient_textures == 3);
+    CHECK(graph.statistics.allocated_textures == 2);
+    CHECK(graph.statistics.peak_memory < graph.statistics.unaliased_memory);
+    CHECK(gfx.textures.size() == 2);
+
+    REQUIRE(first_handle != nullptr);
+    CHECK(first_handle == third_handle);
+    CHECK(graph.get_texture(second) != first_handle);
+
+    // the same graph next frame reuses the allocations instead of creating more
+    build();
+
+    CHECK(gfx.textures.size() == 2);
+    CHECK(gfx.destroyed_textures == 0);
+}
+
+TEST_CASE("Barriers between write and read") {
+    stub_gfx gfx;
+    prism::render_graph graph;
+
+    const auto storage = graph.create_texture(color_desc());
+    const auto attachment = graph.create_texture(color_desc());
+
+    graph.add_pass("Compute", [storage](prism::render_graph_builder& builder) {
+        builder.write(storage, prism::texture_access::storage);
+    }, [](GFXCommandBuffer*, prism::render_graph&) {});
+
+    graph.add_pass("Draw", [attachment](prism::render_graph_builder& builder) {
+        builder.write(attachment);
+    }, [](GFXCommandBuffer*, prism::render_graph&) {});
+
+    graph.add_pass("Sample Attachment", [attachment](prism::render_graph_builder& builder) {
+        builder.read(attachment);
+        builder.set_side_effect();
+    }, [](GFXCommandBuffer*, prism::render_graph&) {});
+
+    graph.add_pass("Sample Storage", [storage](prism::render_graph_builder& builder) {
+        builder.read(storage);
+        builder.read(storage); // reading again the same way doesn't need anything
+        builder.set_side_effect();
+    }, [](GFXCommandBuffer*, prism::render_graph&) {});
+
+    graph.compile(&gfx);
+
+    // both reads need a transition, but render passes already finish attachment writes so only storage needs a barrier
+    CHECK(graph.statistics.transitions == 2);
+    CHECK(graph.statistics.barriers == 1);
+
+    GFXCommandBuffer command_buffer;
+    graph.execute(&command_buffer);
+
+    // the barrier goes right before the group of the pass that reads, and nowhere else
+    std::vector<std::string_view> barriers_before;
+    bool barrier_pending = false;
+    for(const auto& command : command_buffer) {
+        if(command.type == GFXCommandType::MemoryBarrier)
+            barrier_pending = true;
+
+        if(command.type == GFXCommandType::PushGroup) {
+            if(barrier_pending)
+                barriers_before.push_back(command.push_group().name);
+
+            barrier_pending = false;
+        }
+    }
+
+    CHECK(barriers_before == std::vector<std::string_view>{"Sample Storage"});
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,57 @@
+#include <doctest.h>
+
+#include <algorithm>
+
+#include "skeleton.hpp"
+
+TEST_SUITE_BEGIN("Skeleton");
+
+namespace {
+    bool parents_first(const std::vector<int>& parents, const std::vector<uint32_t>& order) {
+        std::vector<size_t> position(parents.size());
+        for(size_t i = 0; i < order.size(); i++)
+            position[order[i]] = i;
+
+        for(size_t i = 0; i < parents.size(); i++) {
+            if(parents[i] != -1 && position[parents[i]] > position[i])
+                return false;
+        }
+
+        return true;
+    }
+}
+
+TEST_CASE("Hierarchy order") {
+    // children listed before their parents, like bones exported in an arbitrary order
+    const std::vector<int> parents = {3, 3, 4, -1, 3, 2, -1, 6};
+
+    const auto order = prism::sort_bone_hierarchy(parents);
+    REQUIRE(order.size() == parents.size());
+
+    auto sorted = order;
+    std::sort(sorted.begin(), sorted.end());
+    CHECK(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+
+    CHECK(parents_first(parents, order));
+
+    // a long chain, the worst case for scanning for children
+    std::vector<int> chain(500);
+    for(int i = 0; i < 500; i++)
+        chain[i] = i == 499 ? -1 : i + 1;
+
+    CHECK(parents_first(chain, prism::sort_bone_hierarchy(chain)));
+
+    // a broken cycle still includes every bone once
+    const auto cyclic = prism::sort_bone_hierarchy({1, 0, -1});
+    CHECK(cyclic.size() == 3);
+}
+
+TEST_CASE("Bone remap") {
+    const std::vector<std::string> body = {"root", "spine", "head", "arm.l", "arm.r"};
+    const std::vector<std::string> shirt = {"spine", "arm.r", "cloth", "arm.l"};
+
+    CHECK(prism::create_bone_remap(shirt, body) == std::vector<int>{1, 4, -1, 3});
+    CHECK(prism::create_bone_remap({}, body).empty());
+}
+
+TEST_SUITE_END();
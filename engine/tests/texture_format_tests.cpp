@@ -0,0 +1,92 @@
+#include <doctest.h>
+
+#include <utility>
+#include <vector>
+
+#include "texture_format.hpp"
+
+TEST_SUITE_BEGIN("Texture Format");
+
+namespace {
+    // an 8x8 bc1 texture with every level right after the level table
+    struct cooked_texture {
+        prism::texture_header header;
+        std::vector<prism::texture_level> levels;
+        uint64_t file_size = 0;
+    };
+
+    cooked_texture create_texture() {
+        cooked_texture texture;
+        texture.header.format = prism::texture_format::bc1;
+        texture.header.width = 8;
+        texture.header.height = 8;
+        texture.header.mip_count = prism::calculate_mip_count(8, 8);
+
+        texture.file_size = sizeof(prism::texture_header) + sizeof(prism::texture_level) * texture.header.mip_count;
+        for(uint32_t i = 0; i < texture.header.mip_count; i++) {
+            prism::texture_level level;
+            level.offset = texture.file_size;
+            level.size = prism::calculate_level_size(texture.header.format, prism::calculate_mip_extent(8, i), prism::calculate_mip_extent(8, i));
+
+            texture.levels.push_back(level);
+            texture.file_size += level.size;
+        }
+
+        return texture;
+    }
+}
+
+TEST_CASE("Valid levels") {
+    const auto texture = create_texture();
+
+    CHECK(prism::is_valid_texture_header(texture.header));
+    CHECK(prism::are_valid_texture_levels(texture.header, texture.levels.data(), texture.file_size));
+}
+
+TEST_CASE("Invalid headers") {
+    auto texture = create_texture();
+    texture.header.mip_count = 64;
+
+    CHECK_FALSE(prism::is_valid_texture_header(texture.header));
+
+    texture = create_texture();
+    texture.header.format = static_cast<prism::texture_format>(100);
+
+    CHECK_FALSE(prism::is_valid_texture_header(texture.header));
+}
+
+TEST_CASE("Levels outside of the file") {
+    auto texture = create_texture();
+
+    // every truncation cuts off at least part of the last level
+    bool all_rejected = true;
+    for(uint64_t size = 0; size < texture.file_size; size++)
+        all_rejected &= !prism::are_valid_texture_levels(texture.header, texture.levels.data(), size);
+
+    CHECK(all_rejected);
+
+    // sizes that would wrap around when added to the offset
+    texture.levels[1].size = UINT64_MAX;
+    CHECK_FALSE(prism::are_valid_texture_levels(texture.header, texture.levels.data(), texture.file_size));
+
+    texture = create_texture();
+    texture.levels[0].offset = UINT64_MAX - 2;
+    CHECK_FALSE(prism::are_valid_texture_levels(texture.header, texture.levels.data(), texture.file_size));
+
+    // pointing back into the level table
+    texture = create_texture();
+    texture.levels[0].offset = 0;
+    CHECK_FALSE(prism::are_valid_texture_levels(texture.header, texture.levels.data(), texture.file_size));
+
+    // too small to decode
+    texture = create_texture();
+    texture.levels[0].size--;
+    CHECK_FALSE(prism::are_valid_texture_levels(texture.header, texture.levels.data(), texture.file_size));
+
+    // out of order, later levels are read relative to the first one
+    texture = create_texture();
+    std::swap(texture.levels[0], texture.levels[1]);
+    CHECK_FALSE(prism::are_valid_texture_levels(texture.header, texture.levels.data(), texture.file_size));
+}
+
+TEST_SUITE_END();
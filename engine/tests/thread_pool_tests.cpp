@@ -0,0 +1,95 @@
+#include <doctest.h>
+
+#include <atomic>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+TEST_SUITE_BEGIN("Thread Pool");
+
+TEST_CASE("Running jobs") {
+    prism::thread_pool pool(4);
+    CHECK(pool.get_thread_count() == 4);
+    
+    std::atomic<int> sum = 0;
+    for(int i = 1; i <= 1000; i++) {
+        pool.submit([&sum, i] {
+            sum += i;
+        });
+    }
+    
+    pool.wait();
+    
+    CHECK(sum == 500500);
+    
+    // jobs can queue more jobs, wait() covers those too
+    std::atomic<int> nested = 0;
+    for(int i = 0; i < 10; i++) {
+        pool.submit([&pool, &nested] {
+            for(int j = 0; j < 10; j++)
+                pool.submit([&nested] { nested++; });
+        });
+    }
+    
+    pool.wait();
+    
+    CHECK(nested == 100);
+}
+
+TEST_CASE("Parallel for") {
+    prism::thread_pool pool(3);
+    
+    std::vector<int> values(1000, 0);
+    pool.parallel_for(static_cast<uint32_t>(values.size()), [&values](const uint32_t i) {
+        values[i] = static_cast<int>(i) * 2;
+    });
+    
+    bool all_written = true;
+    for(size_t i = 0; i < values.size(); i++)
+        all_written &= values[i] == static_cast<int>(i) * 2;
+    
+    CHECK(all_written);
+    
+    // the calling thread makes progress on its own, even if every worker is stuck behind another job
+    std::atomic<bool> release = false;
+    for(uint32_t i = 0; i < pool.get_thread_count(); i++) {
+        pool.submit([&release] {
+            while(!release)
+                std::this_thread::yield();
+        });
+    }
+    
+    std::atomic<int> count = 0;
+    pool.parallel_for(100, [&count](uint32_t) {
+        count++;
+    });
+    
+    CHECK(count == 100);
+    
+    release = true;
+    pool.wait();
+    
+    // and it can be nested inside of a job
+    std::atomic<int> nested = 0;
+    pool.parallel_for(4, [&pool, &nested](uint32_t) {
+        pool.parallel_for(25, [&nested](uint32_t) {
+            nested++;
+        });
+    });
+    
+    CHECK(nested == 100);
+}
+
+TEST_CASE("Finishing on destruction") {
+    std::atomic<int> count = 0;
+    
+    {
+        prism::thread_pool pool(2);
+        for(int i = 0; i < 100; i++)
+            pool.submit([&count] { count++; });
+    }
+    
+    CHECK(count == 100);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,95 @@
+#include <doctest.h>
+
+#include <cmath>
+#include <limits>
+
+#include "vertex_format.hpp"
+
+TEST_SUITE_BEGIN("Vertex Format");
+
+namespace {
+    // deterministic points spread over the whole sphere, including the poles and the folded lower hemisphere
+    prism::float3 sphere_point(const int i, const int count) {
+        const float z = 1.0f - 2.0f * (static_cast<float>(i) + 0.5f) / static_cast<float>(count);
+        const float radius = std::sqrt(1.0f - z * z);
+        const float phi = static_cast<float>(i) * 2.39996323f;
+
+        return prism::float3(radius * std::cos(phi), radius * std::sin(phi), z);
+    }
+}
+
+TEST_CASE("Half floats") {
+    for(const float value : {0.0f, 1.0f, -2.0f, 0.5f, 0.25f, 65504.0f, -65504.0f, 6.103515625e-05f})
+        CHECK(prism::half_to_float(prism::float_to_half(value)) == value);
+
+    // smallest subnormal
+    CHECK(prism::half_to_float(prism::float_to_half(5.9604645e-08f)) == 5.9604645e-08f);
+
+    CHECK(std::isinf(prism::half_to_float(prism::float_to_half(100000.0f))));
+    CHECK(std::isnan(prism::half_to_float(prism::float_to_half(std::numeric_limits<float>::quiet_NaN()))));
+
+    // texture coordinates are usually in [0, 1] but can tile a few times
+    for(int i = 0; i <= 1000; i++) {
+        const float value = -4.0f + 8.0f * static_cast<float>(i) / 1000.0f;
+        const float result = prism::half_to_float(prism::float_to_half(value));
+
+        CHECK(std::abs(result - value) <= std::max(std::abs(value), 6.103515625e-05f) / 2048.0f);
+    }
+}
+
+TEST_CASE("Octahedral encoding") {
+    constexpr int count = 2000;
+    for(int i = 0; i < count; i++) {
+        const auto v = sphere_point(i, count);
+        const auto encoded = prism::encode_octahedral(v);
+
+        CHECK(std::abs(encoded.x) <= 1.0f);
+        CHECK(std::abs(encoded.y) <= 1.0f);
+        CHECK(prism::dot(prism::decode_octahedral(encoded), v) > 0.99999f);
+    }
+
+    // degenerate vectors shouldn't produce NaN
+    const auto zero = prism::decode_octahedral(prism::encode_octahedral(prism::float3(0.0f, 0.0f, 0.0f)));
+    CHECK(zero.z == doctest::Approx(1.0f));
+}
+
+TEST_CASE("Packed vertices") {
+    constexpr int count = 2000;
+
+    float worst_normal = 1.0f, worst_tangent = 1.0f;
+    for(int i = 0; i < count; i++) {
+        const auto normal = sphere_point(i, count);
+
+        // any vector perpendicular to the normal works as a tangent
+        const auto helper = std::abs(normal.x) < 0.9f ? prism::float3(1.0f, 0.0f, 0.0f) : prism::float3(0.0f, 1.0f, 0.0f);
+        const auto tangent = prism::normalize(prism::cross(helper, normal));
+
+        const bool flipped = i % 2 == 0;
+        const auto bitangent = prism::cross(normal, tangent) * (flipped ? -1.0f : 1.0f);
+
+        const auto packed = prism::pack_vertex(normal, prism::float2(0.25f, 3.5f), tangent, bitangent);
+
+        prism::float3 unpacked_normal, unpacked_tangent, unpacked_bitangent;
+        prism::float2 unpacked_texture_coord;
+        prism::unpack_vertex(packed, unpacked_normal, unpacked_texture_coord, unpacked_tangent, unpacked_bitangent);
+
+        worst_normal = std::min(worst_normal, prism::dot(unpacked_normal, normal));
+        worst_tangent = std::min(worst_tangent, prism::dot(unpacked_tangent, tangent));
+
+        CHECK(unpacked_texture_coord.x == 0.25f);
+        CHECK(unpacked_texture_coord.y == 3.5f);
+
+        // the handedness has to survive, otherwise normal mapping is mirrored
+        CHECK(prism::dot(unpacked_bitangent, bitangent) > 0.99f);
+    }
+
+    MESSAGE("worst normal dot = " << worst_normal << ", worst tangent dot = " << worst_tangent);
+
+    CHECK(worst_normal > 0.99999f);
+    CHECK(worst_tangent > 0.9999f);
+
+    // normal, texture coordinate, tangent and bitangent used to be 11 floats
+    CHECK(sizeof(prism::packed_vertex) * 3 < sizeof(float) * 11);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "vector.hpp"
+#include "quaternion.hpp"
+
+/*
+ Compressed animations (.anim) start with animation_magic, older files without it are uncompressed keyframes. They're laid out as:
+
+ animation_header
+ char[header.string_size], null terminated channel names
+ for each channel:
+    animation_channel_header
+    float[position_count] times, quantized_key[position_count]
+    float[rotation_count] times, quantized_key[rotation_count]
+    float[scale_count] times, quantized_key[scale_count]
+
+ Keys that can be interpolated from their neighbours within a tolerance are removed. Rotations are stored as the smallest
+ three components (15 bits each, plus 2 bits for which one was dropped) and positions and scales are quantized to 16 bits
+ within the range of each channel.
+ */
+namespace prism {
+    constexpr std::array<char, 4> animation_magic = {'P', 'A', 'N', 'M'};
+    constexpr uint32_t animation_version = 1;
+
+    using quantized_key = std::array<uint16_t, 3>;
+
+    struct animation_header {
+        std::array<char, 4> magic = animation_magic;
+        uint32_t version = animation_version;
+        uint32_t channel_count = 0;
+        uint32_t string_size = 0;
+        double duration = 0.0, ticks_per_second = 0.0;
+    };
+
+    struct animation_channel_header {
+        uint32_t name = 0; // offset into the string table
+        uint32_t position_count = 0, rotation_count = 0, scale_count = 0;
+        float3 position_min, position_extent;
+        float3 scale_min, scale_extent;
+    };
+
+    struct vector_key {
+        float time = 0.0f;
+        float3 value;
+    };
+
+    struct rotation_key {
+        float time = 0.0f;
+        Quaternion value;
+    };
+
+    /// Uncompressed keyframes, what the model compiler gets from the source file.
+    struct animation_clip {
+        struct channel {
+            std::string name;
+            std::vector<vector_key> positions;
+            std::vector<rotation_key> rotations;
+            std::vector<vector_key> scales;
+        };
+
+        double duration = 0.0, ticks_per_second = 0.0;
+        std::vector<channel> channels;
+    };
+
+    struct compressed_animation {
+        struct channel {
+            std::string name;
+
+            float3 position_min, position_extent;
+            float3 scale_min, scale_extent;
+
+            std::vector<float> position_times, rotation_times, scale_times;
+            std::vector<quantized_key> positions, rotations, scales;
+        };
+
+        double duration = 0.0, ticks_per_second = 0.0;
+        std::vector<channel> channels;
+    };
+
+    /// The furthest a reduced channel may stray from the original keys. These can't go below the quantization error.
+    struct animation_tolerance {
+        float position = 0.001f; // in model units
+        float rotation = 0.0005f; // in radians
+        float scale = 0.001f;
+    };
+
+    quantized_key quantize_rotation(const Quaternion& rotation);
+    Quaternion dequantize_rotation(const quantized_key& key);
+
+    quantized_key quantize_vector(float3 value, float3 min, float3 extent);
+    float3 dequantize_vector(const quantized_key& key, float3 min, float3 extent);
+
+    /// The angle between two rotations in radians, this is accurate even for tiny differences.
+    float rotation_difference(const Quaternion& a, const Quaternion& b);
+
+    compressed_animation compress_animation(const animation_clip& clip, const animation_tolerance& tolerance = {});
+    animation_clip decompress_animation(const compressed_animation& animation);
+
+    /// Returns true if the data starts with a compressed animation header, regardless of the version.
+    bool is_compressed_animation(const std::byte* data, size_t size);
+
+    std::vector<std::byte> write_animation_file(const compressed_animation& animation);
+
+    /// Returns std::nullopt if the header doesn't match, or if any count or offset is out of range for the data.
+    std::optional<compressed_animation> read_animation_file(const std::byte* data, size_t size);
+}
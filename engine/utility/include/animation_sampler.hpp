@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "vector.hpp"
+#include "quaternion.hpp"
+
+namespace prism {
+    struct transform_pose {
+        float3 position;
+        Quaternion rotation;
+        float3 scale = float3(1.0f);
+    };
+
+    enum class rotation_interpolation {
+        slerp,
+        nlerp // cheaper, but doesn't keep a constant angular velocity between keys that are far apart
+    };
+
+    /** Finds the last key at or before time, or the first key if time is before every key. Keys must be sorted by time.
+     @param cursor The key found last time, which is checked first along with the one after it. Playing forward is O(1) amortized this way, and anything else (seeking, looping, playing backwards) falls back to a binary search.
+     */
+    template<typename Key>
+    uint32_t find_key(const std::vector<Key>& keys, const float time, uint32_t& cursor) {
+        const auto count = static_cast<uint32_t>(keys.size());
+
+        const auto contains = [&keys, count, time](const uint32_t index) {
+            return (index == 0 || keys[index].time <= time) && (index + 1 >= count || time < keys[index + 1].time);
+        };
+
+        if(cursor < count && contains(cursor))
+            return cursor;
+
+        if(cursor + 1 < count && contains(cursor + 1))
+            return ++cursor;
+
+        const auto next = std::upper_bound(keys.begin(), keys.end(), time, [](const float time, const Key& key) {
+            return time < key.time;
+        });
+
+        cursor = next == keys.begin() ? 0 : static_cast<uint32_t>(next - keys.begin() - 1);
+
+        return cursor;
+    }
+
+    inline Quaternion nlerp(const Quaternion& a, const Quaternion& b, const float t) {
+        const float sign = dot(a, b) < 0.0f ? -1.0f : 1.0f;
+
+        return normalize(Quaternion(a.x + (b.x * sign - a.x) * t,
+                                    a.y + (b.y * sign - a.y) * t,
+                                    a.z + (b.z * sign - a.z) * t,
+                                    a.w + (b.w * sign - a.w) * t));
+    }
+
+    /// Moves result towards pose, a weight of 0 leaves result as is and 1 replaces it.
+    inline void blend_pose(transform_pose& result, const transform_pose& pose, const float weight) {
+        result.position = lerp(result.position, pose.position, weight);
+        result.rotation = nlerp(result.rotation, pose.rotation, weight);
+        result.scale = lerp(result.scale, pose.scale, weight);
+    }
+
+    /// Adds how far pose has moved from reference on top of result, scaled by weight. Rotations are added in the bone's local space.
+    inline void add_pose(transform_pose& result, const transform_pose& pose, const transform_pose& reference, const float weight) {
+        result.position += (pose.position - reference.position) * weight;
+
+        const Quaternion inverse_reference(-reference.rotation.x, -reference.rotation.y, -reference.rotation.z, reference.rotation.w);
+        result.rotation = normalize(result.rotation * nlerp(Quaternion(), inverse_reference * pose.rotation, weight));
+
+        for(int i = 0; i < 3; i++) {
+            if(reference.scale[i] != 0.0f)
+                result.scale[i] *= 1.0f + (pose.scale[i] / reference.scale[i] - 1.0f) * weight;
+        }
+    }
+
+    /** Samples every channel of an animation into a pose buffer, one pose per channel in the same order.
+     Each channel keeps a cursor into its keys, so the sampler should be kept around for as long as the animation plays.
+     Channels can be any type with positions, rotations and scales, where each key has a time and a value.
+     */
+    template<typename Channel>
+    class animation_sampler {
+    public:
+        rotation_interpolation interpolation = rotation_interpolation::slerp;
+
+        /// Channel tracks without any keys leave that part of their pose untouched.
+        void sample(const std::vector<Channel>& channels, const float time, std::vector<transform_pose>& poses) {
+            cursors.resize(channels.size());
+            poses.resize(channels.size());
+
+            for(size_t i = 0; i < channels.size(); i++) {
+                const auto& channel = channels[i];
+                auto& cursor = cursors[i];
+                auto& pose = poses[i];
+
+                if(!channel.positions.empty())
+                    pose.position = sample_track(channel.positions, time, cursor.position, lerp_vector);
+
+                if(!channel.rotations.empty()) {
+                    if(interpolation == rotation_interpolation::slerp) {
+                        pose.rotation = sample_track(channel.rotations, time, cursor.rotation, slerp_rotation);
+                    } else {
+                        pose.rotation = sample_track(channel.rotations, time, cursor.rotation, nlerp);
+                    }
+                }
+
+                if(!channel.scales.empty())
+                    pose.scale = sample_track(channel.scales, time, cursor.scale, lerp_vector);
+            }
+        }
+
+        /// Forgets every cursor, only needed if the channels change order. Seeking within the same channels is handled already.
+        void reset() {
+            cursors.clear();
+        }
+
+    private:
+        struct channel_cursor {
+            uint32_t position = 0, rotation = 0, scale = 0;
+        };
+
+        std::vector<channel_cursor> cursors;
+
+        static float3 lerp_vector(const float3 a, const float3 b, const float t) {
+            return lerp(a, b, t);
+        }
+
+        static Quaternion slerp_rotation(const Quaternion& a, const Quaternion& b, const float t) {
+            return lerp(a, b, t);
+        }
+
+        template<typename Key, typename Interpolate>
+        static auto sample_track(const std::vector<Key>& keys, const float time, uint32_t& cursor, Interpolate interpolate) {
+            const uint32_t index = find_key(keys, time, cursor);
+
+            const auto& start = keys[index];
+            if(index + 1 >= keys.size() || time <= start.time)
+                return start.value;
+
+            const auto& end = keys[index + 1];
+
+            return interpolate(start.value, end.value, (time - start.time) / (end.time - start.time));
+        }
+    };
+}
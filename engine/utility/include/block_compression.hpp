@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+#include "texture_format.hpp"
+
+namespace prism {
+    /** Encodes an RGBA8 image into 4x4 blocks.
+     @param format The block compressed format to encode into.
+     @param rgba The source pixels, must be width * height * 4 bytes.
+     @param output The destination, must be at least calculate_level_size(format, width, height) bytes.
+     @note BC1 ignores alpha, BC4 only encodes red and BC5 only encodes red and green. BC7 is always written using mode 6.
+     */
+    void compress_blocks(texture_format format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* output);
+
+    /** Decodes 4x4 blocks back into an RGBA8 image.
+     @param format The block compressed format to decode from.
+     @param blocks The source blocks, must be at least calculate_level_size(format, width, height) bytes.
+     @param rgba The destination, must be width * height * 4 bytes.
+     @note Only BC7 mode 6 blocks are supported, which is what compress_blocks emits. Blocks using other modes decode to black.
+     */
+    void decompress_blocks(texture_format format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba);
+}
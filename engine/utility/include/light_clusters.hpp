@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "matrix.hpp"
+#include "vector.hpp"
+
+namespace prism {
+    class thread_pool;
+
+    /** Sorts lights into a grid of clusters that splits the view into screen tiles and exponentially growing depth slices, so shading only has to look at the lights near it.
+     The result is a single list of integers: an offset and a count for every cluster, followed by the light indices the offsets point to.
+     */
+    class light_clusters {
+    public:
+        static constexpr uint32_t tiles_x = 16, tiles_y = 9, slices = 24;
+
+        /** Assigns every light to the clusters its sphere touches. Each slice is binned on its own, spread across the workers of the pool.
+         @param view The camera's view matrix, looking down +Z.
+         @param projection Only the scale of x and y is used, so it can be an infinite projection.
+         @param z_near The start of the first slice.
+         @param z_far The start of the last slice, which goes on forever.
+         @param lights World space spheres as xyz and radius in w, the index of each one is what ends up in the clusters.
+         */
+        void build(const Matrix4x4& view, const Matrix4x4& projection, float z_near, float z_far, const std::vector<float4>& lights, thread_pool& pool);
+
+        /// Puts every light into one cluster covering everything, for views that don't have a camera to build the grid from.
+        void build_single(uint32_t light_count);
+
+        /// Offsets and counts for every cluster in order of x, then y, then the depth slice, followed by the light indices.
+        [[nodiscard]] const std::vector<uint32_t>& get_grid() const {
+            return grid;
+        }
+
+        /// The number of clusters along x, y and depth.
+        [[nodiscard]] uint32_t get_size_x() const {
+            return size_x;
+        }
+
+        [[nodiscard]] uint32_t get_size_y() const {
+            return size_y;
+        }
+
+        [[nodiscard]] uint32_t get_size_z() const {
+            return size_z;
+        }
+
+        /// The slice of a view depth is floor(log(depth) * scale - bias).
+        [[nodiscard]] float get_slice_scale() const {
+            return slice_scale;
+        }
+
+        [[nodiscard]] float get_slice_bias() const {
+            return slice_bias;
+        }
+
+        /// The total number of light indices in every cluster.
+        [[nodiscard]] uint32_t get_assignment_count() const {
+            return static_cast<uint32_t>(grid.size()) - size_x * size_y * size_z * 2;
+        }
+
+        [[nodiscard]] uint32_t get_max_cluster_lights() const {
+            return max_cluster_lights;
+        }
+
+    private:
+        // everything a slice needs while it's being binned, so slices don't share anything
+        struct slice_scratch {
+            std::vector<uint32_t> candidates; // lights that reach the slice's depth range
+            std::vector<float> x, y, z, radius_squared;
+            std::vector<uint8_t> inside;
+
+            std::vector<uint32_t> indices;
+            std::vector<uint32_t> counts; // one for each tile
+        };
+
+        void bin_slice(uint32_t slice);
+
+        uint32_t size_x = 0, size_y = 0, size_z = 0;
+        float slice_scale = 0.0f, slice_bias = 0.0f;
+        float scale_x = 1.0f, scale_y = 1.0f;
+        float z_near = 0.0f, z_far = 0.0f;
+
+        // view space, for every light
+        std::vector<float> light_x, light_y, light_z, light_radius;
+
+        std::vector<slice_scratch> scratch;
+        std::vector<uint32_t> grid;
+        uint32_t max_cluster_lights = 0;
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vector.hpp"
+
+/*
+ Binary materials are .material files that start with material_magic, anything else is loaded as a JSON material. They're laid out as:
+
+ material_header
+ material_node[header.node_count]
+ material_property[header.property_count], the properties of every node one after another in node order
+ material_connection[header.connection_count]
+ char[header.string_size], null terminated strings referenced by their offset
+
+ Nodes and connectors are referenced by their index, so a material is loaded in a single pass without looking anything up by id or name.
+ */
+namespace prism {
+    constexpr std::array<char, 4> material_magic = {'P', 'M', 'A', 'T'};
+    constexpr uint32_t material_version = 1;
+
+    constexpr uint32_t no_material_string = 0xFFFFFFFF;
+
+    struct material_header {
+        std::array<char, 4> magic = material_magic;
+        uint32_t version = material_version;
+        uint32_t node_count = 0, property_count = 0, connection_count = 0;
+        uint32_t string_size = 0;
+    };
+
+    struct material_node {
+        uint32_t name = no_material_string; // decides which type of node is created
+        uint32_t property_count = 0;
+        float x = 0.0f, y = 0.0f;
+    };
+
+    struct material_property {
+        float3 value;
+        float float_value = 0.0f;
+        uint32_t texture = no_material_string; // the path of the texture asset, if any
+    };
+
+    struct material_connection {
+        uint32_t output_node = 0, output = 0; // output is an index into the outputs of output_node
+        uint32_t input_node = 0, input = 0; // input is an index into the inputs of input_node
+    };
+
+    struct material_file {
+        std::vector<material_node> nodes;
+        std::vector<material_property> properties;
+        std::vector<material_connection> connections;
+        std::string strings;
+
+        /// Adds a string to the string table, and returns the offset to pass to get_string().
+        uint32_t add_string(std::string_view string);
+
+        /// Returns an empty string if the offset is no_material_string or out of range.
+        std::string_view get_string(uint32_t offset) const;
+    };
+
+    /// Returns true if the data starts with a binary material header, regardless of the version.
+    bool is_binary_material(const std::byte* data, size_t size);
+
+    std::vector<std::byte> write_material_file(const material_file& file);
+
+    /// Returns std::nullopt if the header doesn't match, or if any count or index is out of range for the data.
+    std::optional<material_file> read_material_file(const std::byte* data, size_t size);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vector.hpp"
+
+/*
+ Offline triangle and vertex reordering for the model compiler. Every function works on a triangle list for a single
+ mesh part, where indices are relative to the first vertex of that part.
+
+ The intended order is optimize_vertex_cache, then optimize_overdraw, then optimize_vertex_fetch_remap. When building
+ meshlets, build_meshlets and optimize_meshlet_overdraw take the place of optimize_overdraw. Simplified levels of detail
+ reuse the same vertices, so they only need optimize_vertex_cache.
+ */
+namespace prism {
+    struct vertex_cache_statistics {
+        float acmr = 0.0f; // average cache miss ratio, transformed vertices per triangle. 0.5 is the best case for a regular grid, 3 is the worst
+        float atvr = 0.0f; // average transformed vertex ratio, transformed vertices per referenced vertex. 1 is ideal
+    };
+
+    /// A small cluster of triangles that can be culled on its own, it covers a range of the indices it was built from.
+    struct meshlet {
+        uint32_t index_offset = 0, index_count = 0;
+
+        // bounding sphere
+        float3 center;
+        float radius = 0.0f;
+
+        // every triangle's normal is within this cone, a cutoff of 1 means the triangles face too many directions to be culled
+        float3 cone_axis;
+        float cone_cutoff = 1.0f;
+    };
+
+    constexpr size_t max_meshlet_vertices = 64;
+    constexpr size_t max_meshlet_triangles = 124;
+
+    struct vertex_fetch_statistics {
+        uint64_t bytes_fetched = 0;
+        float overfetch = 0.0f; // bytes fetched over the size of every referenced vertex. 1 is ideal
+    };
+
+    /// Simulates a FIFO post-transform cache, which is what most GPUs behave closest to.
+    vertex_cache_statistics analyze_vertex_cache(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size = 16);
+
+    /// Simulates fetching every post-transform cache miss from memory through a small cache of 64-byte lines.
+    vertex_fetch_statistics analyze_vertex_fetch(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t vertex_size);
+
+    /// Reorders triangles to reuse recently transformed vertices, using Forsyth's linear-speed algorithm.
+    std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t>& indices, uint32_t vertex_count);
+
+    /** Reorders clusters of triangles so the ones facing outwards are drawn first, which reduces overdraw from any view.
+     @param indices Should already be optimized for the vertex cache, clusters are split where that order already misses the cache.
+     @param threshold How much worse the ACMR is allowed to get, 1.05 allows 5%. Higher values create more (smaller) clusters.
+     */
+    std::vector<uint32_t> optimize_overdraw(const std::vector<uint32_t>& indices, const std::vector<float3>& positions, float threshold = 1.05f);
+
+    /// Returns a remap table (remap[old] = new) that orders vertices by their first use. Unreferenced vertices are moved to the end.
+    std::vector<uint32_t> optimize_vertex_fetch_remap(const std::vector<uint32_t>& indices, uint32_t vertex_count);
+
+    /** Reduces the triangle count by collapsing edges onto existing vertices, so the result can share the original vertex buffer.
+     Vertices on borders and attribute seams never move, so the result can't reach the target if those make up most of the mesh.
+     @param target_index_count Simplification stops once there are this many indices or fewer.
+     @param target_error The furthest the surface is allowed to move, relative to the largest extent of the mesh. 0.01 is 1%.
+     @param result_error If not null, this is set to the furthest the surface actually moved, in the same units as target_error.
+     */
+    std::vector<uint32_t> simplify(const std::vector<uint32_t>& indices, const std::vector<float3>& positions, size_t target_index_count, float target_error, float* result_error = nullptr);
+
+    /** Splits a triangle list into meshlets, each grown from neighbouring triangles until it would go over max_vertices unique vertices or max_triangles triangles.
+     @param indices Reordered so every meshlet is a contiguous range, the triangles inside of each one are reordered for the vertex cache again.
+     */
+    std::vector<meshlet> build_meshlets(std::vector<uint32_t>& indices, const std::vector<float3>& positions, size_t max_vertices = max_meshlet_vertices, size_t max_triangles = max_meshlet_triangles);
+
+    /** Reorders whole meshlets the same way optimize_overdraw reorders clusters, the triangles inside of each meshlet keep their order.
+     Use this instead of optimize_overdraw when building meshlets, since building them reorders the triangles again.
+     @param indices Should be the indices build_meshlets returned, these are reordered and the offsets in meshlets are updated to match.
+     */
+    void optimize_meshlet_overdraw(std::vector<uint32_t>& indices, std::vector<meshlet>& meshlets, const std::vector<float3>& positions);
+
+    /// Returns true if every triangle in the meshlet faces away from the camera, where the camera position is in the same space as the meshlet.
+    bool is_meshlet_backfacing(const meshlet& meshlet, float3 camera_position);
+
+    std::vector<uint32_t> remap_indices(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap);
+
+    template<typename T>
+    std::vector<T> remap_vertices(const std::vector<T>& vertices, const std::vector<uint32_t>& remap) {
+        std::vector<T> result(vertices.size());
+        for(size_t i = 0; i < vertices.size(); i++)
+            result[remap[i]] = vertices[i];
+
+        return result;
+    }
+}
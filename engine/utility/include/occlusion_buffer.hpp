@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "aabb.hpp"
+#include "matrix.hpp"
+#include "vector.hpp"
+
+namespace prism {
+    class thread_pool;
+
+    /** A small depth buffer rasterized on the cpu from a few large occluders, so anything completely hidden behind them can be skipped.
+     Depth is stored as 1/w, which doesn't depend on how the projection maps depth. Larger values are closer, and 0 is where nothing was drawn.
+     Every test is conservative: occluders only cover pixels whose centers are inside of them, and bounds are only hidden if every pixel they touch is in front of them.
+     */
+    class occlusion_buffer {
+    public:
+        // tiles are rasterized independently, and blocks are the coarser level of depth that bounds are tested against first
+        static constexpr uint32_t tile_size = 32;
+        static constexpr uint32_t block_size = 8;
+
+        /// The size is rounded up to a multiple of tile_size, this also clears the buffer.
+        void resize(uint32_t width, uint32_t height);
+
+        /// Forgets every occluder, this has to be called before adding the occluders of a new frame.
+        void clear();
+
+        /// The distance to the camera's near plane. Occluders are clipped against it like the gpu would, so nothing it doesn't draw hides anything.
+        void set_near_plane(const float near_plane) {
+            this->near_plane = near_plane;
+        }
+
+        /** Transforms the triangles and sorts them into every tile they touch, nothing is rasterized until the tiles are.
+         Triangles are clipped against the near plane, so occluders the camera is inside of still hide what's behind their far side.
+         @param matrix From the space of the positions to clip space, usually projection * view * model.
+         @param indices A triangle list.
+         */
+        void add_occluder(const Matrix4x4& matrix, const std::vector<float3>& positions, const std::vector<uint32_t>& indices);
+
+        /// Rasterizes every triangle sorted into the tile. Tiles don't share anything, so they can be rasterized on different threads at once.
+        void rasterize_tile(uint32_t tile);
+
+        /// Rasterizes every tile, spread across the workers of the pool.
+        void rasterize(thread_pool& pool);
+
+        /// Returns false if the box is completely hidden behind the occluders, this has to be called after rasterizing.
+        [[nodiscard]] bool is_visible(const Matrix4x4& view_projection, const aabb& bounds) const;
+
+        [[nodiscard]] uint32_t get_width() const {
+            return width;
+        }
+
+        [[nodiscard]] uint32_t get_height() const {
+            return height;
+        }
+
+        [[nodiscard]] uint32_t get_tile_count() const {
+            return tiles_x * tiles_y;
+        }
+
+        /// Every triangle added since the last clear that wasn't clipped away.
+        [[nodiscard]] size_t get_triangle_count() const {
+            return triangles.size();
+        }
+
+        /// 1/w of every pixel, row by row from the top.
+        [[nodiscard]] const std::vector<float>& get_depth() const {
+            return depth;
+        }
+
+    private:
+        // in pixels
+        struct screen_triangle {
+            float x[3], y[3];
+            float inverse_w[3];
+        };
+
+        void add_triangle(const float4& a, const float4& b, const float4& c);
+
+        uint32_t width = 0, height = 0;
+        float near_plane = 0.01f;
+        uint32_t tiles_x = 0, tiles_y = 0;
+        uint32_t blocks_x = 0, blocks_y = 0;
+
+        std::vector<float> depth;
+        std::vector<float> block_depth; // the furthest depth in each block
+
+        std::vector<screen_triangle> triangles;
+        std::vector<std::vector<uint32_t>> tile_triangles;
+
+        // clip space positions of the occluder being added, kept so they don't have to be allocated again
+        std::vector<float4> transformed;
+    };
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace prism {
+    /** Orders bones so every parent comes before its children, which lets a skeleton be evaluated in a single pass.
+     @param parents The index of each bone's parent, or -1 for a root. Bones that are part of a cycle are treated as roots.
+     */
+    std::vector<uint32_t> sort_bone_hierarchy(const std::vector<int>& parents);
+
+    /// For each bone in bone_names, the index of the bone with the same name in target_names, or -1 if there isn't one.
+    std::vector<int> create_bone_remap(const std::vector<std::string>& bone_names, const std::vector<std::string>& target_names);
+}
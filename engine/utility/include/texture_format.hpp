@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <algorithm>
+
+/*
+ Cooked textures (.texture) are laid out as:
+
+ texture_header
+ texture_level[header.mip_count]
+ level data, mip 0 (largest) first
+
+ The header and level table are plain structs, so they can be read without touching or decoding any pixel data.
+ */
+namespace prism {
+    constexpr std::array<char, 4> texture_magic = {'P', 'T', 'E', 'X'};
+    constexpr uint32_t texture_version = 1;
+
+    enum class texture_format : uint32_t {
+        rgba8 = 0,
+        bc1 = 1, // rgb, 4 bpp
+        bc3 = 2, // rgba, 8 bpp
+        bc4 = 3, // r, 4 bpp
+        bc5 = 4, // rg, 8 bpp
+        bc7 = 5 // rgba, 8 bpp
+    };
+
+    struct texture_header {
+        std::array<char, 4> magic = texture_magic;
+        uint32_t version = texture_version;
+        texture_format format = texture_format::rgba8;
+        uint32_t width = 0, height = 0;
+        uint32_t mip_count = 0;
+    };
+
+    /// Describes where a single mip level lives, offset is relative to the beginning of the file.
+    struct texture_level {
+        uint64_t offset = 0, size = 0;
+    };
+
+    /// Returns the number of mip levels in a full chain down to 1x1.
+    inline uint32_t calculate_mip_count(const uint32_t width, const uint32_t height) {
+        uint32_t count = 1;
+        uint32_t size = std::max(width, height);
+        while(size > 1) {
+            size /= 2;
+            count++;
+        }
+
+        return count;
+    }
+
+    /// Returns the size of one dimension at the specified mip level.
+    inline uint32_t calculate_mip_extent(const uint32_t extent, const uint32_t level) {
+        return std::max(extent >> level, 1u);
+    }
+
+    /// Returns true if the format is stored as 4x4 pixel blocks.
+    inline bool is_block_compressed(const texture_format format) {
+        return format != texture_format::rgba8;
+    }
+
+    /// Returns the size in bytes of a single 4x4 block, or of a single pixel if the format is not block compressed.
+    inline uint32_t get_block_size(const texture_format format) {
+        switch(format) {
+            case texture_format::rgba8:
+                return 4;
+            case texture_format::bc1:
+            case texture_format::bc4:
+                return 8;
+            case texture_format::bc3:
+            case texture_format::bc5:
+            case texture_format::bc7:
+                return 16;
+        }
+
+        return 0;
+    }
+
+    /// Returns the size in bytes of a single mip level.
+    inline uint64_t calculate_level_size(const texture_format format, const uint32_t width, const uint32_t height) {
+        if(is_block_compressed(format))
+            return static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * get_block_size(format);
+
+        return static_cast<uint64_t>(width) * height * get_block_size(format);
+    }
+
+    inline bool is_valid_texture_header(const texture_header& header) {
+        return header.magic == texture_magic && header.version == texture_version && get_block_size(header.format) != 0 && header.width > 0 && header.height > 0 && header.mip_count > 0 && header.mip_count <= calculate_mip_count(header.width, header.height);
+    }
+
+    /** Checks that every level is after the level table, in order from most to least detailed, large enough for its extent and inside of the file.
+     @param levels header.mip_count levels, the header has to be valid.
+     @param file_size The size of the whole file in bytes.
+     */
+    inline bool are_valid_texture_levels(const texture_header& header, const texture_level* levels, const uint64_t file_size) {
+        const uint64_t data_start = sizeof(texture_header) + sizeof(texture_level) * header.mip_count;
+        if(data_start > file_size)
+            return false;
+
+        for(uint32_t i = 0; i < header.mip_count; i++) {
+            const auto& level = levels[i];
+
+            // written so nothing can overflow, these come straight from the file
+            if(level.offset < data_start || level.offset > file_size || level.size > file_size - level.offset)
+                return false;
+
+            if(i > 0 && level.offset < levels[i - 1].offset)
+                return false;
+
+            if(level.size < calculate_level_size(header.format, calculate_mip_extent(header.width, i), calculate_mip_extent(header.height, i)))
+                return false;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace prism {
+    /// A fixed set of worker threads that run submitted jobs in the order they were submitted.
+    class thread_pool {
+    public:
+        /// @param thread_count How many workers to start, 0 picks one less than the number of hardware threads (but at least one).
+        explicit thread_pool(uint32_t thread_count = 0);
+        
+        /// Finishes every job that was already submitted before returning.
+        ~thread_pool();
+        
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+        
+        /// Queues a job to be run on a worker. This can be called from any thread, including from inside of a job.
+        void submit(std::function<void()> job);
+        
+        /// Blocks until every submitted job has finished. Must not be called from inside of a job.
+        void wait();
+        
+        /** Calls function(i) for every i in [0, count) spread across the workers and the calling thread, and returns once they've all finished.
+         Unlike wait(), this doesn't wait for unrelated jobs and can be called from inside of a job.
+         */
+        void parallel_for(uint32_t count, const std::function<void(uint32_t)>& function);
+        
+        uint32_t get_thread_count() const;
+        
+    private:
+        void worker_main();
+        
+        std::vector<std::thread> workers;
+        
+        std::deque<std::function<void()>> jobs;
+        uint32_t running_jobs = 0;
+        bool stopping = false;
+        
+        std::mutex mutex;
+        std::condition_variable job_available, jobs_finished;
+    };
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "vector.hpp"
+
+/*
+ Mesh vertices (version 7 and up) are stored as two streams:
+
+ float3 positions, kept separate so position-only passes (like shadows) don't fetch anything else
+ packed_vertex, every other attribute interleaved together
+
+ Indices are 16-bit if every index fits, otherwise 32-bit.
+ */
+namespace prism {
+    struct packed_vertex {
+        std::array<int16_t, 2> normal = {}; // octahedral encoded, snorm
+        std::array<uint16_t, 2> texture_coord = {}; // half floats
+        uint32_t tangent = 0; // octahedral encoded in the first two 10-bit unorm channels, the top two bits are the bitangent sign
+    };
+
+    static_assert(sizeof(packed_vertex) == 12, "packed_vertex must stay tightly packed to match the vertex input layout");
+
+    /// Maps a unit vector onto the octahedron, the result is in [-1, 1].
+    float2 encode_octahedral(float3 v);
+
+    /// Reverses encode_octahedral, the result is normalized.
+    float3 decode_octahedral(float2 e);
+
+    /// Converts to an IEEE half float, rounding to the nearest value. Out of range values are clamped to infinity.
+    uint16_t float_to_half(float value);
+
+    float half_to_float(uint16_t value);
+
+    /// Packs a vertex, the bitangent is only used to determine the handedness of the tangent frame.
+    packed_vertex pack_vertex(float3 normal, float2 texture_coord, float3 tangent, float3 bitangent);
+
+    /// Unpacks a vertex, the bitangent is reconstructed from the normal, tangent and stored sign.
+    void unpack_vertex(const packed_vertex& vertex, float3& normal, float2& texture_coord, float3& tangent, float3& bitangent);
+}
@@ -0,0 +1,380 @@
+#include "animation_format.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    constexpr float rotation_component_range = 0.70710678f; // the dropped component is the largest, so the others can't go past 1/sqrt(2)
+    constexpr uint32_t rotation_component_max = (1u << 15) - 1;
+    constexpr float vector_component_max = 65535.0f;
+
+    /// Greedily removes keys, a key is only removed if every original key it covers is still within the tolerance.
+    /// Decoded keys are compared against the original ones, so the quantization error is accounted for.
+    template<typename T, typename Interpolate, typename Difference>
+    std::vector<size_t> reduce_keys(const std::vector<float>& times, const std::vector<T>& original, const std::vector<T>& decoded, const float tolerance, Interpolate interpolate, Difference difference) {
+        const size_t count = times.size();
+        if(count <= 1)
+            return std::vector<size_t>(count, 0);
+
+        std::vector<size_t> kept = {0};
+
+        size_t start = 0;
+        for(size_t end = start + 2; end < count; end++) {
+            const float duration = times[end] - times[start];
+
+            bool fits = duration > 0.0f;
+            for(size_t k = start + 1; k < end && fits; k++) {
+                const float t = (times[k] - times[start]) / duration;
+                fits = difference(interpolate(decoded[start], decoded[end], t), original[k]) <= tolerance;
+            }
+
+            if(!fits) {
+                start = end - 1;
+                kept.push_back(start);
+            }
+        }
+
+        kept.push_back(count - 1);
+
+        // a channel that never changes only needs one key
+        if(kept.size() == 2) {
+            bool constant = true;
+            for(size_t k = 1; k < count && constant; k++)
+                constant = difference(decoded[0], original[k]) <= tolerance;
+
+            if(constant)
+                kept.pop_back();
+        }
+
+        return kept;
+    }
+
+    template<typename Key>
+    std::vector<float> key_times(const std::vector<Key>& keys) {
+        std::vector<float> times;
+        for(const auto& key : keys)
+            times.push_back(key.time);
+
+        return times;
+    }
+
+    void calculate_range(const std::vector<prism::vector_key>& keys, prism::float3& min, prism::float3& extent) {
+        if(keys.empty())
+            return;
+
+        min = keys[0].value;
+        prism::float3 max = keys[0].value;
+        for(const auto& key : keys) {
+            for(int i = 0; i < 3; i++) {
+                min[i] = std::min(min[i], key.value[i]);
+                max[i] = std::max(max[i], key.value[i]);
+            }
+        }
+
+        extent = max - min;
+    }
+
+    void compress_vector_keys(const std::vector<prism::vector_key>& keys, const float tolerance, prism::float3& min, prism::float3& extent, std::vector<float>& compressed_times, std::vector<prism::quantized_key>& compressed_keys) {
+        calculate_range(keys, min, extent);
+
+        const auto times = key_times(keys);
+
+        std::vector<prism::float3> original, decoded;
+        std::vector<prism::quantized_key> quantized;
+        for(const auto& key : keys) {
+            quantized.push_back(prism::quantize_vector(key.value, min, extent));
+
+            original.push_back(key.value);
+            decoded.push_back(prism::dequantize_vector(quantized.back(), min, extent));
+        }
+
+        const auto kept = reduce_keys(times, original, decoded, tolerance, [](const prism::float3 a, const prism::float3 b, const float t) {
+            return prism::lerp(a, b, t);
+        }, [](const prism::float3 a, const prism::float3 b) {
+            return prism::length(a - b);
+        });
+
+        for(const auto index : kept) {
+            compressed_times.push_back(times[index]);
+            compressed_keys.push_back(quantized[index]);
+        }
+    }
+
+    void compress_rotation_keys(const std::vector<prism::rotation_key>& keys, const float tolerance, std::vector<float>& compressed_times, std::vector<prism::quantized_key>& compressed_keys) {
+        const auto times = key_times(keys);
+
+        std::vector<Quaternion> original, decoded;
+        std::vector<prism::quantized_key> quantized;
+        for(const auto& key : keys) {
+            quantized.push_back(prism::quantize_rotation(key.value));
+
+            original.push_back(normalize(key.value));
+            decoded.push_back(prism::dequantize_rotation(quantized.back()));
+        }
+
+        // lerp on quaternions is a slerp, which is what the engine samples rotations with
+        const auto kept = reduce_keys(times, original, decoded, tolerance, [](const Quaternion& a, const Quaternion& b, const float t) {
+            return normalize(lerp(a, b, t));
+        }, prism::rotation_difference);
+
+        for(const auto index : kept) {
+            compressed_times.push_back(times[index]);
+            compressed_keys.push_back(quantized[index]);
+        }
+    }
+
+    template<typename T>
+    void write_array(std::vector<std::byte>& data, const T* values, const size_t count) {
+        const size_t offset = data.size();
+        data.resize(offset + sizeof(T) * count);
+
+        if(count > 0)
+            memcpy(data.data() + offset, values, sizeof(T) * count);
+    }
+
+    template<typename T>
+    bool read_array(const std::byte* data, const size_t size, size_t& offset, std::vector<T>& values, const uint32_t count) {
+        // compared as 64-bit, so a huge count can't overflow past the check
+        if(offset + static_cast<uint64_t>(sizeof(T)) * count > size)
+            return false;
+
+        values.resize(count);
+
+        if(count > 0)
+            memcpy(values.data(), data + offset, sizeof(T) * count);
+
+        offset += sizeof(T) * count;
+
+        return true;
+    }
+}
+
+prism::quantized_key prism::quantize_rotation(const Quaternion& rotation) {
+    const Quaternion q = normalize(rotation);
+    const std::array<float, 4> components = {q.x, q.y, q.z, q.w};
+
+    int largest = 0;
+    for(int i = 1; i < 4; i++) {
+        if(std::abs(components[i]) > std::abs(components[largest]))
+            largest = i;
+    }
+
+    // q and -q are the same rotation, so the dropped component is always made positive and can be rebuilt from the others
+    const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint64_t packed = static_cast<uint64_t>(largest) << 45;
+
+    int shift = 30;
+    for(int i = 0; i < 4; i++) {
+        if(i == largest)
+            continue;
+
+        const float normalized = std::clamp(components[i] * sign / rotation_component_range * 0.5f + 0.5f, 0.0f, 1.0f);
+        const auto quantized = static_cast<uint64_t>(std::lround(normalized * rotation_component_max));
+
+        packed |= quantized << shift;
+        shift -= 15;
+    }
+
+    return {static_cast<uint16_t>(packed), static_cast<uint16_t>(packed >> 16), static_cast<uint16_t>(packed >> 32)};
+}
+
+Quaternion prism::dequantize_rotation(const quantized_key& key) {
+    const uint64_t packed = static_cast<uint64_t>(key[0]) | (static_cast<uint64_t>(key[1]) << 16) | (static_cast<uint64_t>(key[2]) << 32);
+    const auto largest = static_cast<int>((packed >> 45) & 3);
+
+    std::array<float, 4> components = {};
+
+    float sum = 0.0f;
+    int shift = 30;
+    for(int i = 0; i < 4; i++) {
+        if(i == largest)
+            continue;
+
+        const auto quantized = static_cast<float>((packed >> shift) & rotation_component_max);
+        components[i] = (quantized / rotation_component_max * 2.0f - 1.0f) * rotation_component_range;
+
+        sum += components[i] * components[i];
+        shift -= 15;
+    }
+
+    components[largest] = std::sqrt(std::max(1.0f - sum, 0.0f));
+
+    return normalize(Quaternion(components[0], components[1], components[2], components[3]));
+}
+
+prism::quantized_key prism::quantize_vector(const float3 value, const float3 min, const float3 extent) {
+    quantized_key key = {};
+    for(int i = 0; i < 3; i++) {
+        if(extent[i] > 0.0f) {
+            const float normalized = std::clamp((value[i] - min[i]) / extent[i], 0.0f, 1.0f);
+            key[i] = static_cast<uint16_t>(std::lround(normalized * vector_component_max));
+        }
+    }
+
+    return key;
+}
+
+prism::float3 prism::dequantize_vector(const quantized_key& key, const float3 min, const float3 extent) {
+    float3 value;
+    for(int i = 0; i < 3; i++)
+        value[i] = min[i] + static_cast<float>(key[i]) / vector_component_max * extent[i];
+
+    return value;
+}
+
+float prism::rotation_difference(const Quaternion& a, const Quaternion& b) {
+    // |a - b| is 2 sin(angle / 4) for unit quaternions, unlike acos(dot) this doesn't lose precision near zero
+    const float sign = dot(a, b) < 0.0f ? -1.0f : 1.0f;
+
+    const float dx = a.x - b.x * sign, dy = a.y - b.y * sign, dz = a.z - b.z * sign, dw = a.w - b.w * sign;
+    const float chord = std::sqrt(dx * dx + dy * dy + dz * dz + dw * dw);
+
+    return 4.0f * std::asin(std::min(chord * 0.5f, 1.0f));
+}
+
+prism::compressed_animation prism::compress_animation(const animation_clip& clip, const animation_tolerance& tolerance) {
+    compressed_animation animation;
+    animation.duration = clip.duration;
+    animation.ticks_per_second = clip.ticks_per_second;
+
+    for(const auto& channel : clip.channels) {
+        compressed_animation::channel compressed;
+        compressed.name = channel.name;
+
+        compress_vector_keys(channel.positions, tolerance.position, compressed.position_min, compressed.position_extent, compressed.position_times, compressed.positions);
+        compress_rotation_keys(channel.rotations, tolerance.rotation, compressed.rotation_times, compressed.rotations);
+        compress_vector_keys(channel.scales, tolerance.scale, compressed.scale_min, compressed.scale_extent, compressed.scale_times, compressed.scales);
+
+        animation.channels.push_back(std::move(compressed));
+    }
+
+    return animation;
+}
+
+prism::animation_clip prism::decompress_animation(const compressed_animation& animation) {
+    animation_clip clip;
+    clip.duration = animation.duration;
+    clip.ticks_per_second = animation.ticks_per_second;
+
+    for(const auto& compressed : animation.channels) {
+        animation_clip::channel channel;
+        channel.name = compressed.name;
+
+        for(size_t i = 0; i < compressed.positions.size(); i++)
+            channel.positions.push_back({compressed.position_times[i], dequantize_vector(compressed.positions[i], compressed.position_min, compressed.position_extent)});
+
+        for(size_t i = 0; i < compressed.rotations.size(); i++)
+            channel.rotations.push_back({compressed.rotation_times[i], dequantize_rotation(compressed.rotations[i])});
+
+        for(size_t i = 0; i < compressed.scales.size(); i++)
+            channel.scales.push_back({compressed.scale_times[i], dequantize_vector(compressed.scales[i], compressed.scale_min, compressed.scale_extent)});
+
+        clip.channels.push_back(std::move(channel));
+    }
+
+    return clip;
+}
+
+bool prism::is_compressed_animation(const std::byte* data, const size_t size) {
+    return size >= animation_magic.size() && memcmp(data, animation_magic.data(), animation_magic.size()) == 0;
+}
+
+std::vector<std::byte> prism::write_animation_file(const compressed_animation& animation) {
+    std::string strings;
+    std::vector<uint32_t> names;
+    for(const auto& channel : animation.channels) {
+        names.push_back(static_cast<uint32_t>(strings.size()));
+
+        strings += channel.name;
+        strings += '\0';
+    }
+
+    animation_header header;
+    header.channel_count = static_cast<uint32_t>(animation.channels.size());
+    header.string_size = static_cast<uint32_t>(strings.size());
+    header.duration = animation.duration;
+    header.ticks_per_second = animation.ticks_per_second;
+
+    std::vector<std::byte> data;
+    write_array(data, &header, 1);
+    write_array(data, strings.data(), strings.size());
+
+    for(size_t i = 0; i < animation.channels.size(); i++) {
+        const auto& channel = animation.channels[i];
+
+        animation_channel_header channel_header;
+        channel_header.name = names[i];
+        channel_header.position_count = static_cast<uint32_t>(channel.positions.size());
+        channel_header.rotation_count = static_cast<uint32_t>(channel.rotations.size());
+        channel_header.scale_count = static_cast<uint32_t>(channel.scales.size());
+        channel_header.position_min = channel.position_min;
+        channel_header.position_extent = channel.position_extent;
+        channel_header.scale_min = channel.scale_min;
+        channel_header.scale_extent = channel.scale_extent;
+
+        write_array(data, &channel_header, 1);
+        write_array(data, channel.position_times.data(), channel.position_times.size());
+        write_array(data, channel.positions.data(), channel.positions.size());
+        write_array(data, channel.rotation_times.data(), channel.rotation_times.size());
+        write_array(data, channel.rotations.data(), channel.rotations.size());
+        write_array(data, channel.scale_times.data(), channel.scale_times.size());
+        write_array(data, channel.scales.data(), channel.scales.size());
+    }
+
+    return data;
+}
+
+std::optional<prism::compressed_animation> prism::read_animation_file(const std::byte* data, const size_t size) {
+    if(size < sizeof(animation_header))
+        return std::nullopt;
+
+    animation_header header;
+    memcpy(&header, data, sizeof(animation_header));
+
+    if(header.magic != animation_magic || header.version != animation_version)
+        return std::nullopt;
+
+    size_t offset = sizeof(animation_header);
+
+    std::vector<char> strings;
+    if(!read_array(data, size, offset, strings, header.string_size))
+        return std::nullopt;
+
+    if(!strings.empty() && strings.back() != '\0')
+        return std::nullopt;
+
+    compressed_animation animation;
+    animation.duration = header.duration;
+    animation.ticks_per_second = header.ticks_per_second;
+
+    for(uint32_t i = 0; i < header.channel_count; i++) {
+        std::vector<animation_channel_header> channel_header;
+        if(!read_array(data, size, offset, channel_header, 1))
+            return std::nullopt;
+
+        const auto& h = channel_header[0];
+        if(h.name >= strings.size())
+            return std::nullopt;
+
+        compressed_animation::channel channel;
+        channel.name = strings.data() + h.name;
+        channel.position_min = h.position_min;
+        channel.position_extent = h.position_extent;
+        channel.scale_min = h.scale_min;
+        channel.scale_extent = h.scale_extent;
+
+        if(!read_array(data, size, offset, channel.position_times, h.position_count) ||
+           !read_array(data, size, offset, channel.positions, h.position_count) ||
+           !read_array(data, size, offset, channel.rotation_times, h.rotation_count) ||
+           !read_array(data, size, offset, channel.rotations, h.rotation_count) ||
+           !read_array(data, size, offset, channel.scale_times, h.scale_count) ||
+           !read_array(data, size, offset, channel.scales, h.scale_count))
+            return std::nullopt;
+
+        animation.channels.push_back(std::move(channel));
+    }
+
+    return animation;
+}
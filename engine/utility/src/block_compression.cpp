@@ -0,0 +1,603 @@
+#include "block_compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    using block_pixels = std::array<std::array<uint8_t, 4>, 16>;
+
+    // edge blocks repeat the last row/column so partial blocks don't pull in garbage
+    block_pixels fetch_block(const uint8_t* rgba, const uint32_t width, const uint32_t height, const uint32_t block_x, const uint32_t block_y) {
+        block_pixels block;
+        for(uint32_t y = 0; y < 4; y++) {
+            for(uint32_t x = 0; x < 4; x++) {
+                const uint32_t px = std::min(block_x * 4 + x, width - 1);
+                const uint32_t py = std::min(block_y * 4 + y, height - 1);
+
+                memcpy(block[y * 4 + x].data(), rgba + (py * width + px) * 4, 4);
+            }
+        }
+
+        return block;
+    }
+
+    void store_block(const block_pixels& block, uint8_t* rgba, const uint32_t width, const uint32_t height, const uint32_t block_x, const uint32_t block_y) {
+        for(uint32_t y = 0; y < 4; y++) {
+            for(uint32_t x = 0; x < 4; x++) {
+                const uint32_t px = block_x * 4 + x;
+                const uint32_t py = block_y * 4 + y;
+                if(px >= width || py >= height)
+                    continue;
+
+                memcpy(rgba + (py * width + px) * 4, block[y * 4 + x].data(), 4);
+            }
+        }
+    }
+
+    float clamp_channel(const float value, const float max = 255.0f) {
+        return std::clamp(value, 0.0f, max);
+    }
+
+    template<int N>
+    using color = std::array<float, N>;
+
+    /// Finds the endpoints of the line that best fits the first N channels of the block.
+    template<int N>
+    void fit_principal_axis(const block_pixels& block, color<N>& start, color<N>& end) {
+        color<N> mean = {};
+        for(auto& pixel : block) {
+            for(int i = 0; i < N; i++)
+                mean[i] += pixel[i];
+        }
+
+        for(int i = 0; i < N; i++)
+            mean[i] /= 16.0f;
+
+        float covariance[N][N] = {};
+        for(auto& pixel : block) {
+            for(int i = 0; i < N; i++) {
+                for(int j = i; j < N; j++)
+                    covariance[i][j] += (pixel[i] - mean[i]) * (pixel[j] - mean[j]);
+            }
+        }
+
+        for(int i = 0; i < N; i++) {
+            for(int j = 0; j < i; j++)
+                covariance[i][j] = covariance[j][i];
+        }
+
+        // power iteration converges quickly enough for a 4x4 block
+        color<N> axis;
+        axis.fill(1.0f);
+        for(int iteration = 0; iteration < 8; iteration++) {
+            color<N> next = {};
+            for(int i = 0; i < N; i++) {
+                for(int j = 0; j < N; j++)
+                    next[i] += covariance[i][j] * axis[j];
+            }
+
+            float largest = 0.0f;
+            for(int i = 0; i < N; i++)
+                largest = std::max(largest, std::fabs(next[i]));
+
+            if(largest == 0.0f)
+                break;
+
+            for(int i = 0; i < N; i++)
+                axis[i] = next[i] / largest;
+        }
+
+        float min_t = std::numeric_limits<float>::max(), max_t = std::numeric_limits<float>::lowest();
+        float axis_length = 0.0f;
+        for(int i = 0; i < N; i++)
+            axis_length += axis[i] * axis[i];
+
+        axis_length = std::sqrt(axis_length);
+        for(int i = 0; i < N; i++)
+            axis[i] /= axis_length;
+
+        for(auto& pixel : block) {
+            float t = 0.0f;
+            for(int i = 0; i < N; i++)
+                t += (pixel[i] - mean[i]) * axis[i];
+
+            min_t = std::min(min_t, t);
+            max_t = std::max(max_t, t);
+        }
+
+        for(int i = 0; i < N; i++) {
+            start[i] = clamp_channel(mean[i] + axis[i] * max_t);
+            end[i] = clamp_channel(mean[i] + axis[i] * min_t);
+        }
+    }
+
+    /** Solves for the two endpoints that minimize the error given fixed interpolation weights.
+     @param weights The weight of the start endpoint for every pixel.
+     @return False if the system is degenerate (every pixel uses the same weight.)
+     */
+    template<int N>
+    bool least_squares_endpoints(const block_pixels& block, const std::array<float, 16>& weights, color<N>& start, color<N>& end) {
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+        color<N> ax = {}, bx = {};
+
+        for(int p = 0; p < 16; p++) {
+            const float a = weights[p];
+            const float b = 1.0f - a;
+
+            aa += a * a;
+            bb += b * b;
+            ab += a * b;
+
+            for(int i = 0; i < N; i++) {
+                ax[i] += a * block[p][i];
+                bx[i] += b * block[p][i];
+            }
+        }
+
+        const float determinant = aa * bb - ab * ab;
+        if(std::fabs(determinant) < 1e-6f)
+            return false;
+
+        for(int i = 0; i < N; i++) {
+            start[i] = clamp_channel((ax[i] * bb - bx[i] * ab) / determinant);
+            end[i] = clamp_channel((bx[i] * aa - ax[i] * ab) / determinant);
+        }
+
+        return true;
+    }
+
+    // bc1
+
+    uint16_t pack_565(const color<3>& c) {
+        const auto r = static_cast<uint16_t>(std::lround(c[0] * 31.0f / 255.0f));
+        const auto g = static_cast<uint16_t>(std::lround(c[1] * 63.0f / 255.0f));
+        const auto b = static_cast<uint16_t>(std::lround(c[2] * 31.0f / 255.0f));
+
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    std::array<int, 3> unpack_565(const uint16_t v) {
+        const int r = (v >> 11) & 31;
+        const int g = (v >> 5) & 63;
+        const int b = v & 31;
+
+        return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+    }
+
+    using bc1_palette = std::array<std::array<int, 4>, 4>;
+
+    bc1_palette calculate_bc1_palette(const uint16_t c0, const uint16_t c1, const bool four_color) {
+        const auto a = unpack_565(c0);
+        const auto b = unpack_565(c1);
+
+        bc1_palette palette;
+        for(int i = 0; i < 3; i++) {
+            palette[0][i] = a[i];
+            palette[1][i] = b[i];
+
+            if(four_color) {
+                palette[2][i] = (2 * a[i] + b[i]) / 3;
+                palette[3][i] = (a[i] + 2 * b[i]) / 3;
+            } else {
+                palette[2][i] = (a[i] + b[i]) / 2;
+                palette[3][i] = 0;
+            }
+        }
+
+        palette[0][3] = palette[1][3] = palette[2][3] = 255;
+        palette[3][3] = four_color ? 255 : 0;
+
+        return palette;
+    }
+
+    // always emits the four color mode, so the block is also valid as the color half of bc3
+    void encode_bc1(const block_pixels& block, uint8_t* output) {
+        color<3> start, end;
+        fit_principal_axis<3>(block, start, end);
+
+        constexpr std::array<float, 4> index_weights = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+        int best_error = std::numeric_limits<int>::max();
+        uint16_t best_c0 = 0, best_c1 = 0;
+        uint32_t best_indices = 0;
+
+        for(int iteration = 0; iteration < 3; iteration++) {
+            uint16_t c0 = pack_565(start), c1 = pack_565(end);
+            if(c0 < c1)
+                std::swap(c0, c1);
+
+            const auto palette = calculate_bc1_palette(c0, c1, true);
+
+            int error = 0;
+            uint32_t indices = 0;
+            std::array<float, 16> weights;
+            for(int p = 0; p < 16; p++) {
+                int closest_error = std::numeric_limits<int>::max(), closest = 0;
+                for(int i = 0; i < 4; i++) {
+                    int e = 0;
+                    for(int c = 0; c < 3; c++) {
+                        const int d = palette[i][c] - block[p][c];
+                        e += d * d;
+                    }
+
+                    if(e < closest_error) {
+                        closest_error = e;
+                        closest = i;
+                    }
+                }
+
+                error += closest_error;
+                indices |= static_cast<uint32_t>(closest) << (p * 2);
+                weights[p] = index_weights[closest];
+            }
+
+            if(error < best_error) {
+                best_error = error;
+                best_c0 = c0;
+                best_c1 = c1;
+                best_indices = c0 == c1 ? 0 : indices;
+            }
+
+            if(error == 0)
+                break;
+
+            const auto start_565 = unpack_565(c0), end_565 = unpack_565(c1);
+            for(int c = 0; c < 3; c++) {
+                start[c] = static_cast<float>(start_565[c]);
+                end[c] = static_cast<float>(end_565[c]);
+            }
+
+            if(!least_squares_endpoints<3>(block, weights, start, end))
+                break;
+        }
+
+        memcpy(output, &best_c0, 2);
+        memcpy(output + 2, &best_c1, 2);
+        memcpy(output + 4, &best_indices, 4);
+    }
+
+    void decode_bc1(const uint8_t* input, block_pixels& block, const bool force_four_color) {
+        uint16_t c0, c1;
+        uint32_t indices;
+        memcpy(&c0, input, 2);
+        memcpy(&c1, input + 2, 2);
+        memcpy(&indices, input + 4, 4);
+
+        const auto palette = calculate_bc1_palette(c0, c1, force_four_color || c0 > c1);
+
+        for(int p = 0; p < 16; p++) {
+            const auto& entry = palette[(indices >> (p * 2)) & 3];
+            for(int c = 0; c < 4; c++)
+                block[p][c] = static_cast<uint8_t>(entry[c]);
+        }
+    }
+
+    // bc4, also used for the alpha half of bc3 and both halves of bc5
+
+    std::array<int, 8> calculate_bc4_palette(const int r0, const int r1) {
+        std::array<int, 8> palette;
+        palette[0] = r0;
+        palette[1] = r1;
+
+        if(r0 > r1) {
+            for(int i = 1; i < 7; i++)
+                palette[i + 1] = ((7 - i) * r0 + i * r1) / 7;
+        } else {
+            for(int i = 1; i < 5; i++)
+                palette[i + 1] = ((5 - i) * r0 + i * r1) / 5;
+
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        return palette;
+    }
+
+    void encode_bc4(const block_pixels& block, const int channel, uint8_t* output) {
+        int min = 255, max = 0;
+        for(auto& pixel : block) {
+            min = std::min<int>(min, pixel[channel]);
+            max = std::max<int>(max, pixel[channel]);
+        }
+
+        const auto palette = calculate_bc4_palette(max, min);
+
+        uint64_t indices = 0;
+        if(max != min) {
+            for(int p = 0; p < 16; p++) {
+                int closest_error = std::numeric_limits<int>::max(), closest = 0;
+                for(int i = 0; i < 8; i++) {
+                    const int e = std::abs(palette[i] - block[p][channel]);
+                    if(e < closest_error) {
+                        closest_error = e;
+                        closest = i;
+                    }
+                }
+
+                indices |= static_cast<uint64_t>(closest) << (p * 3);
+            }
+        }
+
+        output[0] = static_cast<uint8_t>(max);
+        output[1] = static_cast<uint8_t>(min);
+        for(int i = 0; i < 6; i++)
+            output[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+
+    void decode_bc4(const uint8_t* input, block_pixels& block, const int channel) {
+        const auto palette = calculate_bc4_palette(input[0], input[1]);
+
+        uint64_t indices = 0;
+        for(int i = 0; i < 6; i++)
+            indices |= static_cast<uint64_t>(input[2 + i]) << (i * 8);
+
+        for(int p = 0; p < 16; p++)
+            block[p][channel] = static_cast<uint8_t>(palette[(indices >> (p * 3)) & 7]);
+    }
+
+    // bc7, mode 6 only: one subset, rgba 7.7.7.7 endpoints with a unique p-bit each and 4-bit indices
+
+    constexpr std::array<int, 16> bc7_weights = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    struct bit_writer {
+        uint8_t* data;
+        int position = 0;
+
+        void write(const uint32_t value, const int count) {
+            for(int i = 0; i < count; i++, position++) {
+                if((value >> i) & 1)
+                    data[position / 8] |= static_cast<uint8_t>(1 << (position % 8));
+            }
+        }
+    };
+
+    struct bit_reader {
+        const uint8_t* data;
+        int position = 0;
+
+        uint32_t read(const int count) {
+            uint32_t value = 0;
+            for(int i = 0; i < count; i++, position++)
+                value |= static_cast<uint32_t>((data[position / 8] >> (position % 8)) & 1) << i;
+
+            return value;
+        }
+    };
+
+    struct bc7_endpoints {
+        std::array<int, 4> start, end; // 7-bit
+        int start_pbit = 0, end_pbit = 0;
+    };
+
+    int quantize_7bit(const float value, const int pbit) {
+        return std::clamp(static_cast<int>(std::lround((value - pbit) / 2.0f)), 0, 127);
+    }
+
+    void encode_bc7(const block_pixels& block, uint8_t* output) {
+        color<4> start, end;
+        fit_principal_axis<4>(block, start, end);
+
+        int best_error = std::numeric_limits<int>::max();
+        bc7_endpoints best_endpoints = {};
+        std::array<int, 16> best_indices = {};
+
+        for(int iteration = 0; iteration < 3; iteration++) {
+            int iteration_error = std::numeric_limits<int>::max();
+            std::array<int, 16> iteration_indices = {};
+
+            for(int pbits = 0; pbits < 4; pbits++) {
+                bc7_endpoints endpoints;
+                endpoints.start_pbit = pbits & 1;
+                endpoints.end_pbit = pbits >> 1;
+
+                std::array<int, 4> a, b;
+                for(int c = 0; c < 4; c++) {
+                    endpoints.start[c] = quantize_7bit(start[c], endpoints.start_pbit);
+                    endpoints.end[c] = quantize_7bit(end[c], endpoints.end_pbit);
+
+                    a[c] = (endpoints.start[c] << 1) | endpoints.start_pbit;
+                    b[c] = (endpoints.end[c] << 1) | endpoints.end_pbit;
+                }
+
+                std::array<std::array<int, 4>, 16> palette;
+                for(int i = 0; i < 16; i++) {
+                    for(int c = 0; c < 4; c++)
+                        palette[i][c] = ((64 - bc7_weights[i]) * a[c] + bc7_weights[i] * b[c] + 32) >> 6;
+                }
+
+                // project onto the endpoint line for a first guess, then only check the neighbors
+                float line_length = 0.0f;
+                for(int c = 0; c < 4; c++)
+                    line_length += static_cast<float>((b[c] - a[c]) * (b[c] - a[c]));
+
+                int error = 0;
+                std::array<int, 16> indices;
+                for(int p = 0; p < 16; p++) {
+                    int guess = 0;
+                    if(line_length > 0.0f) {
+                        float t = 0.0f;
+                        for(int c = 0; c < 4; c++)
+                            t += static_cast<float>((block[p][c] - a[c]) * (b[c] - a[c]));
+
+                        guess = std::clamp(static_cast<int>(std::lround(t / line_length * 15.0f)), 0, 15);
+                    }
+
+                    int closest_error = std::numeric_limits<int>::max(), closest = guess;
+                    for(int i = std::max(guess - 1, 0); i <= std::min(guess + 1, 15); i++) {
+                        int e = 0;
+                        for(int c = 0; c < 4; c++) {
+                            const int d = palette[i][c] - block[p][c];
+                            e += d * d;
+                        }
+
+                        if(e < closest_error) {
+                            closest_error = e;
+                            closest = i;
+                        }
+                    }
+
+                    error += closest_error;
+                    indices[p] = closest;
+                }
+
+                if(error < iteration_error) {
+                    iteration_error = error;
+                    iteration_indices = indices;
+                }
+
+                if(error < best_error) {
+                    best_error = error;
+                    best_endpoints = endpoints;
+                    best_indices = indices;
+                }
+            }
+
+            if(best_error == 0)
+                break;
+
+            std::array<float, 16> weights;
+            for(int p = 0; p < 16; p++)
+                weights[p] = 1.0f - bc7_weights[iteration_indices[p]] / 64.0f;
+
+            if(!least_squares_endpoints<4>(block, weights, start, end))
+                break;
+        }
+
+        // the anchor index is stored without its top bit, so it has to be in the lower half
+        if(best_indices[0] >= 8) {
+            std::swap(best_endpoints.start, best_endpoints.end);
+            std::swap(best_endpoints.start_pbit, best_endpoints.end_pbit);
+
+            for(auto& index : best_indices)
+                index = 15 - index;
+        }
+
+        memset(output, 0, 16);
+
+        bit_writer writer = {output};
+        writer.write(1 << 6, 7);
+
+        for(int c = 0; c < 4; c++) {
+            writer.write(best_endpoints.start[c], 7);
+            writer.write(best_endpoints.end[c], 7);
+        }
+
+        writer.write(best_endpoints.start_pbit, 1);
+        writer.write(best_endpoints.end_pbit, 1);
+
+        for(int p = 0; p < 16; p++)
+            writer.write(best_indices[p], p == 0 ? 3 : 4);
+    }
+
+    void decode_bc7(const uint8_t* input, block_pixels& block) {
+        bit_reader reader = {input};
+
+        int mode = 0;
+        while(mode < 8 && reader.read(1) == 0)
+            mode++;
+
+        if(mode != 6) {
+            for(auto& pixel : block)
+                pixel = {0, 0, 0, 0};
+
+            return;
+        }
+
+        std::array<int, 4> a, b;
+        for(int c = 0; c < 4; c++) {
+            a[c] = reader.read(7);
+            b[c] = reader.read(7);
+        }
+
+        const int start_pbit = reader.read(1);
+        const int end_pbit = reader.read(1);
+
+        for(int c = 0; c < 4; c++) {
+            a[c] = (a[c] << 1) | start_pbit;
+            b[c] = (b[c] << 1) | end_pbit;
+        }
+
+        for(int p = 0; p < 16; p++) {
+            const int weight = bc7_weights[reader.read(p == 0 ? 3 : 4)];
+            for(int c = 0; c < 4; c++)
+                block[p][c] = static_cast<uint8_t>(((64 - weight) * a[c] + weight * b[c] + 32) >> 6);
+        }
+    }
+}
+
+void prism::compress_blocks(const texture_format format, const uint8_t* rgba, const uint32_t width, const uint32_t height, uint8_t* output) {
+    const uint32_t blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+    const uint32_t block_size = get_block_size(format);
+
+    for(uint32_t y = 0; y < blocks_y; y++) {
+        for(uint32_t x = 0; x < blocks_x; x++) {
+            const auto block = fetch_block(rgba, width, height, x, y);
+            uint8_t* destination = output + (y * blocks_x + x) * block_size;
+
+            switch(format) {
+                case texture_format::bc1:
+                    encode_bc1(block, destination);
+                    break;
+                case texture_format::bc3:
+                    encode_bc4(block, 3, destination);
+                    encode_bc1(block, destination + 8);
+                    break;
+                case texture_format::bc4:
+                    encode_bc4(block, 0, destination);
+                    break;
+                case texture_format::bc5:
+                    encode_bc4(block, 0, destination);
+                    encode_bc4(block, 1, destination + 8);
+                    break;
+                case texture_format::bc7:
+                    encode_bc7(block, destination);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+void prism::decompress_blocks(const texture_format format, const uint8_t* blocks, const uint32_t width, const uint32_t height, uint8_t* rgba) {
+    const uint32_t blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+    const uint32_t block_size = get_block_size(format);
+
+    for(uint32_t y = 0; y < blocks_y; y++) {
+        for(uint32_t x = 0; x < blocks_x; x++) {
+            const uint8_t* source = blocks + (y * blocks_x + x) * block_size;
+
+            // matches what the gpu returns for channels the format doesn't store
+            block_pixels block;
+            for(auto& pixel : block)
+                pixel = {0, 0, 0, 255};
+
+            switch(format) {
+                case texture_format::bc1:
+                    decode_bc1(source, block, false);
+                    break;
+                case texture_format::bc3:
+                    decode_bc1(source + 8, block, true);
+                    decode_bc4(source, block, 3);
+                    break;
+                case texture_format::bc4:
+                    decode_bc4(source, block, 0);
+                    break;
+                case texture_format::bc5:
+                    decode_bc4(source, block, 0);
+                    decode_bc4(source + 8, block, 1);
+                    break;
+                case texture_format::bc7:
+                    decode_bc7(source, block);
+                    break;
+                default:
+                    break;
+            }
+
+            store_block(block, rgba, width, height, x, y);
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#include "light_clusters.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "thread_pool.hpp"
+
+void prism::light_clusters::build(const Matrix4x4& view, const Matrix4x4& projection, const float z_near, const float z_far, const std::vector<float4>& lights, thread_pool& pool) {
+    size_x = tiles_x;
+    size_y = tiles_y;
+    size_z = slices;
+
+    scale_x = projection[0][0];
+    scale_y = projection[1][1];
+
+    this->z_near = z_near;
+    this->z_far = z_far;
+
+    slice_scale = static_cast<float>(slices) / std::log(z_far / z_near);
+    slice_bias = slice_scale * std::log(z_near);
+
+    light_x.resize(lights.size());
+    light_y.resize(lights.size());
+    light_z.resize(lights.size());
+    light_radius.resize(lights.size());
+
+    for(size_t i = 0; i < lights.size(); i++) {
+        const auto position = view * float4(lights[i].xyz, 1.0f);
+
+        light_x[i] = position.x;
+        light_y[i] = position.y;
+        light_z[i] = position.z;
+        light_radius[i] = lights[i].w;
+    }
+
+    scratch.resize(slices);
+
+    pool.parallel_for(slices, [this](const uint32_t slice) {
+        bin_slice(slice);
+    });
+
+    // the slices are put back together in order, after the offsets and counts of every cluster
+    grid.resize(static_cast<size_t>(size_x) * size_y * size_z * 2);
+    max_cluster_lights = 0;
+
+    uint32_t cluster = 0;
+    for(const auto& slice : scratch) {
+        auto index = slice.indices.begin();
+        for(const auto count : slice.counts) {
+            grid[cluster * 2] = static_cast<uint32_t>(grid.size());
+            grid[cluster * 2 + 1] = count;
+            grid.insert(grid.end(), index, index + count);
+
+            max_cluster_lights = std::max(max_cluster_lights, count);
+
+            index += count;
+            cluster++;
+        }
+    }
+}
+
+void prism::light_clusters::build_single(const uint32_t light_count) {
+    size_x = size_y = size_z = 1;
+    slice_scale = slice_bias = 0.0f;
+
+    grid = {2, light_count};
+    for(uint32_t i = 0; i < light_count; i++)
+        grid.push_back(i);
+
+    max_cluster_lights = light_count;
+}
+
+void prism::light_clusters::bin_slice(const uint32_t slice) {
+    auto& data = scratch[slice];
+
+    // nothing is in front of the first slice or behind the last one
+    const float slice_near = slice == 0 ? 0.0f : z_near * std::pow(z_far / z_near, static_cast<float>(slice) / static_cast<float>(slices));
+    const float slice_far = slice == slices - 1 ? std::numeric_limits<float>::max() : z_near * std::pow(z_far / z_near, static_cast<float>(slice + 1) / static_cast<float>(slices));
+
+    data.candidates.clear();
+    data.x.clear();
+    data.y.clear();
+    data.z.clear();
+    data.radius_squared.clear();
+
+    for(uint32_t i = 0; i < light_z.size(); i++) {
+        if(light_z[i] + light_radius[i] < slice_near || light_z[i] - light_radius[i] > slice_far)
+            continue;
+
+        data.candidates.push_back(i);
+        data.x.push_back(light_x[i]);
+        data.y.push_back(light_y[i]);
+        data.z.push_back(light_z[i]);
+        data.radius_squared.push_back(light_radius[i] * light_radius[i]);
+    }
+
+    const size_t candidate_count = data.candidates.size();
+    data.inside.resize(candidate_count);
+
+    data.indices.clear();
+    data.counts.assign(tiles_x * tiles_y, 0);
+
+    for(uint32_t tile_y = 0; tile_y < tiles_y; tile_y++) {
+        const float ndc_min_y = -1.0f + 2.0f * static_cast<float>(tile_y) / static_cast<float>(tiles_y);
+        const float ndc_max_y = -1.0f + 2.0f * static_cast<float>(tile_y + 1) / static_cast<float>(tiles_y);
+
+        // the tile's edges lean outwards, so its bounds at both ends of the slice are needed
+        const float min_y = std::min({ndc_min_y / scale_y * slice_near, ndc_min_y / scale_y * slice_far});
+        const float max_y = std::max({ndc_max_y / scale_y * slice_near, ndc_max_y / scale_y * slice_far});
+
+        for(uint32_t tile_x = 0; tile_x < tiles_x; tile_x++) {
+            const float ndc_min_x = -1.0f + 2.0f * static_cast<float>(tile_x) / static_cast<float>(tiles_x);
+            const float ndc_max_x = -1.0f + 2.0f * static_cast<float>(tile_x + 1) / static_cast<float>(tiles_x);
+
+            const float min_x = std::min({ndc_min_x / scale_x * slice_near, ndc_min_x / scale_x * slice_far});
+            const float max_x = std::max({ndc_max_x / scale_x * slice_near, ndc_max_x / scale_x * slice_far});
+
+            // plain arrays and no branches, so this vectorizes
+            for(size_t i = 0; i < candidate_count; i++) {
+                const float distance_x = std::max(std::max(min_x - data.x[i], data.x[i] - max_x), 0.0f);
+                const float distance_y = std::max(std::max(min_y - data.y[i], data.y[i] - max_y), 0.0f);
+                const float distance_z = std::max(std::max(slice_near - data.z[i], data.z[i] - slice_far), 0.0f);
+
+                data.inside[i] = distance_x * distance_x + distance_y * distance_y + distance_z * distance_z <= data.radius_squared[i];
+            }
+
+            uint32_t count = 0;
+            for(size_t i = 0; i < candidate_count; i++) {
+                if(data.inside[i]) {
+                    data.indices.push_back(data.candidates[i]);
+                    count++;
+                }
+            }
+
+            data.counts[tile_y * tiles_x + tile_x] = count;
+        }
+    }
+}
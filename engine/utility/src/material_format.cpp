@@ -0,0 +1,110 @@
+#include "material_format.hpp"
+
+#include <cstring>
+
+namespace {
+    template<typename T>
+    void write_array(std::vector<std::byte>& data, const T* values, const size_t count) {
+        const size_t offset = data.size();
+        data.resize(offset + sizeof(T) * count);
+
+        if(count > 0)
+            memcpy(data.data() + offset, values, sizeof(T) * count);
+    }
+
+    template<typename T>
+    bool read_array(const std::byte* data, const size_t size, size_t& offset, std::vector<T>& values, const uint32_t count) {
+        // compared as 64-bit, so a huge count can't overflow past the check
+        if(offset + static_cast<uint64_t>(sizeof(T)) * count > size)
+            return false;
+
+        values.resize(count);
+
+        if(count > 0)
+            memcpy(values.data(), data + offset, sizeof(T) * count);
+
+        offset += sizeof(T) * count;
+
+        return true;
+    }
+}
+
+uint32_t prism::material_file::add_string(const std::string_view string) {
+    const auto offset = static_cast<uint32_t>(strings.size());
+
+    strings += string;
+    strings += '\0';
+
+    return offset;
+}
+
+std::string_view prism::material_file::get_string(const uint32_t offset) const {
+    if(offset >= strings.size())
+        return {};
+
+    // the string table is always null terminated, see read_material_file()
+    return std::string_view(strings.data() + offset);
+}
+
+bool prism::is_binary_material(const std::byte* data, const size_t size) {
+    return size >= material_magic.size() && memcmp(data, material_magic.data(), material_magic.size()) == 0;
+}
+
+std::vector<std::byte> prism::write_material_file(const material_file& file) {
+    material_header header;
+    header.node_count = static_cast<uint32_t>(file.nodes.size());
+    header.property_count = static_cast<uint32_t>(file.properties.size());
+    header.connection_count = static_cast<uint32_t>(file.connections.size());
+    header.string_size = static_cast<uint32_t>(file.strings.size());
+
+    std::vector<std::byte> data;
+    write_array(data, &header, 1);
+    write_array(data, file.nodes.data(), file.nodes.size());
+    write_array(data, file.properties.data(), file.properties.size());
+    write_array(data, file.connections.data(), file.connections.size());
+    write_array(data, file.strings.data(), file.strings.size());
+
+    return data;
+}
+
+std::optional<prism::material_file> prism::read_material_file(const std::byte* data, const size_t size) {
+    if(size < sizeof(material_header))
+        return std::nullopt;
+
+    material_header header;
+    memcpy(&header, data, sizeof(material_header));
+
+    if(header.magic != material_magic || header.version != material_version)
+        return std::nullopt;
+
+    size_t offset = sizeof(material_header);
+
+    material_file file;
+    if(!read_array(data, size, offset, file.nodes, header.node_count) ||
+       !read_array(data, size, offset, file.properties, header.property_count) ||
+       !read_array(data, size, offset, file.connections, header.connection_count))
+        return std::nullopt;
+
+    std::vector<char> strings;
+    if(!read_array(data, size, offset, strings, header.string_size))
+        return std::nullopt;
+
+    if(!strings.empty() && strings.back() != '\0')
+        return std::nullopt;
+
+    file.strings.assign(strings.begin(), strings.end());
+
+    uint64_t node_property_count = 0;
+    for(const auto& node : file.nodes)
+        node_property_count += node.property_count;
+
+    if(node_property_count != header.property_count)
+        return std::nullopt;
+
+    for(const auto& connection : file.connections) {
+        if(connection.output_node >= header.node_count || connection.input_node >= header.node_count)
+            return std::nullopt;
+    }
+
+    return file;
+}
@@ -0,0 +1,904 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+    constexpr uint32_t invalid_index = std::numeric_limits<uint32_t>::max();
+
+    // forsyth's tuning values, see "Linear-Speed Vertex Cache Optimisation"
+    constexpr int max_cache_size = 32;
+    constexpr float cache_decay_power = 1.5f;
+    constexpr float last_triangle_score = 0.75f;
+    constexpr float valence_boost_scale = 2.0f;
+    constexpr float valence_boost_power = 0.5f;
+
+    float calculate_vertex_score(const int cache_position, const uint32_t remaining_triangles) {
+        // no triangles left to use this vertex, so it doesn't matter anymore
+        if(remaining_triangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if(cache_position >= 0) {
+            // the last triangle's vertices get a fixed score, so the next triangle doesn't just reuse two of them and form a strip
+            if(cache_position < 3) {
+                score = last_triangle_score;
+            } else {
+                const float scaler = 1.0f / static_cast<float>(max_cache_size - 3);
+                score = std::pow(1.0f - static_cast<float>(cache_position - 3) * scaler, cache_decay_power);
+            }
+        }
+
+        // vertices with only a few triangles left are finished off first, so they can leave the cache
+        score += valence_boost_scale * std::pow(static_cast<float>(remaining_triangles), -valence_boost_power);
+
+        return score;
+    }
+
+    /// Tracks which vertices are in a FIFO cache without storing the cache itself, a vertex is cached if fewer than cache_size misses happened since it was inserted.
+    class fifo_cache {
+    public:
+        fifo_cache(const size_t element_count, const uint32_t cache_size) : timestamps(element_count, 0), time(cache_size + 1), cache_size(cache_size) {}
+
+        /// Returns true if the element missed the cache, and inserts it.
+        bool access(const size_t element) {
+            if(time - timestamps[element] > cache_size) {
+                timestamps[element] = time++;
+                return true;
+            }
+
+            return false;
+        }
+
+        /// Evicts everything, as if the cache was just created.
+        void reset() {
+            time += cache_size + 1;
+        }
+
+    private:
+        std::vector<uint32_t> timestamps;
+        uint32_t time = 0, cache_size = 0;
+    };
+
+    uint32_t count_unique_vertices(const std::vector<uint32_t>& indices, const uint32_t vertex_count) {
+        std::vector<bool> referenced(vertex_count, false);
+
+        uint32_t unique = 0;
+        for(const auto index : indices) {
+            if(!referenced[index]) {
+                referenced[index] = true;
+                unique++;
+            }
+        }
+
+        return unique;
+    }
+
+    /// A contiguous range of triangles that is moved around as a whole.
+    struct triangle_cluster {
+        size_t start = 0, end = 0;
+        prism::float3 centroid, normal;
+        float area = 0.0f;
+        float sort_key = 0.0f;
+    };
+
+    /// Sorts clusters so the ones facing away from the center of the mesh come first, they're the most likely to occlude everything else.
+    void sort_clusters_outwards(std::vector<triangle_cluster>& clusters, const std::vector<uint32_t>& indices, const std::vector<prism::float3>& positions) {
+        prism::float3 mesh_centroid;
+        float mesh_area = 0.0f;
+
+        for(auto& cl : clusters) {
+            for(size_t t = cl.start; t < cl.end; t++) {
+                const auto& a = positions[indices[t * 3]];
+                const auto& b = positions[indices[t * 3 + 1]];
+                const auto& c = positions[indices[t * 3 + 2]];
+
+                // the cross product's length is twice the area, so this is already area weighted
+                const auto n = prism::cross(b - a, c - a);
+                const float area = prism::length(n);
+
+                cl.centroid += (a + b + c) * (area / 3.0f);
+                cl.normal += n;
+                cl.area += area;
+            }
+
+            mesh_centroid += cl.centroid;
+            mesh_area += cl.area;
+
+            if(cl.area > 0.0f)
+                cl.centroid = cl.centroid / cl.area;
+        }
+
+        if(mesh_area > 0.0f)
+            mesh_centroid = mesh_centroid / mesh_area;
+
+        for(auto& cl : clusters) {
+            const float normal_length = prism::length(cl.normal);
+            if(normal_length > 0.0f)
+                cl.sort_key = prism::dot(cl.centroid - mesh_centroid, cl.normal / normal_length);
+        }
+
+        std::stable_sort(clusters.begin(), clusters.end(), [](const triangle_cluster& a, const triangle_cluster& b) {
+            return a.sort_key > b.sort_key;
+        });
+    }
+}
+
+prism::vertex_cache_statistics prism::analyze_vertex_cache(const std::vector<uint32_t>& indices, const uint32_t vertex_count, const uint32_t cache_size) {
+    vertex_cache_statistics statistics;
+    if(indices.empty())
+        return statistics;
+
+    fifo_cache cache(vertex_count, cache_size);
+
+    uint32_t misses = 0;
+    for(const auto index : indices) {
+        if(cache.access(index))
+            misses++;
+    }
+
+    statistics.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    statistics.atvr = static_cast<float>(misses) / static_cast<float>(count_unique_vertices(indices, vertex_count));
+
+    return statistics;
+}
+
+prism::vertex_fetch_statistics prism::analyze_vertex_fetch(const std::vector<uint32_t>& indices, const uint32_t vertex_count, const uint32_t vertex_size) {
+    constexpr uint32_t cache_line_size = 64;
+    constexpr uint32_t cache_line_count = 128;
+
+    vertex_fetch_statistics statistics;
+    if(indices.empty() || vertex_size == 0)
+        return statistics;
+
+    const uint64_t buffer_size = static_cast<uint64_t>(vertex_count) * vertex_size;
+    fifo_cache cache(buffer_size / cache_line_size + 1, cache_line_count);
+
+    // vertices still in the post-transform cache are never fetched again
+    fifo_cache vertex_cache(vertex_count, 16);
+
+    for(const auto index : indices) {
+        if(!vertex_cache.access(index))
+            continue;
+
+        const uint64_t first_line = static_cast<uint64_t>(index) * vertex_size / cache_line_size;
+        const uint64_t last_line = (static_cast<uint64_t>(index + 1) * vertex_size - 1) / cache_line_size;
+
+        for(uint64_t line = first_line; line <= last_line; line++) {
+            if(cache.access(line))
+                statistics.bytes_fetched += cache_line_size;
+        }
+    }
+
+    const uint64_t referenced_size = static_cast<uint64_t>(count_unique_vertices(indices, vertex_count)) * vertex_size;
+    statistics.overfetch = static_cast<float>(statistics.bytes_fetched) / static_cast<float>(referenced_size);
+
+    return statistics;
+}
+
+std::vector<uint32_t> prism::optimize_vertex_cache(const std::vector<uint32_t>& indices, const uint32_t vertex_count) {
+    const size_t triangle_count = indices.size() / 3;
+
+    // triangles using each vertex, only the first remaining_triangles[v] entries of each list are still to be emitted
+    std::vector<uint32_t> remaining_triangles(vertex_count, 0);
+    for(const auto index : indices)
+        remaining_triangles[index]++;
+
+    std::vector<uint32_t> adjacency_offsets(vertex_count, 0);
+    for(uint32_t v = 1; v < vertex_count; v++)
+        adjacency_offsets[v] = adjacency_offsets[v - 1] + remaining_triangles[v - 1];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill = adjacency_offsets;
+        for(size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int> cache_positions(vertex_count, -1);
+
+    std::vector<float> vertex_scores(vertex_count);
+    for(uint32_t v = 0; v < vertex_count; v++)
+        vertex_scores[v] = calculate_vertex_score(-1, remaining_triangles[v]);
+
+    std::vector<float> triangle_scores(triangle_count);
+    for(size_t t = 0; t < triangle_count; t++)
+        triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+
+    std::vector<bool> emitted(triangle_count, false);
+
+    std::vector<uint32_t> cache, new_cache;
+    cache.reserve(max_cache_size + 3);
+    new_cache.reserve(max_cache_size + 3);
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    size_t input_cursor = 0;
+    int64_t best_triangle = -1;
+
+    for(size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++) {
+        // nothing in the cache has triangles left, so start somewhere else
+        if(best_triangle < 0) {
+            while(emitted[input_cursor])
+                input_cursor++;
+
+            best_triangle = static_cast<int64_t>(input_cursor);
+        }
+
+        const auto triangle = static_cast<uint32_t>(best_triangle);
+        const uint32_t* triangle_indices = indices.data() + triangle * 3;
+
+        result.insert(result.end(), triangle_indices, triangle_indices + 3);
+        emitted[triangle] = true;
+
+        new_cache.clear();
+
+        for(int i = 0; i < 3; i++) {
+            const uint32_t v = triangle_indices[i];
+
+            uint32_t* list = adjacency.data() + adjacency_offsets[v];
+            const auto found = std::find(list, list + remaining_triangles[v], triangle);
+            std::swap(*found, list[remaining_triangles[v] - 1]);
+            remaining_triangles[v]--;
+
+            if(std::find(new_cache.begin(), new_cache.end(), v) == new_cache.end())
+                new_cache.push_back(v);
+        }
+
+        for(const auto v : cache) {
+            if(std::find(new_cache.begin(), new_cache.end(), v) == new_cache.end())
+                new_cache.push_back(v);
+        }
+
+        // update the scores of everything that moved in or out of the cache, including what was just pushed out
+        for(size_t i = 0; i < new_cache.size(); i++) {
+            const uint32_t v = new_cache[i];
+
+            cache_positions[v] = i < max_cache_size ? static_cast<int>(i) : -1;
+
+            const float score = calculate_vertex_score(cache_positions[v], remaining_triangles[v]);
+            const float delta = score - vertex_scores[v];
+            vertex_scores[v] = score;
+
+            const uint32_t* list = adjacency.data() + adjacency_offsets[v];
+            for(uint32_t j = 0; j < remaining_triangles[v]; j++)
+                triangle_scores[list[j]] += delta;
+        }
+
+        if(new_cache.size() > max_cache_size)
+            new_cache.resize(max_cache_size);
+
+        std::swap(cache, new_cache);
+
+        // only triangles touching the cache are considered, which is what keeps this linear
+        best_triangle = -1;
+        float best_score = -std::numeric_limits<float>::max();
+
+        for(const auto v : cache) {
+            const uint32_t* list = adjacency.data() + adjacency_offsets[v];
+            for(uint32_t j = 0; j < remaining_triangles[v]; j++) {
+                if(triangle_scores[list[j]] > best_score) {
+                    best_triangle = list[j];
+                    best_score = triangle_scores[list[j]];
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+std::vector<uint32_t> prism::optimize_overdraw(const std::vector<uint32_t>& indices, const std::vector<float3>& positions, const float threshold) {
+    constexpr uint32_t cache_size = 16;
+
+    const size_t triangle_count = indices.size() / 3;
+    if(triangle_count == 0)
+        return indices;
+
+    std::vector<uint32_t> triangle_misses(triangle_count);
+    {
+        fifo_cache cache(positions.size(), cache_size);
+        for(size_t t = 0; t < triangle_count; t++) {
+            for(int i = 0; i < 3; i++)
+                triangle_misses[t] += cache.access(indices[t * 3 + i]) ? 1 : 0;
+        }
+    }
+
+    // hard boundaries are where the existing order already starts over, so splitting there costs nothing
+    std::vector<size_t> hard_boundaries;
+    for(size_t t = 0; t < triangle_count; t++) {
+        if(t == 0 || triangle_misses[t] == 3)
+            hard_boundaries.push_back(t);
+    }
+
+    hard_boundaries.push_back(triangle_count);
+
+    fifo_cache cache(positions.size(), cache_size);
+
+    const auto count_misses = [&indices, &cache](const size_t triangle) {
+        uint32_t misses = 0;
+        for(int i = 0; i < 3; i++)
+            misses += cache.access(indices[triangle * 3 + i]) ? 1 : 0;
+
+        return misses;
+    };
+
+    // soft boundaries split those further, but only once the triangles so far (starting from a cold cache, since clusters are reordered) are within the acmr threshold
+    std::vector<size_t> boundaries;
+    for(size_t i = 0; i + 1 < hard_boundaries.size(); i++) {
+        const size_t start = hard_boundaries[i], end = hard_boundaries[i + 1];
+
+        cache.reset();
+
+        uint32_t cluster_misses = 0;
+        for(size_t t = start; t < end; t++)
+            cluster_misses += count_misses(t);
+
+        const float target_acmr = static_cast<float>(cluster_misses) / static_cast<float>(end - start) * threshold;
+
+        boundaries.push_back(start);
+
+        cache.reset();
+
+        uint32_t running_misses = 0, running_triangles = 0;
+        for(size_t t = start; t + 1 < end; t++) {
+            running_misses += count_misses(t);
+            running_triangles++;
+
+            if(static_cast<float>(running_misses) / static_cast<float>(running_triangles) <= target_acmr) {
+                boundaries.push_back(t + 1);
+
+                cache.reset();
+
+                running_misses = 0;
+                running_triangles = 0;
+            }
+        }
+    }
+
+    boundaries.push_back(triangle_count);
+
+    const size_t cluster_count = boundaries.size() - 1;
+
+    std::vector<triangle_cluster> clusters(cluster_count);
+    for(size_t c = 0; c < cluster_count; c++) {
+        clusters[c].start = boundaries[c];
+        clusters[c].end = boundaries[c + 1];
+    }
+
+    sort_clusters_outwards(clusters, indices, positions);
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    for(const auto& cl : clusters)
+        result.insert(result.end(), indices.begin() + cl.start * 3, indices.begin() + cl.end * 3);
+
+    return result;
+}
+
+void prism::optimize_meshlet_overdraw(std::vector<uint32_t>& indices, std::vector<meshlet>& meshlets, const std::vector<float3>& positions) {
+    // every meshlet is a cluster, so the order of the triangles inside of them is left alone
+    std::vector<triangle_cluster> clusters(meshlets.size());
+    for(size_t i = 0; i < meshlets.size(); i++) {
+        clusters[i].start = meshlets[i].index_offset / 3;
+        clusters[i].end = (meshlets[i].index_offset + meshlets[i].index_count) / 3;
+    }
+
+    sort_clusters_outwards(clusters, indices, positions);
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    std::vector<meshlet> sorted_meshlets;
+    sorted_meshlets.reserve(meshlets.size());
+
+    for(const auto& cl : clusters) {
+        // meshlets are still sorted by their offset, so the one this cluster came from can be found again
+        auto m = *std::lower_bound(meshlets.begin(), meshlets.end(), cl.start * 3, [](const meshlet& other, const size_t offset) {
+            return other.index_offset < offset;
+        });
+        m.index_offset = static_cast<uint32_t>(result.size());
+
+        result.insert(result.end(), indices.begin() + cl.start * 3, indices.begin() + cl.end * 3);
+        sorted_meshlets.push_back(m);
+    }
+
+    indices = std::move(result);
+    meshlets = std::move(sorted_meshlets);
+}
+
+std::vector<uint32_t> prism::optimize_vertex_fetch_remap(const std::vector<uint32_t>& indices, const uint32_t vertex_count) {
+    std::vector<uint32_t> remap(vertex_count, invalid_index);
+
+    uint32_t next_vertex = 0;
+    for(const auto index : indices) {
+        if(remap[index] == invalid_index)
+            remap[index] = next_vertex++;
+    }
+
+    for(auto& new_index : remap) {
+        if(new_index == invalid_index)
+            new_index = next_vertex++;
+    }
+
+    return remap;
+}
+
+std::vector<prism::meshlet> prism::build_meshlets(std::vector<uint32_t>& indices, const std::vector<float3>& positions, const size_t max_vertices, const size_t max_triangles) {
+    const size_t triangle_count = indices.size() / 3;
+    const auto vertex_count = static_cast<uint32_t>(positions.size());
+
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for(const auto index : indices)
+        adjacency_offsets[index + 1]++;
+
+    for(uint32_t v = 0; v < vertex_count; v++)
+        adjacency_offsets[v + 1] += adjacency_offsets[v];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for(size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<float3> triangle_centers(triangle_count);
+    for(size_t t = 0; t < triangle_count; t++)
+        triangle_centers[t] = (positions[indices[t * 3]] + positions[indices[t * 3 + 1]] + positions[indices[t * 3 + 2]]) / 3.0f;
+
+    std::vector<bool> emitted(triangle_count, false);
+
+    // which meshlet a vertex was last added to, so checking if it's already in the current one is constant time
+    std::vector<uint32_t> vertex_meshlet(vertex_count, invalid_index);
+
+    std::vector<meshlet> meshlets;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    std::vector<uint32_t> vertices;
+    std::vector<float3> normals;
+
+    const auto count_new_vertices = [&](const uint32_t triangle, const uint32_t meshlet_index) {
+        int new_vertices = 0;
+        for(int i = 0; i < 3; i++)
+            new_vertices += vertex_meshlet[indices[triangle * 3 + i]] != meshlet_index ? 1 : 0;
+
+        return new_vertices;
+    };
+
+    size_t seed_cursor = 0;
+    while(true) {
+        while(seed_cursor < triangle_count && emitted[seed_cursor])
+            seed_cursor++;
+
+        if(seed_cursor == triangle_count)
+            break;
+
+        const auto meshlet_index = static_cast<uint32_t>(meshlets.size());
+
+        meshlet m;
+        m.index_offset = static_cast<uint32_t>(result.size());
+
+        vertices.clear();
+
+        float3 center_sum;
+        size_t triangles = 0;
+
+        auto triangle = static_cast<int64_t>(seed_cursor);
+        while(triangle >= 0) {
+            emitted[triangle] = true;
+            triangles++;
+
+            for(int i = 0; i < 3; i++) {
+                const uint32_t v = indices[triangle * 3 + i];
+                result.push_back(v);
+
+                if(vertex_meshlet[v] != meshlet_index) {
+                    vertex_meshlet[v] = meshlet_index;
+                    vertices.push_back(v);
+                }
+            }
+
+            center_sum += triangle_centers[triangle];
+
+            if(triangles == max_triangles)
+                break;
+
+            // grow into the neighbouring triangle that adds the fewest vertices, and then the one closest to the middle so the meshlet stays round
+            const float3 center = center_sum / static_cast<float>(triangles);
+
+            triangle = -1;
+            int best_new_vertices = 4;
+            float best_distance = std::numeric_limits<float>::max();
+
+            for(const auto v : vertices) {
+                for(uint32_t j = adjacency_offsets[v]; j < adjacency_offsets[v + 1]; j++) {
+                    const uint32_t candidate = adjacency[j];
+                    if(emitted[candidate])
+                        continue;
+
+                    const int new_vertices = count_new_vertices(candidate, meshlet_index);
+                    if(vertices.size() + new_vertices > max_vertices)
+                        continue;
+
+                    const float distance = length(triangle_centers[candidate] - center);
+                    if(new_vertices < best_new_vertices || (new_vertices == best_new_vertices && distance < best_distance)) {
+                        triangle = candidate;
+                        best_new_vertices = new_vertices;
+                        best_distance = distance;
+                    }
+                }
+            }
+        }
+
+        m.index_count = static_cast<uint32_t>(result.size()) - m.index_offset;
+
+        // growing the meshlet doesn't care about the vertex cache, so fix up the order inside of it
+        {
+            std::vector<uint32_t> local_indices(m.index_count);
+            for(uint32_t i = 0; i < m.index_count; i++) {
+                const uint32_t v = result[m.index_offset + i];
+                local_indices[i] = static_cast<uint32_t>(std::find(vertices.begin(), vertices.end(), v) - vertices.begin());
+            }
+
+            local_indices = optimize_vertex_cache(local_indices, static_cast<uint32_t>(vertices.size()));
+
+            for(uint32_t i = 0; i < m.index_count; i++)
+                result[m.index_offset + i] = vertices[local_indices[i]];
+        }
+
+        float3 min_position = positions[vertices[0]], max_position = positions[vertices[0]];
+        for(const auto v : vertices) {
+            for(int i = 0; i < 3; i++) {
+                min_position[i] = std::min(min_position[i], positions[v][i]);
+                max_position[i] = std::max(max_position[i], positions[v][i]);
+            }
+        }
+
+        m.center = (min_position + max_position) / 2.0f;
+        for(const auto v : vertices)
+            m.radius = std::max(m.radius, length(positions[v] - m.center));
+
+        normals.clear();
+        for(size_t i = m.index_offset; i < result.size(); i += 3) {
+            const auto& a = positions[result[i]];
+            const auto n = cross(positions[result[i + 1]] - a, positions[result[i + 2]] - a);
+
+            // degenerate triangles are never visible, so they don't limit the cone
+            const float n_length = length(n);
+            if(n_length > 0.0f) {
+                normals.push_back(n / n_length);
+                m.cone_axis += normals.back();
+            }
+        }
+
+        const float axis_length = length(m.cone_axis);
+        if(axis_length > 0.0f) {
+            m.cone_axis = m.cone_axis / axis_length;
+
+            float min_dot = 1.0f;
+            for(const auto& n : normals)
+                min_dot = std::min(min_dot, dot(n, m.cone_axis));
+
+            // the cone is wider than a hemisphere (or close to it), so there's no direction it can be culled from
+            if(min_dot > 0.1f)
+                m.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+        }
+
+        meshlets.push_back(m);
+    }
+
+    indices = std::move(result);
+
+    return meshlets;
+}
+
+bool prism::is_meshlet_backfacing(const meshlet& meshlet, const float3 camera_position) {
+    if(meshlet.cone_cutoff >= 1.0f)
+        return false;
+
+    // the sphere makes this conservative, any point in the meshlet sees it at a narrower angle than the cutoff
+    const float3 view = meshlet.center - camera_position;
+
+    return dot(view, meshlet.cone_axis) >= meshlet.cone_cutoff * length(view) + meshlet.radius;
+}
+
+std::vector<uint32_t> prism::remap_indices(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap) {
+    std::vector<uint32_t> result(indices.size());
+    for(size_t i = 0; i < indices.size(); i++)
+        result[i] = remap[indices[i]];
+
+    return result;
+}
+
+namespace {
+    /// The sum of squared distances to a set of planes, see Garland and Heckbert's "Surface Simplification Using Quadric Error Metrics".
+    struct quadric {
+        float a2 = 0.0f, b2 = 0.0f, c2 = 0.0f, d2 = 0.0f;
+        float ab = 0.0f, ac = 0.0f, ad = 0.0f;
+        float bc = 0.0f, bd = 0.0f, cd = 0.0f;
+        float weight = 0.0f;
+
+        void add_plane(const prism::float3 n, const float d, const float w) {
+            a2 += n.x * n.x * w;
+            b2 += n.y * n.y * w;
+            c2 += n.z * n.z * w;
+            d2 += d * d * w;
+            ab += n.x * n.y * w;
+            ac += n.x * n.z * w;
+            ad += n.x * d * w;
+            bc += n.y * n.z * w;
+            bd += n.y * d * w;
+            cd += n.z * d * w;
+            weight += w;
+        }
+
+        quadric& operator+=(const quadric& other) {
+            a2 += other.a2;
+            b2 += other.b2;
+            c2 += other.c2;
+            d2 += other.d2;
+            ab += other.ab;
+            ac += other.ac;
+            ad += other.ad;
+            bc += other.bc;
+            bd += other.bd;
+            cd += other.cd;
+            weight += other.weight;
+
+            return *this;
+        }
+
+        /// Returns the average squared distance from p to the planes.
+        float error(const prism::float3 p) const {
+            if(weight <= 0.0f)
+                return 0.0f;
+
+            const float rx = a2 * p.x + ab * p.y + ac * p.z + ad;
+            const float ry = ab * p.x + b2 * p.y + bc * p.z + bd;
+            const float rz = ac * p.x + bc * p.y + c2 * p.z + cd;
+            const float rw = ad * p.x + bd * p.y + cd * p.z + d2;
+
+            return std::abs(rx * p.x + ry * p.y + rz * p.z + rw) / weight;
+        }
+    };
+
+    struct position_hash {
+        size_t operator()(const prism::float3& p) const {
+            uint32_t bits[3] = {};
+            memcpy(bits, p.data.data(), sizeof(bits));
+
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    struct position_equal {
+        bool operator()(const prism::float3& a, const prism::float3& b) const {
+            return a.x == b.x && a.y == b.y && a.z == b.z;
+        }
+    };
+
+    struct collapse {
+        uint32_t from = 0, to = 0;
+        float error = 0.0f;
+    };
+
+    // triangles whose normal rotates further than this (about 75 degrees) would visibly fold over, so the collapse is rejected
+    constexpr float max_flip_cosine = 0.25f;
+}
+
+std::vector<uint32_t> prism::simplify(const std::vector<uint32_t>& indices, const std::vector<float3>& positions, const size_t target_index_count, const float target_error, float* result_error) {
+    if(result_error != nullptr)
+        *result_error = 0.0f;
+
+    const auto vertex_count = static_cast<uint32_t>(positions.size());
+    if(indices.size() <= target_index_count || vertex_count == 0)
+        return indices;
+
+    // errors are relative to the size of the mesh, so the same threshold works for every model
+    float3 min_position = positions[indices[0]], max_position = positions[indices[0]];
+    for(const auto index : indices) {
+        for(int i = 0; i < 3; i++) {
+            min_position[i] = std::min(min_position[i], positions[index][i]);
+            max_position[i] = std::max(max_position[i], positions[index][i]);
+        }
+    }
+
+    const float extent = std::max({max_position.x - min_position.x, max_position.y - min_position.y, max_position.z - min_position.z});
+    if(extent <= 0.0f)
+        return indices;
+
+    std::vector<float3> scaled_positions(vertex_count);
+    for(uint32_t v = 0; v < vertex_count; v++)
+        scaled_positions[v] = (positions[v] - min_position) / extent;
+
+    // vertices sharing a position are split along an attribute seam, moving one of them would tear the mesh open
+    std::vector<uint32_t> position_owner(vertex_count);
+    std::vector<bool> locked(vertex_count, false);
+    {
+        std::unordered_map<float3, uint32_t, position_hash, position_equal> owners;
+        for(uint32_t v = 0; v < vertex_count; v++) {
+            const auto [it, inserted] = owners.try_emplace(positions[v], v);
+            position_owner[v] = it->second;
+
+            if(!inserted) {
+                locked[v] = true;
+                locked[it->second] = true;
+            }
+        }
+    }
+
+    // the same goes for borders, an edge only used in one direction has nothing on the other side
+    {
+        std::unordered_set<uint64_t> edges;
+        const auto edge_key = [&position_owner](const uint32_t a, const uint32_t b) {
+            return static_cast<uint64_t>(position_owner[a]) << 32 | position_owner[b];
+        };
+
+        for(size_t i = 0; i < indices.size(); i += 3) {
+            for(int e = 0; e < 3; e++)
+                edges.insert(edge_key(indices[i + e], indices[i + (e + 1) % 3]));
+        }
+
+        for(size_t i = 0; i < indices.size(); i += 3) {
+            for(int e = 0; e < 3; e++) {
+                const uint32_t a = indices[i + e], b = indices[i + (e + 1) % 3];
+                if(!edges.count(edge_key(b, a))) {
+                    locked[a] = true;
+                    locked[b] = true;
+                }
+            }
+        }
+    }
+
+    std::vector<quadric> quadrics(vertex_count);
+    for(size_t i = 0; i < indices.size(); i += 3) {
+        const auto& a = scaled_positions[indices[i]];
+        const auto& b = scaled_positions[indices[i + 1]];
+        const auto& c = scaled_positions[indices[i + 2]];
+
+        const auto n = cross(b - a, c - a);
+        const float double_area = length(n);
+        if(double_area <= 0.0f)
+            continue;
+
+        const auto normal = n / double_area;
+        const float d = -dot(normal, a);
+
+        for(int j = 0; j < 3; j++)
+            quadrics[indices[i + j]].add_plane(normal, d, double_area);
+    }
+
+    const float max_error = target_error * target_error;
+    float worst_error = 0.0f;
+
+    std::vector<uint32_t> result = indices;
+    std::vector<uint32_t> remap(vertex_count);
+    std::vector<bool> touched(vertex_count);
+    std::vector<collapse> collapses;
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1), adjacency;
+
+    // each pass collapses the cheapest edges that don't overlap, until the target or the error limit is reached
+    while(result.size() > target_index_count) {
+        collapses.clear();
+        for(size_t i = 0; i < result.size(); i += 3) {
+            for(int e = 0; e < 3; e++) {
+                const uint32_t a = result[i + e], b = result[i + (e + 1) % 3];
+
+                for(const auto& [from, to] : {std::make_pair(a, b), std::make_pair(b, a)}) {
+                    if(locked[from])
+                        continue;
+
+                    quadric q = quadrics[from];
+                    q += quadrics[to];
+
+                    const float error = q.error(scaled_positions[to]);
+                    if(error <= max_error)
+                        collapses.push_back({from, to, error});
+                }
+            }
+        }
+
+        if(collapses.empty())
+            break;
+
+        std::sort(collapses.begin(), collapses.end(), [](const collapse& a, const collapse& b) {
+            return a.error < b.error;
+        });
+
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+        for(const auto index : result)
+            adjacency_offsets[index + 1]++;
+
+        for(uint32_t v = 0; v < vertex_count; v++)
+            adjacency_offsets[v + 1] += adjacency_offsets[v];
+
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for(size_t i = 0; i < result.size(); i++)
+                adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        const auto flips = [&](const collapse& c) {
+            for(uint32_t j = adjacency_offsets[c.from]; j < adjacency_offsets[c.from + 1]; j++) {
+                const uint32_t* triangle = result.data() + adjacency[j] * 3;
+                if(triangle[0] == c.to || triangle[1] == c.to || triangle[2] == c.to)
+                    continue;
+
+                float3 before[3], after[3];
+                for(int k = 0; k < 3; k++) {
+                    before[k] = scaled_positions[triangle[k]];
+                    after[k] = triangle[k] == c.from ? scaled_positions[c.to] : before[k];
+                }
+
+                const auto n0 = cross(before[1] - before[0], before[2] - before[0]);
+                const auto n1 = cross(after[1] - after[0], after[2] - after[0]);
+
+                // already degenerate triangles can't flip, but collapsing must not create new ones
+                const float length0 = length(n0);
+                if(length0 > 0.0f && dot(n0, n1) <= max_flip_cosine * length0 * length(n1))
+                    return true;
+            }
+
+            return false;
+        };
+
+        for(uint32_t v = 0; v < vertex_count; v++)
+            remap[v] = v;
+
+        std::fill(touched.begin(), touched.end(), false);
+
+        // every collapse removes about two triangles
+        const size_t wanted_collapses = (result.size() - target_index_count) / 6 + 1;
+        size_t applied_collapses = 0;
+
+        for(const auto& c : collapses) {
+            if(applied_collapses >= wanted_collapses)
+                break;
+
+            if(touched[c.from] || touched[c.to] || flips(c))
+                continue;
+
+            remap[c.from] = c.to;
+            quadrics[c.to] += quadrics[c.from];
+            worst_error = std::max(worst_error, c.error);
+
+            // the neighbourhood changed, so the flip checks for anything around it aren't valid anymore this pass
+            for(uint32_t j = adjacency_offsets[c.from]; j < adjacency_offsets[c.from + 1]; j++) {
+                const uint32_t* triangle = result.data() + adjacency[j] * 3;
+                for(int k = 0; k < 3; k++)
+                    touched[triangle[k]] = true;
+            }
+
+            applied_collapses++;
+        }
+
+        if(applied_collapses == 0)
+            break;
+
+        size_t write = 0;
+        for(size_t i = 0; i < result.size(); i += 3) {
+            const uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if(a == b || b == c || c == a)
+                continue;
+
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+
+        result.resize(write);
+    }
+
+    if(result_error != nullptr)
+        *result_error = std::sqrt(worst_error);
+
+    return result;
+}
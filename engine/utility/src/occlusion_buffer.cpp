@@ -0,0 +1,314 @@
+#include "occlusion_buffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "thread_pool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_BUFFER_SSE2
+#endif
+
+namespace {
+    // a line through a and b, positive on the left side. for a triangle wound the right way round, every edge is positive on the inside
+    struct edge_function {
+        float a = 0.0f, b = 0.0f, c = 0.0f;
+
+        // whether pixel centers exactly on the edge are inside. triangles sharing an edge see it in opposite directions, so only one of them covers those pixels
+        bool inclusive = false;
+
+        edge_function(const float x0, const float y0, const float x1, const float y1) {
+            a = y0 - y1;
+            b = x1 - x0;
+            c = -(a * x0 + b * y0);
+
+            inclusive = a > 0.0f || (a == 0.0f && b > 0.0f);
+        }
+
+        [[nodiscard]] bool is_inside(const float value) const {
+            return inclusive ? value >= 0.0f : value > 0.0f;
+        }
+
+#ifdef OCCLUSION_BUFFER_SSE2
+        [[nodiscard]] __m128 is_inside(const __m128 value) const {
+            return inclusive ? _mm_cmpge_ps(value, _mm_setzero_ps()) : _mm_cmpgt_ps(value, _mm_setzero_ps());
+        }
+#endif
+    };
+
+    prism::float2 to_screen(const prism::float4& clip, const uint32_t width, const uint32_t height) {
+        const float inverse_w = 1.0f / clip.w;
+
+        return {(clip.x * inverse_w * 0.5f + 0.5f) * static_cast<float>(width),
+                (0.5f - clip.y * inverse_w * 0.5f) * static_cast<float>(height)};
+    }
+
+    // the first and last pixel whose center is between min and max, which can be empty
+    void get_pixel_range(const float min, const float max, const uint32_t size, int& first, int& last) {
+        first = static_cast<int>(std::ceil(std::clamp(min - 0.5f, -1.0f, static_cast<float>(size))));
+        last = static_cast<int>(std::floor(std::clamp(max - 0.5f, -1.0f, static_cast<float>(size))));
+
+        first = std::max(first, 0);
+        last = std::min(last, static_cast<int>(size) - 1);
+    }
+}
+
+void prism::occlusion_buffer::resize(const uint32_t width, const uint32_t height) {
+    tiles_x = std::max<uint32_t>((width + tile_size - 1) / tile_size, 1);
+    tiles_y = std::max<uint32_t>((height + tile_size - 1) / tile_size, 1);
+
+    this->width = tiles_x * tile_size;
+    this->height = tiles_y * tile_size;
+
+    blocks_x = this->width / block_size;
+    blocks_y = this->height / block_size;
+
+    depth.assign(this->width * this->height, 0.0f);
+    block_depth.assign(blocks_x * blocks_y, 0.0f);
+
+    tile_triangles.resize(get_tile_count());
+
+    clear();
+}
+
+void prism::occlusion_buffer::clear() {
+    triangles.clear();
+
+    for(auto& tile : tile_triangles)
+        tile.clear();
+}
+
+void prism::occlusion_buffer::add_occluder(const Matrix4x4& matrix, const std::vector<float3>& positions, const std::vector<uint32_t>& indices) {
+    transformed.resize(positions.size());
+    for(size_t i = 0; i < positions.size(); i++)
+        transformed[i] = matrix * float4(positions[i], 1.0f);
+
+    for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const float4& a = transformed[indices[i]];
+        const float4& b = transformed[indices[i + 1]];
+        const float4& c = transformed[indices[i + 2]];
+
+        // completely outside of one side of the screen
+        if((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+           (a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w))
+            continue;
+
+        if(a.w >= near_plane && b.w >= near_plane && c.w >= near_plane) {
+            add_triangle(a, b, c);
+            continue;
+        }
+
+        // clipping a triangle against a single plane leaves at most a quad
+        const float4 input[3] = {a, b, c};
+        float4 output[4];
+        int output_count = 0;
+
+        for(int j = 0; j < 3; j++) {
+            const float4& current = input[j];
+            const float4& next = input[(j + 1) % 3];
+
+            const float current_distance = current.w - near_plane;
+            const float next_distance = next.w - near_plane;
+
+            if(current_distance >= 0.0f)
+                output[output_count++] = current;
+
+            if((current_distance >= 0.0f) != (next_distance >= 0.0f))
+                output[output_count++] = current + (next - current) * (current_distance / (current_distance - next_distance));
+        }
+
+        for(int j = 1; j + 1 < output_count; j++)
+            add_triangle(output[0], output[j], output[j + 1]);
+    }
+}
+
+void prism::occlusion_buffer::add_triangle(const float4& a, const float4& b, const float4& c) {
+    screen_triangle triangle;
+
+    const float4* vertices[3] = {&a, &b, &c};
+    for(int i = 0; i < 3; i++) {
+        const auto screen = to_screen(*vertices[i], width, height);
+
+        triangle.x[i] = screen.x;
+        triangle.y[i] = screen.y;
+        triangle.inverse_w[i] = 1.0f / vertices[i]->w;
+    }
+
+    int first_x, last_x, first_y, last_y;
+    get_pixel_range(std::min({triangle.x[0], triangle.x[1], triangle.x[2]}), std::max({triangle.x[0], triangle.x[1], triangle.x[2]}), width, first_x, last_x);
+    get_pixel_range(std::min({triangle.y[0], triangle.y[1], triangle.y[2]}), std::max({triangle.y[0], triangle.y[1], triangle.y[2]}), height, first_y, last_y);
+
+    if(first_x > last_x || first_y > last_y)
+        return;
+
+    const auto index = static_cast<uint32_t>(triangles.size());
+    triangles.push_back(triangle);
+
+    for(int tile_y = first_y / static_cast<int>(tile_size); tile_y <= last_y / static_cast<int>(tile_size); tile_y++) {
+        for(int tile_x = first_x / static_cast<int>(tile_size); tile_x <= last_x / static_cast<int>(tile_size); tile_x++)
+            tile_triangles[tile_y * tiles_x + tile_x].push_back(index);
+    }
+}
+
+void prism::occlusion_buffer::rasterize_tile(const uint32_t tile) {
+    const uint32_t tile_x = (tile % tiles_x) * tile_size;
+    const uint32_t tile_y = (tile / tiles_x) * tile_size;
+
+    for(uint32_t y = tile_y; y < tile_y + tile_size; y++)
+        std::fill_n(depth.data() + y * width + tile_x, tile_size, 0.0f);
+
+    for(const auto index : tile_triangles[tile]) {
+        auto triangle = triangles[index];
+
+        float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+        if(area == 0.0f)
+            continue;
+
+        // occluders are drawn from both sides, so they're rewound to make the inside of every edge positive
+        if(area < 0.0f) {
+            std::swap(triangle.x[1], triangle.x[2]);
+            std::swap(triangle.y[1], triangle.y[2]);
+            std::swap(triangle.inverse_w[1], triangle.inverse_w[2]);
+            area = -area;
+        }
+
+        // each edge function is the barycentric weight of the vertex opposite to it, scaled by the area
+        const edge_function edge0(triangle.x[1], triangle.y[1], triangle.x[2], triangle.y[2]);
+        const edge_function edge1(triangle.x[2], triangle.y[2], triangle.x[0], triangle.y[0]);
+        const edge_function edge2(triangle.x[0], triangle.y[0], triangle.x[1], triangle.y[1]);
+
+        // 1/w is linear in screen space, so it's a plane too
+        const float depth_a = (edge0.a * triangle.inverse_w[0] + edge1.a * triangle.inverse_w[1] + edge2.a * triangle.inverse_w[2]) / area;
+        const float depth_b = (edge0.b * triangle.inverse_w[0] + edge1.b * triangle.inverse_w[1] + edge2.b * triangle.inverse_w[2]) / area;
+        const float depth_c = (edge0.c * triangle.inverse_w[0] + edge1.c * triangle.inverse_w[1] + edge2.c * triangle.inverse_w[2]) / area;
+
+        int first_x, last_x, first_y, last_y;
+        get_pixel_range(std::min({triangle.x[0], triangle.x[1], triangle.x[2]}), std::max({triangle.x[0], triangle.x[1], triangle.x[2]}), width, first_x, last_x);
+        get_pixel_range(std::min({triangle.y[0], triangle.y[1], triangle.y[2]}), std::max({triangle.y[0], triangle.y[1], triangle.y[2]}), height, first_y, last_y);
+
+        first_x = std::max(first_x, static_cast<int>(tile_x));
+        last_x = std::min(last_x, static_cast<int>(tile_x + tile_size) - 1);
+        first_y = std::max(first_y, static_cast<int>(tile_y));
+        last_y = std::min(last_y, static_cast<int>(tile_y + tile_size) - 1);
+
+        // pixels are processed 4 at a time, the tile is a multiple of 4 wide so they never leave it
+        first_x &= ~3;
+
+        for(int y = first_y; y <= last_y; y++) {
+            const float pixel_y = static_cast<float>(y) + 0.5f;
+            float* row = depth.data() + y * width;
+
+#ifdef OCCLUSION_BUFFER_SSE2
+            const __m128 lane_offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+
+            const __m128 edge0_row = _mm_set1_ps(edge0.b * pixel_y + edge0.c);
+            const __m128 edge1_row = _mm_set1_ps(edge1.b * pixel_y + edge1.c);
+            const __m128 edge2_row = _mm_set1_ps(edge2.b * pixel_y + edge2.c);
+            const __m128 depth_row = _mm_set1_ps(depth_b * pixel_y + depth_c);
+
+            for(int x = first_x; x <= last_x; x += 4) {
+                const __m128 pixel_x = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane_offsets);
+
+                const __m128 weight0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge0.a), pixel_x), edge0_row);
+                const __m128 weight1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge1.a), pixel_x), edge1_row);
+                const __m128 weight2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge2.a), pixel_x), edge2_row);
+
+                const __m128 inside = _mm_and_ps(_mm_and_ps(edge0.is_inside(weight0), edge1.is_inside(weight1)), edge2.is_inside(weight2));
+                if(_mm_movemask_ps(inside) == 0)
+                    continue;
+
+                const __m128 pixel_depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depth_a), pixel_x), depth_row);
+
+                const __m128 old_depth = _mm_loadu_ps(row + x);
+                const __m128 new_depth = _mm_max_ps(old_depth, pixel_depth);
+
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_depth), _mm_andnot_ps(inside, old_depth)));
+            }
+#else
+            for(int x = first_x; x <= last_x; x++) {
+                const float pixel_x = static_cast<float>(x) + 0.5f;
+
+                const float weight0 = edge0.a * pixel_x + edge0.b * pixel_y + edge0.c;
+                const float weight1 = edge1.a * pixel_x + edge1.b * pixel_y + edge1.c;
+                const float weight2 = edge2.a * pixel_x + edge2.b * pixel_y + edge2.c;
+
+                if(edge0.is_inside(weight0) && edge1.is_inside(weight1) && edge2.is_inside(weight2))
+                    row[x] = std::max(row[x], depth_a * pixel_x + depth_b * pixel_y + depth_c);
+            }
+#endif
+        }
+    }
+
+    // the furthest depth of each block, so bounds that are behind all of it don't have to look at its pixels
+    for(uint32_t block_y = tile_y / block_size; block_y < (tile_y + tile_size) / block_size; block_y++) {
+        for(uint32_t block_x = tile_x / block_size; block_x < (tile_x + tile_size) / block_size; block_x++) {
+            float furthest = INFINITY;
+            for(uint32_t y = block_y * block_size; y < (block_y + 1) * block_size; y++) {
+                const float* row = depth.data() + y * width + block_x * block_size;
+                furthest = std::min(furthest, *std::min_element(row, row + block_size));
+            }
+
+            block_depth[block_y * blocks_x + block_x] = furthest;
+        }
+    }
+}
+
+void prism::occlusion_buffer::rasterize(thread_pool& pool) {
+    pool.parallel_for(get_tile_count(), [this](const uint32_t tile) {
+        rasterize_tile(tile);
+    });
+}
+
+bool prism::occlusion_buffer::is_visible(const Matrix4x4& view_projection, const aabb& bounds) const {
+    float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    float closest = 0.0f;
+
+    for(const auto point : get_points(bounds)) {
+        const auto clip = view_projection * float4(point, 1.0f);
+
+        // anything crossing the camera plane can't be hidden by a depth buffer in front of it
+        if(clip.w < near_plane)
+            return true;
+
+        const auto screen = to_screen(clip, width, height);
+
+        min_x = std::min(min_x, screen.x);
+        min_y = std::min(min_y, screen.y);
+        max_x = std::max(max_x, screen.x);
+        max_y = std::max(max_y, screen.y);
+
+        closest = std::max(closest, 1.0f / clip.w);
+    }
+
+    // touching a pixel at all counts, not just its center
+    const int first_x = std::max(static_cast<int>(std::floor(std::clamp(min_x, -1.0f, static_cast<float>(width)))), 0);
+    const int last_x = std::min(static_cast<int>(std::floor(std::clamp(max_x, -1.0f, static_cast<float>(width)))), static_cast<int>(width) - 1);
+    const int first_y = std::max(static_cast<int>(std::floor(std::clamp(min_y, -1.0f, static_cast<float>(height)))), 0);
+    const int last_y = std::min(static_cast<int>(std::floor(std::clamp(max_y, -1.0f, static_cast<float>(height)))), static_cast<int>(height) - 1);
+
+    // off screen, which is for frustum culling to decide
+    if(first_x > last_x || first_y > last_y)
+        return true;
+
+    for(int block_y = first_y / static_cast<int>(block_size); block_y <= last_y / static_cast<int>(block_size); block_y++) {
+        for(int block_x = first_x / static_cast<int>(block_size); block_x <= last_x / static_cast<int>(block_size); block_x++) {
+            if(block_depth[block_y * blocks_x + block_x] > closest)
+                continue;
+
+            const int block_first_x = std::max(first_x, block_x * static_cast<int>(block_size));
+            const int block_last_x = std::min(last_x, (block_x + 1) * static_cast<int>(block_size) - 1);
+            const int block_first_y = std::max(first_y, block_y * static_cast<int>(block_size));
+            const int block_last_y = std::min(last_y, (block_y + 1) * static_cast<int>(block_size) - 1);
+
+            for(int y = block_first_y; y <= block_last_y; y++) {
+                for(int x = block_first_x; x <= block_last_x; x++) {
+                    if(depth[y * width + x] <= closest)
+                        return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
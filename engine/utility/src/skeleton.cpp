@@ -0,0 +1,67 @@
+#include "skeleton.hpp"
+
+#include <unordered_map>
+
+std::vector<uint32_t> prism::sort_bone_hierarchy(const std::vector<int>& parents) {
+    const auto count = static_cast<uint32_t>(parents.size());
+
+    std::vector<std::vector<uint32_t>> children(count);
+    std::vector<uint32_t> roots;
+    for(uint32_t i = 0; i < count; i++) {
+        const int parent = parents[i];
+        if(parent >= 0 && static_cast<uint32_t>(parent) < count && static_cast<uint32_t>(parent) != i) {
+            children[parent].push_back(i);
+        } else {
+            roots.push_back(i);
+        }
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(count);
+
+    std::vector<char> visited(count, false);
+
+    // breadth first, the order grows as it's walked
+    const auto visit_from = [&](const uint32_t root) {
+        const size_t start = order.size();
+
+        visited[root] = true;
+        order.push_back(root);
+
+        for(size_t i = start; i < order.size(); i++) {
+            for(const auto child : children[order[i]]) {
+                if(!visited[child]) {
+                    visited[child] = true;
+                    order.push_back(child);
+                }
+            }
+        }
+    };
+
+    for(const auto root : roots)
+        visit_from(root);
+
+    // anything left over is in a cycle, which can't be reached from a root
+    for(uint32_t i = 0; i < count; i++) {
+        if(!visited[i])
+            visit_from(i);
+    }
+
+    return order;
+}
+
+std::vector<int> prism::create_bone_remap(const std::vector<std::string>& bone_names, const std::vector<std::string>& target_names) {
+    std::unordered_map<std::string, int> target_indices;
+    for(size_t i = 0; i < target_names.size(); i++)
+        target_indices.try_emplace(target_names[i], static_cast<int>(i));
+
+    std::vector<int> remap;
+    remap.reserve(bone_names.size());
+
+    for(const auto& name : bone_names) {
+        const auto found = target_indices.find(name);
+        remap.push_back(found != target_indices.end() ? found->second : -1);
+    }
+
+    return remap;
+}
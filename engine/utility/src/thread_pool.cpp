@@ -0,0 +1,119 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+prism::thread_pool::thread_pool(uint32_t thread_count) {
+    // the calling thread is usually busy too, so it isn't given a worker of its own
+    if(thread_count == 0)
+        thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    
+    for(uint32_t i = 0; i < thread_count; i++)
+        workers.emplace_back(&thread_pool::worker_main, this);
+}
+
+prism::thread_pool::~thread_pool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    
+    job_available.notify_all();
+    
+    for(auto& worker : workers)
+        worker.join();
+}
+
+void prism::thread_pool::submit(std::function<void()> job) {
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    
+    job_available.notify_one();
+}
+
+void prism::thread_pool::wait() {
+    std::unique_lock lock(mutex);
+    jobs_finished.wait(lock, [this] {
+        return jobs.empty() && running_jobs == 0;
+    });
+}
+
+void prism::thread_pool::parallel_for(const uint32_t count, const std::function<void(uint32_t)>& function) {
+    if(count == 0)
+        return;
+    
+    // shared with the helper jobs, which can start after this function has already returned if the workers are busy
+    struct shared_state {
+        const std::function<void(uint32_t)>* function = nullptr;
+        uint32_t count = 0;
+        
+        std::atomic<uint32_t> next_index = 0, finished_count = 0;
+        
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    
+    auto state = std::make_shared<shared_state>();
+    state->function = &function;
+    state->count = count;
+    
+    // the function is only touched while there are unfinished indices, so it can't be used after it's gone out of scope
+    const auto run = [state] {
+        uint32_t index;
+        while((index = state->next_index++) < state->count) {
+            (*state->function)(index);
+            
+            if(++state->finished_count == state->count) {
+                std::lock_guard lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+    
+    const uint32_t helper_count = std::min(count - 1, get_thread_count());
+    for(uint32_t i = 0; i < helper_count; i++)
+        submit(run);
+    
+    // the calling thread helps too, so this makes progress even when every worker is busy
+    run();
+    
+    std::unique_lock lock(state->mutex);
+    state->finished.wait(lock, [&state] {
+        return state->finished_count == state->count;
+    });
+}
+
+uint32_t prism::thread_pool::get_thread_count() const {
+    return static_cast<uint32_t>(workers.size());
+}
+
+void prism::thread_pool::worker_main() {
+    while(true) {
+        std::function<void()> job;
+        
+        {
+            std::unique_lock lock(mutex);
+            job_available.wait(lock, [this] {
+                return stopping || !jobs.empty();
+            });
+            
+            // jobs left in the queue are still run when stopping, someone might be waiting on their results
+            if(jobs.empty())
+                return;
+            
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            running_jobs++;
+        }
+        
+        job();
+        
+        {
+            std::lock_guard lock(mutex);
+            running_jobs--;
+        }
+        
+        jobs_finished.notify_all();
+    }
+}
@@ -0,0 +1,180 @@
+#include "vertex_format.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    float sign_not_zero(const float value) {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    /// Quantizes an octahedral encoding into integers in [min_value, max_value].
+    /// Plain rounding isn't always the closest point on the sphere, so each neighbour is tried and the most accurate one kept.
+    std::array<int, 2> quantize_octahedral(const prism::float3 v, const int min_value, const int max_value) {
+        const float range = static_cast<float>(max_value - min_value);
+
+        const auto quantize = [min_value, range](const float x) {
+            return (x * 0.5f + 0.5f) * range + static_cast<float>(min_value);
+        };
+
+        const auto dequantize = [min_value, range](const int q) {
+            return static_cast<float>(q - min_value) / range * 2.0f - 1.0f;
+        };
+
+        const prism::float2 encoded = prism::encode_octahedral(v);
+        const float qx = quantize(encoded.x), qy = quantize(encoded.y);
+
+        std::array<int, 2> best = {};
+        float best_dot = -2.0f;
+        for(int i = 0; i < 4; i++) {
+            const int x = std::clamp(static_cast<int>(i & 1 ? std::ceil(qx) : std::floor(qx)), min_value, max_value);
+            const int y = std::clamp(static_cast<int>(i & 2 ? std::ceil(qy) : std::floor(qy)), min_value, max_value);
+
+            const float d = prism::dot(prism::decode_octahedral(prism::float2(dequantize(x), dequantize(y))), v);
+            if(d > best_dot) {
+                best = {x, y};
+                best_dot = d;
+            }
+        }
+
+        return best;
+    }
+
+    constexpr int tangent_bits = 10;
+    constexpr uint32_t tangent_mask = (1u << tangent_bits) - 1;
+    constexpr int tangent_sign_shift = 30;
+}
+
+prism::float2 prism::encode_octahedral(const float3 v) {
+    const float l1_norm = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+
+    // also catches NaN, which shows up in tangents of meshes with degenerate texture coordinates
+    if(!(l1_norm > 0.0f))
+        return float2(0.0f, 0.0f);
+
+    float2 p(v.x / l1_norm, v.y / l1_norm);
+
+    // fold the lower hemisphere over the diagonals
+    if(v.z < 0.0f) {
+        p = float2((1.0f - std::abs(p.y)) * sign_not_zero(p.x),
+                   (1.0f - std::abs(p.x)) * sign_not_zero(p.y));
+    }
+
+    return p;
+}
+
+prism::float3 prism::decode_octahedral(const float2 e) {
+    float3 v(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+
+    const float t = std::max(-v.z, 0.0f);
+    v.x += v.x >= 0.0f ? -t : t;
+    v.y += v.y >= 0.0f ? -t : t;
+
+    return normalize(v);
+}
+
+uint16_t prism::float_to_half(const float value) {
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(float));
+
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const uint32_t float_exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    // infinity and NaN
+    if(float_exponent == 0xFF)
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+
+    const int exponent = static_cast<int>(float_exponent) - 127 + 15;
+    if(exponent >= 31)
+        return static_cast<uint16_t>(sign | 0x7C00);
+
+    // too small for a normal half, so it becomes a subnormal (or zero)
+    if(exponent <= 0) {
+        if(exponent < -10)
+            return static_cast<uint16_t>(sign);
+
+        mantissa |= 0x800000;
+
+        const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half_mantissa = mantissa >> shift;
+
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if(remainder > halfway || (remainder == halfway && (half_mantissa & 1) != 0))
+            half_mantissa++;
+
+        return static_cast<uint16_t>(sign | half_mantissa);
+    }
+
+    uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+
+    // round to nearest even, a carry out of the mantissa correctly bumps the exponent
+    const uint32_t remainder = mantissa & 0x1FFF;
+    if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1) != 0))
+        half++;
+
+    return static_cast<uint16_t>(half);
+}
+
+float prism::half_to_float(const uint16_t value) {
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1F;
+    const uint32_t mantissa = value & 0x3FF;
+
+    if(exponent == 0) {
+        const float subnormal = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign != 0 ? -subnormal : subnormal;
+    }
+
+    uint32_t bits = 0;
+    if(exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float result = 0.0f;
+    memcpy(&result, &bits, sizeof(float));
+
+    return result;
+}
+
+prism::packed_vertex prism::pack_vertex(const float3 normal, const float2 texture_coord, const float3 tangent, const float3 bitangent) {
+    packed_vertex vertex;
+
+    const auto n = quantize_octahedral(normal, -32767, 32767);
+    vertex.normal = {static_cast<int16_t>(n[0]), static_cast<int16_t>(n[1])};
+
+    vertex.texture_coord = {float_to_half(texture_coord.x), float_to_half(texture_coord.y)};
+
+    const auto t = quantize_octahedral(tangent, 0, static_cast<int>(tangent_mask));
+    const bool right_handed = dot(cross(normal, tangent), bitangent) >= 0.0f;
+
+    vertex.tangent = static_cast<uint32_t>(t[0]) |
+                     (static_cast<uint32_t>(t[1]) << tangent_bits) |
+                     ((right_handed ? 3u : 0u) << tangent_sign_shift);
+
+    return vertex;
+}
+
+void prism::unpack_vertex(const packed_vertex& vertex, float3& normal, float2& texture_coord, float3& tangent, float3& bitangent) {
+    // matches how the gpu expands snorm and unorm vertex attributes
+    const auto snorm = [](const int16_t value) {
+        return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+    };
+
+    const auto unorm = [](const uint32_t value) {
+        return static_cast<float>(value & tangent_mask) / static_cast<float>(tangent_mask) * 2.0f - 1.0f;
+    };
+
+    normal = decode_octahedral(float2(snorm(vertex.normal[0]), snorm(vertex.normal[1])));
+
+    texture_coord = float2(half_to_float(vertex.texture_coord[0]), half_to_float(vertex.texture_coord[1]));
+
+    tangent = decode_octahedral(float2(unorm(vertex.tangent), unorm(vertex.tangent >> tangent_bits)));
+
+    const float sign = (vertex.tangent >> tangent_sign_shift) != 0 ? 1.0f : -1.0f;
+    bitangent = cross(normal, tangent) * sign;
+}
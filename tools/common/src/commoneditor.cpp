@@ -22,6 +22,7 @@
 #include "console.hpp"
 #include "input.hpp"
 #include "scenecapture.hpp"
+#include "texture_format.hpp"
 
 const std::map<ImGuiKey, InputButton> imToPl = {
     {ImGuiKey_Tab, InputButton::Tab},
@@ -426,6 +427,9 @@ void CommonEditor::editRenderable(Renderable& mesh) {
     
     if(ImGui::Button("Add material"))
         mesh.materials.push_back({});
+    
+    ImGui::ComboEnum("Occluder", &mesh.occluder);
+    ImGui::ComboEnum("Mobility", &mesh.mobility);
 }
 
 void editLight(Light& light) {
@@ -711,7 +715,11 @@ void CommonEditor::drawViewport(Scene* scene) {
     viewport_x = mouse_pos.x - real_pos.x;
     viewport_y = mouse_pos.y - real_pos.y;
     
-    ImGui::Image((ImTextureID)target->target->offscreenColorTexture, size);
+    // the color texture comes from the render graph, so it doesn't exist until the target is rendered once
+    if(target->target->offscreenColorTexture != nullptr)
+        ImGui::Image((ImTextureID)target->target->offscreenColorTexture, size);
+    else
+        ImGui::Dummy(size);
     
     accepting_viewport_input = ImGui::IsWindowHovered();
     
@@ -733,7 +741,7 @@ bool mesh_readable(const prism::path path) {
     int version = 0;
     file->read(&version);
     
-    return version == 5 || version == 6;
+    return version >= 5 && version <= 9;
 }
 
 bool material_readable(const prism::path path) {
@@ -749,6 +757,19 @@ bool material_readable(const prism::path path) {
     return j.count("version") && j["version"] == 2;
 }
 
+bool texture_readable(const prism::path path) {
+    auto file = prism::open_file(path, true);
+    if(!file.has_value()) {
+        prism::log::error(System::Renderer, "Failed to load texture from {}!", path);
+        return false;
+    }
+
+    prism::texture_header header;
+    file->read(&header);
+
+    return prism::is_valid_texture_header(header);
+}
+
 void cacheAssetFilesystem() {
     asset_files.clear();
     
@@ -760,6 +781,8 @@ void cacheAssetFilesystem() {
             asset_files[std::filesystem::relative(p, data_directory)] = AssetType::Material;
         } else if(p.path().extension() == ".png") {
             asset_files[std::filesystem::relative(p, data_directory)] = AssetType::Texture;
+        } else if(p.path().extension() == ".texture" && texture_readable(p.path())) {
+            asset_files[std::filesystem::relative(p, data_directory)] = AssetType::Texture;
         }
     }
     
@@ -975,7 +998,8 @@ GFXTexture* CommonEditor::generate_common_preview(Scene& scene, const prism::flo
     
     GFXCommandBuffer* command_buffer = gfx->acquire_command_buffer();
     
-    renderer->shadow_pass->render(command_buffer, scene);
+    // the thumbnail's scene isn't animated, so skinned meshes use their own matrices
+    renderer->shadow_pass->render(command_buffer, scene, target->shadow_instances[target->current_frame], nullptr);
 
     if(render_options.enable_ibl)
         renderer->scene_capture->render(command_buffer, &scene);
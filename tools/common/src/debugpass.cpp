@@ -234,7 +234,7 @@ void DebugPass::draw_arrow(GFXCommandBuffer* commandBuffer, prism::float3 color,
     commandBuffer->set_push_constant(&pc, sizeof(PushConstant));
     
     commandBuffer->set_vertex_buffer(arrowMesh->position_buffer, 0, 0);
-    commandBuffer->set_index_buffer(arrowMesh->index_buffer, IndexType::UINT32);
+    commandBuffer->set_index_buffer(arrowMesh->index_buffer, arrowMesh->index_type);
     
     commandBuffer->draw_indexed(arrowMesh->num_indices, 0, 0, 0);
 }
@@ -343,7 +343,7 @@ void DebugPass::render_scene(Scene& scene, GFXCommandBuffer* commandBuffer) {
         commandBuffer->set_push_constant(&pc, sizeof(PushConstant));
 
         commandBuffer->set_vertex_buffer(cubeMesh->position_buffer, 0, 0);
-        commandBuffer->set_index_buffer(cubeMesh->index_buffer, IndexType::UINT32);
+        commandBuffer->set_index_buffer(cubeMesh->index_buffer, cubeMesh->index_type);
 
         commandBuffer->draw_indexed(cubeMesh->num_indices, 0, 0, 0);
     }
@@ -416,7 +416,7 @@ void DebugPass::render_scene(Scene& scene, GFXCommandBuffer* commandBuffer) {
         commandBuffer->set_push_constant(&pc, sizeof(PC));
         
         commandBuffer->set_vertex_buffer(renderable.mesh->position_buffer, 0, 0);
-        commandBuffer->set_index_buffer(renderable.mesh->index_buffer, IndexType::UINT32);
+        commandBuffer->set_index_buffer(renderable.mesh->index_buffer, renderable.mesh->index_type);
         
         if(renderable.mesh) {
             for (auto& part : renderable.mesh->parts)
@@ -532,7 +532,7 @@ void DebugPass::get_selected_object(int x, int y, std::function<void(SelectableO
         }
 
         commandBuffer->set_vertex_buffer(mesh->position_buffer, 0, 0);
-        commandBuffer->set_index_buffer(mesh->index_buffer, IndexType::UINT32);
+        commandBuffer->set_index_buffer(mesh->index_buffer, mesh->index_type);
 
         struct PC {
             Matrix4x4 mvp;
@@ -308,7 +308,9 @@ void CutsceneEditor::drawUI() {
                 ImGui::SetNextItemWidth(50.0f);
                                 
                 const char* preview_value = "None";
-                if(currentChannel->target != NullObject && currentShot->scene->has<Data>(currentChannel->target))
+                if(currentChannel->bone != nullptr)
+                    preview_value = currentChannel->bone->name.c_str();
+                else if(currentChannel->target != NullObject && currentShot->scene->has<Data>(currentChannel->target))
                     preview_value = currentShot->scene->get(currentChannel->target).name.c_str();
                 
                 if(ImGui::BeginCombo("Target", preview_value)) {
@@ -324,7 +326,7 @@ void CutsceneEditor::drawUI() {
                             for(auto& bone : currentShot->scene->get<Renderable>(object).mesh->bones) {
                                 if(ImGui::Selectable(bone.name.c_str())) {
                                     currentChannel->bone = &bone;
-                                    currentChannel->target = NullObject;
+                                    currentChannel->target = object; // the bone is shared by every instance of the mesh, this is the one that's animated
                                 }
                             }
                             
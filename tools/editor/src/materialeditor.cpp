@@ -149,6 +149,12 @@ void MaterialEditor::draw(CommonEditor* editor) {
                 });
             }
             
+            if (ImGui::MenuItem("Export as JSON...")) {
+                platform::save_dialog([this](std::string path) {
+                    save_material(*material, path, true);
+                });
+            }
+            
             ImGui::Separator();
             
             if(ImGui::MenuItem("Close"))
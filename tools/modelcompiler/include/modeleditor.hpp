@@ -13,6 +13,13 @@ public:
         bool compile_static = false;
         bool export_animations = true;
         bool export_materials = true;
+        
+        int lod_count = 3; // simplified levels generated for each part, not counting the full detail one
+        float lod_reduction = 0.5f; // each level aims for this fraction of the previous level's triangles
+        float lod_max_error = 0.02f; // how far a level may move from the original surface, relative to the size of the part
+        
+        float animation_position_tolerance = 0.001f; // how far reduced animation keys may move positions and scales, in model units
+        float animation_rotation_tolerance = 0.0005f; // in radians
     } flags;
     
     std::string data_path, model_path;
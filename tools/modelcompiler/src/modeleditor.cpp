@@ -10,6 +10,9 @@
 #include <assimp/scene.h>
 #include <unordered_map>
 #include <functional>
+#include <algorithm>
+#include <limits>
+#include <cmath>
 
 #include "engine.hpp"
 #include "imguipass.hpp"
@@ -17,6 +20,10 @@
 #include "json_conversions.hpp"
 #include "platform.hpp"
 #include "utility.hpp"
+#include "vertex_format.hpp"
+#include "mesh_optimizer.hpp"
+#include "animation_format.hpp"
+#include "log.hpp"
 
 void app_main(Engine* engine) {
     ModelEditor* editor = (ModelEditor*)engine->get_app();
@@ -38,6 +45,15 @@ void app_main(Engine* engine) {
 
             if(argument == "--compile-static")
                 editor->flags.compile_static = true;
+
+            if(argument == "--lod-count")
+                editor->flags.lod_count = std::stoi(engine->command_line_arguments[i + 1]);
+
+            if(argument == "--lod-reduction")
+                editor->flags.lod_reduction = std::stof(engine->command_line_arguments[i + 1]);
+
+            if(argument == "--lod-max-error")
+                editor->flags.lod_max_error = std::stof(engine->command_line_arguments[i + 1]);
         }
 
         editor->compile_model();
@@ -171,7 +187,6 @@ void ModelEditor::compile_model() {
 
     unsigned int importer_flags =
         aiProcess_Triangulate |
-        aiProcess_ImproveCacheLocality |
         aiProcess_JoinIdenticalVertices |
         aiProcess_OptimizeMeshes |
         aiProcess_CalcTangentSpace;
@@ -195,7 +210,7 @@ void ModelEditor::compile_model() {
 
     FILE* file = fopen((data_path + "/models/" + name + ".model").c_str(), "wb");
 
-    int version = 6;
+    int version = 9;
     fwrite(&version, sizeof(int), 1, file);
     
     std::vector<std::string> meshToMaterial;
@@ -227,6 +242,15 @@ void ModelEditor::compile_model() {
     std::vector<uint32_t> indices;
     
     std::vector<BoneWeight> bone_weights;
+    
+    struct PartLOD {
+        std::vector<uint32_t> indices;
+        uint32_t index_offset = 0;
+        float error = 0.0f;
+    };
+    
+    std::vector<std::vector<PartLOD>> part_lods(sc->mNumMeshes);
+    std::vector<std::vector<prism::meshlet>> part_meshlets(sc->mNumMeshes);
 
     aiMesh* armature_mesh = nullptr;
 
@@ -238,7 +262,92 @@ void ModelEditor::compile_model() {
             armature_mesh = mesh;
         }
         
-        for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
+        std::vector<uint32_t> mesh_indices;
+        for (unsigned int e = 0; e < mesh->mNumFaces; e++) {
+            const aiFace& face = mesh->mFaces[e];
+            
+            mesh_indices.push_back(face.mIndices[0]);
+            mesh_indices.push_back(face.mIndices[1]);
+            mesh_indices.push_back(face.mIndices[2]);
+        }
+        
+        std::vector<prism::float3> mesh_positions;
+        for (unsigned int v = 0; v < mesh->mNumVertices; v++)
+            mesh_positions.emplace_back(mesh->mVertices[v].x, mesh->mVertices[v].y, mesh->mVertices[v].z);
+        
+        const auto cache_before = prism::analyze_vertex_cache(mesh_indices, mesh->mNumVertices);
+        const auto fetch_before = prism::analyze_vertex_fetch(mesh_indices, mesh->mNumVertices, sizeof(prism::packed_vertex));
+        
+        // reorder triangles for the post-transform cache and overdraw, then vertices in the order they're first used
+        // building meshlets reorders the triangles again, so overdraw is optimized by moving whole meshlets around afterwards
+        // meshlets only cover the full detail part, the other levels are small enough to cull as a whole
+        mesh_indices = prism::optimize_vertex_cache(mesh_indices, mesh->mNumVertices);
+        part_meshlets[i] = prism::build_meshlets(mesh_indices, mesh_positions);
+        prism::optimize_meshlet_overdraw(mesh_indices, part_meshlets[i], mesh_positions);
+        
+        for(auto& meshlet : part_meshlets[i])
+            meshlet.index_offset += static_cast<uint32_t>(indices.size());
+        
+        const auto remap = prism::optimize_vertex_fetch_remap(mesh_indices, mesh->mNumVertices);
+        mesh_indices = prism::remap_indices(mesh_indices, remap);
+        
+        const auto cache_after = prism::analyze_vertex_cache(mesh_indices, mesh->mNumVertices);
+        const auto fetch_after = prism::analyze_vertex_fetch(mesh_indices, mesh->mNumVertices, sizeof(prism::packed_vertex));
+        
+        prism::log::info(System::Core, "{}: {} meshlets", std::string(mesh->mName.C_Str()), std::to_string(part_meshlets[i].size()));
+        prism::log::info(System::Core, "{}: ACMR {} -> {}, ATVR {} -> {}, overfetch {} -> {}",
+                         std::string(mesh->mName.C_Str()),
+                         std::to_string(cache_before.acmr), std::to_string(cache_after.acmr),
+                         std::to_string(cache_before.atvr), std::to_string(cache_after.atvr),
+                         std::to_string(fetch_before.overfetch), std::to_string(fetch_after.overfetch));
+        
+        // every level of detail shares the vertices of the full detail part, and is simplified from it directly so the errors don't add up
+        const auto lod_positions = prism::remap_vertices(mesh_positions, remap);
+        
+        float part_size = 0.0f;
+        if(!lod_positions.empty()) {
+            prism::float3 min_position = lod_positions[0], max_position = lod_positions[0];
+            for(const auto& position : lod_positions) {
+                for(int j = 0; j < 3; j++) {
+                    min_position[j] = std::min(min_position[j], position[j]);
+                    max_position[j] = std::max(max_position[j], position[j]);
+                }
+            }
+            
+            part_size = std::max({max_position.x - min_position.x, max_position.y - min_position.y, max_position.z - min_position.z});
+        }
+        
+        size_t previous_index_count = mesh_indices.size();
+        for(int l = 1; l <= flags.lod_count; l++) {
+            const auto target_index_count = static_cast<size_t>(mesh_indices.size() * std::pow(flags.lod_reduction, l)) / 3 * 3;
+            
+            float lod_error = 0.0f;
+            auto lod_indices = prism::simplify(mesh_indices, lod_positions, target_index_count, flags.lod_max_error, &lod_error);
+            
+            // the error threshold (or locked borders and seams) stopped it from removing much, so a level this close isn't worth keeping
+            if(lod_indices.empty() || lod_indices.size() > previous_index_count * 9 / 10)
+                break;
+            
+            lod_indices = prism::optimize_vertex_cache(lod_indices, mesh->mNumVertices);
+            
+            prism::log::info(System::Core, "{}: LOD {} has {} triangles, error {}",
+                             std::string(mesh->mName.C_Str()), std::to_string(l),
+                             std::to_string(lod_indices.size() / 3), std::to_string(lod_error * part_size));
+            
+            previous_index_count = lod_indices.size();
+            
+            PartLOD lod;
+            lod.indices = std::move(lod_indices);
+            lod.error = lod_error * part_size;
+            
+            part_lods[i].push_back(std::move(lod));
+        }
+        
+        std::vector<unsigned int> original_vertex(mesh->mNumVertices);
+        for (unsigned int v = 0; v < mesh->mNumVertices; v++)
+            original_vertex[remap[v]] = v;
+        
+        for (const auto v : original_vertex) {
             positions.push_back(mesh->mVertices[v]);
             normals.push_back(mesh->mNormals[v]);
             
@@ -252,19 +361,13 @@ void ModelEditor::compile_model() {
             bitangents.push_back(mesh->mBitangents[v]);
         }
         
-        for (unsigned int e = 0; e < mesh->mNumFaces; e++) {
-            const aiFace& face = mesh->mFaces[e];
-            
-            indices.push_back(face.mIndices[0]);
-            indices.push_back(face.mIndices[1]);
-            indices.push_back(face.mIndices[2]);
-        }
+        indices.insert(indices.end(), mesh_indices.begin(), mesh_indices.end());
         
         for(unsigned int b = 0; b < mesh->mNumBones; b++) {
             for(int y = 0; y < mesh->mBones[b]->mNumWeights; y++) {
                 BoneWeight bw;
                 bw.bone_index = b;
-                bw.vertex_index = vertex_offset + mesh->mBones[b]->mWeights[y].mVertexId;
+                bw.vertex_index = vertex_offset + remap[mesh->mBones[b]->mWeights[y].mVertexId];
                 bw.weight = mesh->mBones[b]->mWeights[y].mWeight;
                 
                 bone_weights.push_back(bw);
@@ -280,6 +383,14 @@ void ModelEditor::compile_model() {
         vertex_offset += mesh->mNumVertices;
     }
     
+    // lod indices go after every part's full detail indices, so those stay contiguous
+    for(auto& lods : part_lods) {
+        for(auto& lod : lods) {
+            lod.index_offset = static_cast<uint32_t>(indices.size());
+            indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+        }
+    }
+    
     if(mesh_type == MeshType::Skinned) {
         bone_vertex_data.resize(positions.size());
         
@@ -299,10 +410,21 @@ void ModelEditor::compile_model() {
     };
     
     write_buffer(positions, sizeof(aiVector3D));
-    write_buffer(normals, sizeof(aiVector3D));
-    write_buffer(texture_coords, sizeof(aiVector2D));
-    write_buffer(tangents, sizeof(aiVector3D));
-    write_buffer(bitangents, sizeof(aiVector3D));
+    
+    const auto to_float3 = [](const aiVector3D& v) {
+        return prism::float3(v.x, v.y, v.z);
+    };
+    
+    // everything besides the position is interleaved and quantized
+    std::vector<prism::packed_vertex> packed_vertices(positions.size());
+    for(unsigned int i = 0; i < positions.size(); i++) {
+        packed_vertices[i] = prism::pack_vertex(to_float3(normals[i]),
+                                                prism::float2(texture_coords[i].x, texture_coords[i].y),
+                                                to_float3(tangents[i]),
+                                                to_float3(bitangents[i]));
+    }
+    
+    write_buffer(packed_vertices, sizeof(prism::packed_vertex));
 
     if(mesh_type == MeshType::Skinned)
         write_buffer(bone_vertex_data, sizeof(BoneVertexData));
@@ -310,7 +432,19 @@ void ModelEditor::compile_model() {
     int element_len = indices.size();
     fwrite(&element_len, sizeof(int), 1, file);
     
-    fwrite(indices.data(), sizeof(uint32_t) * indices.size(), 1, file);
+    // indices are relative to each mesh, so they usually fit in 16 bits
+    const bool use_short_indices = *std::max_element(indices.begin(), indices.end()) <= std::numeric_limits<uint16_t>::max();
+    
+    int index_size = use_short_indices ? sizeof(uint16_t) : sizeof(uint32_t);
+    fwrite(&index_size, sizeof(int), 1, file);
+    
+    if(use_short_indices) {
+        std::vector<uint16_t> short_indices(indices.begin(), indices.end());
+        
+        fwrite(short_indices.data(), sizeof(uint16_t) * short_indices.size(), 1, file);
+    } else {
+        fwrite(indices.data(), sizeof(uint32_t) * indices.size(), 1, file);
+    }
     
     int bone_len = 0;
     if(armature_mesh != nullptr) {
@@ -396,6 +530,21 @@ void ModelEditor::compile_model() {
 
         int material_override = matNameToIndex[meshToMaterial[i]];
         fwrite(&material_override, sizeof(int), 1, file);
+        
+        int numLods = part_lods[i].size();
+        fwrite(&numLods, sizeof(int), 1, file);
+        
+        for(const auto& lod : part_lods[i]) {
+            const auto index_count = static_cast<uint32_t>(lod.indices.size());
+            
+            fwrite(&lod.index_offset, sizeof(uint32_t), 1, file);
+            fwrite(&index_count, sizeof(uint32_t), 1, file);
+            fwrite(&lod.error, sizeof(float), 1, file);
+        }
+        
+        int numMeshlets = part_meshlets[i].size();
+        fwrite(&numMeshlets, sizeof(int), 1, file);
+        fwrite(part_meshlets[i].data(), sizeof(prism::meshlet) * numMeshlets, 1, file);
     }
 
     fclose(file);
@@ -437,49 +586,56 @@ void ModelEditor::compile_model() {
 
             std::replace(finalName.begin(), finalName.end(), '|', '_');
 
-            FILE* file = fopen((data_path + "/animations/" + finalName).c_str(), "wb");
-
-            fwrite(&animation->mDuration, sizeof(double), 1, file);
-            fwrite(&animation->mTicksPerSecond, sizeof(double), 1, file);
-
-            fwrite(&animation->mNumChannels, sizeof(unsigned int), 1, file);
+            prism::animation_clip clip;
+            clip.duration = animation->mDuration;
+            clip.ticks_per_second = animation->mTicksPerSecond;
 
             for(auto j = 0; j < animation->mNumChannels; j++) {
                 const aiNodeAnim* channel = animation->mChannels[j];
 
-                write_string(file, channel->mNodeName);
-
-                fwrite(&channel->mNumPositionKeys, sizeof(unsigned int), 1, file);
+                prism::animation_clip::channel clip_channel;
+                clip_channel.name = channel->mNodeName.C_Str();
 
                 for(auto k = 0; k < channel->mNumPositionKeys; k++) {
-                    PositionKeyFrame key;
-                    key.value = Vector3(channel->mPositionKeys[k].mValue.x, channel->mPositionKeys[k].mValue.y, channel->mPositionKeys[k].mValue.z);
-                    key.time = channel->mPositionKeys[k].mTime;
-
-                    fwrite(&key, sizeof(PositionKeyFrame), 1, file);
+                    const auto& key = channel->mPositionKeys[k];
+                    clip_channel.positions.push_back({static_cast<float>(key.mTime), Vector3(key.mValue.x, key.mValue.y, key.mValue.z)});
                 }
 
-                fwrite(&channel->mNumRotationKeys, sizeof(unsigned int), 1, file);
-
                 for(auto k = 0; k < channel->mNumRotationKeys; k++) {
-                    RotationKeyFrame key;
-                    key.value = Quaternion(channel->mRotationKeys[k].mValue.x, channel->mRotationKeys[k].mValue.y, channel->mRotationKeys[k].mValue.z, channel->mRotationKeys[k].mValue.w);
-                    key.time = channel->mRotationKeys[k].mTime;
-
-                    fwrite(&key, sizeof(RotationKeyFrame), 1, file);
+                    const auto& key = channel->mRotationKeys[k];
+                    clip_channel.rotations.push_back({static_cast<float>(key.mTime), Quaternion(key.mValue.x, key.mValue.y, key.mValue.z, key.mValue.w)});
                 }
 
-                fwrite(&channel->mNumScalingKeys, sizeof(unsigned int), 1, file);
-
                 for(auto k = 0; k < channel->mNumScalingKeys; k++) {
-                    ScaleKeyFrame key;
-                    key.value = Vector3(channel->mScalingKeys[k].mValue.x, channel->mScalingKeys[k].mValue.y, channel->mScalingKeys[k].mValue.z);
-                    key.time = channel->mScalingKeys[k].mTime;
-
-                    fwrite(&key, sizeof(ScaleKeyFrame), 1, file);
+                    const auto& key = channel->mScalingKeys[k];
+                    clip_channel.scales.push_back({static_cast<float>(key.mTime), Vector3(key.mValue.x, key.mValue.y, key.mValue.z)});
                 }
+
+                clip.channels.push_back(std::move(clip_channel));
             }
 
+            prism::animation_tolerance tolerance;
+            tolerance.position = flags.animation_position_tolerance;
+            tolerance.rotation = flags.animation_rotation_tolerance;
+            tolerance.scale = flags.animation_position_tolerance;
+
+            const auto compressed = prism::compress_animation(clip, tolerance);
+
+            size_t original_keys = 0, compressed_keys = 0;
+            for(const auto& channel : clip.channels)
+                original_keys += channel.positions.size() + channel.rotations.size() + channel.scales.size();
+
+            for(const auto& channel : compressed.channels)
+                compressed_keys += channel.positions.size() + channel.rotations.size() + channel.scales.size();
+
+            prism::log::info(System::Core, "Reduced animation {} from {} to {} keys", finalName, std::to_string(original_keys), std::to_string(compressed_keys));
+
+            const auto data = prism::write_animation_file(compressed);
+
+            FILE* file = fopen((data_path + "/animations/" + finalName).c_str(), "wb");
+
+            fwrite(data.data(), data.size(), 1, file);
+
             fclose(file);
         }
     }
@@ -506,6 +662,13 @@ void ModelEditor::drawUI() {
     ImGui::Checkbox("Compile as static (remove transforms)", &flags.compile_static);
     ImGui::Checkbox("Export materials", &flags.export_materials);
     ImGui::Checkbox("Export animations", &flags.export_animations);
+    
+    ImGui::InputInt("LOD count", &flags.lod_count);
+    ImGui::SliderFloat("LOD reduction", &flags.lod_reduction, 0.1f, 0.9f);
+    ImGui::SliderFloat("LOD max error", &flags.lod_max_error, 0.001f, 0.1f);
+    
+    ImGui::InputFloat("Animation position tolerance", &flags.animation_position_tolerance, 0.0f, 0.0f, "%.5f");
+    ImGui::InputFloat("Animation rotation tolerance", &flags.animation_rotation_tolerance, 0.0f, 0.0f, "%.5f");
 
     if(!model_path.empty() && !data_path.empty()) {
         ImGui::Text("%s will be compiled for data path %s", model_path.c_str(), data_path.c_str());
@@ -0,0 +1,203 @@
+#include <cstdio>
+
+#include <string_view>
+#include <array>
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+#include <stb_image.h>
+
+#include "texture_format.hpp"
+#include "block_compression.hpp"
+
+constexpr int channels = 4;
+
+struct mip_level {
+    uint32_t width = 0, height = 0;
+    std::vector<unsigned char> data;
+};
+
+// simple 2x2 box filter, edges are clamped so odd-sized levels still sample inside the image
+mip_level downsample(const mip_level& src) {
+    mip_level dst;
+    dst.width = std::max(src.width / 2, 1u);
+    dst.height = std::max(src.height / 2, 1u);
+    dst.data.resize(dst.width * dst.height * channels);
+
+    const auto sample = [&src](uint32_t x, uint32_t y, int c) -> unsigned int {
+        x = std::min(x, src.width - 1);
+        y = std::min(y, src.height - 1);
+
+        return src.data[(y * src.width + x) * channels + c];
+    };
+
+    for(uint32_t y = 0; y < dst.height; y++) {
+        for(uint32_t x = 0; x < dst.width; x++) {
+            for(int c = 0; c < channels; c++) {
+                const unsigned int sum = sample(x * 2, y * 2, c) +
+                                         sample(x * 2 + 1, y * 2, c) +
+                                         sample(x * 2, y * 2 + 1, c) +
+                                         sample(x * 2 + 1, y * 2 + 1, c);
+
+                dst.data[(y * dst.width + x) * channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+            }
+        }
+    }
+
+    return dst;
+}
+
+enum class texture_usage {
+    albedo,
+    normal,
+    mask,
+    uncompressed
+};
+
+struct usage_info {
+    std::string_view name;
+    texture_usage usage;
+    prism::texture_format format;
+};
+
+// normal maps only need two channels since z is reconstructed in the shader, masks only need one
+constexpr std::array usages = {
+    usage_info{"albedo", texture_usage::albedo, prism::texture_format::bc7},
+    usage_info{"normal", texture_usage::normal, prism::texture_format::bc5},
+    usage_info{"mask", texture_usage::mask, prism::texture_format::bc4},
+    usage_info{"uncompressed", texture_usage::uncompressed, prism::texture_format::rgba8}
+};
+
+struct format_info {
+    std::string_view name;
+    prism::texture_format format;
+};
+
+constexpr std::array formats = {
+    format_info{"rgba8", prism::texture_format::rgba8},
+    format_info{"bc1", prism::texture_format::bc1},
+    format_info{"bc3", prism::texture_format::bc3},
+    format_info{"bc4", prism::texture_format::bc4},
+    format_info{"bc5", prism::texture_format::bc5},
+    format_info{"bc7", prism::texture_format::bc7}
+};
+
+// box filtering shortens normals, so they are pushed back onto the unit sphere after every downsample
+void renormalize(mip_level& level) {
+    for(uint32_t i = 0; i < level.width * level.height; i++) {
+        unsigned char* pixel = level.data.data() + i * channels;
+
+        float n[3];
+        for(int c = 0; c < 3; c++)
+            n[c] = pixel[c] / 255.0f * 2.0f - 1.0f;
+
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if(length <= 0.0f)
+            continue;
+
+        for(int c = 0; c < 3; c++)
+            pixel[c] = static_cast<unsigned char>(std::lround((n[c] / length * 0.5f + 0.5f) * 255.0f));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if(argc != 3 && argc != 4) {
+        std::cout << "Usage: TextureCompiler [input image] [output texture] [usage or format]" << std::endl;
+        std::cout << "Usages: albedo (default, bc7), normal (bc5), mask (bc4), uncompressed (rgba8)" << std::endl;
+        std::cout << "Formats: rgba8, bc1, bc3, bc4, bc5, bc7" << std::endl;
+        return 0;
+    }
+
+    texture_usage usage = texture_usage::albedo;
+    prism::texture_format format = prism::texture_format::bc7;
+
+    if(argc == 4) {
+        const std::string_view requested = argv[3];
+
+        bool found = false;
+        for(const auto& info : usages) {
+            if(info.name == requested) {
+                usage = info.usage;
+                format = info.format;
+                found = true;
+            }
+        }
+
+        for(const auto& info : formats) {
+            if(info.name == requested) {
+                format = info.format;
+                found = true;
+            }
+        }
+
+        if(!found) {
+            std::cerr << "Unknown usage or format " << requested << std::endl;
+            return -1;
+        }
+    }
+
+    int width, height, source_channels;
+    unsigned char* pixels = stbi_load(argv[1], &width, &height, &source_channels, channels);
+    if(!pixels) {
+        std::cerr << "Unable to load image " << argv[1] << std::endl;
+        return -1;
+    }
+
+    prism::texture_header header;
+    header.format = format;
+    header.width = width;
+    header.height = height;
+    header.mip_count = prism::calculate_mip_count(width, height);
+
+    std::vector<mip_level> levels(header.mip_count);
+    levels[0].width = width;
+    levels[0].height = height;
+    levels[0].data.assign(pixels, pixels + width * height * channels);
+
+    stbi_image_free(pixels);
+
+    for(uint32_t i = 1; i < header.mip_count; i++) {
+        levels[i] = downsample(levels[i - 1]);
+
+        if(usage == texture_usage::normal)
+            renormalize(levels[i]);
+    }
+
+    if(prism::is_block_compressed(format)) {
+        for(auto& level : levels) {
+            std::vector<unsigned char> blocks(prism::calculate_level_size(format, level.width, level.height));
+            prism::compress_blocks(format, level.data.data(), level.width, level.height, blocks.data());
+
+            level.data = std::move(blocks);
+        }
+    }
+
+    std::vector<prism::texture_level> level_table(header.mip_count);
+
+    uint64_t offset = sizeof(prism::texture_header) + sizeof(prism::texture_level) * header.mip_count;
+    for(uint32_t i = 0; i < header.mip_count; i++) {
+        level_table[i].offset = offset;
+        level_table[i].size = levels[i].data.size();
+
+        offset += level_table[i].size;
+    }
+
+    FILE* file = fopen(argv[2], "wb");
+    if(!file) {
+        std::cerr << "Unable to open " << argv[2] << " for writing" << std::endl;
+        return -1;
+    }
+
+    fwrite(&header, sizeof(prism::texture_header), 1, file);
+    fwrite(level_table.data(), sizeof(prism::texture_level), level_table.size(), file);
+
+    for(auto& level : levels)
+        fwrite(level.data.data(), level.data.size(), 1, file);
+
+    fclose(file);
+
+    std::cout << "Wrote " << width << "x" << height << " texture with " << header.mip_count << " mips (" << offset << " bytes) to " << argv[2] << std::endl;
+
+    return 0;
+}